@@ -0,0 +1,99 @@
+#pragma once
+
+#include <istream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "storage_view.h"
+#include "vocabulary.h"
+
+namespace ctranslate2 {
+
+  // Backoff n-gram language model loaded from an ARPA file. The scores are returned as
+  // natural log probabilities.
+  class NGramLanguageModel {
+  public:
+    static std::shared_ptr<const NGramLanguageModel> from_arpa_file(const std::string& path);
+
+    NGramLanguageModel(std::istream& in);
+
+    size_t order() const {
+      return _order;
+    }
+
+    size_t num_words() const {
+      return _words.size();
+    }
+
+    // Returns the id of the word, or the id of <unk> (or num_words() if the model has no
+    // <unk> entry) for unknown words.
+    size_t to_id(const std::string& word) const;
+
+    size_t bos_id() const {
+      return _bos_id;
+    }
+    size_t eos_id() const {
+      return _eos_id;
+    }
+
+    // Log probability of the word given the context. Only the last order() - 1 ids of the
+    // context are used.
+    float score(const size_t* context, size_t context_length, size_t word) const;
+
+  private:
+    struct NGramHash {
+      size_t operator()(const std::vector<size_t>& ngram) const;
+    };
+
+    struct NGramEntry {
+      float log_prob = 0;
+      float backoff = 0;
+    };
+
+    size_t _order = 0;
+    std::unordered_map<std::string, size_t> _words;
+    std::unordered_map<std::vector<size_t>, NGramEntry, NGramHash> _ngrams;
+    size_t _bos_id = 0;
+    size_t _eos_id = 0;
+    size_t _unk_id = 0;
+
+    size_t add_word(const std::string& word);
+  };
+
+  struct CTCDecodingOptions {
+    // Beam size (set 1 to run a greedy search without language model).
+    size_t beam_size = 1;
+    // Number of hypotheses to return (should be <= beam_size).
+    size_t num_hypotheses = 1;
+    // Index of the blank token.
+    size_t blank_id = 0;
+    // Tokens with a lower log probability are not expanded by the beam search.
+    float min_token_log_prob = -10;
+
+    // Optional n-gram language model which is combined with the acoustic scores during the
+    // beam search. Its units are the vocabulary tokens, e.g. characters for most Wav2Vec2
+    // checkpoints.
+    std::shared_ptr<const NGramLanguageModel> language_model;
+    // Weight of the language model score.
+    float lm_weight = 0.5;
+    // Score added for each emitted token (used to balance the language model score).
+    float token_score = 0;
+  };
+
+  struct CTCDecodingResult {
+    std::vector<std::vector<std::string>> sequences;
+    std::vector<std::vector<size_t>> sequences_ids;
+    std::vector<float> scores;
+  };
+
+  // Decodes the output of a CTC model. log_probs is a float32 CPU tensor with shape
+  // [batch_size, time, vocabulary_size]. The vocabulary is required to map the tokens to
+  // the language model words and to return the sequences as strings. The batch is decoded
+  // in parallel.
+  std::vector<CTCDecodingResult> ctc_decode(const StorageView& log_probs,
+                                            const CTCDecodingOptions& options,
+                                            const Vocabulary* vocabulary = nullptr);
+
+}
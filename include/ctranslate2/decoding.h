@@ -16,6 +16,9 @@ namespace ctranslate2 {
     std::vector<float> scores;
     std::vector<std::vector<std::vector<float>>> attention;
     std::vector<std::vector<StorageView>> logits_vocab;
+    // Speculative decoding statistics.
+    size_t num_draft_tokens = 0;
+    size_t num_accepted_draft_tokens = 0;
   };
 
   struct DecodingStepResult {
@@ -47,6 +50,7 @@ namespace ctranslate2 {
            const bool return_prefix = true,
            const size_t num_hypotheses = 1,
            const bool include_eos_in_hypotheses = true,
+           const bool include_eos_in_attention = false,
            const std::vector<std::shared_ptr<LogitsProcessor>>& logits_processors = {},
            const std::vector<std::vector<size_t>>* prefix_ids = nullptr) const = 0;
   };
@@ -74,6 +78,7 @@ namespace ctranslate2 {
            const bool return_prefix = true,
            const size_t num_hypotheses = 1,
            const bool include_eos_in_hypotheses = true,
+           const bool include_eos_in_attention = false,
            const std::vector<std::shared_ptr<LogitsProcessor>>& logits_processors = {},
            const std::vector<std::vector<size_t>>* prefix_ids = nullptr) const override;
 
@@ -85,6 +90,48 @@ namespace ctranslate2 {
     const size_t _max_candidates;
   };
 
+  // Diverse beam search (Vijayakumar et al., 2016): the beams are split into groups that
+  // are expanded one after the other at each step, and the scores of the tokens selected by
+  // the previous groups at the same step are penalized. All groups are forked from the same
+  // decoder state, so the prompt and the encoder output are computed once.
+  class DiverseBeamSearch : public SearchStrategy {
+  public:
+    DiverseBeamSearch(const dim_t beam_size,
+                      const dim_t num_groups,
+                      const float diversity_penalty,
+                      const float length_penalty = 0,
+                      const float coverage_penalty = 0,
+                      const float patience = 1);
+
+    std::vector<DecodingResult>
+    search(layers::Decoder& decoder,
+           layers::DecoderState& state,
+           const Sampler& sampler,
+           const std::vector<size_t>& start_ids,
+           const std::vector<size_t>& end_ids,
+           const dim_t start_step,
+           const dim_t max_length,
+           const dim_t min_length,
+           const bool return_scores = false,
+           const bool return_attention = false,
+           const bool return_logits_vocab = true,
+           const bool return_prefix = true,
+           const size_t num_hypotheses = 1,
+           const bool include_eos_in_hypotheses = true,
+           const bool include_eos_in_attention = false,
+           const std::vector<std::shared_ptr<LogitsProcessor>>& logits_processors = {},
+           const std::vector<std::vector<size_t>>* prefix_ids = nullptr) const override;
+
+  private:
+    const dim_t _beam_size;
+    const dim_t _num_groups;
+    const dim_t _group_size;
+    const float _diversity_penalty;
+    const float _length_penalty;
+    const float _coverage_penalty;
+    const size_t _max_candidates;
+  };
+
   class BiasedDecoder {
   public:
     BiasedDecoder(const float prefix_bias_beta,
@@ -126,10 +173,134 @@ namespace ctranslate2 {
            const bool return_prefix = true,
            const size_t num_hypotheses = 1,
            const bool include_eos_in_hypotheses = true,
+           const bool include_eos_in_attention = false,
+           const std::vector<std::shared_ptr<LogitsProcessor>>& logits_processors = {},
+           const std::vector<std::vector<size_t>>* prefix_ids = nullptr) const override;
+
+  private:
+    const float _length_penalty;
+    const float _coverage_penalty;
+    const std::function<bool(DecodingStepResult)> _callback;
+  };
+
+
+  // Base class to propose the draft tokens of speculative decoding.
+  class Drafter {
+  public:
+    virtual ~Drafter() = default;
+
+    // Proposes num_tokens tokens continuing each sequence. The sequences all have the same
+    // length and their last token was decoded at the given step. When draft_probs is set,
+    // it should be filled with the distributions the draft tokens were sampled from, as a
+    // float32 CPU tensor with shape [batch_size, num_tokens, vocabulary_size].
+    virtual void propose(const std::vector<std::vector<size_t>>& sequences,
+                         const dim_t step,
+                         const dim_t num_tokens,
+                         const Sampler& sampler,
+                         std::vector<std::vector<size_t>>& draft_ids,
+                         StorageView* draft_probs) = 0;
+
+    // Keeps only the batches in alive_batches.
+    virtual void update_state(const std::vector<int32_t>& alive_batches) = 0;
+
+    // Returns a drafter for the batches in batch_ids. This drafter is unchanged.
+    virtual std::shared_ptr<Drafter> select(const std::vector<int32_t>& batch_ids) const = 0;
+
+    // Appends the batches of other, which is a drafter of the same type.
+    virtual void merge(Drafter& other) = 0;
+  };
+
+
+  // Drafter running a smaller decoder that shares the vocabulary of the verifying decoder.
+  class DecoderDrafter : public Drafter {
+  public:
+    // The state should be initialized up to the decoder start tokens.
+    DecoderDrafter(layers::Decoder& decoder, layers::DecoderState state);
+
+    void propose(const std::vector<std::vector<size_t>>& sequences,
+                 const dim_t step,
+                 const dim_t num_tokens,
+                 const Sampler& sampler,
+                 std::vector<std::vector<size_t>>& draft_ids,
+                 StorageView* draft_probs) override;
+
+    void update_state(const std::vector<int32_t>& alive_batches) override;
+    std::shared_ptr<Drafter> select(const std::vector<int32_t>& batch_ids) const override;
+    void merge(Drafter& other) override;
+
+  private:
+    layers::Decoder& _decoder;
+    layers::DecoderState _state;
+    // Tokens of each sequence that are currently in the decoder state.
+    std::vector<std::vector<size_t>> _forwarded_ids;
+  };
+
+
+  // Drafter proposing the tokens that followed the previous occurrence of the last n-gram,
+  // either in the sequence or in additional context tokens such as the prompt. It works
+  // well when the output copies spans of the input and does not require a draft model.
+  class PromptLookupDrafter : public Drafter {
+  public:
+    // contexts are optional tokens preceding each sequence that are not part of it.
+    PromptLookupDrafter(const dim_t max_ngram_size = 3,
+                        std::vector<std::vector<size_t>> contexts = {});
+
+    void propose(const std::vector<std::vector<size_t>>& sequences,
+                 const dim_t step,
+                 const dim_t num_tokens,
+                 const Sampler& sampler,
+                 std::vector<std::vector<size_t>>& draft_ids,
+                 StorageView* draft_probs) override;
+
+    void update_state(const std::vector<int32_t>& alive_batches) override;
+    std::shared_ptr<Drafter> select(const std::vector<int32_t>& batch_ids) const override;
+    void merge(Drafter& other) override;
+
+  private:
+    const dim_t _max_ngram_size;
+    std::vector<std::vector<size_t>> _contexts;
+  };
+
+
+  // Greedy search or random sampling where a drafter proposes the next tokens which are
+  // then verified in a single decoder forward. The accepted draft tokens are the ones the
+  // decoder would have generated, so the output follows the same distribution as
+  // GreedySearch. Unsupported options fall back to GreedySearch.
+  //
+  // Each batch keeps the draft tokens it accepted. Since the decoder state has a single
+  // time dimension, the batches that accepted a different number of tokens are split in
+  // groups with their own state. The group with the smallest step is decoded first and
+  // groups reaching the same step are merged again.
+  class SpeculativeSearch : public SearchStrategy {
+  public:
+    SpeculativeSearch(std::shared_ptr<Drafter> drafter,
+                      const dim_t num_draft_tokens,
+                      const float length_penalty = 0,
+                      const float coverage_penalty = 0,
+                      std::function<bool(DecodingStepResult)> callback = nullptr);
+
+    std::vector<DecodingResult>
+    search(layers::Decoder& decoder,
+           layers::DecoderState& state,
+           const Sampler& sampler,
+           const std::vector<size_t>& start_ids,
+           const std::vector<size_t>& end_id,
+           const dim_t start_step,
+           const dim_t max_length,
+           const dim_t min_length,
+           const bool return_scores = false,
+           const bool return_attention = false,
+           const bool return_logits_vocab = true,
+           const bool return_prefix = true,
+           const size_t num_hypotheses = 1,
+           const bool include_eos_in_hypotheses = true,
+           const bool include_eos_in_attention = false,
            const std::vector<std::shared_ptr<LogitsProcessor>>& logits_processors = {},
            const std::vector<std::vector<size_t>>* prefix_ids = nullptr) const override;
 
   private:
+    const std::shared_ptr<Drafter> _drafter;
+    const dim_t _num_draft_tokens;
     const float _length_penalty;
     const float _coverage_penalty;
     const std::function<bool(DecodingStepResult)> _callback;
@@ -144,6 +315,9 @@ namespace ctranslate2 {
     float repetition_penalty = 1;
     size_t no_repeat_ngram_size = 0;
     float prefix_bias_beta = 0;
+    // Split the beams in groups for diverse beam search (see DiverseBeamSearch).
+    size_t num_beam_groups = 1;
+    float diversity_penalty = 0;
     dim_t start_step = 0;
     size_t max_length = 256;
     size_t min_length = 0;
@@ -152,6 +326,9 @@ namespace ctranslate2 {
     float sampling_temperature = 1;
     size_t num_hypotheses = 1;
     bool include_eos_in_hypotheses = true;
+    // Keep the attention of the end of sequence step even when the token is not
+    // included in the hypotheses.
+    bool include_eos_in_attention = false;
     bool return_scores = false;
     bool return_attention = false;
     bool return_logits_vocab = false;
@@ -163,6 +340,9 @@ namespace ctranslate2 {
     std::vector<std::vector<size_t>> disable_sequences;
     std::vector<std::shared_ptr<LogitsProcessor>> logits_processors;
     std::function<bool(DecodingStepResult)> callback = nullptr;
+    // Enable speculative decoding with this drafter.
+    std::shared_ptr<Drafter> drafter;
+    size_t num_speculative_tokens = 4;
   };
 
   std::vector<DecodingResult>
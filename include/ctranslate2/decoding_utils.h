@@ -2,12 +2,16 @@
 
 #include <algorithm>
 #include <limits>
+#include <memory>
+#include <unordered_map>
 
 #include "ops/tile.h"
 #include "storage_view.h"
 
 namespace ctranslate2 {
 
+  class TokenAutomaton;
+
   inline void split_batch_beam(StorageView& input, dim_t beam_size) {
     Shape shape = input.shape();
     shape.insert(shape.begin() + 1, beam_size);
@@ -86,6 +90,11 @@ namespace ctranslate2 {
                        const std::vector<dim_t>& batch_offset,
                        const std::vector<std::vector<size_t>>* prefix) = 0;
 
+    // Called when the hypotheses are reordered or removed by the search: the hypothesis i
+    // of the next step continues the hypothesis origins[i] of the current step.
+    virtual void update_state(const std::vector<int32_t>&) {
+    }
+
   protected:
     dim_t get_batch_index(const dim_t batch_size,
                           const dim_t batch_id,
@@ -178,4 +187,30 @@ namespace ctranslate2 {
     const std::vector<size_t> _ids;
   };
 
+  // Only allow the tokens accepted by an automaton, e.g. compiled from a regular expression
+  // or a JSON schema (see grammar.h). The end tokens are only allowed when the generated
+  // sequence is a complete match. The automaton state of each hypothesis is advanced by
+  // the last generated token, so an instance should only be used for one decoding.
+  class ConstrainedDecoding : public LogitsProcessor {
+  public:
+    ConstrainedDecoding(std::shared_ptr<TokenAutomaton> automaton, std::vector<size_t> end_ids);
+    void apply(dim_t step,
+               StorageView& logits,
+               DisableTokens& disable_tokens,
+               const StorageView& sequences,
+               const std::vector<dim_t>& batch_offset,
+               const std::vector<std::vector<size_t>>* prefix) override;
+    void update_state(const std::vector<int32_t>& origins) override;
+
+  private:
+    const std::vector<int32_t>& get_disabled_tokens(int32_t state, dim_t vocabulary_size);
+
+    const std::shared_ptr<TokenAutomaton> _automaton;
+    std::vector<uint64_t> _end_tokens;
+    // Automaton state of each hypothesis and number of sequence tokens read to reach it.
+    std::vector<int32_t> _states;
+    std::vector<dim_t> _num_read_tokens;
+    std::unordered_map<int32_t, std::vector<int32_t>> _disabled_tokens;
+  };
+
 }
@@ -22,6 +22,41 @@ namespace ctranslate2 {
     forward_batch_async(const StorageView& ids,
                         const StorageView& lengths,
                         std::vector<std::vector<size_t>> token_type_ids = {});
+
+    // Returns pooled embeddings instead of the full hidden states.
+    std::future<EmbeddingOutput>
+    embed_batch_async(std::vector<std::vector<std::string>> tokens,
+                      const EmbeddingOptions& options = EmbeddingOptions(),
+                      std::vector<std::vector<size_t>> token_type_ids = {});
+
+    std::future<EmbeddingOutput>
+    embed_batch_async(std::vector<std::vector<size_t>> ids,
+                      const EmbeddingOptions& options = EmbeddingOptions(),
+                      std::vector<std::vector<size_t>> token_type_ids = {});
+
+    std::future<EmbeddingOutput>
+    embed_batch_async(const StorageView& ids,
+                      const StorageView& lengths,
+                      const EmbeddingOptions& options = EmbeddingOptions(),
+                      std::vector<std::vector<size_t>> token_type_ids = {});
+
+    // Classifies the sequences with a classifier head evaluated after some layers, stopping
+    // early for the examples with a confident prediction.
+    std::future<EncoderClassificationOutput>
+    classify_batch_async(std::vector<std::vector<std::string>> tokens,
+                         const EarlyExitOptions& options,
+                         std::vector<std::vector<size_t>> token_type_ids = {});
+
+    std::future<EncoderClassificationOutput>
+    classify_batch_async(std::vector<std::vector<size_t>> ids,
+                         const EarlyExitOptions& options,
+                         std::vector<std::vector<size_t>> token_type_ids = {});
+
+    std::future<EncoderClassificationOutput>
+    classify_batch_async(const StorageView& ids,
+                         const StorageView& lengths,
+                         const EarlyExitOptions& options,
+                         std::vector<std::vector<size_t>> token_type_ids = {});
   };
 
 }
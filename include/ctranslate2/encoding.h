@@ -1,6 +1,8 @@
 #pragma once
 
 #include <optional>
+#include <string>
+#include <vector>
 
 #include "storage_view.h"
 
@@ -12,4 +14,67 @@ namespace ctranslate2 {
     std::optional<StorageView> pooler_output;
   };
 
+  // How the hidden states of a sequence are reduced to a single embedding.
+  enum class EmbeddingPooling {
+    CLS,        // Hidden state of the first token.
+    Mean,       // Average of the hidden states of the non padding tokens.
+    Max,        // Maximum of the hidden states of the non padding tokens.
+    LastToken,  // Hidden state of the last non padding token.
+  };
+
+  EmbeddingPooling str_to_embedding_pooling(const std::string& pooling);
+
+  enum class EmbeddingQuantization {
+    None,
+    Int8,    // Symmetric int8 quantization with one scale per embedding.
+    Binary,  // Sign bits packed in bytes (the first dimension is the most significant bit).
+  };
+
+  EmbeddingQuantization str_to_embedding_quantization(const std::string& quantization);
+
+  struct EmbeddingOptions {
+    EmbeddingPooling pooling = EmbeddingPooling::Mean;
+    // Normalize the embeddings to unit L2 norm (before the quantization).
+    bool normalize = false;
+    EmbeddingQuantization quantization = EmbeddingQuantization::None;
+  };
+
+  struct EmbeddingOutput {
+    // The embeddings with shape [batch_size, hidden_size] as float32 values, or as int8
+    // values when quantized. With the binary quantization, the shape is [batch_size,
+    // ceil(hidden_size / 8)] and each int8 value holds 8 sign bits.
+    StorageView embeddings;
+
+    // With the int8 quantization, the scale of each embedding with shape [batch_size] such
+    // that embeddings = round(values * scales).
+    std::optional<StorageView> scales;
+  };
+
+  struct EarlyExitOptions {
+    // Linear classifier head applied to the pooled hidden states after the exit layers:
+    // the weight has shape [num_classes, hidden_size] and the optional bias [num_classes].
+    StorageView classifier_weight;
+    std::optional<StorageView> classifier_bias;
+
+    // Pooling of the hidden states before the classifier. With the CLS pooling, the model
+    // pooler layer is also applied when it exists (e.g. BERT).
+    EmbeddingPooling pooling = EmbeddingPooling::CLS;
+
+    // Indices of the layers (starting from 0) after which the classifier is evaluated. The
+    // classifier is always evaluated after the last layer.
+    std::vector<size_t> exit_layers;
+
+    // An example stops after an exit layer when its maximum class probability is greater
+    // or equal to this threshold.
+    float confidence_threshold = 0.9;
+  };
+
+  struct EncoderClassificationOutput {
+    // Classifier logits with shape [batch_size, num_classes].
+    StorageView logits;
+
+    // For each example, the index of the layer after which the classifier logits were
+    // computed.
+    std::vector<size_t> exit_layers;
+  };
 }
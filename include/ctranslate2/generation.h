@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <variant>
 #include <vector>
 #include <string>
@@ -9,6 +10,12 @@
 
 namespace ctranslate2 {
 
+  namespace models {
+    class Model;
+  }
+
+  class LoraAdapter;
+
   struct GenerationStepResult;
 
   struct GenerationOptions {
@@ -17,6 +24,11 @@ namespace ctranslate2 {
     // Beam search patience factor, as described in https://arxiv.org/abs/2204.05424.
     // The decoding will continue until beam_size*patience hypotheses are finished.
     float patience = 1;
+    // Diverse beam search: split the beams in this number of groups and penalize the
+    // tokens selected by the previous groups at the same step with diversity_penalty.
+    // The beam size should be a multiple of the number of groups.
+    size_t num_beam_groups = 1;
+    float diversity_penalty = 0;
     // Exponential penalty applied to the length during beam search.
     // The scores are normalized with:
     //   hypothesis_score /= (hypothesis_length ** length_penalty)
@@ -31,6 +43,13 @@ namespace ctranslate2 {
     // Disable the generation of some sequences of tokens.
     std::vector<std::vector<std::string>> suppress_sequences;
 
+    // Constrain the generated text to match this regular expression (see grammar.h for
+    // the supported syntax). The end token is only generated after a complete match.
+    std::string regex_constraint;
+    // Constrain the generated text to a JSON value that validates this JSON schema.
+    // It cannot be combined with regex_constraint.
+    std::string json_schema_constraint;
+
     // Stop the decoding on one of these tokens (defaults to the model EOS token).
     std::variant<std::string, std::vector<std::string>, std::vector<size_t>> end_token;
 
@@ -69,12 +88,36 @@ namespace ctranslate2 {
     // the same static prompt.
     bool cache_static_prompt = true;
 
+    // Reuse the model state cached for the longest prefix of the prompt and cache the model
+    // state after the prompt for future runs. Only the prompt tokens that are common to all
+    // batches and forwarded before the decoding are cached, so this option requires
+    // include_prompt_in_result = false to cache more than the static prompt.
+    bool cache_prompt = false;
+
     // Include the input tokens in the generation result.
     bool include_prompt_in_result = true;
 
     // Function to call for each generated token in greedy search.
     // Returns true indicate the current generation is considered finished thus can be stopped early.
     std::function<bool(GenerationStepResult)> callback = nullptr;
+
+    // Smaller model proposing tokens that are verified in a single forward of the model
+    // (speculative decoding). It should use the same vocabulary and device as the model.
+    // Only greedy search and random sampling are accelerated.
+    // With random sampling, the distributions of the draft tokens are copied to the CPU
+    // to accept or reject them.
+    std::shared_ptr<const models::Model> draft_model;
+    // Number of tokens proposed before each verification in speculative decoding.
+    size_t num_speculative_tokens = 4;
+    // Propose the next tokens by looking up the last generated n-gram (up to this size)
+    // in the prompt and the previous tokens, without a draft model (set 0 to disable).
+    // It cannot be combined with draft_model.
+    size_t prompt_lookup_ngram_size = 0;
+
+    // LoRA adapter of each example, or nullptr to use the base model. Examples using
+    // different adapters can be generated in the same batch. When set, the prompt states
+    // are not shared between the batch entries or cached.
+    std::vector<std::shared_ptr<const LoraAdapter>> adapters;
   };
 
   struct GenerationResult {
@@ -82,6 +125,9 @@ namespace ctranslate2 {
     std::vector<std::vector<size_t>> sequences_ids;
     std::vector<float> scores;
     std::vector<std::vector<StorageView>> logits;
+    // Number of tokens proposed by the draft model and number of accepted tokens.
+    size_t num_draft_tokens = 0;
+    size_t num_accepted_draft_tokens = 0;
 
     size_t num_sequences() const {
       return sequences.size();
@@ -90,6 +136,10 @@ namespace ctranslate2 {
     bool has_scores() const {
       return !scores.empty();
     }
+
+    float draft_acceptance_rate() const {
+      return num_draft_tokens > 0 ? float(num_accepted_draft_tokens) / num_draft_tokens : 0.f;
+    }
   };
 
   struct GenerationStepResult {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "lora.h"
 #include "replica_pool.h"
 #include "models/language_model.h"
 
@@ -35,6 +36,15 @@ namespace ctranslate2 {
     forward_batch_async(StorageView ids,
                         StorageView lengths,
                         const bool return_log_probs);
+
+    // LoRA adapters loaded for this model. The adapters used by an example are selected
+    // with GenerationOptions::adapters.
+    LoraRegistry& get_adapters() {
+      return *_adapters;
+    }
+
+  private:
+    std::shared_ptr<LoraRegistry> _adapters = std::make_shared<LoraRegistry>();
   };
 
 }
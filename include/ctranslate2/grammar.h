@@ -0,0 +1,160 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vocabulary.h"
+
+namespace ctranslate2 {
+
+  template <typename Key, typename Value, typename Hash>
+  class LruCache;
+
+  // Deterministic finite automaton over bytes compiled from a regular expression.
+  // The full input should match the expression (^ and $ anchors are implicit).
+  //
+  // The supported syntax is: literals, escapes (\d, \w, \s, \n, \xHH, \uHHHH, etc.),
+  // character classes with ranges and negation, the wildcard ".", groups, alternations,
+  // and the quantifiers *, +, ?, {n}, {n,}, {n,m}. Backreferences, lookarounds and word
+  // boundaries are not supported. Negated classes and the wildcard match any byte so
+  // that multi-byte UTF-8 characters can be generated.
+  class RegexAutomaton {
+  public:
+    RegexAutomaton(const std::string& pattern);
+
+    static constexpr int32_t dead_state = -1;
+
+    int32_t initial_state() const {
+      return 0;
+    }
+
+    // Returns the state after reading the byte, or dead_state if the input can no longer
+    // match the expression.
+    int32_t next_state(int32_t state, unsigned char byte) const {
+      return _transitions[state][byte];
+    }
+
+    bool is_accepting(int32_t state) const {
+      return _accepting[state];
+    }
+
+    size_t num_states() const {
+      return _transitions.size();
+    }
+
+    bool matches(const std::string& text) const;
+
+  private:
+    std::vector<std::array<int32_t, 256>> _transitions;
+    std::vector<bool> _accepting;
+  };
+
+  // Converts a JSON schema to a regular expression matching compact JSON values that
+  // validate the schema. Object properties are generated in the schema order.
+  //
+  // The supported keywords are: type, properties, required, additionalProperties, items,
+  // minItems, maxItems, minLength, maxLength, pattern, format (date, time, date-time, uuid),
+  // enum, const, anyOf, oneOf, allOf (with a single schema), and non recursive $ref.
+  std::string json_schema_to_regex(const std::string& schema);
+
+  // Returns the bytes represented by each vocabulary token. SentencePiece and byte-level
+  // BPE vocabularies are supported. Special tokens are mapped to an empty string.
+  std::vector<std::string> get_tokens_bytes(const Vocabulary& vocabulary);
+
+  // Prefix tree of the vocabulary tokens, used to match all tokens against an automaton
+  // in a single traversal.
+  class TokenTrie {
+  public:
+    TokenTrie(const std::vector<std::string>& tokens_bytes);
+
+    size_t num_tokens() const {
+      return _num_tokens;
+    }
+
+  private:
+    friend class TokenAutomaton;
+
+    struct Node {
+      std::vector<std::pair<unsigned char, int32_t>> children;
+      std::vector<int32_t> tokens;
+    };
+
+    std::vector<Node> _nodes;
+    size_t _num_tokens;
+  };
+
+  // Automaton over the vocabulary tokens built from a RegexAutomaton: a token is allowed
+  // in a state if all its bytes can be read from this state. The allowed tokens of each
+  // state are computed on first use. This class is thread safe.
+  class TokenAutomaton {
+  public:
+    TokenAutomaton(RegexAutomaton automaton, std::shared_ptr<const TokenTrie> trie);
+
+    static constexpr int32_t dead_state = RegexAutomaton::dead_state;
+
+    int32_t initial_state() const {
+      return _automaton.initial_state();
+    }
+
+    bool is_accepting(int32_t state) const {
+      return _automaton.is_accepting(state);
+    }
+
+    size_t num_tokens() const {
+      return _trie->num_tokens();
+    }
+
+    // Returns a bitset of the tokens that can be generated in this state. The bit of
+    // the token i is (bitset[i / 64] >> (i % 64)) & 1.
+    const std::vector<uint64_t>& allowed_tokens(int32_t state);
+
+    // Returns the state after generating the token, or dead_state if the token is not allowed.
+    int32_t next_state(int32_t state, size_t token_id);
+
+  private:
+    struct State {
+      std::vector<uint64_t> allowed_tokens;
+      std::vector<std::pair<int32_t, int32_t>> transitions;  // Sorted by token id.
+    };
+
+    const State& get_state(int32_t state);
+
+    const RegexAutomaton _automaton;
+    const std::shared_ptr<const TokenTrie> _trie;
+    std::vector<std::unique_ptr<State>> _states;
+    std::mutex _mutex;
+  };
+
+  // Cache of the token automata compiled for a vocabulary, indexed by regular expression.
+  // The least recently used automata are removed when the cache is full. This class is
+  // thread safe.
+  class GrammarCache {
+  public:
+    GrammarCache(std::shared_ptr<const Vocabulary> vocabulary, size_t max_size = 32);
+    ~GrammarCache();
+
+    // Returns the token automaton of the regular expression, compiling it on first use.
+    std::shared_ptr<TokenAutomaton> get(const std::string& pattern);
+
+    size_t size() const;
+    void clear();
+
+  private:
+    std::shared_ptr<const TokenTrie> get_trie();
+
+    using AutomatonLru = LruCache<std::string,
+                                  std::shared_ptr<TokenAutomaton>,
+                                  std::hash<std::string>>;
+
+    const std::shared_ptr<const Vocabulary> _vocabulary;
+    const size_t _max_size;
+    std::shared_ptr<const TokenTrie> _trie;
+    std::unique_ptr<AutomatonLru> _automata;
+    mutable std::mutex _mutex;
+  };
+
+}
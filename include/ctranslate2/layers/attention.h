@@ -47,6 +47,22 @@ namespace ctranslate2 {
             return _relative_position_keys || _relative_attention_bias || _rotary_embeddings || _alibi;
       }
     private:
+      bool use_ragged_attention(const StorageView& queries,
+                                const StorageView* cached_keys,
+                                const StorageView* attention,
+                                const Padder* queries_padder,
+                                const Padder* values_padder) const;
+
+      void ragged_attention(StorageView& fused_proj,
+                            const StorageView& values,
+                            const Padder& queries_padder,
+                            const Padder* values_padder,
+                            StorageView& context) const;
+
+      void project_output(const StorageView& queries,
+                          StorageView& context,
+                          StorageView& output) const;
+
       static void split_heads(StorageView& x,
                                dim_t num_heads,
                                const Padder* padder = nullptr,
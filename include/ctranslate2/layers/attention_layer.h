@@ -94,6 +94,18 @@ namespace ctranslate2 {
 
       void apply(StorageView& x, const dim_t offset = 0, bool fa2 = false);
 
+      // Splits the heads of x [batch, time, heads, head_dim] and applies the embeddings
+      // on the first num_rotary_heads heads in a single pass, see ops::Rotary.
+      void apply_and_split_heads(const StorageView& x,
+                                 const dim_t num_rotary_heads,
+                                 StorageView& output,
+                                 const dim_t offset = 0);
+
+      // Returns true if apply_and_split_heads can be used for this input.
+      static bool support_split_heads(const StorageView& x) {
+        return x.device() == Device::CPU && x.dtype() == DataType::FLOAT32;
+      }
+
       StorageView& get_cos_half() {
         return *_cos_half;
       }
@@ -107,10 +119,21 @@ namespace ctranslate2 {
       }
 
     private:
+      void ensure_positions(const dim_t num_positions,
+                            const dim_t dim,
+                            const Device device,
+                            const DataType dtype);
       void initialize(const dim_t num_positions,
                       const dim_t dim,
                       const Device device,
-                      const DataType dtype);
+                      const DataType dtype,
+                      StorageView& sin,
+                      StorageView& cos) const;
+      dim_t get_table_size(const dim_t num_positions, const dim_t cur_num_positions) const;
+
+      // The sin/cos tables only depend on the rotary parameters so they are shared
+      // by all layers using the same parameters, see ensure_positions.
+      struct Tables;
 
       const dim_t _dim;
       const bool _interleave;
@@ -127,8 +150,9 @@ namespace ctranslate2 {
       const ops::Rotary _rotary_op;
       const bool _transpose;
 
-      StorageView _sin;
-      StorageView _cos;
+      std::shared_ptr<Tables> _tables;
+      std::shared_ptr<const StorageView> _sin;
+      std::shared_ptr<const StorageView> _cos;
       std::unique_ptr<StorageView> _sin_half;
       std::unique_ptr<StorageView> _cos_half;
     };
@@ -132,8 +132,25 @@ namespace ctranslate2 {
       DataType output_type() const override;
       dim_t output_size() const override;
       void operator()(const StorageView& input, StorageView& output) const;
+      // Runs the layer on an input that was already quantized with quantize_op().
+      void operator()(const StorageView& qinput,
+                      const StorageView& qinput_scale,
+                      StorageView& output) const;
       void select_weights(const StorageView* index, const StorageView* extra_bias = nullptr);
+      // Returns true if the input can be quantized by the caller, for example
+      // in a fused normalization kernel.
+      bool accepts_quantized_input(const StorageView& input) const;
+      const ops::Quantize& quantize_op() const {
+        return _quantize_op;
+      }
     private:
+      void compute(const StorageView& input,
+                   StorageView& output,
+                   const ops::Gemm& gemm_op,
+                   const ops::Dequantize& dequantize_op,
+                   const ops::ActivationType* activation_type) const;
+
+      const std::string _scope;
       bool _packed_weight;
       const StorageView& _weight;
       const StorageView* _bias;
@@ -161,6 +178,19 @@ namespace ctranslate2 {
       DataType output_type() const override;
       dim_t output_size() const override;
       void operator()(const StorageView& input, StorageView& output) const;
+      // Fused residual connection and normalization: output = norm(input + residual).
+      // The sum is saved in residual_output when set.
+      void operator()(const StorageView& input,
+                      const StorageView* residual,
+                      StorageView& output,
+                      StorageView* residual_output = nullptr) const;
+      // Same as above, but the normalized output is quantized for the next Dense layer.
+      void operator()(const StorageView& input,
+                      const StorageView* residual,
+                      const Dense& next_layer,
+                      StorageView& qoutput,
+                      StorageView& qoutput_scale,
+                      StorageView* residual_output = nullptr) const;
     private:
       const StorageView* _beta;
       const StorageView& _gamma;
@@ -175,7 +205,8 @@ namespace ctranslate2 {
              dim_t stride = 1,
              dim_t padding = 0,
              dim_t dilation = 1,
-             dim_t groups = 1);
+             dim_t groups = 1,
+             const ops::ActivationType* activation_type = nullptr);
       DataType output_type() const override;
       dim_t output_size() const override;
       dim_t input_size() const;
@@ -185,6 +216,7 @@ namespace ctranslate2 {
       const StorageView& _weight;
       const StorageView* _bias;
       const StorageView* _qscale;
+      const StorageView _packed_weight;
     };
 
   }
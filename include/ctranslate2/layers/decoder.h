@@ -1,6 +1,6 @@
 #pragma once
 
-#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
@@ -9,6 +9,10 @@
 #include "ctranslate2/storage_view.h"
 
 namespace ctranslate2 {
+
+  template <typename Key, typename Value, typename Hash>
+  class LruCache;
+
   namespace layers {
 
     using DecoderState = std::unordered_map<std::string, StorageView>;
@@ -51,6 +55,15 @@ namespace ctranslate2 {
       // Returns true if the state must be replicated beam_size times.
       virtual bool replicate_state(const std::string& name) const;
 
+      // Returns true if the decoder state can be rewound with rewind_state.
+      virtual bool support_state_rewind() const {
+        return false;
+      }
+
+      // Removes the last num_steps positions from the decoder state, e.g. to discard
+      // the draft tokens that were rejected in speculative decoding.
+      virtual void rewind_state(DecoderState& state, const dim_t num_steps) const;
+
       // Restrict the output layer to a set of ids and/or resize it to a preferred size multiple.
       // Elements in restrict_ids must be unique and sorted.
       void update_output_layer(const dim_t size_multiple = 1,
@@ -99,13 +112,68 @@ namespace ctranslate2 {
     };
 
 
+    // Radix tree of decoder states indexed by the forwarded token ids. The states have a
+    // batch size of 1 and are evicted in least recently used order when the cache exceeds
+    // its maximum size. This class is thread safe.
     class DecoderStateCache {
     public:
-      void save(std::vector<size_t> prompt, DecoderState state);
-      const DecoderState* get(const std::vector<size_t>& prompt) const;
+      struct Match {
+        // State after forwarding the first state_length tokens of a cached sequence.
+        std::shared_ptr<const DecoderState> state;
+        size_t state_length = 0;
+        // Number of query tokens that are found in the state.
+        size_t length = 0;
+      };
+
+      struct Stats {
+        size_t num_lookups = 0;
+        size_t num_hits = 0;
+        size_t num_lookup_tokens = 0;
+        size_t num_reused_tokens = 0;
+        size_t num_evictions = 0;
+        size_t num_states = 0;
+        size_t size_in_bytes = 0;
+
+        float hit_rate() const {
+          return num_lookups == 0 ? 0 : float(num_hits) / float(num_lookups);
+        }
+
+        float token_hit_rate() const {
+          return (num_lookup_tokens == 0
+                  ? 0
+                  : float(num_reused_tokens) / float(num_lookup_tokens));
+        }
+      };
+
+      // A max_size_in_bytes of 0 means the cache size is not limited.
+      DecoderStateCache(size_t max_size_in_bytes = 0);
+      ~DecoderStateCache();
+
+      void save(const std::vector<size_t>& ids, DecoderState state);
+
+      // Returns the cached state sharing the longest prefix with ids. If allow_truncation
+      // is false, only the states of prefixes of ids are considered. Otherwise the state
+      // of a longer sequence can be returned and should be rewound to the match length.
+      Match lookup(const std::vector<size_t>& ids, bool allow_truncation);
+
+      void set_max_size(size_t max_size_in_bytes);
+      size_t max_size() const;
+      Stats get_stats() const;
+      void clear();
 
     private:
-      std::map<std::vector<size_t>, DecoderState> _cache;
+      struct Node;
+
+      using StateLru = LruCache<Node*,
+                                std::shared_ptr<const DecoderState>,
+                                std::hash<Node*>>;
+
+      Node* find_state_in_subtree(Node* node) const;
+      void prune(Node* node);
+
+      std::unique_ptr<Node> _root;
+      std::unique_ptr<StateLru> _states;  // Nodes with a state.
+      Stats _stats;
       mutable std::mutex _mutex;
     };
 
@@ -1,11 +1,22 @@
 #pragma once
 
+#include <functional>
+
 #include "ctranslate2/layers/common.h"
 #include "ctranslate2/storage_view.h"
 
 namespace ctranslate2 {
   namespace layers {
 
+    // Function called by Encoder::forward_with_early_exit after a layer. It receives the layer
+    // index, the hidden states [batch_size, max_time, depth] and the lengths of the examples
+    // that are still running, and their indices in the original batch. max_time is the
+    // maximum length of these examples. It returns which of these examples can stop.
+    using EarlyExitFunction = std::function<std::vector<bool>(dim_t layer,
+                                                              const StorageView& hidden_states,
+                                                              const StorageView& lengths,
+                                                              const std::vector<dim_t>& batch_ids)>;
+
     // Base class for encoders.
     class Encoder : public Layer {
     public:
@@ -30,6 +41,21 @@ namespace ctranslate2 {
         operator()(ids, &lengths, output);
       }
 
+      // Runs the encoder and calls exit_fn after each layer in exit_layers and after the last
+      // layer. The examples that stop are removed from the batch before the next layer, so the
+      // remaining layers only run on the examples that need them. The value returned by exit_fn
+      // after the last layer is ignored.
+      virtual void forward_with_early_exit(const std::vector<StorageView>& ids,
+                                           const StorageView& lengths,
+                                           const std::vector<dim_t>& exit_layers,
+                                           const EarlyExitFunction& exit_fn) {
+        (void)ids;
+        (void)lengths;
+        (void)exit_layers;
+        (void)exit_fn;
+        throw std::runtime_error("This encoder does not support early exit");
+      }
+
     protected:
       virtual void operator()(const std::vector<StorageView>& ids,
                               const StorageView* lengths,
@@ -32,8 +32,11 @@ namespace ctranslate2 {
       const std::unique_ptr<const LayerNorm> _layer_norm;
       const bool _pre_norm;
       const ops::ActivationType _activation_type;
-      const Dense _ff1;
+      // Fused gate and up projections, see Model::process_linear_weights.
+      const std::unique_ptr<const Dense> _ff1_gated;
+      const std::unique_ptr<const Dense> _ff1;
       const std::unique_ptr<const Dense> _ff1_noact;
+      const ops::GatedActivation _gated_activation;
       const Dense _ff2;
       const bool _tensor_parallel;
     };
@@ -134,6 +137,11 @@ namespace ctranslate2 {
                       const StorageView* lengths,
                       StorageView& output) override;
 
+      void forward_with_early_exit(const std::vector<StorageView>& ids,
+                                   const StorageView& lengths,
+                                   const std::vector<dim_t>& exit_layers,
+                                   const EarlyExitFunction& exit_fn) override;
+
       size_t num_input_features() const override {
         return _embeddings.num_inputs();
       }
@@ -157,6 +165,9 @@ namespace ctranslate2 {
       const std::vector<std::unique_ptr<const TransformerEncoderLayer>> _layers;
       const std::unique_ptr<PositionEncoder> _position_encoder;
       const bool _tensor_parallel;
+
+      void embed_inputs(const std::vector<StorageView>& ids, StorageView& input);
+      StorageView make_lengths_mask(const StorageView& lengths, const dim_t max_time) const;
     };
 
     class TransformerDecoder : public Decoder
@@ -166,6 +177,8 @@ namespace ctranslate2 {
 
       DecoderState initial_state(bool iterative_decoding = true) const override;
       bool replicate_state(const std::string& name) const override;
+      bool support_state_rewind() const override;
+      void rewind_state(DecoderState& state, const dim_t num_steps) const override;
 
       void operator()(dim_t step,
                       const StorageView& ids,
@@ -43,9 +43,9 @@ namespace ctranslate2 {
       }
 
     private:
+      const ops::ActivationType _activation_type;
       const Conv1D _conv1;
       const Conv1D _conv2;
-      const ops::GELU _gelu;
       const ops::Transpose _transpose;
       PositionEmbedding _position_embedding;
       const dim_t _num_heads;
@@ -56,14 +56,25 @@ namespace ctranslate2 {
     class WhisperDecoder : public TransformerDecoder {
     public:
       using TransformerDecoder::TransformerDecoder;
+      using TransformerDecoder::operator();
 
       bool return_normalized_attention() const override {
         return false;
       }
 
+      // The attention of the alignment heads is returned with shape
+      // [batch_size, num_heads * memory_time] so that it can be tracked during decoding.
+      void operator()(dim_t step,
+                      const StorageView& ids,
+                      DecoderState& state,
+                      StorageView* logits = nullptr,
+                      StorageView* attention = nullptr) override;
+
+      // step is the number of prompt tokens already forwarded in the state.
       void forward_prompt(const StorageView& prompt,
                           DecoderState& state,
-                          StorageView* outputs = nullptr);
+                          StorageView* outputs = nullptr,
+                          dim_t step = 0);
 
       void compute_logits_for_steps(const StorageView& outputs,
                                     const StorageView& steps,
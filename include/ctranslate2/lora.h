@@ -0,0 +1,158 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "storage_view.h"
+
+namespace ctranslate2 {
+
+  template <typename Key, typename Value, typename Hash>
+  class LruCache;
+
+  namespace models {
+    class Model;
+  }
+
+  // Low-rank adapter (LoRA) of a model. The output of an adapted linear layer with the
+  // weight W [out, in] becomes: x W^T + scale * (x A^T) B^T, with A [rank, in] and B [out, rank].
+  class LoraAdapter {
+  public:
+    struct Weights {
+      StorageView a;
+      StorageView b;
+    };
+
+    // The variables are named "<linear layer scope>/lora_a" and "<linear layer scope>/lora_b",
+    // e.g. "decoder/layer_0/self_attention/linear_0/lora_a". If model is set, the layers
+    // are mapped to the linear layers of the model: the adapters of layers that were merged
+    // when loading the model (e.g. the gated feed forward projections on CPU) are merged the
+    // same way, and an exception is raised if a layer does not exist in the model.
+    LoraAdapter(std::unordered_map<std::string, StorageView> variables,
+                float scale = 1,
+                const models::Model* model = nullptr);
+
+    float scale() const {
+      return _scale;
+    }
+
+    size_t num_layers() const {
+      return _weights.size();
+    }
+
+    bool has_layer(const std::string& scope) const {
+      return _weights.find(scope) != _weights.end();
+    }
+
+    // Replaces the adapters of linear layers with the adapter of the layer concatenating
+    // their outputs, see Model::merge_linear_layers. The layers should have the same output
+    // size. The update of the layers without adapter is zero.
+    void merge_layers(const std::vector<std::string>& scopes, const std::string& merged_scope);
+
+    // Returns the weights of the layer on the device and with the type, or nullptr if the
+    // layer is not adapted. The weights are converted on first use.
+    const Weights* get_weights(const std::string& scope,
+                               Device device,
+                               int device_index,
+                               DataType dtype) const;
+
+  private:
+    using WeightsMap = std::unordered_map<std::string, Weights>;
+    using ConversionKey = std::tuple<Device, int, DataType>;
+
+    void map_layers(const models::Model& model);
+
+    WeightsMap _weights;
+    float _scale;
+    mutable std::map<ConversionKey, WeightsMap> _converted_weights;
+    mutable std::mutex _mutex;
+  };
+
+  // Registry of the adapters that are loaded for a model, indexed by name. The least
+  // recently used adapters are unloaded when the registry is full. This class is thread safe.
+  class LoraRegistry {
+  public:
+    // max_size is the maximum number of adapters, or 0 for no limit.
+    LoraRegistry(size_t max_size = 0);
+    ~LoraRegistry();
+
+    // Registers the adapter and returns the adapters that were unloaded to make room for it.
+    std::vector<std::string> load(const std::string& name,
+                                  std::shared_ptr<const LoraAdapter> adapter);
+    // Returns false if no adapter is registered with this name.
+    bool unload(const std::string& name);
+    // Returns the adapter and marks it as recently used, or throws if it is not loaded.
+    std::shared_ptr<const LoraAdapter> get(const std::string& name);
+
+    bool contains(const std::string& name) const;
+    std::vector<std::string> list() const;
+    size_t size() const;
+    void set_max_size(size_t max_size);
+    size_t max_size() const;
+    void clear();
+
+  private:
+    using AdapterLru = LruCache<std::string,
+                                std::shared_ptr<const LoraAdapter>,
+                                std::hash<std::string>>;
+
+    std::unique_ptr<AdapterLru> _adapters;
+    std::vector<std::string> _evicted;  // Adapters unloaded by the current operation.
+    mutable std::mutex _mutex;
+  };
+
+  // Adapters of the batch entries decoded by the current thread. The linear layers add
+  // the low-rank update of each entry to the base projection.
+  class LoraBatch {
+  public:
+    // adapters has one element per batch entry (nullptr for the base model). row_offsets
+    // has batch_size + 1 elements when the entries have different numbers of rows, for
+    // example when the padding is removed. Otherwise the rows are split evenly.
+    LoraBatch(std::vector<const LoraAdapter*> adapters, std::vector<dim_t> row_offsets = {});
+
+    // Returns true if an adapter of the batch updates this layer.
+    bool adapts(const std::string& scope) const;
+
+    // Adds the low-rank updates of the layer to the output. The input is [rows, in] or
+    // [batch, time, in] and the output has the same number of rows.
+    void apply(const std::string& scope, const StorageView& input, StorageView& output) const;
+
+  private:
+    std::vector<const LoraAdapter*> _adapters;
+    std::vector<dim_t> _row_offsets;
+  };
+
+  // Returns the batch set for the current thread, or nullptr if no adapter is used.
+  const LoraBatch* get_current_lora_batch();
+
+  // Sets the adapters of the decoded batch for the current thread. The decoder state "lora_ids"
+  // maps each batch entry to an index in the adapters passed to ScopedLoraAdapters (or -1
+  // for the base model) so that it follows the batch reordering during the decoding.
+  class ScopedLoraBatch {
+  public:
+    ScopedLoraBatch(const StorageView& lora_ids,
+                    const StorageView* lengths = nullptr,
+                    dim_t max_time = 0);
+    ~ScopedLoraBatch();
+
+  private:
+    std::unique_ptr<LoraBatch> _batch;
+    const LoraBatch* _previous_batch;
+  };
+
+  // Sets the adapters of the examples decoded by the current thread.
+  class ScopedLoraAdapters {
+  public:
+    ScopedLoraAdapters(const std::vector<std::shared_ptr<const LoraAdapter>>& adapters);
+    ~ScopedLoraAdapters();
+
+  private:
+    const std::vector<std::shared_ptr<const LoraAdapter>>* _previous_adapters;
+  };
+
+}
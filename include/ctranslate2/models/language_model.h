@@ -5,6 +5,7 @@
 #include "ctranslate2/models/model.h"
 #include "ctranslate2/encoding.h"
 #include "ctranslate2/generation.h"
+#include "ctranslate2/grammar.h"
 #include "ctranslate2/scoring.h"
 
 namespace ctranslate2 {
@@ -20,12 +21,17 @@ namespace ctranslate2 {
       // The returned cache is thread safe.
       layers::DecoderStateCache& get_state_cache() const;
 
+      // Token automata compiled for the constrained generation. The returned cache is
+      // thread safe.
+      GrammarCache& get_grammar_cache() const;
+
     protected:
       void initialize(ModelReader& model_reader) override;
 
     private:
       std::shared_ptr<const Vocabulary> _vocabulary;
       std::shared_ptr<layers::DecoderStateCache> _state_cache;
+      std::shared_ptr<GrammarCache> _grammar_cache;
     };
 
 
@@ -105,8 +111,12 @@ namespace ctranslate2 {
       StorageView forward(const StorageView& ids, const StorageView& lengths) override;
 
     private:
+      // Returns a replica of the draft model used for speculative decoding.
+      const DecoderReplica& get_draft_replica(const std::shared_ptr<const Model>& draft_model);
+
       const std::shared_ptr<const LanguageModel> _model;
       const std::unique_ptr<layers::Decoder> _decoder;
+      std::unique_ptr<DecoderReplica> _draft_replica;
     };
 
 
@@ -131,12 +141,49 @@ namespace ctranslate2 {
                                    const StorageView& lengths,
                                    const std::vector<std::vector<size_t>>& token_type_ids = {});
 
+      // Returns the pooled embeddings [batch_size, hidden_size] of the last hidden states.
+      // The pooling, normalization, and quantization run on the model device, so the full
+      // hidden states are never copied to the host.
+      EmbeddingOutput embed(const std::vector<std::vector<std::string>>& tokens,
+                            const EmbeddingOptions& options = EmbeddingOptions(),
+                            const std::vector<std::vector<size_t>>& token_type_ids = {});
+      EmbeddingOutput embed(const std::vector<std::vector<size_t>>& ids,
+                            const EmbeddingOptions& options = EmbeddingOptions(),
+                            const std::vector<std::vector<size_t>>& token_type_ids = {});
+      EmbeddingOutput embed(const StorageView& ids,
+                            const StorageView& lengths,
+                            const EmbeddingOptions& options = EmbeddingOptions(),
+                            const std::vector<std::vector<size_t>>& token_type_ids = {});
+
+      // Classifies the sequences with a classifier head that is evaluated after some layers.
+      // The examples with a confident prediction stop early and the batch is compacted, so
+      // the remaining layers only run on the examples that need them.
+      EncoderClassificationOutput
+      classify(const std::vector<std::vector<std::string>>& tokens,
+               const EarlyExitOptions& options,
+               const std::vector<std::vector<size_t>>& token_type_ids = {});
+      EncoderClassificationOutput
+      classify(const std::vector<std::vector<size_t>>& ids,
+               const EarlyExitOptions& options,
+               const std::vector<std::vector<size_t>>& token_type_ids = {});
+      EncoderClassificationOutput
+      classify(const StorageView& ids,
+               const StorageView& lengths,
+               const EarlyExitOptions& options,
+               const std::vector<std::vector<size_t>>& token_type_ids = {});
+
     protected:
       virtual EncoderForwardOutput
       forward_impl(const StorageView& ids,
                    const StorageView& lengths,
                    const StorageView& token_type_ids) = 0;
 
+      virtual EncoderClassificationOutput
+      classify_impl(const StorageView& ids,
+                    const StorageView& lengths,
+                    const StorageView& token_type_ids,
+                    const EarlyExitOptions& options);
+
     private:
       const std::shared_ptr<const LanguageModel> _model;
     };
@@ -154,11 +201,20 @@ namespace ctranslate2 {
                    const StorageView& lengths,
                    const StorageView& token_type_ids) override;
 
+      EncoderClassificationOutput
+      classify_impl(const StorageView& ids,
+                    const StorageView& lengths,
+                    const StorageView& token_type_ids,
+                    const EarlyExitOptions& options) override;
+
     private:
       const std::shared_ptr<const LanguageModel> _model;
       const std::unique_ptr<layers::Encoder> _encoder;
       const ops::ActivationType _pooler_activation;
       const std::unique_ptr<layers::Dense> _pooler_dense;
+
+      std::vector<StorageView> make_inputs(const StorageView& ids,
+                                           const StorageView& token_type_ids) const;
     };
 
   }
@@ -174,6 +174,8 @@ namespace ctranslate2 {
 
     private:
       void process_linear_weights();
+      bool merge_linear_layers(const std::vector<std::string>& scopes,
+                               const std::string& merged_scope);
       void set_compute_type(ComputeType type, Device device, int device_index, bool update_weight=true);
       void ensure_dtype(const std::string& name,
                         StorageView& variable,
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <mutex>
+
 #include "ctranslate2/layers/decoder.h"
 #include "ctranslate2/layers/encoder.h"
 #include "ctranslate2/models/model.h"
@@ -8,15 +10,70 @@
 #include "ctranslate2/vocabulary_map.h"
 
 namespace ctranslate2 {
+
+  template <typename Key, typename Value, typename Hash>
+  class LruCache;
+
   namespace models {
 
+    // Cache of encoder outputs indexed by the source ids of each example. The outputs are
+    // evicted in least recently used order when the cache exceeds its maximum size.
+    // This class is thread safe.
+    class EncoderOutputCache {
+    public:
+      // Source ids of each input feature.
+      using Key = std::vector<std::vector<size_t>>;
+
+      struct Stats {
+        size_t num_lookups = 0;
+        size_t num_hits = 0;
+        size_t num_evictions = 0;
+        size_t num_entries = 0;
+        size_t size_in_bytes = 0;
+
+        float hit_rate() const {
+          return num_lookups == 0 ? 0 : float(num_hits) / float(num_lookups);
+        }
+      };
+
+      // A max_size_in_bytes of 0 means the cache size is not limited.
+      EncoderOutputCache(size_t max_size_in_bytes = 0);
+      ~EncoderOutputCache();
+
+      // The output has the shape [1, length, depth].
+      void save(const Key& ids, StorageView output);
+      std::shared_ptr<const StorageView> get(const Key& ids);
+
+      void set_max_size(size_t max_size_in_bytes);
+      size_t max_size() const;
+      Stats get_stats() const;
+      void clear();
+
+    private:
+      struct KeyHash {
+        size_t operator()(const Key& key) const;
+      };
+
+      using OutputLru = LruCache<Key, std::shared_ptr<const StorageView>, KeyHash>;
+
+      std::unique_ptr<OutputLru> _outputs;
+      mutable std::mutex _mutex;
+    };
+
+
     class SequenceToSequenceModel : public Model {
     public:
+      SequenceToSequenceModel();
+      SequenceToSequenceModel(const SequenceToSequenceModel& other);
+
       size_t num_source_vocabularies() const;
       const Vocabulary& get_source_vocabulary(size_t index = 0) const;
       const Vocabulary& get_target_vocabulary() const;
       const VocabularyMap* get_vocabulary_map() const;
 
+      // The returned cache is thread safe. The outputs are stored on the model device.
+      EncoderOutputCache& get_encoder_cache() const;
+
       bool with_source_bos() const {
         return config["add_source_bos"];
       }
@@ -37,6 +94,7 @@ namespace ctranslate2 {
       std::vector<std::shared_ptr<const Vocabulary>> _source_vocabularies;
       std::shared_ptr<const Vocabulary> _target_vocabulary;
       std::shared_ptr<const VocabularyMap> _vocabulary_map;
+      std::shared_ptr<EncoderOutputCache> _encoder_cache;
 
       void load_vocabularies(ModelReader& model_reader);
     };
@@ -150,9 +208,22 @@ namespace ctranslate2 {
                   StorageView& memory,
                   StorageView& memory_lengths);
 
+      // Same as encode but reuses the outputs of the model cache and caches the new outputs.
+      void encode_with_cache(const std::vector<std::vector<std::vector<size_t>>>& ids,
+                             StorageView& memory,
+                             StorageView& memory_lengths);
+
+      // Returns a replica of the draft model used for speculative decoding.
+      EncoderDecoderReplica& get_draft_replica(const std::shared_ptr<const Model>& draft_model);
+
+      // Encodes the source with this model and returns a drafter proposing the next tokens.
+      std::shared_ptr<Drafter> make_drafter(const std::vector<std::vector<std::string>>& source,
+                                            size_t max_input_length);
+
       const std::shared_ptr<const SequenceToSequenceModel> _model;
       const std::unique_ptr<layers::Encoder> _encoder;
       const std::unique_ptr<layers::Decoder> _decoder;
+      std::unique_ptr<EncoderDecoderReplica> _draft_replica;
     };
 
   }
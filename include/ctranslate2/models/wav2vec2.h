@@ -1,6 +1,7 @@
 #pragma once
 
 //#include "ctranslate2/generation.h"
+#include "ctranslate2/ctc_decoding.h"
 #include "ctranslate2/layers/wav2vec2.h"
 #include "ctranslate2/models/model.h"
 #include "ctranslate2/replica_pool.h"
@@ -53,6 +54,10 @@ namespace ctranslate2 {
 
       StorageView encode(StorageView features, const bool to_cpu);
 
+      // Runs the encoder and decodes its output with a CTC greedy or beam search.
+      std::vector<CTCDecodingResult> decode_ctc(StorageView features,
+                                                const CTCDecodingOptions& options = {});
+
     private:
       const std::shared_ptr<const Wav2Vec2Model> _model;
       const std::unique_ptr<layers::Wav2Vec2Encoder> _encoder;
@@ -66,6 +71,9 @@ namespace ctranslate2 {
 
       std::future<StorageView> encode(const StorageView& features, const bool to_cpu);
 
+      std::future<std::vector<CTCDecodingResult>>
+      decode_ctc(const StorageView& features, const CTCDecodingOptions& options = {});
+
     };
 
   }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <mutex>
+
 #include "ctranslate2/generation.h"
 #include "ctranslate2/layers/whisper.h"
 #include "ctranslate2/models/model.h"
@@ -53,6 +55,26 @@ namespace ctranslate2 {
       // Suppress blank outputs at the beginning of the sampling.
       bool suppress_blank = true;
 
+      // Detect the language of each batch and insert the language token after
+      // <|startoftranscript|> when the prompt does not already include one. The detection
+      // runs in the same job as the generation and reuses the encoder output.
+      bool detect_language = false;
+
+      // Record the cross-attention of the alignment heads while decoding and return the
+      // alignments between the generated tokens and the audio frames, as computed by align().
+      bool return_alignments = false;
+      // Number of non padding frames of each batch used for the alignments and the dynamic
+      // encoder length (all frames if empty).
+      std::vector<size_t> num_frames;
+      // Width of the median filter applied to the alignment heads.
+      dim_t median_filter_width = 7;
+
+      // Encode the features up to the last non padding frame of the batch, as given by
+      // num_frames, instead of the full 30-second window. The encoded length is at least
+      // min_encoder_frames since the model quality degrades with very short audio contexts.
+      bool dynamic_encoder_length = false;
+      size_t min_encoder_frames = 1000;
+
       // List of token IDs to suppress.
       // -1 will suppress a default set of symbols as defined in the model config.json file.
       std::vector<int> suppress_tokens = {-1};
@@ -64,6 +86,12 @@ namespace ctranslate2 {
       std::vector<float> scores;
       std::vector<std::vector<StorageView>> logits;
       float no_speech_prob = 0;
+      // Language token and its probability when the option detect_language is enabled.
+      std::string language;
+      float language_prob = 0;
+      // Alignments of each sequence when the option return_alignments is enabled. The text
+      // indices refer to the tokens of the sequence followed by the end of text token.
+      std::vector<std::vector<std::pair<dim_t, dim_t>>> alignments;
 
       size_t num_sequences() const {
         return sequences.size();
@@ -79,6 +107,116 @@ namespace ctranslate2 {
       std::vector<float> text_token_probs;
     };
 
+    struct WhisperStreamSegment {
+      // Start and end time of the segment in seconds from the beginning of the stream.
+      float start = 0;
+      float end = 0;
+      std::vector<std::string> tokens;
+      std::vector<size_t> tokens_ids;
+    };
+
+    struct WhisperStreamingResult {
+      // Segments committed by this update. They are not changed by the next updates.
+      std::vector<WhisperStreamSegment> segments;
+      // Tentative transcription of the buffered audio which is not committed yet.
+      std::vector<std::string> partial;
+      std::vector<size_t> partial_ids;
+      // The stream ended and all its audio is transcribed.
+      bool finished = false;
+    };
+
+    struct WhisperStreamingOptions {
+      // Number of new mel frames (10ms each) after which the buffered audio is transcribed
+      // again to update the partial result. This bounds the latency of the partial results.
+      size_t partial_interval = 100;
+
+      // Include the text of the previous windows in the prompt.
+      bool condition_on_previous_text = true;
+
+      // Maximum number of previous text tokens to include in the prompt.
+      size_t max_previous_tokens = 223;
+    };
+
+    // Pads log-Mel features [n_mels, num_frames] to length frames with the features of silent
+    // audio as computed by ops::MelSpectrogram: the log10 power of zero samples is clamped to
+    // 8 below the maximum value, i.e. 2 below the maximum of the scaled features.
+    StorageView pad_log_mel_features(const StorageView& features, dim_t length);
+
+    // Audio stream transcribed incrementally with Whisper::transcribe_streams.
+    //
+    // The mel frames are buffered as they arrive and transcribed in windows of 30 seconds.
+    // Until the window is full, each update returns a partial transcription. When the window
+    // is full or the stream ended, the complete segments are committed and the next window
+    // starts after the last committed timestamp. The previous text is kept to condition the
+    // transcription of the next windows. This class is thread safe.
+    class WhisperStream {
+    public:
+      static constexpr size_t window_frames = 3000;
+      static constexpr size_t frames_per_timestamp = 2;
+      static constexpr float frame_duration = 0.01;
+
+      // The prompt contains the task tokens starting with <|startoftranscript|>, for example
+      // {"<|startoftranscript|>", "<|en|>", "<|transcribe|>"}. The timestamps are always
+      // predicted so the prompt should not end with <|notimestamps|>.
+      WhisperStream(std::vector<std::string> prompt, WhisperStreamingOptions options = {});
+
+      // Appends mel frames with shape [n_mels, num_frames].
+      void append_features(const StorageView& features);
+
+      // Marks the end of the audio. The next update commits all the remaining frames.
+      void end_of_stream();
+
+      // Returns true if the stream should be updated: enough new frames were appended since
+      // the last update, the window is full, or the stream ended.
+      bool has_pending_update() const;
+      bool is_finished() const;
+
+      // Number of frames that are not committed yet.
+      size_t num_buffered_frames() const;
+
+      // Text tokens committed so far.
+      std::vector<std::string> transcription() const;
+
+      const std::vector<std::string>& prompt() const {
+        return _prompt;
+      }
+
+    private:
+      friend class WhisperReplica;
+      friend class Whisper;
+
+      struct Window {
+        StorageView features;  // [n_mels, num_frames]
+        size_t num_frames = 0;
+        bool commit = false;
+        bool last = false;
+        std::vector<size_t> previous_tokens;
+      };
+
+      bool has_pending_update_unlocked() const;
+      size_t num_buffered_frames_unlocked() const;
+      // Returns false if the stream has nothing to transcribe.
+      bool start_update();
+      void cancel_update();
+      Window get_window() const;
+      WhisperStreamingResult update(const Window& window,
+                                    const std::vector<size_t>& tokens,
+                                    size_t timestamp_begin_id,
+                                    const Vocabulary& vocabulary);
+
+      const std::vector<std::string> _prompt;
+      const WhisperStreamingOptions _options;
+      StorageView _features;
+      size_t _offset = 0;  // Position of the first buffered frame in the stream.
+      size_t _pending_frames = 0;
+      bool _ended = false;
+      bool _finished = false;
+      bool _updating = false;
+      std::vector<size_t> _previous_tokens;
+      std::vector<std::string> _transcription;
+      mutable std::mutex _mutex;
+    };
+
     class WhisperModel : public Model {
     public:
       const Vocabulary& get_vocabulary() const;
@@ -117,7 +255,12 @@ namespace ctranslate2 {
         return _num_languages;
       }
 
-      StorageView encode(StorageView features, const bool to_cpu);
+      // When num_frames is set, the features are trimmed after the last non padding frame
+      // of the batch but not below min_frames (see WhisperOptions::dynamic_encoder_length).
+      StorageView encode(StorageView features,
+                         const bool to_cpu,
+                         const std::vector<size_t>& num_frames = {},
+                         size_t min_frames = 1000);
 
       std::vector<WhisperGenerationResult>
       generate(StorageView features,
@@ -129,6 +272,20 @@ namespace ctranslate2 {
                const std::vector<std::vector<size_t>>& prompts,
                const WhisperOptions& options);
 
+      // Computes the log-Mel spectrogram of 16 kHz audio samples with shape
+      // [batch_size, num_samples], padded to the 30-second window.
+      StorageView compute_features(StorageView audio) const;
+
+      std::vector<WhisperGenerationResult>
+      generate_from_audio(StorageView audio,
+                          const std::vector<std::vector<std::string>>& prompts,
+                          const WhisperOptions& options);
+
+      std::vector<WhisperGenerationResult>
+      generate_from_audio(StorageView audio,
+                          const std::vector<std::vector<size_t>>& prompts,
+                          const WhisperOptions& options);
+
       std::vector<std::vector<std::pair<std::string, float>>>
       detect_language(StorageView features);
 
@@ -139,10 +296,15 @@ namespace ctranslate2 {
             std::vector<size_t> num_frames,
             dim_t median_filter_width);
 
+      std::vector<WhisperStreamingResult>
+      transcribe_streams(const std::vector<std::shared_ptr<WhisperStream>>& streams,
+                         const WhisperOptions& options);
+
     private:
       const std::shared_ptr<const WhisperModel> _model;
       const std::unique_ptr<layers::WhisperEncoder> _encoder;
       const std::unique_ptr<layers::WhisperDecoder> _decoder;
+      const ops::MelSpectrogram _mel_spectrogram;
 
       size_t _sot_id;
       size_t _eot_id;
@@ -153,6 +315,17 @@ namespace ctranslate2 {
       bool _is_multilingual;
 
       StorageView maybe_encode(StorageView features);
+      void trim_features(StorageView& features,
+                         const std::vector<size_t>& num_frames,
+                         size_t min_frames) const;
+      void set_alignment_heads();
+      std::vector<int32_t> get_language_ids() const;
+      // Returns the number of prompt tokens forwarded in the decoder state.
+      dim_t detect_prompts_language(const std::vector<std::vector<size_t>>& prompts,
+                                    layers::DecoderState& state,
+                                    std::vector<std::vector<size_t>>& language_prompts,
+                                    std::vector<std::pair<size_t, float>>& languages,
+                                    StorageView& sot_logits);
     };
 
     class Whisper : public ReplicaPool<WhisperReplica> {
@@ -163,7 +336,10 @@ namespace ctranslate2 {
       size_t n_mels() const;
       size_t num_languages() const;
 
-      std::future<StorageView> encode(const StorageView& features, const bool to_cpu);
+      std::future<StorageView> encode(const StorageView& features,
+                                      const bool to_cpu,
+                                      std::vector<size_t> num_frames = {},
+                                      size_t min_frames = 1000);
 
       std::vector<std::future<WhisperGenerationResult>>
       generate(const StorageView& features,
@@ -175,6 +351,18 @@ namespace ctranslate2 {
                std::vector<std::vector<size_t>> prompts,
                WhisperOptions options = {});
 
+      // Same as generate but the features are computed by the model workers from 16 kHz audio
+      // samples with shape [batch_size, num_samples] (at most 30 seconds).
+      std::vector<std::future<WhisperGenerationResult>>
+      generate_from_audio(const StorageView& audio,
+                          std::vector<std::vector<std::string>> prompts,
+                          WhisperOptions options = {});
+
+      std::vector<std::future<WhisperGenerationResult>>
+      generate_from_audio(const StorageView& audio,
+                          std::vector<std::vector<size_t>> prompts,
+                          WhisperOptions options = {});
+
       std::vector<std::future<std::vector<std::pair<std::string, float>>>>
       detect_language(const StorageView& features);
 
@@ -185,6 +373,13 @@ namespace ctranslate2 {
             std::vector<size_t> num_frames,
             dim_t median_filter_width);
 
+      // Transcribes the new audio of the streams. The streams with a pending update are
+      // batched by prompt length and run on the replicas. The other streams get an empty result.
+      // A stream should not be passed again before its previous result is ready.
+      std::vector<std::future<WhisperStreamingResult>>
+      transcribe_streams(const std::vector<std::shared_ptr<WhisperStream>>& streams,
+                         WhisperOptions options = {});
+
     };
 
   }
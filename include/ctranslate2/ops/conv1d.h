@@ -8,37 +8,52 @@ namespace ctranslate2 {
 
     class Conv1D : public Op {
     public:
-      Conv1D(dim_t stride = 1, dim_t padding = 0, dim_t dilation = 1, dim_t groups=1);
+      Conv1D(dim_t stride = 1,
+             dim_t padding = 0,
+             dim_t dilation = 1,
+             dim_t groups = 1,
+             const ActivationType* activation_type = nullptr);
 
+      // The packed weight is optional and should be returned by pack_weight.
       void operator()(const StorageView& input,
                       const StorageView& weight,
                       const StorageView& bias,
                       StorageView& output,
-                      const StorageView* qscale = nullptr) const;
+                      const StorageView* qscale = nullptr,
+                      const StorageView* packed_weight = nullptr) const;
 
       void operator()(const StorageView& input,
                       const StorageView& weight,
                       StorageView& output,
-                      const StorageView* qscale = nullptr) const;
+                      const StorageView* qscale = nullptr,
+                      const StorageView* packed_weight = nullptr) const;
+
+      // Returns the weight in the layout of the CPU direct convolution so that it is not
+      // packed on each call, or an empty storage if this convolution does not use it.
+      StorageView pack_weight(const StorageView& weight,
+                              const StorageView* qscale = nullptr) const;
 
     private:
       dim_t _stride;
       dim_t _padding;
       dim_t _dilation;
       dim_t _groups;
+      const ActivationType* _activation_type;
 
       void operator()(const StorageView& input,
                       const StorageView& weight,
                       const StorageView* bias,
                       StorageView& output,
-                      const StorageView* qscale) const;
+                      const StorageView* qscale,
+                      const StorageView* packed_weight) const;
 
       template <Device D, typename T>
       void compute(const StorageView& input,
                    const StorageView& weight,
                    const StorageView* bias,
                    StorageView& output,
-                   const StorageView* qscale = nullptr) const;
+                   const StorageView* qscale = nullptr,
+                   const StorageView* packed_weight = nullptr) const;
 
       void compute_with_gemm(const StorageView& input, const StorageView& weight, StorageView& output,
                              const StorageView* qscale) const;
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "activation.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    // Gated activation as used in GLU variants (e.g. SwiGLU, GeGLU): the last dimension
+    // of the input is the concatenation [gate, up] and the output is activation(gate) * up.
+    class GatedActivation : public UnaryOp {
+    public:
+      GatedActivation(const ActivationType activation_type);
+      void operator()(const StorageView& x, StorageView& y) const override;
+
+    private:
+      const ActivationType _activation_type;
+
+      template <Device D, typename T>
+      void compute(const StorageView& x, StorageView& y) const;
+    };
+
+  }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "op.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    // Computes the log-Mel spectrogram of audio samples as in Whisper: the power of a
+    // short-time Fourier transform (periodic Hann window, reflect padding) is projected on a
+    // Mel filterbank with the Slaney scale and normalization, then it is log10 compressed,
+    // clamped to 8 below its maximum value and scaled with (x + 4) / 4.
+    //
+    // The audio is [batch_size, num_samples] and the output is
+    // [batch_size, num_mels, num_samples / hop_length]. The DFT is computed as a GEMM with a
+    // precomputed basis, so n_fft does not need to be a power of 2.
+    class MelSpectrogram : public Op {
+    public:
+      MelSpectrogram(dim_t num_mels,
+                     dim_t n_fft = 400,
+                     dim_t hop_length = 160,
+                     dim_t sampling_rate = 16000);
+
+      void operator()(const StorageView& audio, StorageView& features) const;
+
+      dim_t num_mels() const {
+        return _num_mels;
+      }
+
+      dim_t hop_length() const {
+        return _hop_length;
+      }
+
+    private:
+      const dim_t _num_mels;
+      const dim_t _n_fft;
+      const dim_t _hop_length;
+      const dim_t _num_bins;
+      StorageView _dft_basis;    // [n_fft, 2 * num_bins] with the window applied.
+      StorageView _mel_filters;  // [num_mels, num_bins]
+    };
+
+  }
+}
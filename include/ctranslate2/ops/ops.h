@@ -6,6 +6,7 @@
 #include "conv1d.h"
 #include "cos.h"
 #include "gather.h"
+#include "gated_activation.h"
 #include "gelu.h"
 #include "gemm.h"
 #include "gumbel_max.h"
@@ -33,8 +34,11 @@
 #include "min_max.h"
 #include "log.h"
 #include "rms_norm.h"
+#include "residual_norm.h"
 #include "tanh.h"
 #include "median_filter.h"
+#include "mel_spectrogram.h"
+#include "ragged_attention.h"
 #include "rotary.h"
 #include "alibi_add.h"
 #include "slide.h"
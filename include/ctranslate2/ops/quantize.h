@@ -23,6 +23,14 @@ namespace ctranslate2 {
                       StorageView& output,
                       StorageView& scale) const;
 
+      bool shift_to_uint8() const {
+        return _shift_to_uint8;
+      }
+
+      bool round_before_cast() const {
+        return _round_before_cast;
+      }
+
     private:
       template <Device D, typename InT, typename OutT>
       void quantize(const StorageView& input,
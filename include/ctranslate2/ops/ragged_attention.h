@@ -0,0 +1,34 @@
+#pragma once
+
+#include "op.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    // Scaled dot-product attention over sequences packed without padding. The rows of the
+    // sequence b are [offsets[b], offsets[b + 1]) in the queries and in the keys/values, so
+    // no computation is spent on padding positions.
+    //
+    // The queries are [total_queries, num_heads * head_dim] and the keys and values are
+    // [total_keys, num_heads_kv * head_dim], with num_heads a multiple of num_heads_kv.
+    // When is_causal is set, the query i of a sequence attends to the keys j <= i + (keys_length
+    // - queries_length) of the same sequence.
+    class RaggedAttention : public Op {
+    public:
+      RaggedAttention(dim_t num_heads, float queries_scale = 1, bool is_causal = false);
+
+      void operator()(const StorageView& queries,
+                      const StorageView& keys,
+                      const StorageView& values,
+                      const std::vector<dim_t>& queries_offsets,
+                      const std::vector<dim_t>& keys_offsets,
+                      StorageView& output) const;
+
+    private:
+      const dim_t _num_heads;
+      const float _queries_scale;
+      const bool _is_causal;
+    };
+
+  }
+}
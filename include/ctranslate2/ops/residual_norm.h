@@ -0,0 +1,59 @@
+#pragma once
+
+#include "op.h"
+#include "quantize.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    // Fused residual connection and normalization: output = norm(input + residual).
+    // The normalization is a LayerNorm when beta is set and a RMSNorm otherwise.
+    // The sum input + residual is also returned when requested as it is usually
+    // the residual of the next sublayer.
+    class ResidualNorm : public Op {
+    public:
+      ResidualNorm(const float epsilon = 1e-5, const bool rms_use_residual = false);
+
+      void operator()(const StorageView* beta,
+                      const StorageView& gamma,
+                      const StorageView& input,
+                      const StorageView* residual,
+                      StorageView& output,
+                      StorageView* sum = nullptr) const;
+
+      // Same as above, but the normalized output is directly quantized to INT8 with
+      // the settings of quantize_op.
+      void operator()(const StorageView* beta,
+                      const StorageView& gamma,
+                      const StorageView& input,
+                      const StorageView* residual,
+                      const Quantize& quantize_op,
+                      StorageView& qoutput,
+                      StorageView& qscale,
+                      StorageView* sum = nullptr) const;
+
+    private:
+      void unfused(const StorageView* beta,
+                   const StorageView& gamma,
+                   const StorageView& input,
+                   const StorageView* residual,
+                   StorageView& output,
+                   StorageView* sum) const;
+
+      template <Device D, typename T>
+      void compute(const StorageView* beta,
+                   const StorageView& gamma,
+                   const StorageView& input,
+                   const StorageView* residual,
+                   StorageView* output,
+                   StorageView* sum,
+                   StorageView* qoutput,
+                   StorageView* qscale,
+                   const Quantize* quantize_op) const;
+
+      const float _epsilon;
+      const bool _rms_use_residual;
+    };
+
+  }
+}
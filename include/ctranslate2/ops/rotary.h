@@ -15,6 +15,15 @@ namespace ctranslate2 {
                       StorageView& output,
                       bool is_transpose=true) const;
 
+      // Splits the heads of input [batch, time, heads, depth] into output
+      // [batch, heads, time, depth] and applies the rotary embeddings on the first
+      // num_rotary_heads heads in the same pass. This is only implemented on CPU.
+      void operator()(const StorageView& input,
+                      const StorageView& sin,
+                      const StorageView& cos,
+                      const dim_t num_rotary_heads,
+                      StorageView& output) const;
+
     private:
       const dim_t _ndims;
       const bool _interleave;
@@ -25,6 +34,13 @@ namespace ctranslate2 {
                    const StorageView& cos,
                    StorageView& output,
                    bool is_transpose) const;
+
+      template <Device D, typename T>
+      void compute_split_heads(const StorageView& input,
+                               const StorageView& sin,
+                               const StorageView& cos,
+                               const dim_t num_rotary_heads,
+                               StorageView& output) const;
     };
 
   }
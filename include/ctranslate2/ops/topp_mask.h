@@ -14,6 +14,10 @@ namespace ctranslate2 {
       static dim_t max_num_classes(const Device device);
 
       void operator()(const StorageView& input, StorageView& output) const;
+      // Same as above, but with the probabilities of the input already computed.
+      void operator()(const StorageView& input,
+                      const StorageView& probs,
+                      StorageView& output) const;
 
     private:
       const float _p;
@@ -25,9 +25,21 @@ namespace ctranslate2 {
     // Split first dimension into batch and time dimensions and add padding.
     void add_padding(StorageView& x) const;
 
+    // Returns true if the sequences have different lengths, i.e. remove_padding changes the layout.
+    bool has_padding() const {
+      return bool(_padded_to_flat);
+    }
+
+    // Offsets of each sequence in the layout without padding (batch_size + 1 values, the last
+    // one being the total number of positions).
+    const std::vector<dim_t>& offsets() const {
+      return _offsets;
+    }
+
   private:
     dim_t _batch_size;
     dim_t _max_time;
+    std::vector<dim_t> _offsets;
     StorageView _padded_to_flat;
     StorageView _flat_to_padded;
     const ops::Gather _gather_op;
@@ -14,6 +14,17 @@ namespace ctranslate2 {
                     StorageView& sampled_ids,
                     StorageView& sampled_scores,
                     dim_t num_samples = 1) const;
+
+    // Returns true if the ids are randomly sampled from a distribution.
+    virtual bool is_random() const {
+      return false;
+    }
+
+    // Computes the probability distribution that the ids are sampled from.
+    // probs is a float32 tensor on the CPU device with the same shape as scores, so
+    // scores on other devices are copied to the host.
+    virtual void get_distribution(const StorageView& scores, StorageView& probs) const;
+
   protected:
     virtual void sample(const StorageView& scores,
                         dim_t num_samples,
@@ -34,6 +45,13 @@ namespace ctranslate2 {
   class RandomSampler : public Sampler {
   public:
     RandomSampler(dim_t from_topk = 0, float topp = 1, float temperature = 1);
+
+    bool is_random() const override {
+      return true;
+    }
+
+    void get_distribution(const StorageView& scores, StorageView& probs) const override;
+
   protected:
     void sample(const StorageView& scores,
                 dim_t num_samples,
@@ -14,6 +14,11 @@ namespace ctranslate2 {
     // Beam search patience factor, as described in https://arxiv.org/abs/2204.05424.
     // The decoding will continue until beam_size*patience hypotheses are finished.
     float patience = 1;
+    // Diverse beam search: split the beams in this number of groups and penalize the
+    // tokens selected by the previous groups at the same step with diversity_penalty.
+    // The beam size should be a multiple of the number of groups.
+    size_t num_beam_groups = 1;
+    float diversity_penalty = 0;
     // Exponential penalty applied to the length during beam search.
     // The scores are normalized with:
     //   hypothesis_score /= (hypothesis_length ** length_penalty)
@@ -60,6 +65,10 @@ namespace ctranslate2 {
     // Allow using the vocabulary map included in the model directory, if it exists.
     bool use_vmap = false;
 
+    // Reuse the encoder outputs cached for the same source and cache the new outputs. The
+    // cache size can be limited with the environment variable CT2_ENCODER_OUTPUT_CACHE_SIZE_MB.
+    bool cache_encoder_output = false;
+
     // Number of hypotheses to store in the TranslationResult class.
     size_t num_hypotheses = 1;
 
@@ -83,6 +92,20 @@ namespace ctranslate2 {
     // Function to call for each generated token in greedy search.
     // Returns true indicate the current generation is considered finished thus can be stopped early.
     std::function<bool(GenerationStepResult)> callback = nullptr;
+
+    // Smaller model proposing tokens that are verified in a single forward of the model
+    // (speculative decoding). It should use the same target vocabulary and device as the
+    // model. Only greedy search and random sampling are accelerated.
+    // With random sampling, the distributions of the draft tokens are copied to the CPU
+    // to accept or reject them.
+    std::shared_ptr<const models::Model> draft_model;
+    // Number of tokens proposed before each verification in speculative decoding.
+    size_t num_speculative_tokens = 4;
+    // Propose the next tokens by looking up the last generated n-gram (up to this size)
+    // in the source and the previous tokens, without a draft model (set 0 to disable).
+    // Source tokens only match if they are also in the target vocabulary. It cannot be
+    // combined with draft_model.
+    size_t prompt_lookup_ngram_size = 0;
   };
 
   struct TranslationResult {
@@ -90,6 +113,9 @@ namespace ctranslate2 {
     std::vector<float> scores;
     std::vector<std::vector<std::vector<float>>> attention;
     std::vector<std::vector<StorageView>> logits;
+    // Number of tokens proposed by the draft model and number of accepted tokens.
+    size_t num_draft_tokens = 0;
+    size_t num_accepted_draft_tokens = 0;
 
     TranslationResult(std::vector<std::vector<std::string>> hypotheses_)
       : hypotheses(std::move(hypotheses_))
@@ -143,6 +169,10 @@ namespace ctranslate2 {
     bool has_attention() const {
       return !attention.empty();
     }
+
+    float draft_acceptance_rate() const {
+      return num_draft_tokens > 0 ? float(num_accepted_draft_tokens) / num_draft_tokens : 0.f;
+    }
   };
 
 }
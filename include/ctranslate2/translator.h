@@ -1,11 +1,17 @@
 #pragma once
 
+#include <mutex>
+#include <optional>
+
 #include "filesystem.h"
 #include "replica_pool.h"
 #include "models/sequence_to_sequence.h"
 
 namespace ctranslate2 {
 
+  template <typename Key, typename Value, typename Hash>
+  class LruCache;
+
   struct ExecutionStats {
     size_t num_tokens = 0;
     size_t num_examples = 0;
@@ -21,6 +27,65 @@ namespace ctranslate2 {
                   const Batch& batch,
                   const TranslationOptions& options);
 
+  // Cache of translation results indexed by the source, the target prefix and the
+  // translation options. The least recently used results are evicted first.
+  // This class is thread safe.
+  class TranslationResultCache {
+  public:
+    struct Key {
+      std::vector<std::string> source;
+      std::vector<std::string> target_prefix;
+      // Canonical representation of the options, see get_options_key.
+      std::string options;
+
+      bool operator==(const Key& other) const {
+        return (source == other.source
+                && target_prefix == other.target_prefix
+                && options == other.options);
+      }
+    };
+
+    struct Stats {
+      size_t num_lookups = 0;
+      size_t num_hits = 0;
+      size_t num_evictions = 0;
+      size_t num_entries = 0;
+      size_t size_in_bytes = 0;
+
+      float hit_rate() const {
+        return num_lookups == 0 ? 0 : float(num_hits) / float(num_lookups);
+      }
+    };
+
+    // max_size_in_bytes is the maximum memory usage of the cached keys and results.
+    // The cache is disabled when it is 0.
+    TranslationResultCache(size_t max_size_in_bytes = 0);
+    ~TranslationResultCache();
+
+    // Returns the options that change the translation results as a string, or nullopt
+    // if the results should not be cached (e.g. random sampling or a callback is set).
+    static std::optional<std::string> get_options_key(const TranslationOptions& options);
+
+    void save(const Key& key, TranslationResult result);
+    std::optional<TranslationResult> get(const Key& key);
+
+    bool enabled() const;
+    void set_max_size(size_t max_size_in_bytes);
+    size_t max_size() const;
+    Stats get_stats() const;
+    void clear();
+
+  private:
+    struct KeyHash {
+      size_t operator()(const Key& key) const;
+    };
+
+    using ResultLru = LruCache<Key, TranslationResult, KeyHash>;
+
+    std::unique_ptr<ResultLru> _results;
+    mutable std::mutex _mutex;
+  };
+
   // Translator is the high-level class for running translations. It supports parallel
   // and asynchronous translations.
   class Translator : public ReplicaPool<models::SequenceToSequenceReplica> {
@@ -51,6 +116,12 @@ namespace ctranslate2 {
                     const size_t max_batch_size = 0,
                     const BatchType batch_type = BatchType::Examples);
 
+    // Results cache checked by translate_batch_async before running the translation.
+    // It is disabled by default, see TranslationResultCache::set_max_size.
+    TranslationResultCache& get_result_cache() {
+      return *_result_cache;
+    }
+
     std::vector<std::future<ScoringResult>>
     score_batch_async(const std::vector<std::vector<std::string>>& source,
                       const std::vector<std::vector<std::string>>& target,
@@ -306,6 +377,9 @@ namespace ctranslate2 {
   private:
     friend class BufferedTranslationWrapper;
 
+    std::shared_ptr<TranslationResultCache> _result_cache
+      = std::make_shared<TranslationResultCache>();
+
     template <typename Result,
               typename SourceTokenizer,
               typename TargetTokenizer,
@@ -42,6 +42,97 @@ namespace ctranslate2 {
 
         return future.get();
       }
+
+      EmbeddingOutput
+      embed_batch(const std::variant<BatchTokens, BatchIds, StorageView>& inputs,
+                  const std::optional<StorageView>& lengths,
+                  const std::optional<BatchIds>& token_type_ids,
+                  const std::string& pooling,
+                  bool normalize,
+                  const std::optional<std::string>& quantization) {
+        EmbeddingOptions options;
+        options.pooling = str_to_embedding_pooling(pooling);
+        options.normalize = normalize;
+        if (quantization)
+          options.quantization = str_to_embedding_quantization(quantization.value());
+
+        std::future<EmbeddingOutput> future;
+        std::shared_lock lock(_mutex);
+        assert_model_is_ready();
+
+        switch (inputs.index()) {
+        case 0:
+          future = _pool->embed_batch_async(
+            std::get<BatchTokens>(inputs),
+            options,
+            token_type_ids.value_or(std::vector<std::vector<size_t>>()));
+          break;
+        case 1:
+          future = _pool->embed_batch_async(
+            std::get<BatchIds>(inputs),
+            options,
+            token_type_ids.value_or(std::vector<std::vector<size_t>>()));
+          break;
+        case 2:
+          if (!lengths)
+            throw std::invalid_argument("lengths vector is required when passing a dense input");
+          future = _pool->embed_batch_async(
+            std::get<StorageView>(inputs),
+            lengths.value(),
+            options,
+            token_type_ids.value_or(std::vector<std::vector<size_t>>()));
+          break;
+        }
+
+        return future.get();
+      }
+
+      EncoderClassificationOutput
+      classify_batch(const std::variant<BatchTokens, BatchIds, StorageView>& inputs,
+                     const std::optional<StorageView>& lengths,
+                     const std::optional<BatchIds>& token_type_ids,
+                     const StorageView& classifier_weight,
+                     const std::optional<StorageView>& classifier_bias,
+                     const std::vector<size_t>& exit_layers,
+                     float confidence_threshold,
+                     const std::string& pooling) {
+        EarlyExitOptions options;
+        options.classifier_weight = classifier_weight;
+        options.classifier_bias = classifier_bias;
+        options.exit_layers = exit_layers;
+        options.confidence_threshold = confidence_threshold;
+        options.pooling = str_to_embedding_pooling(pooling);
+
+        std::future<EncoderClassificationOutput> future;
+        std::shared_lock lock(_mutex);
+        assert_model_is_ready();
+
+        switch (inputs.index()) {
+        case 0:
+          future = _pool->classify_batch_async(
+            std::get<BatchTokens>(inputs),
+            options,
+            token_type_ids.value_or(std::vector<std::vector<size_t>>()));
+          break;
+        case 1:
+          future = _pool->classify_batch_async(
+            std::get<BatchIds>(inputs),
+            options,
+            token_type_ids.value_or(std::vector<std::vector<size_t>>()));
+          break;
+        case 2:
+          if (!lengths)
+            throw std::invalid_argument("lengths vector is required when passing a dense input");
+          future = _pool->classify_batch_async(
+            std::get<StorageView>(inputs),
+            lengths.value(),
+            options,
+            token_type_ids.value_or(std::vector<std::vector<size_t>>()));
+          break;
+        }
+
+        return future.get();
+      }
     };
 
 
@@ -62,6 +153,40 @@ namespace ctranslate2 {
         })
         ;
 
+      py::class_<EmbeddingOutput>(m, "EmbeddingOutput",
+                                  "Pooled embeddings of an encoder model.")
+
+        .def_readonly("embeddings", &EmbeddingOutput::embeddings,
+                      "Embeddings with shape ``[batch_size, hidden_size]`` (float32 or int8), "
+                      "or ``[batch_size, ceil(hidden_size / 8)]`` packed sign bits with the "
+                      "binary quantization.")
+        .def_readonly("scales", &EmbeddingOutput::scales,
+                      "Scale of each embedding with the int8 quantization.")
+
+        .def("__repr__", [](const EmbeddingOutput& output) {
+          return "EmbeddingOutput(embeddings="
+            + std::string(py::repr(py::cast(output.embeddings)))
+            + ", scales=" + std::string(py::repr(py::cast(output.scales)))
+            + ")";
+        })
+        ;
+
+      py::class_<EncoderClassificationOutput>(m, "EncoderClassificationOutput",
+                                              "Classification output of an encoder model.")
+
+        .def_readonly("logits", &EncoderClassificationOutput::logits,
+                      "Classifier logits with shape ``[batch_size, num_classes]``.")
+        .def_readonly("exit_layers", &EncoderClassificationOutput::exit_layers,
+                      "Index of the layer after which each example was classified.")
+
+        .def("__repr__", [](const EncoderClassificationOutput& output) {
+          return "EncoderClassificationOutput(logits="
+            + std::string(py::repr(py::cast(output.logits)))
+            + ", exit_layers=" + std::string(py::repr(py::cast(output.exit_layers)))
+            + ")";
+        })
+        ;
+
       py::class_<EncoderWrapper>(
         m, "Encoder",
         R"pbdoc(
@@ -143,6 +268,78 @@ namespace ctranslate2 {
                    The encoder model output.
              )pbdoc")
 
+        .def("embed_batch", &EncoderWrapper::embed_batch,
+             py::arg("inputs"),
+             py::arg("lengths")=py::none(),
+             py::arg("token_type_ids")=py::none(),
+             py::kw_only(),
+             py::arg("pooling")="mean",
+             py::arg("normalize")=false,
+             py::arg("quantization")=py::none(),
+             py::call_guard<py::gil_scoped_release>(),
+             R"pbdoc(
+                 Computes pooled embeddings of a batch of sequences. Only the embeddings
+                 are returned, which is cheaper than :meth:`forward_batch` when the full
+                 hidden states are not needed.
+
+                 Arguments:
+                   inputs: A batch of sequences either as string tokens or token IDs.
+                     This argument can also be a dense int32 array with shape
+                     ``[batch_size, max_length]`` (e.g. created from a Numpy array or PyTorch tensor).
+                   lengths: The length of each sequence as a int32 array with shape
+                     ``[batch_size]``. Required when :obj:`inputs` is a dense array.
+                   token_type_ids: A batch of token type IDs of same shape as :obj:`inputs`.
+                     ``[batch_size, max_length]``.
+                   pooling: Pooling of the last hidden states (possible values are:
+                     cls, mean, max, last_token). The padding positions are ignored.
+                   normalize: Normalize the embeddings to unit L2 norm.
+                   quantization: Optional quantization of the embeddings (possible values are:
+                     int8, binary).
+
+                 Returns:
+                   The pooled embeddings.
+             )pbdoc")
+
+        .def("classify_batch", &EncoderWrapper::classify_batch,
+             py::arg("inputs"),
+             py::arg("lengths")=py::none(),
+             py::arg("token_type_ids")=py::none(),
+             py::kw_only(),
+             py::arg("classifier_weight"),
+             py::arg("classifier_bias")=py::none(),
+             py::arg("exit_layers")=std::vector<size_t>(),
+             py::arg("confidence_threshold")=0.9,
+             py::arg("pooling")="cls",
+             py::call_guard<py::gil_scoped_release>(),
+             R"pbdoc(
+                 Classifies a batch of sequences with early exit: a linear classifier is
+                 evaluated after the layers :obj:`exit_layers` and the examples with a
+                 confident prediction skip the remaining layers.
+
+                 Arguments:
+                   inputs: A batch of sequences either as string tokens or token IDs.
+                     This argument can also be a dense int32 array with shape
+                     ``[batch_size, max_length]`` (e.g. created from a Numpy array or PyTorch tensor).
+                   lengths: The length of each sequence as a int32 array with shape
+                     ``[batch_size]``. Required when :obj:`inputs` is a dense array.
+                   token_type_ids: A batch of token type IDs of same shape as :obj:`inputs`.
+                     ``[batch_size, max_length]``.
+                   classifier_weight: Weight of the classifier with shape
+                     ``[num_classes, hidden_size]``.
+                   classifier_bias: Optional bias of the classifier with shape ``[num_classes]``.
+                   exit_layers: Indices of the layers (starting from 0) after which the
+                     classifier is evaluated. The classifier is always evaluated after the
+                     last layer.
+                   confidence_threshold: An example stops when its maximum class probability
+                     is greater or equal to this value.
+                   pooling: Pooling of the hidden states before the classifier (possible values
+                     are: cls, mean, max, last_token). With the cls pooling, the model pooler
+                     layer is also applied when it exists.
+
+                 Returns:
+                   The classification output.
+             )pbdoc")
+
         .def("unload_model", &EncoderWrapper::unload_model,
              py::arg("to_cpu")=false,
              py::call_guard<py::gil_scoped_release>(),
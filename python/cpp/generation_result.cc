@@ -51,6 +51,12 @@ namespace ctranslate2 {
                       "Score of each sequence (empty if :obj:`return_scores` was disabled).")
         .def_readonly("logits", &GenerationResult::logits,
                       "Logits of each sequence (empty if :obj:`return_logits_vocab` was disabled).")
+        .def_readonly("num_draft_tokens", &GenerationResult::num_draft_tokens,
+                      "Number of tokens proposed in speculative decoding.")
+        .def_readonly("num_accepted_draft_tokens", &GenerationResult::num_accepted_draft_tokens,
+                      "Number of proposed tokens that were accepted in speculative decoding.")
+        .def_property_readonly("draft_acceptance_rate", &GenerationResult::draft_acceptance_rate,
+                               "Ratio of accepted tokens in speculative decoding.")
 
         .def("__repr__", [](const GenerationResult& result) {
           return "GenerationResult(sequences=" + std::string(py::repr(py::cast(result.sequences)))
@@ -19,19 +19,25 @@ namespace ctranslate2 {
                      bool asynchronous,
                      size_t beam_size,
                      float patience,
+                     size_t num_beam_groups,
+                     float diversity_penalty,
                      size_t num_hypotheses,
                      float length_penalty,
                      float repetition_penalty,
                      size_t no_repeat_ngram_size,
                      bool disable_unk,
                      const std::optional<std::vector<std::vector<std::string>>>& suppress_sequences,
+                     const std::string& regex_constraint,
+                     const std::string& json_schema_constraint,
                      const std::optional<EndToken>& end_token,
                      bool return_end_token,
                      size_t max_length,
                      size_t min_length,
                      const std::optional<std::vector<std::string>>& static_prompt,
                      bool cache_static_prompt,
+                     bool cache_prompt,
                      bool include_prompt_in_result,
+                     const std::optional<std::vector<std::optional<std::string>>>& adapters,
                      bool return_scores,
                      bool return_logits_vocab,
                      bool return_alternatives,
@@ -39,6 +45,9 @@ namespace ctranslate2 {
                      size_t sampling_topk,
                      float sampling_topp,
                      float sampling_temperature,
+                     GeneratorWrapper* draft_model,
+                     size_t num_speculative_tokens,
+                     size_t prompt_lookup_ngram_size,
                      std::function<bool(GenerationStepResult)> callback) {
         if (tokens.empty())
           return {};
@@ -47,10 +56,14 @@ namespace ctranslate2 {
         GenerationOptions options;
         options.beam_size = beam_size;
         options.patience = patience;
+        options.num_beam_groups = num_beam_groups;
+        options.diversity_penalty = diversity_penalty;
         options.length_penalty = length_penalty;
         options.repetition_penalty = repetition_penalty;
         options.no_repeat_ngram_size = no_repeat_ngram_size;
         options.disable_unk = disable_unk;
+        options.regex_constraint = regex_constraint;
+        options.json_schema_constraint = json_schema_constraint;
         options.sampling_topk = sampling_topk;
         options.sampling_topp = sampling_topp;
         options.sampling_temperature = sampling_temperature;
@@ -62,8 +75,11 @@ namespace ctranslate2 {
         options.return_logits_vocab = return_logits_vocab;
         options.return_alternatives = return_alternatives;
         options.cache_static_prompt = cache_static_prompt;
+        options.cache_prompt = cache_prompt;
         options.include_prompt_in_result = include_prompt_in_result;
         options.min_alternative_expansion_prob = min_alternative_expansion_prob;
+        options.num_speculative_tokens = num_speculative_tokens;
+        options.prompt_lookup_ngram_size = prompt_lookup_ngram_size;
         options.callback = std::move(callback);
         if (suppress_sequences)
           options.suppress_sequences = suppress_sequences.value();
@@ -74,6 +90,22 @@ namespace ctranslate2 {
         std::shared_lock lock(_mutex);
         assert_model_is_ready();
 
+        std::shared_lock<std::shared_mutex> draft_lock;
+        if (draft_model) {
+          if (draft_model == this)
+            throw std::invalid_argument("The draft model should be a different generator");
+          draft_lock = std::shared_lock(draft_model->_mutex);
+          draft_model->assert_model_is_ready();
+          options.draft_model = draft_model->model();
+        }
+
+        if (adapters) {
+          auto& registry = _pool->get_adapters();
+          options.adapters.reserve(adapters->size());
+          for (const auto& name : *adapters)
+            options.adapters.emplace_back(name ? registry.get(*name) : nullptr);
+        }
+
         auto futures = _pool->generate_batch_async(tokens, options, max_batch_size, batch_type);
         return maybe_wait_on_futures(std::move(futures), asynchronous);
       }
@@ -119,6 +151,30 @@ namespace ctranslate2 {
 
         return future.get();
       }
+
+      std::vector<std::string>
+      load_adapter(const std::string& name,
+                   std::unordered_map<std::string, StorageView> variables,
+                   float scale) {
+        auto adapter = std::make_shared<LoraAdapter>(std::move(variables), scale, model().get());
+        return _pool->get_adapters().load(name, std::move(adapter));
+      }
+
+      bool unload_adapter(const std::string& name) {
+        return _pool->get_adapters().unload(name);
+      }
+
+      std::vector<std::string> loaded_adapters() const {
+        return _pool->get_adapters().list();
+      }
+
+      size_t get_max_loaded_adapters() const {
+        return _pool->get_adapters().max_size();
+      }
+
+      void set_max_loaded_adapters(size_t max_size) {
+        _pool->get_adapters().set_max_size(max_size);
+      }
     };
 
 
@@ -191,19 +247,25 @@ namespace ctranslate2 {
              py::arg("asynchronous")=false,
              py::arg("beam_size")=1,
              py::arg("patience")=1,
+             py::arg("num_beam_groups")=1,
+             py::arg("diversity_penalty")=0,
              py::arg("num_hypotheses")=1,
              py::arg("length_penalty")=1,
              py::arg("repetition_penalty")=1,
              py::arg("no_repeat_ngram_size")=0,
              py::arg("disable_unk")=false,
              py::arg("suppress_sequences")=py::none(),
+             py::arg("regex_constraint")="",
+             py::arg("json_schema_constraint")="",
              py::arg("end_token")=py::none(),
              py::arg("return_end_token")=false,
              py::arg("max_length")=512,
              py::arg("min_length")=0,
              py::arg("static_prompt")=py::none(),
              py::arg("cache_static_prompt")=true,
+             py::arg("cache_prompt")=false,
              py::arg("include_prompt_in_result")=true,
+             py::arg("adapters")=py::none(),
              py::arg("return_scores")=false,
              py::arg("return_logits_vocab")=false,
              py::arg("return_alternatives")=false,
@@ -211,6 +273,9 @@ namespace ctranslate2 {
              py::arg("sampling_topk")=1,
              py::arg("sampling_topp")=1,
              py::arg("sampling_temperature")=1,
+             py::arg("draft_model")=py::none(),
+             py::arg("num_speculative_tokens")=4,
+             py::arg("prompt_lookup_ngram_size")=0,
              py::arg("callback")=nullptr,
              py::call_guard<py::gil_scoped_release>(),
              R"pbdoc(
@@ -244,6 +309,11 @@ namespace ctranslate2 {
                    patience: Beam search patience factor, as described in
                      https://arxiv.org/abs/2204.05424. The decoding will continue until
                      beam_size*patience hypotheses are finished.
+                   num_beam_groups: Number of groups for diverse beam search, as described in
+                     https://arxiv.org/abs/1610.02424. :obj:`beam_size` should be a multiple of
+                     this value.
+                   diversity_penalty: Penalty applied in diverse beam search to the tokens
+                     selected by the previous groups at the same step.
                    num_hypotheses: Number of hypotheses to return.
                    length_penalty: Exponential penalty applied to the length during beam search.
                    repetition_penalty: Penalty applied to the score of previously generated tokens
@@ -252,6 +322,10 @@ namespace ctranslate2 {
                      (set 0 to disable).
                    disable_unk: Disable the generation of the unknown token.
                    suppress_sequences: Disable the generation of some sequences of tokens.
+                   regex_constraint: Constrain the generated text to match this regular
+                     expression. The end token is only generated after a complete match.
+                   json_schema_constraint: Constrain the generated text to a JSON value that
+                     validates this JSON schema (passed as a JSON string).
                    end_token: Stop the decoding on one of these tokens (defaults to the model EOS token).
                    return_end_token: Include the end token in the results.
                    max_length: Maximum generation length.
@@ -261,7 +335,16 @@ namespace ctranslate2 {
                      state for this prompt to accelerate future generations.
                    cache_static_prompt: Cache the model state after the static prompt and
                      reuse it for future generations using the same static prompt.
+                   cache_prompt: Reuse the model state cached for the longest prefix of the
+                     prompt and cache the model state after the prompt. This only applies to the
+                     start tokens that are common to all batches and requires
+                     :obj:`include_prompt_in_result` to be ``False``. The cache size can be
+                     limited with the environment variable ``CT2_DECODER_STATE_CACHE_SIZE_MB``.
                    include_prompt_in_result: Include the :obj:`start_tokens` in the result.
+                   adapters: Name of the LoRA adapter to use for each example (``None`` to use
+                     the base model), see :meth:`ctranslate2.Generator.load_adapter`. Examples
+                     using different adapters can be generated in the same batch. The prompt
+                     states are not cached when adapters are used.
                    return_scores: Include the scores in the output.
                    return_logits_vocab: Include log probs for each token in the output
                    return_alternatives: Return alternatives at the first unconstrained decoding position.
@@ -270,6 +353,17 @@ namespace ctranslate2 {
                    sampling_topp: Keep the most probable tokens whose cumulative probability exceeds
                      this value.
                    sampling_temperature: Sampling temperature to generate more random samples.
+                   draft_model: A smaller generator proposing the next tokens that are then
+                     verified by this model in a single forward (speculative decoding). It should
+                     use the same vocabulary and be loaded on the same device. This only applies
+                     when :obj:`beam_size` is 1.
+                   num_speculative_tokens: Number of tokens proposed by the draft model before
+                     each verification.
+                   prompt_lookup_ngram_size: Propose the next tokens without a draft model by
+                     looking up the last generated n-gram (up to this size) in the prompt and
+                     the previous tokens (set 0 to disable). The proposed tokens are the ones
+                     that followed the most recent match. This cannot be combined with
+                     :obj:`draft_model`.
                    callback: Optional function that is called for each generated token when
                      :obj:`beam_size` is 1. If the callback function returns ``True``, the
                      decoding will stop for this batch index.
@@ -352,6 +446,59 @@ namespace ctranslate2 {
                    keep_cache: If ``True``, the model cache in the CPU memory is not deleted if it exists.
              )pbdoc")
 
+        .def("load_adapter", &GeneratorWrapper::load_adapter,
+             py::arg("name"),
+             py::arg("variables"),
+             py::kw_only(),
+             py::arg("scale")=1,
+             py::call_guard<py::gil_scoped_release>(),
+             R"pbdoc(
+                 Loads a LoRA adapter that can be selected with the argument :obj:`adapters`
+                 of :meth:`ctranslate2.Generator.generate_batch`. An adapter with the same name
+                 is replaced.
+
+                 The output of an adapted linear layer with the weight ``W`` becomes
+                 ``x W^T + scale * (x A^T) B^T``.
+
+                 Arguments:
+                   name: Name of the adapter.
+                   variables: Dictionary mapping the variable names to the low-rank matrices.
+                     The matrices ``A`` with shape ``[rank, input_size]`` and ``B`` with shape
+                     ``[output_size, rank]`` of a linear layer are named
+                     ``<layer scope>/lora_a`` and ``<layer scope>/lora_b``, for example
+                     ``decoder/layer_0/self_attention/linear_0/lora_a``.
+                   scale: Scale of the low-rank update (usually ``alpha / rank``).
+
+                 Returns:
+                   The names of the adapters that were unloaded because the maximum number of
+                   loaded adapters was reached.
+
+                 Raises:
+                   ValueError: if a layer scope does not match a linear layer of the model.
+             )pbdoc")
+
+        .def("unload_adapter", &GeneratorWrapper::unload_adapter,
+             py::arg("name"),
+             R"pbdoc(
+                 Unloads a LoRA adapter. The running generations using this adapter are not
+                 affected.
+
+                 Arguments:
+                   name: Name of the adapter.
+
+                 Returns:
+                   ``True`` if the adapter was loaded.
+             )pbdoc")
+
+        .def_property_readonly("loaded_adapters", &GeneratorWrapper::loaded_adapters,
+                               "Names of the loaded LoRA adapters, from the most to the least "
+                               "recently used.")
+        .def_property("max_loaded_adapters",
+                      &GeneratorWrapper::get_max_loaded_adapters,
+                      &GeneratorWrapper::set_max_loaded_adapters,
+                      "Maximum number of loaded LoRA adapters (0 for unlimited). The least "
+                      "recently used adapters are unloaded first.")
+
         .def_property_readonly("model_is_loaded", &GeneratorWrapper::model_is_loaded,
                                "Whether the model is loaded on the initial device and ready to be used.")
         ;
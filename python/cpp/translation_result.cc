@@ -18,6 +18,12 @@ namespace ctranslate2 {
                       "Attention matrix of each translation hypothesis (empty if :obj:`return_attention` was disabled).")
         .def_readonly("logits", &TranslationResult::logits,
                       "Logits of each translation hypothesis (empty if :obj:`return_logits_vocab` was disabled).")
+        .def_readonly("num_draft_tokens", &TranslationResult::num_draft_tokens,
+                      "Number of tokens proposed in speculative decoding.")
+        .def_readonly("num_accepted_draft_tokens", &TranslationResult::num_accepted_draft_tokens,
+                      "Number of proposed tokens that were accepted in speculative decoding.")
+        .def_property_readonly("draft_acceptance_rate", &TranslationResult::draft_acceptance_rate,
+                               "Ratio of accepted tokens in speculative decoding.")
 
         .def("__repr__", [](const TranslationResult& result) {
           return "TranslationResult(hypotheses=" + std::string(py::repr(py::cast(result.hypotheses)))
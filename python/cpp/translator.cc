@@ -38,6 +38,8 @@ namespace ctranslate2 {
                      const std::string& batch_type_str,
                      size_t beam_size,
                      float patience,
+                     size_t num_beam_groups,
+                     float diversity_penalty,
                      size_t num_hypotheses,
                      float length_penalty,
                      float coverage_penalty,
@@ -69,6 +71,8 @@ namespace ctranslate2 {
         TranslationOptions options;
         options.beam_size = beam_size;
         options.patience = patience;
+        options.num_beam_groups = num_beam_groups;
+        options.diversity_penalty = diversity_penalty;
         options.length_penalty = length_penalty;
         options.coverage_penalty = coverage_penalty;
         options.repetition_penalty = repetition_penalty;
@@ -126,6 +130,8 @@ namespace ctranslate2 {
                       bool asynchronous,
                       size_t beam_size,
                       float patience,
+                      size_t num_beam_groups,
+                      float diversity_penalty,
                       size_t num_hypotheses,
                       float length_penalty,
                       float coverage_penalty,
@@ -140,6 +146,7 @@ namespace ctranslate2 {
                       size_t max_decoding_length,
                       size_t min_decoding_length,
                       bool use_vmap,
+                      bool cache_encoder_output,
                       bool return_scores,
                       bool return_logits_vocab,
                       bool return_attention,
@@ -149,6 +156,9 @@ namespace ctranslate2 {
                       float sampling_topp,
                       float sampling_temperature,
                       bool replace_unknowns,
+                      TranslatorWrapper* draft_model,
+                      size_t num_speculative_tokens,
+                      size_t prompt_lookup_ngram_size,
                       std::function<bool(GenerationStepResult)> callback) {
         if (source.empty())
           return {};
@@ -157,6 +167,8 @@ namespace ctranslate2 {
         TranslationOptions options;
         options.beam_size = beam_size;
         options.patience = patience;
+        options.num_beam_groups = num_beam_groups;
+        options.diversity_penalty = diversity_penalty;
         options.length_penalty = length_penalty;
         options.coverage_penalty = coverage_penalty;
         options.repetition_penalty = repetition_penalty;
@@ -171,6 +183,7 @@ namespace ctranslate2 {
         options.min_decoding_length = min_decoding_length;
         options.num_hypotheses = num_hypotheses;
         options.use_vmap = use_vmap;
+        options.cache_encoder_output = cache_encoder_output;
         options.return_end_token = return_end_token;
         options.return_scores = return_scores;
         options.return_logits_vocab = return_logits_vocab;
@@ -178,6 +191,8 @@ namespace ctranslate2 {
         options.return_alternatives = return_alternatives;
         options.min_alternative_expansion_prob = min_alternative_expansion_prob;
         options.replace_unknowns = replace_unknowns;
+        options.num_speculative_tokens = num_speculative_tokens;
+        options.prompt_lookup_ngram_size = prompt_lookup_ngram_size;
         options.callback = std::move(callback);
         if (suppress_sequences)
           options.suppress_sequences = suppress_sequences.value();
@@ -187,6 +202,15 @@ namespace ctranslate2 {
         std::shared_lock lock(_mutex);
         assert_model_is_ready();
 
+        std::shared_lock<std::shared_mutex> draft_lock;
+        if (draft_model) {
+          if (draft_model == this)
+            throw std::invalid_argument("The draft model should be a different translator");
+          draft_lock = std::shared_lock(draft_model->_mutex);
+          draft_model->assert_model_is_ready();
+          options.draft_model = draft_model->model();
+        }
+
         auto futures = _pool->translate_batch_async(source,
                                                     finalize_optional_batch(target_prefix),
                                                     options,
@@ -341,6 +365,8 @@ namespace ctranslate2 {
              py::arg("asynchronous")=false,
              py::arg("beam_size")=2,
              py::arg("patience")=1,
+             py::arg("num_beam_groups")=1,
+             py::arg("diversity_penalty")=0,
              py::arg("num_hypotheses")=1,
              py::arg("length_penalty")=1,
              py::arg("coverage_penalty")=0,
@@ -355,6 +381,7 @@ namespace ctranslate2 {
              py::arg("max_decoding_length")=256,
              py::arg("min_decoding_length")=1,
              py::arg("use_vmap")=false,
+             py::arg("cache_encoder_output")=false,
              py::arg("return_scores")=false,
              py::arg("return_logits_vocab")=false,
              py::arg("return_attention")=false,
@@ -364,6 +391,9 @@ namespace ctranslate2 {
              py::arg("sampling_topp")=1,
              py::arg("sampling_temperature")=1,
              py::arg("replace_unknowns")=false,
+             py::arg("draft_model")=py::none(),
+             py::arg("num_speculative_tokens")=4,
+             py::arg("prompt_lookup_ngram_size")=0,
              py::arg("callback")=nullptr,
              py::call_guard<py::gil_scoped_release>(),
              R"pbdoc(
@@ -382,6 +412,11 @@ namespace ctranslate2 {
                    patience: Beam search patience factor, as described in
                      https://arxiv.org/abs/2204.05424. The decoding will continue until
                      beam_size*patience hypotheses are finished.
+                   num_beam_groups: Number of groups for diverse beam search, as described in
+                     https://arxiv.org/abs/1610.02424. :obj:`beam_size` should be a multiple of
+                     this value.
+                   diversity_penalty: Penalty applied in diverse beam search to the tokens
+                     selected by the previous groups at the same step.
                    num_hypotheses: Number of hypotheses to return.
                    length_penalty: Exponential penalty applied to the length during beam search.
                    coverage_penalty: Coverage penalty weight applied during beam search.
@@ -398,6 +433,9 @@ namespace ctranslate2 {
                    max_decoding_length: Maximum prediction length.
                    min_decoding_length: Minimum prediction length.
                    use_vmap: Use the vocabulary mapping file saved in this model
+                   cache_encoder_output: Reuse the encoder outputs cached for the same source
+                     and cache the new outputs. The cache size can be limited with the
+                     environment variable ``CT2_ENCODER_OUTPUT_CACHE_SIZE_MB``.
                    return_scores: Include the scores in the output.
                    return_logits_vocab: Include the log probs of each token in the output
                    return_attention: Include the attention vectors in the output.
@@ -408,6 +446,17 @@ namespace ctranslate2 {
                      this value.
                    sampling_temperature: Sampling temperature to generate more random samples.
                    replace_unknowns: Replace unknown target tokens by the source token with the highest attention.
+                   draft_model: A smaller translator proposing the next tokens that are then
+                     verified by this model in a single forward (speculative decoding). It should
+                     use the same target vocabulary and be loaded on the same device. This only
+                     applies when :obj:`beam_size` is 1.
+                   num_speculative_tokens: Number of tokens proposed by the draft model before
+                     each verification.
+                   prompt_lookup_ngram_size: Propose the next tokens without a draft model by
+                     looking up the last generated n-gram (up to this size) in the source and
+                     the previous tokens (set 0 to disable). The proposed tokens are the ones
+                     that followed the most recent match. This cannot be combined with
+                     :obj:`draft_model`.
                    callback: Optional function that is called for each generated token when
                      :obj:`beam_size` is 1. If the callback function returns ``True``, the
                      decoding will stop for this batch.
@@ -429,6 +478,8 @@ namespace ctranslate2 {
              py::arg("batch_type")="examples",
              py::arg("beam_size")=2,
              py::arg("patience")=1,
+             py::arg("num_beam_groups")=1,
+             py::arg("diversity_penalty")=0,
              py::arg("num_hypotheses")=1,
              py::arg("length_penalty")=1,
              py::arg("coverage_penalty")=0,
@@ -469,6 +520,11 @@ namespace ctranslate2 {
                    patience: Beam search patience factor, as described in
                      https://arxiv.org/abs/2204.05424. The decoding will continue until
                      beam_size*patience hypotheses are finished.
+                   num_beam_groups: Number of groups for diverse beam search, as described in
+                     https://arxiv.org/abs/1610.02424. :obj:`beam_size` should be a multiple of
+                     this value.
+                   diversity_penalty: Penalty applied in diverse beam search to the tokens
+                     selected by the previous groups at the same step.
                    num_hypotheses: Number of hypotheses to return.
                    length_penalty: Exponential penalty applied to the length during beam search.
                    coverage_penalty: Coverage penalty weight applied during beam search.
@@ -16,10 +16,75 @@ namespace ctranslate2 {
         assert_model_is_ready();
         return _pool->encode(features, to_cpu).get();
       }
+
+      std::vector<CTCDecodingResult>
+      decode_ctc(const StorageView& features,
+                 size_t beam_size,
+                 size_t num_hypotheses,
+                 size_t blank_id,
+                 float min_token_log_prob,
+                 std::shared_ptr<NGramLanguageModel> language_model,
+                 float lm_weight,
+                 float token_score) {
+        CTCDecodingOptions options;
+        options.beam_size = beam_size;
+        options.num_hypotheses = num_hypotheses;
+        options.blank_id = blank_id;
+        options.min_token_log_prob = min_token_log_prob;
+        options.language_model = std::move(language_model);
+        options.lm_weight = lm_weight;
+        options.token_score = token_score;
+
+        std::shared_lock lock(_mutex);
+        assert_model_is_ready();
+        return _pool->decode_ctc(features, options).get();
+      }
     };
 
 
     void register_wav2vec2(py::module& m) {
+      py::class_<NGramLanguageModel, std::shared_ptr<NGramLanguageModel>>(
+        m, "NGramLanguageModel",
+        R"pbdoc(
+            Backoff n-gram language model used to rescore the CTC beam search.
+        )pbdoc")
+
+        .def(py::init([](const std::string& path) {
+               return std::const_pointer_cast<NGramLanguageModel>(
+                 NGramLanguageModel::from_arpa_file(path));
+             }),
+             py::arg("path"),
+             py::call_guard<py::gil_scoped_release>(),
+             R"pbdoc(
+                 Loads a language model in the ARPA format.
+
+                 Arguments:
+                   path: Path to the ARPA file. The words are the model vocabulary tokens.
+             )pbdoc")
+
+        .def_property_readonly("order", &NGramLanguageModel::order,
+                               "Order of the language model.")
+        .def_property_readonly("num_words", &NGramLanguageModel::num_words,
+                               "Number of words in the language model.")
+        ;
+
+      py::class_<CTCDecodingResult>(m, "CTCDecodingResult", "A CTC decoding result.")
+
+        .def_readonly("sequences", &CTCDecodingResult::sequences,
+                      "Decoded sequences of tokens.")
+        .def_readonly("sequences_ids", &CTCDecodingResult::sequences_ids,
+                      "Decoded sequences of token IDs.")
+        .def_readonly("scores", &CTCDecodingResult::scores,
+                      "Score of each sequence.")
+
+        .def("__repr__", [](const CTCDecodingResult& result) {
+          return "CTCDecodingResult(sequences=" + std::string(py::repr(py::cast(result.sequences)))
+            + ", sequences_ids=" + std::string(py::repr(py::cast(result.sequences_ids)))
+            + ", scores=" + std::string(py::repr(py::cast(result.scores)))
+            + ")";
+        })
+        ;
+
       py::class_<Wav2Vec2Wrapper>(
         m, "Wav2Vec2",
         R"pbdoc(
@@ -94,6 +159,38 @@ namespace ctranslate2 {
                    The encoder output.
              )pbdoc")
 
+        .def("decode_ctc", &Wav2Vec2Wrapper::decode_ctc,
+             py::arg("features"),
+             py::kw_only(),
+             py::arg("beam_size")=1,
+             py::arg("num_hypotheses")=1,
+             py::arg("blank_id")=0,
+             py::arg("min_token_log_prob")=-10,
+             py::arg("language_model")=nullptr,
+             py::arg("lm_weight")=0.5,
+             py::arg("token_score")=0,
+             py::call_guard<py::gil_scoped_release>(),
+             R"pbdoc(
+                 Encodes the input features and decodes the CTC output. The batch is decoded
+                 in parallel on the CPU.
+
+                 Arguments:
+                   features: Input features, with the same format as :meth:`encode`.
+                   beam_size: Beam size (1 for greedy search).
+                   num_hypotheses: Number of hypotheses to return.
+                   blank_id: Index of the CTC blank token.
+                   min_token_log_prob: Tokens with a lower log probability are not expanded
+                     by the beam search.
+                   language_model: Optional :class:`ctranslate2.models.NGramLanguageModel`
+                     combined with the model scores during the beam search. The language
+                     model words are the vocabulary tokens.
+                   lm_weight: Weight of the language model score.
+                   token_score: Score added for each emitted token.
+
+                 Returns:
+                   A list of :class:`ctranslate2.models.CTCDecodingResult`.
+             )pbdoc")
+
         .def("unload_model", &Wav2Vec2Wrapper::unload_model,
              py::arg("to_cpu")=false,
              py::call_guard<py::gil_scoped_release>(),
@@ -16,6 +16,29 @@ namespace ctranslate2 {
         assert_model_is_ready();
         return _pool->encode(features, to_cpu).get();
       }
+
+      std::vector<CTCDecodingResult>
+      decode_ctc(const StorageView& features,
+                 size_t beam_size,
+                 size_t num_hypotheses,
+                 size_t blank_id,
+                 float min_token_log_prob,
+                 std::shared_ptr<NGramLanguageModel> language_model,
+                 float lm_weight,
+                 float token_score) {
+        CTCDecodingOptions options;
+        options.beam_size = beam_size;
+        options.num_hypotheses = num_hypotheses;
+        options.blank_id = blank_id;
+        options.min_token_log_prob = min_token_log_prob;
+        options.language_model = std::move(language_model);
+        options.lm_weight = lm_weight;
+        options.token_score = token_score;
+
+        std::shared_lock lock(_mutex);
+        assert_model_is_ready();
+        return _pool->decode_ctc(features, options).get();
+      }
     };
 
 
@@ -94,6 +117,38 @@ namespace ctranslate2 {
                    The encoder output.
              )pbdoc")
 
+        .def("decode_ctc", &Wav2Vec2BertWrapper::decode_ctc,
+             py::arg("features"),
+             py::kw_only(),
+             py::arg("beam_size")=1,
+             py::arg("num_hypotheses")=1,
+             py::arg("blank_id")=0,
+             py::arg("min_token_log_prob")=-10,
+             py::arg("language_model")=nullptr,
+             py::arg("lm_weight")=0.5,
+             py::arg("token_score")=0,
+             py::call_guard<py::gil_scoped_release>(),
+             R"pbdoc(
+                 Encodes the input features and decodes the CTC output. The batch is decoded
+                 in parallel on the CPU.
+
+                 Arguments:
+                   features: Input features, with the same format as :meth:`encode`.
+                   beam_size: Beam size (1 for greedy search).
+                   num_hypotheses: Number of hypotheses to return.
+                   blank_id: Index of the CTC blank token.
+                   min_token_log_prob: Tokens with a lower log probability are not expanded
+                     by the beam search.
+                   language_model: Optional :class:`ctranslate2.models.NGramLanguageModel`
+                     combined with the model scores during the beam search. The language
+                     model words are the vocabulary tokens.
+                   lm_weight: Weight of the language model score.
+                   token_score: Score added for each emitted token.
+
+                 Returns:
+                   A list of :class:`ctranslate2.models.CTCDecodingResult`.
+             )pbdoc")
+
         .def("unload_model", &Wav2Vec2BertWrapper::unload_model,
              py::arg("to_cpu")=false,
              py::call_guard<py::gil_scoped_release>(),
@@ -7,6 +7,16 @@
 namespace ctranslate2 {
   namespace python {
 
+    static std::vector<size_t>
+    get_batch_num_frames(const std::optional<std::variant<size_t, std::vector<size_t>>>& num_frames,
+                         const dim_t batch_size) {
+      if (!num_frames)
+        return {};
+      if (num_frames->index() == 0)
+        return std::vector<size_t>(batch_size, std::get<size_t>(*num_frames));
+      return std::get<std::vector<size_t>>(*num_frames);
+    }
+
     class WhisperWrapper : public ReplicaPoolHelper<models::Whisper> {
     public:
       using ReplicaPoolHelper::ReplicaPoolHelper;
@@ -23,10 +33,18 @@ namespace ctranslate2 {
         return _pool->num_languages();
       }
 
-      StorageView encode(const StorageView& features, const bool to_cpu) {
-        return _pool->encode(features, to_cpu).get();
+      StorageView encode(const StorageView& features,
+                         const bool to_cpu,
+                         const std::optional<std::variant<size_t, std::vector<size_t>>>& num_frames,
+                         size_t min_frames) {
+        return _pool->encode(features,
+                             to_cpu,
+                             get_batch_num_frames(num_frames, features.dim(0)),
+                             min_frames).get();
       }
 
+      // The input is the audio samples when FromAudio is true, and the features otherwise.
+      template <bool FromAudio>
       std::variant<std::vector<models::WhisperGenerationResult>,
                    std::vector<AsyncResult<models::WhisperGenerationResult>>>
       generate(const StorageView& features,
@@ -42,6 +60,12 @@ namespace ctranslate2 {
                bool return_scores,
                bool return_logits_vocab,
                bool return_no_speech_prob,
+               bool detect_language,
+               bool return_alignments,
+               const std::optional<std::variant<size_t, std::vector<size_t>>>& num_frames,
+               size_t median_filter_width,
+               bool dynamic_encoder_length,
+               size_t min_encoder_frames,
                size_t max_initial_timestamp_index,
                bool suppress_blank,
                const std::optional<std::vector<int>>& suppress_tokens,
@@ -62,6 +86,12 @@ namespace ctranslate2 {
         options.return_scores = return_scores;
         options.return_logits_vocab = return_logits_vocab;
         options.return_no_speech_prob = return_no_speech_prob;
+        options.detect_language = detect_language;
+        options.return_alignments = return_alignments;
+        options.median_filter_width = median_filter_width;
+        options.num_frames = get_batch_num_frames(num_frames, features.dim(0));
+        options.dynamic_encoder_length = dynamic_encoder_length;
+        options.min_encoder_frames = min_encoder_frames;
         options.max_initial_timestamp_index = max_initial_timestamp_index;
         options.suppress_blank = suppress_blank;
 
@@ -72,10 +102,17 @@ namespace ctranslate2 {
         std::shared_lock lock(_mutex);
         assert_model_is_ready();
 
-        if (prompts.index() == 0)
-          futures = _pool->generate(features, std::get<BatchTokens>(prompts), options);
-        else
-          futures = _pool->generate(features, std::get<BatchIds>(prompts), options);
+        if constexpr (FromAudio) {
+          if (prompts.index() == 0)
+            futures = _pool->generate_from_audio(features, std::get<BatchTokens>(prompts), options);
+          else
+            futures = _pool->generate_from_audio(features, std::get<BatchIds>(prompts), options);
+        } else {
+          if (prompts.index() == 0)
+            futures = _pool->generate(features, std::get<BatchTokens>(prompts), options);
+          else
+            futures = _pool->generate(features, std::get<BatchIds>(prompts), options);
+        }
 
         return maybe_wait_on_futures(std::move(futures), asynchronous);
       }
@@ -111,6 +148,40 @@ namespace ctranslate2 {
                                     median_filter_width);
         return wait_on_futures(std::move(futures));
       }
+
+      std::variant<std::vector<models::WhisperStreamingResult>,
+                   std::vector<AsyncResult<models::WhisperStreamingResult>>>
+      transcribe_streams(const std::vector<std::shared_ptr<models::WhisperStream>>& streams,
+                         bool asynchronous,
+                         size_t beam_size,
+                         float patience,
+                         float length_penalty,
+                         float repetition_penalty,
+                         size_t no_repeat_ngram_size,
+                         size_t max_length,
+                         size_t max_initial_timestamp_index,
+                         bool suppress_blank,
+                         const std::optional<std::vector<int>>& suppress_tokens) {
+        models::WhisperOptions options;
+        options.beam_size = beam_size;
+        options.patience = patience;
+        options.length_penalty = length_penalty;
+        options.repetition_penalty = repetition_penalty;
+        options.no_repeat_ngram_size = no_repeat_ngram_size;
+        options.max_length = max_length;
+        options.max_initial_timestamp_index = max_initial_timestamp_index;
+        options.suppress_blank = suppress_blank;
+
+        if (suppress_tokens)
+          options.suppress_tokens = suppress_tokens.value();
+        else
+          options.suppress_tokens.clear();
+        std::shared_lock lock(_mutex);
+        assert_model_is_ready();
+
+        auto futures = _pool->transcribe_streams(streams, options);
+        return maybe_wait_on_futures(std::move(futures), asynchronous);
+      }
     };
 
 
@@ -128,12 +199,21 @@ namespace ctranslate2 {
                       "logits in each sequence (empty if :obj:`return_logits_vocab` was disabled).")
         .def_readonly("no_speech_prob", &models::WhisperGenerationResult::no_speech_prob,
                       "Probability of the no speech token (0 if :obj:`return_no_speech_prob` was disabled).")
+        .def_readonly("language", &models::WhisperGenerationResult::language,
+                      "Detected language token (empty if :obj:`detect_language` was disabled).")
+        .def_readonly("language_prob", &models::WhisperGenerationResult::language_prob,
+                      "Probability of the detected language (0 if :obj:`detect_language` was disabled).")
+        .def_readonly("alignments", &models::WhisperGenerationResult::alignments,
+                      "List of aligned text and time indices for each sequence "
+                      "(empty if :obj:`return_alignments` was disabled).")
 
         .def("__repr__", [](const models::WhisperGenerationResult& result) {
           return "WhisperGenerationResult(sequences=" + std::string(py::repr(py::cast(result.sequences)))
             + ", sequences_ids=" + std::string(py::repr(py::cast(result.sequences_ids)))
             + ", scores=" + std::string(py::repr(py::cast(result.scores)))
             + ", no_speech_prob=" + std::string(py::repr(py::cast(result.no_speech_prob)))
+            + ", language=" + std::string(py::repr(py::cast(result.language)))
+            + ", language_prob=" + std::string(py::repr(py::cast(result.language_prob)))
             + ")";
         })
         ;
@@ -155,6 +235,103 @@ namespace ctranslate2 {
         })
         ;
 
+      py::class_<models::WhisperStreamSegment>(m, "WhisperStreamSegment",
+                                               "A segment committed by a Whisper stream.")
+
+        .def_readonly("start", &models::WhisperStreamSegment::start,
+                      "Start time of the segment in seconds.")
+        .def_readonly("end", &models::WhisperStreamSegment::end,
+                      "End time of the segment in seconds.")
+        .def_readonly("tokens", &models::WhisperStreamSegment::tokens,
+                      "Text tokens of the segment.")
+        .def_readonly("tokens_ids", &models::WhisperStreamSegment::tokens_ids,
+                      "Text token IDs of the segment.")
+
+        .def("__repr__", [](const models::WhisperStreamSegment& segment) {
+          return "WhisperStreamSegment(start=" + std::string(py::repr(py::cast(segment.start)))
+            + ", end=" + std::string(py::repr(py::cast(segment.end)))
+            + ", tokens=" + std::string(py::repr(py::cast(segment.tokens)))
+            + ")";
+        })
+        ;
+
+      py::class_<models::WhisperStreamingResult>(m, "WhisperStreamingResult",
+                                                 "An update of a Whisper stream.")
+
+        .def_readonly("segments", &models::WhisperStreamingResult::segments,
+                      "Segments committed by this update.")
+        .def_readonly("partial", &models::WhisperStreamingResult::partial,
+                      "Tentative transcription of the audio that is not committed yet.")
+        .def_readonly("partial_ids", &models::WhisperStreamingResult::partial_ids,
+                      "Token IDs of the tentative transcription.")
+        .def_readonly("finished", &models::WhisperStreamingResult::finished,
+                      "``True`` if the stream ended and all its audio is transcribed.")
+
+        .def("__repr__", [](const models::WhisperStreamingResult& result) {
+          return "WhisperStreamingResult(segments=" + std::string(py::repr(py::cast(result.segments)))
+            + ", partial=" + std::string(py::repr(py::cast(result.partial)))
+            + ", finished=" + std::string(py::repr(py::cast(result.finished)))
+            + ")";
+        })
+        ;
+
+      declare_async_wrapper<models::WhisperStreamingResult>(m, "WhisperStreamingResultAsync");
+
+      py::class_<models::WhisperStream, std::shared_ptr<models::WhisperStream>>(
+        m, "WhisperStream",
+        R"pbdoc(
+            Audio stream transcribed incrementally by :meth:`ctranslate2.models.Whisper.transcribe_streams`.
+
+            The mel frames are buffered as they arrive and transcribed in windows of 30 seconds.
+            Until the window is full, each update returns a partial transcription. When the
+            window is full or the stream ended, the complete segments are committed.
+        )pbdoc")
+
+        .def(py::init([](std::vector<std::string> prompt,
+                         size_t partial_interval,
+                         bool condition_on_previous_text,
+                         size_t max_previous_tokens) {
+               models::WhisperStreamingOptions options;
+               options.partial_interval = partial_interval;
+               options.condition_on_previous_text = condition_on_previous_text;
+               options.max_previous_tokens = max_previous_tokens;
+               return std::make_shared<models::WhisperStream>(std::move(prompt), options);
+             }),
+             py::arg("prompt"),
+             py::kw_only(),
+             py::arg("partial_interval")=100,
+             py::arg("condition_on_previous_text")=true,
+             py::arg("max_previous_tokens")=223,
+             R"pbdoc(
+                 Creates a stream.
+
+                 Arguments:
+                   prompt: Task tokens starting with ``<|startoftranscript|>``, for example
+                     ``["<|startoftranscript|>", "<|en|>", "<|transcribe|>"]``.
+                   partial_interval: Number of new mel frames after which the partial
+                     transcription is updated.
+                   condition_on_previous_text: Include the committed text in the prompt of
+                     the next windows.
+                   max_previous_tokens: Maximum number of previous text tokens in the prompt.
+             )pbdoc")
+
+        .def("append_features", &models::WhisperStream::append_features,
+             py::arg("features"),
+             R"pbdoc(
+                 Appends mel frames with shape ``[n_mels, num_frames]``.
+             )pbdoc")
+        .def("end_of_stream", &models::WhisperStream::end_of_stream,
+             "Marks the end of the audio.")
+        .def_property_readonly("has_pending_update", &models::WhisperStream::has_pending_update,
+                               "``True`` if the stream should be updated.")
+        .def_property_readonly("finished", &models::WhisperStream::is_finished,
+                               "``True`` if all the audio is transcribed.")
+        .def_property_readonly("num_buffered_frames", &models::WhisperStream::num_buffered_frames,
+                               "Number of frames that are not committed yet.")
+        .def_property_readonly("transcription", &models::WhisperStream::transcription,
+                               "Text tokens committed so far.")
+        ;
+
       py::class_<WhisperWrapper>(
         m, "Whisper",
         R"pbdoc(
@@ -225,6 +402,9 @@ namespace ctranslate2 {
         .def("encode", &WhisperWrapper::encode,
              py::arg("features"),
              py::arg("to_cpu")=false,
+             py::kw_only(),
+             py::arg("num_frames")=py::none(),
+             py::arg("min_frames")=1000,
              py::call_guard<py::gil_scoped_release>(),
              R"pbdoc(
                  Encodes the input features.
@@ -233,12 +413,17 @@ namespace ctranslate2 {
                    features: Mel spectogram of the audio, as a float array with shape
                      ``[batch_size, n_mels, chunk_length]``.
                    to_cpu: Copy the encoder output to the CPU before returning the value.
+                   num_frames: Number of non padding frames in the features. When set, the
+                     features are encoded up to the last non padding frame of the batch so
+                     that short audio is encoded in proportion to its length.
+                   min_frames: Minimum number of frames to encode when :obj:`num_frames` is set,
+                     since the model quality degrades with very short audio contexts.
 
                  Returns:
                    The encoder output.
              )pbdoc")
 
-        .def("generate", &WhisperWrapper::generate,
+        .def("generate", &WhisperWrapper::generate<false>,
              py::arg("features"),
              py::arg("prompts"),
              py::kw_only(),
@@ -253,6 +438,12 @@ namespace ctranslate2 {
              py::arg("return_scores")=false,
              py::arg("return_logits_vocab")=false,
              py::arg("return_no_speech_prob")=false,
+             py::arg("detect_language")=false,
+             py::arg("return_alignments")=false,
+             py::arg("num_frames")=py::none(),
+             py::arg("median_filter_width")=7,
+             py::arg("dynamic_encoder_length")=false,
+             py::arg("min_encoder_frames")=1000,
              py::arg("max_initial_timestamp_index")=50,
              py::arg("suppress_blank")=true,
              py::arg("suppress_tokens")=std::vector<int>{-1},
@@ -284,6 +475,20 @@ namespace ctranslate2 {
                    return_logits_vocab: Include the log probs in the output
                    return_no_speech_prob: Include the probability of the no speech token in the
                      result.
+                   detect_language: Detect the language of each batch in the same pass and insert
+                     the language token after ``<|startoftranscript|>`` when the prompt does not
+                     include one. The language is returned in the result.
+                   return_alignments: Record the cross-attention of the alignment heads while
+                     decoding and include the alignments in the result, as returned by
+                     :meth:`ctranslate2.models.Whisper.align`. The text indices refer to the
+                     tokens of each sequence followed by the end of text token.
+                   num_frames: Number of non padding frames in the features, used for the
+                     alignments (all frames by default).
+                   median_filter_width: Width of the median filter kernel for the alignments.
+                   dynamic_encoder_length: Encode the features up to the last non padding frame
+                     of the batch, as given by :obj:`num_frames`, instead of the full window.
+                   min_encoder_frames: Minimum number of frames to encode when
+                     :obj:`dynamic_encoder_length` is enabled.
                    max_initial_timestamp_index: Maximum index of the first predicted timestamp.
                    suppress_blank: Suppress blank outputs at the beginning of the sampling.
                    suppress_tokens: List of token IDs to suppress. -1 will suppress a default set
@@ -295,6 +500,49 @@ namespace ctranslate2 {
                    A list of generation results.
              )pbdoc")
 
+        .def("generate_from_audio", &WhisperWrapper::generate<true>,
+             py::arg("audio"),
+             py::arg("prompts"),
+             py::kw_only(),
+             py::arg("asynchronous")=false,
+             py::arg("beam_size")=5,
+             py::arg("patience")=1,
+             py::arg("num_hypotheses")=1,
+             py::arg("length_penalty")=1,
+             py::arg("repetition_penalty")=1,
+             py::arg("no_repeat_ngram_size")=0,
+             py::arg("max_length")=448,
+             py::arg("return_scores")=false,
+             py::arg("return_logits_vocab")=false,
+             py::arg("return_no_speech_prob")=false,
+             py::arg("detect_language")=false,
+             py::arg("return_alignments")=false,
+             py::arg("num_frames")=py::none(),
+             py::arg("median_filter_width")=7,
+             py::arg("dynamic_encoder_length")=false,
+             py::arg("min_encoder_frames")=1000,
+             py::arg("max_initial_timestamp_index")=50,
+             py::arg("suppress_blank")=true,
+             py::arg("suppress_tokens")=std::vector<int>{-1},
+             py::arg("sampling_topk")=1,
+             py::arg("sampling_temperature")=1,
+             py::call_guard<py::gil_scoped_release>(),
+             R"pbdoc(
+                 Computes the log-Mel spectrogram of the audio in the model workers and
+                 generates from the given prompt.
+
+                 The feature extraction runs in C++ without holding the GIL. The other
+                 arguments are the same as :meth:`ctranslate2.models.Whisper.generate`.
+
+                 Arguments:
+                   audio: Audio samples at 16 kHz, as a float array with shape
+                     ``[batch_size, num_samples]``. The audio is padded to 30 seconds.
+                   prompts: Batch of initial string tokens or token IDs.
+
+                 Returns:
+                   A list of generation results.
+             )pbdoc")
+
         .def("detect_language", &WhisperWrapper::detect_language,
              py::arg("features"),
              py::call_guard<py::gil_scoped_release>(),
@@ -340,6 +588,49 @@ namespace ctranslate2 {
                    A list of alignment results.
              )pbdoc")
 
+        .def("transcribe_streams", &WhisperWrapper::transcribe_streams,
+             py::arg("streams"),
+             py::kw_only(),
+             py::arg("asynchronous")=false,
+             py::arg("beam_size")=5,
+             py::arg("patience")=1,
+             py::arg("length_penalty")=1,
+             py::arg("repetition_penalty")=1,
+             py::arg("no_repeat_ngram_size")=0,
+             py::arg("max_length")=448,
+             py::arg("max_initial_timestamp_index")=50,
+             py::arg("suppress_blank")=true,
+             py::arg("suppress_tokens")=std::vector<int>{-1},
+             py::call_guard<py::gil_scoped_release>(),
+             R"pbdoc(
+                 Transcribes the new audio of the streams.
+
+                 The streams with a pending update are batched by prompt length and run on the
+                 model workers. The other streams get an empty result. A stream should not be
+                 passed again before its previous result is ready.
+
+                 Arguments:
+                   streams: List of :class:`ctranslate2.models.WhisperStream`.
+                   asynchronous: Run the model asynchronously.
+                   beam_size: Beam size (1 for greedy search).
+                   patience: Beam search patience factor, as described in
+                     https://arxiv.org/abs/2204.05424. The decoding will continue until
+                     beam_size*patience hypotheses are finished.
+                   length_penalty: Exponential penalty applied to the length during beam search.
+                   repetition_penalty: Penalty applied to the score of previously generated tokens
+                     (set > 1 to penalize).
+                   no_repeat_ngram_size: Prevent repetitions of ngrams with this size
+                     (set 0 to disable).
+                   max_length: Maximum generation length.
+                   max_initial_timestamp_index: Maximum index of the first predicted timestamp.
+                   suppress_blank: Suppress blank outputs at the beginning of the sampling.
+                   suppress_tokens: List of token IDs to suppress. -1 will suppress a default set
+                     of symbols as defined in the model ``config.json`` file.
+
+                 Returns:
+                   One streaming result per stream.
+             )pbdoc")
+
         .def("unload_model", &WhisperWrapper::unload_model,
              py::arg("to_cpu")=false,
              py::call_guard<py::gil_scoped_release>(),
@@ -24,7 +24,9 @@ try:
         AsyncTranslationResult,
         DataType,
         Device,
+        EmbeddingOutput,
         Encoder,
+        EncoderClassificationOutput,
         EncoderForwardOutput,
         ExecutionStats,
         GenerationResult,
@@ -219,6 +219,9 @@ def translator_generate_tokens(
     end_token: Optional[Union[str, List[str], List[int]]] = None,
     max_input_length: int = 1024,
     use_vmap: bool = False,
+    draft_model: Optional[Translator] = None,
+    num_speculative_tokens: int = 4,
+    prompt_lookup_ngram_size: int = 0,
 ) -> Iterable[GenerationStepResult]:
     """Yields tokens as they are generated by the model.
 
@@ -240,6 +243,13 @@ def translator_generate_tokens(
       end_token: Stop the decoding on one of these tokens (defaults to the model EOS token).
       max_input_length: Truncate inputs after this many tokens (set 0 to disable).
       use_vmap: Use the vocabulary mapping file saved in this model
+      draft_model: A smaller translator proposing the next tokens that are then
+        verified by this model (speculative decoding).
+      num_speculative_tokens: Number of tokens proposed by the draft model before
+        each verification.
+      prompt_lookup_ngram_size: Propose the next tokens without a draft model by
+        looking up the last generated n-gram (up to this size) in the source and the
+        previous tokens (set 0 to disable).
 
     Returns:
       A generator iterator over :class:`ctranslate2.GenerationStepResult` instances.
@@ -264,6 +274,9 @@ def translator_generate_tokens(
         return_scores=return_log_prob,
         max_input_length=max_input_length,
         use_vmap=use_vmap,
+        draft_model=draft_model,
+        num_speculative_tokens=num_speculative_tokens,
+        prompt_lookup_ngram_size=prompt_lookup_ngram_size,
     )
 
 
@@ -283,9 +296,16 @@ def generator_generate_tokens(
     no_repeat_ngram_size: int = 0,
     disable_unk: bool = False,
     suppress_sequences: Optional[List[List[str]]] = None,
+    regex_constraint: str = "",
+    json_schema_constraint: str = "",
     end_token: Optional[Union[str, List[str], List[int]]] = None,
     static_prompt: Optional[List[str]] = None,
     cache_static_prompt: bool = True,
+    cache_prompt: bool = False,
+    adapters: Optional[List[Optional[str]]] = None,
+    draft_model: Optional[Generator] = None,
+    num_speculative_tokens: int = 4,
+    prompt_lookup_ngram_size: int = 0,
     callback: Callable[[GenerationStepResult], bool] = None,
 ) -> Iterable[GenerationStepResult]:
     """Yields tokens as they are generated by the model.
@@ -307,12 +327,26 @@ def generator_generate_tokens(
         (set 0 to disable).
       disable_unk: Disable the generation of the unknown token.
       suppress_sequences: Disable the generation of some sequences of tokens.
+      regex_constraint: Constrain the generated text to match this regular expression.
+      json_schema_constraint: Constrain the generated text to a JSON value that validates
+        this JSON schema (passed as a JSON string).
       end_token: Stop the decoding on one these tokens (defaults to the model EOS token).
       static_prompt: If the model expects a static prompt (a.k.a. system prompt)
         it can be set here to simplify the inputs and optionally cache the model
         state for this prompt to accelerate future generations.
       cache_static_prompt: Cache the model state after the static prompt and
         reuse it for future generations using the same static prompt.
+      cache_prompt: Reuse the model state cached for the longest prefix of the prompt
+        and cache the model state after the prompt for future generations.
+      adapters: Name of the LoRA adapter to use for each prompt (``None`` to use
+        the base model).
+      draft_model: A smaller generator proposing the next tokens that are then
+        verified by this model (speculative decoding).
+      num_speculative_tokens: Number of tokens proposed by the draft model before
+        each verification.
+      prompt_lookup_ngram_size: Propose the next tokens without a draft model by
+        looking up the last generated n-gram (up to this size) in the prompt and the
+        previous tokens (set 0 to disable).
       callback: Optional function that is called for each generated token when
         obj:`beam_size` is 1. If the callback function returns ``True``, the
         decoding will stop for this batch index.
@@ -334,6 +368,8 @@ def generator_generate_tokens(
         no_repeat_ngram_size=no_repeat_ngram_size,
         disable_unk=disable_unk,
         suppress_sequences=suppress_sequences,
+        regex_constraint=regex_constraint,
+        json_schema_constraint=json_schema_constraint,
         end_token=end_token,
         max_length=max_length,
         min_length=min_length,
@@ -343,6 +379,11 @@ def generator_generate_tokens(
         return_scores=return_log_prob,
         static_prompt=static_prompt,
         cache_static_prompt=cache_static_prompt,
+        cache_prompt=cache_prompt,
+        adapters=adapters,
+        draft_model=draft_model,
+        num_speculative_tokens=num_speculative_tokens,
+        prompt_lookup_ngram_size=prompt_lookup_ngram_size,
         include_prompt_in_result=False,
         callback=callback,
     )
@@ -364,9 +405,16 @@ async def generator_async_generate_tokens(
     no_repeat_ngram_size: int = 0,
     disable_unk: bool = False,
     suppress_sequences: Optional[List[List[str]]] = None,
+    regex_constraint: str = "",
+    json_schema_constraint: str = "",
     end_token: Optional[Union[str, List[str], List[int]]] = None,
     static_prompt: Optional[List[str]] = None,
     cache_static_prompt: bool = True,
+    cache_prompt: bool = False,
+    adapters: Optional[List[Optional[str]]] = None,
+    draft_model: Optional[Generator] = None,
+    num_speculative_tokens: int = 4,
+    prompt_lookup_ngram_size: int = 0,
     callback: Callable[[GenerationStepResult], bool] = None,
 ) -> AsyncIterable[GenerationStepResult]:
     """Yields tokens asynchronously as they are generated by the model.
@@ -388,12 +436,26 @@ async def generator_async_generate_tokens(
         (set 0 to disable).
       disable_unk: Disable the generation of the unknown token.
       suppress_sequences: Disable the generation of some sequences of tokens.
+      regex_constraint: Constrain the generated text to match this regular expression.
+      json_schema_constraint: Constrain the generated text to a JSON value that validates
+        this JSON schema (passed as a JSON string).
       end_token: Stop the decoding on one of these tokens (defaults to the model EOS token).
       static_prompt: If the model expects a static prompt (a.k.a. system prompt)
         it can be set here to simplify the inputs and optionally cache the model
         state for this prompt to accelerate future generations.
       cache_static_prompt: Cache the model state after the static prompt and
         reuse it for future generations using the same static prompt.
+      cache_prompt: Reuse the model state cached for the longest prefix of the prompt
+        and cache the model state after the prompt for future generations.
+      adapters: Name of the LoRA adapter to use for each prompt (``None`` to use
+        the base model).
+      draft_model: A smaller generator proposing the next tokens that are then
+        verified by this model (speculative decoding).
+      num_speculative_tokens: Number of tokens proposed by the draft model before
+        each verification.
+      prompt_lookup_ngram_size: Propose the next tokens without a draft model by
+        looking up the last generated n-gram (up to this size) in the prompt and the
+        previous tokens (set 0 to disable).
       callback: Optional function that is called for each generated token when
         obj:`beam_size` is 1. If the callback function returns ``True``, the
         decoding will stop for this batch index.
@@ -415,6 +477,8 @@ async def generator_async_generate_tokens(
         no_repeat_ngram_size=no_repeat_ngram_size,
         disable_unk=disable_unk,
         suppress_sequences=suppress_sequences,
+        regex_constraint=regex_constraint,
+        json_schema_constraint=json_schema_constraint,
         end_token=end_token,
         max_length=max_length,
         min_length=min_length,
@@ -424,6 +488,11 @@ async def generator_async_generate_tokens(
         return_scores=return_log_prob,
         static_prompt=static_prompt,
         cache_static_prompt=cache_static_prompt,
+        cache_prompt=cache_prompt,
+        adapters=adapters,
+        draft_model=draft_model,
+        num_speculative_tokens=num_speculative_tokens,
+        prompt_lookup_ngram_size=prompt_lookup_ngram_size,
         include_prompt_in_result=False,
         callback=callback,
     ):
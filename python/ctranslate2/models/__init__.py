@@ -4,11 +4,17 @@ and :class:`ctranslate2.Generator`.
 
 try:
     from ctranslate2._ext import (
+        CTCDecodingResult,
+        NGramLanguageModel,
         Wav2Vec2,
         Wav2Vec2Bert,
         Whisper,
         WhisperGenerationResult,
         WhisperGenerationResultAsync,
+        WhisperStream,
+        WhisperStreamingResult,
+        WhisperStreamingResultAsync,
+        WhisperStreamSegment,
     )
 except ImportError as e:
     # Allow using the Python package without the compiled extension.
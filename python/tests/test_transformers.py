@@ -333,6 +333,114 @@ def test_transformers_encoder(clear_transformers_cache, tmp_dir, device, model_n
         )
 
 
+@test_utils.only_on_linux
+@test_utils.on_available_devices
+@pytest.mark.parametrize("pooling", ["cls", "mean", "max", "last_token"])
+def test_transformers_encoder_embed(clear_transformers_cache, tmp_dir, device, pooling):
+    import transformers
+
+    model_name = "bert-base-uncased"
+    text = ["Hello world!", "Hello, my dog is cute"]
+
+    tokenizer = transformers.AutoTokenizer.from_pretrained(model_name)
+    converter = ctranslate2.converters.TransformersConverter(model_name)
+    output_dir = str(tmp_dir.join("ctranslate2_model"))
+    output_dir = converter.convert(output_dir)
+
+    encoder = ctranslate2.Encoder(output_dir, device=device)
+
+    ids = [tokenizer(t).input_ids for t in text]
+    last_hidden_state = _to_numpy(encoder.forward_batch(ids).last_hidden_state, device)
+
+    ref_embeddings = []
+    for i, sequence_ids in enumerate(ids):
+        states = last_hidden_state[i, : len(sequence_ids)]
+        if pooling == "cls":
+            ref_embeddings.append(states[0])
+        elif pooling == "mean":
+            ref_embeddings.append(states.mean(axis=0))
+        elif pooling == "max":
+            ref_embeddings.append(states.max(axis=0))
+        elif pooling == "last_token":
+            ref_embeddings.append(states[-1])
+    ref_embeddings = np.stack(ref_embeddings)
+
+    output = encoder.embed_batch(ids, pooling=pooling)
+    embeddings = _to_numpy(output.embeddings, device)
+    assert output.scales is None
+    np.testing.assert_array_almost_equal(embeddings, ref_embeddings, decimal=5)
+
+    ref_embeddings /= np.linalg.norm(ref_embeddings, axis=-1, keepdims=True)
+    output = encoder.embed_batch(ids, pooling=pooling, normalize=True)
+    embeddings = _to_numpy(output.embeddings, device)
+    np.testing.assert_array_almost_equal(embeddings, ref_embeddings, decimal=5)
+
+    output = encoder.embed_batch(
+        ids, pooling=pooling, normalize=True, quantization="int8"
+    )
+    embeddings = _to_numpy(output.embeddings, device)
+    scales = _to_numpy(output.scales, device)
+    assert embeddings.dtype == np.int8
+    np.testing.assert_allclose(
+        embeddings / scales[:, np.newaxis], ref_embeddings, atol=1e-2
+    )
+
+    output = encoder.embed_batch(ids, pooling=pooling, quantization="binary")
+    embeddings = _to_numpy(output.embeddings, device)
+    ref_bits = np.packbits(ref_embeddings > 0, axis=-1).view(np.int8)
+    np.testing.assert_array_equal(embeddings, ref_bits)
+
+
+@test_utils.only_on_linux
+@test_utils.on_available_devices
+def test_transformers_encoder_classify_early_exit(
+    clear_transformers_cache, tmp_dir, device
+):
+    import transformers
+
+    model_name = "bert-base-uncased"
+    text = ["Hello world!", "Hello, my dog is cute"]
+
+    tokenizer = transformers.AutoTokenizer.from_pretrained(model_name)
+    converter = ctranslate2.converters.TransformersConverter(model_name)
+    output_dir = str(tmp_dir.join("ctranslate2_model"))
+    output_dir = converter.convert(output_dir)
+
+    encoder = ctranslate2.Encoder(output_dir, device=device)
+    ids = [tokenizer(t).input_ids for t in text]
+
+    rng = np.random.default_rng(0)
+    weight = rng.standard_normal((3, 768), dtype=np.float32) * 0.1
+    bias = rng.standard_normal(3, dtype=np.float32)
+    classifier_weight = ctranslate2.StorageView.from_array(weight)
+    classifier_bias = ctranslate2.StorageView.from_array(bias)
+
+    pooler_output = _to_numpy(encoder.forward_batch(ids).pooler_output, device)
+    ref_logits = pooler_output @ weight.T + bias
+
+    # A threshold that cannot be reached runs all layers.
+    output = encoder.classify_batch(
+        ids,
+        classifier_weight=classifier_weight,
+        classifier_bias=classifier_bias,
+        exit_layers=[3, 7],
+        confidence_threshold=1.1,
+    )
+    assert output.exit_layers == [11, 11]
+    np.testing.assert_allclose(_to_numpy(output.logits, device), ref_logits, atol=1e-4)
+
+    # All examples exit at the first exit layer with a zero threshold.
+    output = encoder.classify_batch(
+        ids,
+        classifier_weight=classifier_weight,
+        classifier_bias=classifier_bias,
+        exit_layers=[3, 7],
+        confidence_threshold=0,
+    )
+    assert output.exit_layers == [3, 3]
+    assert _to_numpy(output.logits, device).shape == (2, 3)
+
+
 def _to_numpy(storage, device):
     import torch
 
@@ -510,6 +618,73 @@ class TestGeneration:
         expected_tokens = "Ċ The Ġfirst Ġof Ġthe Ġthree Ġnew Ġseries Ġof Ġthe".split()
         assert output[0].sequences[0] == expected_tokens
 
+    @test_utils.only_on_linux
+    def test_transformers_generator_draft_model(self, tmp_dir):
+        converter = ctranslate2.converters.TransformersConverter("gpt2")
+        output_dir = str(tmp_dir.join("ctranslate2_model"))
+        output_dir = converter.convert(output_dir)
+        generator = ctranslate2.Generator(output_dir)
+
+        converter = ctranslate2.converters.TransformersConverter("distilgpt2")
+        draft_dir = str(tmp_dir.join("ctranslate2_draft_model"))
+        draft_dir = converter.convert(draft_dir)
+        draft_generator = ctranslate2.Generator(draft_dir)
+
+        prompt = "<|endoftext|> Ċ The Ġfirst Ġtime".split()
+        expected = generator.generate_batch(
+            [prompt], max_length=20, include_prompt_in_result=False
+        )[0]
+
+        # Greedy speculative decoding returns the same tokens as greedy search.
+        output = generator.generate_batch(
+            [prompt],
+            max_length=20,
+            include_prompt_in_result=False,
+            draft_model=draft_generator,
+            num_speculative_tokens=3,
+        )[0]
+        assert output.sequences == expected.sequences
+        assert output.num_draft_tokens > 0
+        assert 0 <= output.num_accepted_draft_tokens <= output.num_draft_tokens
+
+        step_results = generator.generate_tokens(
+            prompt, max_length=20, draft_model=draft_generator
+        )
+        assert [step.token for step in step_results] == expected.sequences[0]
+
+        with pytest.raises(ValueError, match="draft model"):
+            generator.generate_batch([prompt], draft_model=generator)
+
+    @test_utils.only_on_linux
+    def test_transformers_generator_prompt_lookup(self, tmp_dir):
+        converter = ctranslate2.converters.TransformersConverter("gpt2")
+        output_dir = str(tmp_dir.join("ctranslate2_model"))
+        output_dir = converter.convert(output_dir)
+        generator = ctranslate2.Generator(output_dir)
+
+        prompts = [
+            "<|endoftext|> Ċ The Ġfirst Ġtime ĠI Ġsaw Ġthe Ġnew Ġversion Ġof".split(),
+            "<|endoftext|> Ġhello".split(),
+        ]
+        expected = generator.generate_batch(
+            prompts, max_length=20, include_prompt_in_result=False
+        )
+
+        results = generator.generate_batch(
+            prompts,
+            max_length=20,
+            include_prompt_in_result=False,
+            prompt_lookup_ngram_size=2,
+        )
+        for result, expected_result in zip(results, expected):
+            assert result.sequences == expected_result.sequences
+            assert result.num_accepted_draft_tokens <= result.num_draft_tokens
+
+        step_results = generator.generate_tokens(
+            prompts[0], max_length=20, prompt_lookup_ngram_size=2
+        )
+        assert [step.token for step in step_results] == expected[0].sequences[0]
+
     @test_utils.only_on_linux
     @pytest.mark.parametrize("beam_size", [1, 2])
     def test_transformers_generator_ignore_prompt(self, tmp_dir, beam_size):
@@ -880,6 +1055,47 @@ class TestWhisper:
                 tuple(pair) for pair in test_case["expected_alignments"]
             ]
 
+    @test_utils.only_on_linux
+    @pytest.mark.parametrize("beam_size", [1, 2])
+    def test_transformers_whisper_generate_alignments(self, tmp_dir, beam_size):
+        import transformers
+
+        model_name = "openai/whisper-tiny.en"
+        converter = ctranslate2.converters.TransformersConverter(model_name)
+        output_dir = str(tmp_dir.join("ctranslate2_model"))
+        output_dir = converter.convert(output_dir)
+
+        audio_paths = [
+            os.path.join(test_utils.get_data_dir(), "audio", "%s.npy" % name)
+            for name in ("jfk", "mr_quilter")
+        ]
+        audio = list(map(np.load, audio_paths))
+        num_frames = [len(samples) // 160 for samples in audio]
+
+        processor = transformers.WhisperProcessor.from_pretrained(model_name)
+        inputs = processor(audio, return_tensors="np", sampling_rate=16000)
+        features = ctranslate2.StorageView.from_array(inputs.input_features)
+
+        model = ctranslate2.models.Whisper(output_dir)
+        results = model.generate(
+            features,
+            [["<|startoftranscript|>", "<|notimestamps|>"]] * len(audio),
+            beam_size=beam_size,
+            return_alignments=True,
+            num_frames=num_frames,
+        )
+
+        expected_results = model.align(
+            features,
+            [50257],
+            [result.sequences_ids[0] for result in results],
+            num_frames,
+        )
+
+        for result, expected_result in zip(results, expected_results):
+            assert len(result.alignments) == 1
+            assert result.alignments[0] == expected_result.alignments
+
     @test_utils.only_on_linux
     @test_utils.on_available_devices
     def test_transformers_whisper_encode(self, tmp_dir, device):
@@ -911,6 +1127,109 @@ class TestWhisper:
             "ask what you can do for your country."
         )
 
+    @test_utils.only_on_linux
+    def test_transformers_whisper_streaming(self, tmp_dir):
+        import transformers
+
+        model_name = "openai/whisper-tiny.en"
+        converter = ctranslate2.converters.TransformersConverter(model_name)
+        output_dir = str(tmp_dir.join("ctranslate2_model"))
+        output_dir = converter.convert(output_dir)
+
+        audio_path = os.path.join(test_utils.get_data_dir(), "audio", "jfk.npy")
+        audio = np.load(audio_path)
+
+        processor = transformers.WhisperProcessor.from_pretrained(model_name)
+        inputs = processor(audio, padding=False, sampling_rate=16000)
+        features = inputs.input_features[0]
+
+        model = ctranslate2.models.Whisper(output_dir)
+        streams = [
+            ctranslate2.models.WhisperStream(["<|startoftranscript|>"], partial_interval=300)
+            for _ in range(2)
+        ]
+
+        chunk_size = 250
+        segments = [[] for _ in streams]
+        num_partial_results = 0
+
+        for offset in range(0, features.shape[-1], chunk_size):
+            chunk = np.ascontiguousarray(features[:, offset : offset + chunk_size])
+            for stream in streams:
+                stream.append_features(ctranslate2.StorageView.from_array(chunk))
+
+            for i, result in enumerate(model.transcribe_streams(streams, beam_size=1)):
+                assert not result.finished
+                segments[i].extend(result.segments)
+                if result.partial:
+                    num_partial_results += 1
+
+        for stream in streams:
+            stream.end_of_stream()
+
+        for i, result in enumerate(model.transcribe_streams(streams, beam_size=1)):
+            assert result.finished
+            segments[i].extend(result.segments)
+
+        assert num_partial_results > 0
+
+        for stream, stream_segments in zip(streams, segments):
+            assert stream.finished
+            assert stream_segments
+            assert stream_segments[-1].end <= features.shape[-1] * 0.01 + 1e-6
+
+            token_ids = [
+                token for segment in stream_segments for token in segment.tokens_ids
+            ]
+            transcription = processor.decode(token_ids)
+            assert "ask not what your country can do for you" in transcription
+
+    @test_utils.only_on_linux
+    def test_transformers_whisper_generate_detect_language(self, tmp_dir):
+        import transformers
+
+        model_name = "openai/whisper-tiny"
+        converter = ctranslate2.converters.TransformersConverter(model_name)
+        output_dir = str(tmp_dir.join("ctranslate2_model"))
+        output_dir = converter.convert(output_dir)
+
+        audio_path = os.path.join(test_utils.get_data_dir(), "audio", "jfk.npy")
+        audio = np.load(audio_path)
+
+        processor = transformers.WhisperProcessor.from_pretrained(model_name)
+        inputs = processor(audio, return_tensors="np", sampling_rate=16000)
+        features = np.repeat(inputs.input_features, 2, axis=0)
+        features = ctranslate2.StorageView.from_array(features)
+
+        model = ctranslate2.models.Whisper(output_dir)
+        prompts = [
+            ["<|startoftranscript|>", "<|transcribe|>", "<|notimestamps|>"],
+            ["<|startoftranscript|>", "<|en|>", "<|transcribe|>", "<|notimestamps|>"],
+        ]
+
+        results = model.generate(
+            features,
+            prompts,
+            detect_language=True,
+            return_no_speech_prob=True,
+        )
+
+        expected_results = model.generate(
+            features,
+            [prompts[1], prompts[1]],
+            return_no_speech_prob=True,
+        )
+
+        lang_probs = model.detect_language(features)
+
+        for result, expected_result, probs in zip(results, expected_results, lang_probs):
+            assert result.language == "<|en|>"
+            assert result.language_prob == pytest.approx(probs[0][1], abs=1e-4)
+            assert result.sequences_ids == expected_result.sequences_ids
+            assert result.no_speech_prob == pytest.approx(
+                expected_result.no_speech_prob, abs=1e-4
+            )
+
     @test_utils.only_on_linux
     def test_transformers_whisper_partial_audio_context(self, tmp_dir):
         import transformers
@@ -934,6 +1253,69 @@ class TestWhisper:
 
         assert encoder_output.shape == [1, features.shape[2] // 2, 384]
 
+    @test_utils.only_on_linux
+    def test_transformers_whisper_dynamic_encoder_length(self, tmp_dir):
+        import transformers
+
+        model_name = "openai/whisper-tiny.en"
+        converter = ctranslate2.converters.TransformersConverter(model_name)
+        output_dir = str(tmp_dir.join("ctranslate2_model"))
+        output_dir = converter.convert(output_dir)
+
+        audio_path = os.path.join(test_utils.get_data_dir(), "audio", "jfk.npy")
+        audio = np.load(audio_path)
+        num_frames = len(audio) // 160
+
+        processor = transformers.WhisperProcessor.from_pretrained(model_name)
+        inputs = processor(audio, return_tensors="np", sampling_rate=16000)
+        features = ctranslate2.StorageView.from_array(inputs.input_features)
+
+        model = ctranslate2.models.Whisper(output_dir)
+
+        encoder_output = model.encode(features, num_frames=num_frames, min_frames=0)
+        assert encoder_output.shape == [1, ((num_frames + 99) // 100) * 50, 384]
+
+        encoder_output = model.encode(features, num_frames=num_frames, min_frames=3000)
+        assert encoder_output.shape == [1, 1500, 384]
+
+        result = model.generate(
+            features,
+            [["<|startoftranscript|>", "<|notimestamps|>"]],
+            num_frames=num_frames,
+            dynamic_encoder_length=True,
+        )[0]
+
+        transcription = processor.decode(result.sequences_ids[0])
+        assert "ask not what your country can do for you" in transcription
+
+    @test_utils.only_on_linux
+    def test_transformers_whisper_generate_from_audio(self, tmp_dir):
+        import transformers
+
+        model_name = "openai/whisper-tiny.en"
+        converter = ctranslate2.converters.TransformersConverter(model_name)
+        output_dir = str(tmp_dir.join("ctranslate2_model"))
+        output_dir = converter.convert(output_dir)
+
+        audio_path = os.path.join(test_utils.get_data_dir(), "audio", "jfk.npy")
+        audio = np.load(audio_path).astype(np.float32)
+
+        processor = transformers.WhisperProcessor.from_pretrained(model_name)
+        inputs = processor(audio, return_tensors="np", sampling_rate=16000)
+        features = ctranslate2.StorageView.from_array(inputs.input_features)
+
+        model = ctranslate2.models.Whisper(output_dir)
+        prompts = [["<|startoftranscript|>", "<|notimestamps|>"]]
+
+        expected_result = model.generate(features, prompts, beam_size=1)[0]
+        result = model.generate_from_audio(
+            ctranslate2.StorageView.from_array(np.expand_dims(audio, 0)),
+            prompts,
+            beam_size=1,
+        )[0]
+
+        assert result.sequences_ids == expected_result.sequences_ids
+
     @test_utils.only_on_linux
     def test_transformers_whisper_include_tokenizer_json(self, tmp_dir):
         model_name = "openai/whisper-tiny"
@@ -1024,6 +1406,67 @@ class TestWav2Vec2:
 
         assert transcription == expected_transcription[0]
 
+    @test_utils.only_on_linux
+    def test_transformers_wav2vec2_decode_ctc(self, tmp_dir):
+        import transformers
+
+        model_name = "facebook/wav2vec2-large-robust-ft-swbd-300h"
+        converter = ctranslate2.converters.TransformersConverter(model_name)
+        output_dir = str(tmp_dir.join("ctranslate2_model"))
+        output_dir = converter.convert(output_dir)
+
+        processor = transformers.Wav2Vec2Processor.from_pretrained(model_name)
+        model = ctranslate2.models.Wav2Vec2(output_dir)
+
+        speech_array = np.load(
+            os.path.join(test_utils.get_data_dir(), "audio", "mr_quilter.npy")
+        )
+        input_values = processor(
+            speech_array,
+            padding=True,
+            return_tensors="np",
+            sampling_rate=16000,
+        ).input_values
+        features = ctranslate2.StorageView.from_array(
+            np.ascontiguousarray(np.expand_dims(input_values, 0))
+        )
+
+        blank_id = processor.tokenizer.pad_token_id
+        logits = np.array(model.encode(features, to_cpu=True))[0]
+        greedy = model.decode_ctc(features, blank_id=blank_id)[0]
+        assert processor.decode(
+            greedy.sequences_ids[0], group_tokens=False
+        ) == processor.decode(np.argmax(logits, axis=-1))
+
+        beam = model.decode_ctc(
+            features, blank_id=blank_id, beam_size=4, num_hypotheses=2
+        )[0]
+        assert len(beam.sequences) == 2
+        assert beam.scores[0] >= beam.scores[1]
+        assert beam.scores[0] >= greedy.scores[0]
+
+        # A unigram model of the vocabulary tokens.
+        arpa_path = str(tmp_dir.join("lm.arpa"))
+        tokens = list(processor.tokenizer.get_vocab().keys())
+        with open(arpa_path, "w") as arpa_file:
+            arpa_file.write("\\data\\\nngram 1=%d\n\n\\1-grams:\n" % len(tokens))
+            for token in tokens:
+                arpa_file.write("-1.0\t%s\n" % token)
+            arpa_file.write("\n\\end\\\n")
+
+        language_model = ctranslate2.models.NGramLanguageModel(arpa_path)
+        assert language_model.order == 1
+
+        # A uniform language model does not change the best hypothesis.
+        fused = model.decode_ctc(
+            features,
+            blank_id=blank_id,
+            beam_size=4,
+            language_model=language_model,
+            token_score=0.5 * np.log(10),
+        )[0]
+        assert fused.sequences_ids[0] == beam.sequences_ids[0]
+
 
 class TestWav2Vec2Bert:
     @classmethod
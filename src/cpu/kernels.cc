@@ -1,6 +1,11 @@
 #include "cpu/kernels.h"
 
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include <limits>
+#include <numeric>
+#include <vector>
 
 #if defined(__AVX512F__)
 #  define TARGET_ISA CpuIsa::AVX512
@@ -650,6 +655,96 @@ namespace ctranslate2 {
         quantize_s8_batch(x, y, scales, batch_size, depth, shift_to_uint8, identity());
     }
 
+    CT2_FFAST_MATH_BEGIN
+    template <typename RoundFunc>
+    static void residual_norm_batch(const float* input,
+                                    const float* residual,
+                                    const float* gamma,
+                                    const float* beta,
+                                    float* sum,
+                                    float* output,
+                                    int8_t* qoutput,
+                                    float* qscales,
+                                    dim_t batch_size,
+                                    dim_t depth,
+                                    float epsilon,
+                                    bool rms_use_residual,
+                                    bool shift_to_uint8,
+                                    const RoundFunc& round_func) {
+      parallel_for(0, batch_size, 1, [&](dim_t begin, dim_t end) {
+        // Rows that are not returned to the caller are kept in a local buffer.
+        std::vector<float> sum_buffer(residual && !sum ? depth : 0);
+        std::vector<float> output_buffer(output ? 0 : depth);
+
+        for (dim_t i = begin; i < end; ++i) {
+          const auto offset = i * depth;
+          const float* x = input + offset;
+          float* y = output ? output + offset : output_buffer.data();
+
+          if (residual) {
+            const float* r = residual + offset;
+            float* s = sum ? sum + offset : sum_buffer.data();
+            for (dim_t j = 0; j < depth; ++j)
+              s[j] = x[j] + r[j];
+            x = s;
+          }
+
+          float row_sum = 0;
+          float sum_squares = 0;
+          for (dim_t j = 0; j < depth; ++j) {
+            row_sum += x[j];
+            sum_squares += x[j] * x[j];
+          }
+
+          if (beta) {
+            const float mean = row_sum / depth;
+            const float variance = std::max(sum_squares / depth - mean * mean, 0.f);
+            const float rstd = 1.f / std::sqrt(variance + epsilon);
+            for (dim_t j = 0; j < depth; ++j)
+              y[j] = (x[j] - mean) * rstd * gamma[j] + beta[j];
+          } else {
+            const float inv_rms = 1.f / std::sqrt(sum_squares / depth + epsilon);
+            if (rms_use_residual) {
+              for (dim_t j = 0; j < depth; ++j)
+                y[j] = x[j] * inv_rms * (1 + gamma[j]);
+            } else {
+              for (dim_t j = 0; j < depth; ++j)
+                y[j] = x[j] * inv_rms * gamma[j];
+            }
+          }
+
+          if (qoutput)
+            qscales[i] = quantize_s8_row(y, qoutput + offset, depth, shift_to_uint8, round_func);
+        }
+      });
+    }
+    CT2_FFAST_MATH_END
+
+    template<>
+    void residual_norm<TARGET_ISA>(const float* input,
+                                   const float* residual,
+                                   const float* gamma,
+                                   const float* beta,
+                                   float* sum,
+                                   float* output,
+                                   int8_t* qoutput,
+                                   float* qscales,
+                                   dim_t batch_size,
+                                   dim_t depth,
+                                   float epsilon,
+                                   bool rms_use_residual,
+                                   bool shift_to_uint8,
+                                   bool round_before_cast) {
+      if (round_before_cast)
+        residual_norm_batch(input, residual, gamma, beta, sum, output, qoutput, qscales,
+                            batch_size, depth, epsilon, rms_use_residual, shift_to_uint8,
+                            Vec<float, TARGET_ISA>::round);
+      else
+        residual_norm_batch(input, residual, gamma, beta, sum, output, qoutput, qscales,
+                            batch_size, depth, epsilon, rms_use_residual, shift_to_uint8,
+                            identity());
+    }
+
     template <bool with_bias, typename EpilogueFunc>
     static void dequantize_gemm_output_row(const int32_t* c,
                                            const float a_scale,
@@ -755,5 +850,469 @@ namespace ctranslate2 {
       });
     }
 
+    template <typename Function>
+    static void gated_activation_batch(const float* x,
+                                       float* y,
+                                       dim_t batch_size,
+                                       dim_t depth,
+                                       const Function& func) {
+      using VecType = Vec<float, TARGET_ISA>;
+      parallel_for(0, batch_size, 1, [&](dim_t begin, dim_t end) {
+        for (dim_t i = begin; i < end; ++i) {
+          const float* gate = x + i * depth * 2;
+          const float* up = gate + depth;
+          vectorized_binary_transform<TARGET_ISA>(
+            gate, up, y + i * depth, depth,
+            [&func](vec_type<float, TARGET_ISA> a, vec_type<float, TARGET_ISA> b) {
+              return VecType::mul(func(a), b);
+            });
+        }
+      });
+    }
+
+    template<>
+    void gated_activation<TARGET_ISA>(const float* x,
+                                      float* y,
+                                      dim_t batch_size,
+                                      dim_t depth,
+                                      const ops::ActivationType activation_type) {
+      switch (activation_type) {
+      case ops::ActivationType::ReLU:
+        gated_activation_batch(x, y, batch_size, depth, relu_func());
+        break;
+      case ops::ActivationType::GELU:
+        gated_activation_batch(x, y, batch_size, depth, gelu_func());
+        break;
+      case ops::ActivationType::GELUTanh:
+        gated_activation_batch(x, y, batch_size, depth, gelu_tanh_func());
+        break;
+      case ops::ActivationType::GELUSigmoid:
+        gated_activation_batch(x, y, batch_size, depth, gelu_sigmoid_func());
+        break;
+      case ops::ActivationType::Sigmoid:
+        gated_activation_batch(x, y, batch_size, depth, sigmoid_func());
+        break;
+      case ops::ActivationType::Swish:
+        gated_activation_batch(x, y, batch_size, depth, swish_func());
+        break;
+      case ops::ActivationType::Tanh:
+        gated_activation_batch(x, y, batch_size, depth, tanh_func());
+        break;
+      }
+    }
+
+
+    // The top-p selection uses a radix pre-filter: values are mapped to unsigned integers
+    // with the same ordering and a histogram over the most significant bits finds the bucket
+    // containing the selection boundary. Only the values of this bucket need to be sorted.
+    constexpr int selection_histogram_bits = 11;
+    constexpr int selection_histogram_shift = 32 - selection_histogram_bits;
+    constexpr dim_t selection_num_buckets = dim_t(1) << selection_histogram_bits;
+
+    static inline uint32_t to_ordered_key(const float value) {
+      uint32_t bits;
+      std::memcpy(&bits, &value, sizeof (bits));
+      return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    }
+
+    static inline uint32_t to_bucket(const uint32_t key) {
+      return key >> selection_histogram_shift;
+    }
+
+    // Compares (key, index) pairs by decreasing key, then by increasing index.
+    struct greater_key {
+      const float* x;
+      bool operator()(const int32_t i1, const int32_t i2) const {
+        const uint32_t k1 = to_ordered_key(x[i1]);
+        const uint32_t k2 = to_ordered_key(x[i2]);
+        return k1 > k2 || (k1 == k2 && i1 < i2);
+      }
+    };
+
+    template<>
+    void topk<TARGET_ISA>(const float* x,
+                          float* values,
+                          int32_t* indices,
+                          dim_t batch_size,
+                          dim_t depth,
+                          dim_t k) {
+      // The k-th largest block maximum is a lower bound of the top K values: only the
+      // blocks with a maximum above this threshold can contain a top K value.
+      constexpr dim_t block_size = 64;
+      const dim_t num_blocks = ceil_divide(depth, block_size);
+
+      parallel_for(0, batch_size, 1, [&](dim_t begin, dim_t end) {
+        std::vector<float> block_max(num_blocks);
+        std::vector<float> sorted_block_max(num_blocks);
+        std::vector<int32_t> candidates;
+
+        for (dim_t i = begin; i < end; ++i) {
+          const float* row = x + i * depth;
+
+          for (dim_t b = 0; b < num_blocks; ++b) {
+            const dim_t offset = b * block_size;
+            block_max[b] = reduce_max<TARGET_ISA>(row + offset, std::min(block_size, depth - offset));
+          }
+
+          // When there are fewer blocks than k, all values are candidates (including -inf).
+          float threshold = -std::numeric_limits<float>::infinity();
+          if (k <= num_blocks) {
+            sorted_block_max = block_max;
+            std::nth_element(sorted_block_max.begin(),
+                             sorted_block_max.begin() + (k - 1),
+                             sorted_block_max.end(),
+                             std::greater<float>());
+            threshold = sorted_block_max[k - 1];
+          }
+
+          candidates.clear();
+          for (dim_t b = 0; b < num_blocks; ++b) {
+            if (block_max[b] < threshold)
+              continue;
+            const dim_t block_end = std::min((b + 1) * block_size, depth);
+            for (dim_t j = b * block_size; j < block_end; ++j) {
+              if (row[j] >= threshold)
+                candidates.emplace_back(j);
+            }
+          }
+
+          // reduce_max saturates at the lowest finite value so -inf entries never pass the
+          // threshold. When the row has fewer than k finite values, consider the full row.
+          if (dim_t(candidates.size()) < k) {
+            candidates.resize(depth);
+            std::iota(candidates.begin(), candidates.end(), 0);
+          }
+
+          std::partial_sort(candidates.begin(),
+                            candidates.begin() + k,
+                            candidates.end(),
+                            [row](const int32_t i1, const int32_t i2) {
+                              return row[i1] > row[i2] || (row[i1] == row[i2] && i1 < i2);
+                            });
+
+          for (dim_t j = 0; j < k; ++j) {
+            const int32_t index = candidates[j];
+            indices[i * k + j] = index;
+            values[i * k + j] = row[index];
+          }
+        }
+      });
+    }
+
+    template<>
+    void topp_mask<TARGET_ISA>(const float* x,
+                               const float* probs,
+                               float p,
+                               float mask_value,
+                               float* y,
+                               dim_t batch_size,
+                               dim_t depth) {
+      parallel_for(0, batch_size, 1, [&](dim_t begin, dim_t end) {
+        std::vector<float> histogram(selection_num_buckets);
+        std::vector<int32_t> candidates;
+
+        for (dim_t i = begin; i < end; ++i) {
+          const float* x_i = x + i * depth;
+          const float* probs_i = probs + i * depth;
+          float* y_i = y + i * depth;
+
+          std::fill(histogram.begin(), histogram.end(), 0.f);
+          for (dim_t j = 0; j < depth; ++j)
+            histogram[to_bucket(to_ordered_key(probs_i[j]))] += probs_i[j];
+
+          // Find the bucket where the cumulative probability reaches p.
+          dim_t bucket = selection_num_buckets - 1;
+          float total_p = 0;
+          while (bucket > 0 && total_p + histogram[bucket] < p)
+            total_p += histogram[bucket--];
+
+          candidates.clear();
+          for (dim_t j = 0; j < depth; ++j) {
+            if (to_bucket(to_ordered_key(probs_i[j])) == uint32_t(bucket))
+              candidates.emplace_back(j);
+          }
+
+          std::sort(candidates.begin(), candidates.end(), greater_key{probs_i});
+
+          // A value is kept if the cumulative probability of larger values is below p.
+          // The kept values are the ones larger or equal to (last_key, last_index).
+          uint32_t last_key = ((uint32_t(bucket) + 1) << selection_histogram_shift) - 1;
+          int32_t last_index = -1;
+          for (const int32_t index : candidates) {
+            if (total_p >= p)
+              break;
+            last_key = to_ordered_key(probs_i[index]);
+            last_index = index;
+            total_p += probs_i[index];
+          }
+
+          for (dim_t j = 0; j < depth; ++j) {
+            const uint32_t key = to_ordered_key(probs_i[j]);
+            const bool keep = key > last_key || (key == last_key && j <= last_index);
+            y_i[j] = keep ? x_i[j] : mask_value;
+          }
+        }
+      });
+    }
+
+    // The direct convolution computes blocks of conv1d_block_channels output channels and
+    // conv1d_block_vectors vectors of output positions in registers (the block size depends
+    // on the number of vector registers). The output positions are processed in tiles of
+    // conv1d_tile_blocks blocks so that the weights of a block are reused across the tile.
+#if defined(__AVX512F__) || defined(__aarch64__)
+    constexpr dim_t conv1d_block_channels = 8;
+#else
+    constexpr dim_t conv1d_block_channels = 4;
+#endif
+    constexpr dim_t conv1d_block_vectors = 3;
+    constexpr dim_t conv1d_tile_blocks = 2;
+
+    // Computes output[c][0:count] for num_channels output channels. The input is split in
+    // stride phases and tap_offsets[k] is the offset of the tap k in this layout, so that
+    // all taps read contiguous values. The weight is packed as [in_channels][kernel_size]
+    // [num_channels].
+    template <dim_t num_channels>
+    static void conv1d_block(const float* input,
+                             dim_t channel_stride,
+                             const dim_t* tap_offsets,
+                             const float* weight,
+                             const float* bias,
+                             dim_t in_channels,
+                             dim_t kernel_size,
+                             float* output,
+                             dim_t output_stride,
+                             dim_t count) {
+      using VecType = Vec<float, TARGET_ISA>;
+      constexpr dim_t width = VecType::width;
+      constexpr dim_t num_vectors = conv1d_block_vectors;
+
+      vec_type<float, TARGET_ISA> acc[num_channels][num_vectors];
+
+      for (dim_t c = 0; c < num_channels; ++c) {
+        const auto init = VecType::load(bias ? bias[c] : 0.f);
+        for (dim_t v = 0; v < num_vectors; ++v)
+          acc[c][v] = init;
+      }
+
+      for (dim_t i = 0; i < in_channels; ++i) {
+        const float* x_i = input + i * channel_stride;
+        const float* w_i = weight + i * kernel_size * num_channels;
+
+        for (dim_t k = 0; k < kernel_size; ++k) {
+          const float* x = x_i + tap_offsets[k];
+          const float* w = w_i + k * num_channels;
+
+          vec_type<float, TARGET_ISA> xv[num_vectors];
+          for (dim_t v = 0; v < num_vectors; ++v)
+            xv[v] = VecType::load(x + v * width);
+
+          for (dim_t c = 0; c < num_channels; ++c) {
+            const auto wv = VecType::load(w[c]);
+            for (dim_t v = 0; v < num_vectors; ++v)
+              acc[c][v] = VecType::mul_add(wv, xv[v], acc[c][v]);
+          }
+        }
+      }
+
+      for (dim_t c = 0; c < num_channels; ++c) {
+        float* y = output + c * output_stride;
+        for (dim_t v = 0; v < num_vectors; ++v) {
+          const dim_t remaining = count - v * width;
+          if (remaining >= width)
+            VecType::store(acc[c][v], y + v * width);
+          else if (remaining > 0)
+            VecType::store(acc[c][v], y + v * width, remaining);
+        }
+      }
+    }
+
+    static void apply_activation(float* x, dim_t size, const ops::ActivationType activation_type) {
+      switch (activation_type) {
+      case ops::ActivationType::ReLU:
+        vectorized_unary_transform<TARGET_ISA>(x, x, size, relu_func());
+        break;
+      case ops::ActivationType::GELU:
+        vectorized_unary_transform<TARGET_ISA>(x, x, size, gelu_func());
+        break;
+      case ops::ActivationType::GELUTanh:
+        vectorized_unary_transform<TARGET_ISA>(x, x, size, gelu_tanh_func());
+        break;
+      case ops::ActivationType::GELUSigmoid:
+        vectorized_unary_transform<TARGET_ISA>(x, x, size, gelu_sigmoid_func());
+        break;
+      case ops::ActivationType::Sigmoid:
+        vectorized_unary_transform<TARGET_ISA>(x, x, size, sigmoid_func());
+        break;
+      case ops::ActivationType::Swish:
+        vectorized_unary_transform<TARGET_ISA>(x, x, size, swish_func());
+        break;
+      case ops::ActivationType::Tanh:
+        vectorized_unary_transform<TARGET_ISA>(x, x, size, tanh_func());
+        break;
+      }
+    }
+
+    // Packs the weights as [block][in_channel][tap][block_channels], where the channels of the
+    // last incomplete block of a group are packed one by one.
+    template <typename T>
+    static void conv1d_pack_weight_impl(const T* weight,
+                                        const float* weight_scale,
+                                        float* packed_weight,
+                                        dim_t in_channels,
+                                        dim_t out_channels,
+                                        dim_t kernel_size,
+                                        dim_t groups) {
+      constexpr dim_t block_channels = conv1d_block_channels;
+
+      const dim_t group_out_channels = out_channels / groups;
+      const dim_t group_kernel_size = in_channels / groups * kernel_size;
+      const dim_t full_channels = group_out_channels - group_out_channels % block_channels;
+
+      parallel_for(0, out_channels, 1, [&](dim_t begin, dim_t end) {
+        for (dim_t oc = begin; oc < end; ++oc) {
+          const dim_t g_oc = oc % group_out_channels;
+          const dim_t num_channels = g_oc < full_channels ? block_channels : 1;
+          const dim_t block_start = oc - (g_oc < full_channels ? g_oc % block_channels : 0);
+          const dim_t c = oc - block_start;
+          const float scale = weight_scale ? 1.f / weight_scale[oc] : 1.f;
+
+          const T* w = weight + oc * group_kernel_size;
+          float* packed = packed_weight + block_start * group_kernel_size + c;
+          for (dim_t i = 0; i < group_kernel_size; ++i)
+            packed[i * num_channels] = static_cast<float>(w[i]) * scale;
+        }
+      });
+    }
+
+    template<>
+    void conv1d_pack_weight<TARGET_ISA>(const float* weight,
+                                        const float* weight_scale,
+                                        float* packed_weight,
+                                        dim_t in_channels,
+                                        dim_t out_channels,
+                                        dim_t kernel_size,
+                                        dim_t groups) {
+      conv1d_pack_weight_impl(weight, weight_scale, packed_weight,
+                              in_channels, out_channels, kernel_size, groups);
+    }
+
+    template<>
+    void conv1d_pack_weight<TARGET_ISA>(const int8_t* weight,
+                                        const float* weight_scale,
+                                        float* packed_weight,
+                                        dim_t in_channels,
+                                        dim_t out_channels,
+                                        dim_t kernel_size,
+                                        dim_t groups) {
+      conv1d_pack_weight_impl(weight, weight_scale, packed_weight,
+                              in_channels, out_channels, kernel_size, groups);
+    }
+
+    template<>
+    void conv1d<TARGET_ISA>(const float* input,
+                            const float* packed_weight,
+                            const float* bias,
+                            float* output,
+                            dim_t batch_size,
+                            dim_t in_channels,
+                            dim_t input_length,
+                            dim_t out_channels,
+                            dim_t kernel_size,
+                            dim_t output_length,
+                            dim_t stride,
+                            dim_t padding,
+                            dim_t groups,
+                            const ops::ActivationType* activation_type) {
+      constexpr dim_t block_channels = conv1d_block_channels;
+      constexpr dim_t block_length = conv1d_block_vectors * Vec<float, TARGET_ISA>::width;
+      constexpr dim_t tile_length = conv1d_tile_blocks * block_length;
+
+      const dim_t group_in_channels = in_channels / groups;
+      const dim_t group_out_channels = out_channels / groups;
+      const dim_t group_kernel_size = group_in_channels * kernel_size;
+      const dim_t full_channels = group_out_channels - group_out_channels % block_channels;
+
+      // The input tile of a group is copied and split in stride phases: the row of the phase
+      // r holds the positions j * stride + r of the padded input, so that all taps read
+      // contiguous values. The rows are extended so that the last block can load full vectors.
+      const dim_t phase_length = tile_length + (kernel_size - 1) / stride;
+      const dim_t channel_stride = stride * phase_length;
+
+      std::vector<dim_t> tap_offsets(kernel_size);
+      for (dim_t k = 0; k < kernel_size; ++k)
+        tap_offsets[k] = (k % stride) * phase_length + k / stride;
+
+      const dim_t num_tiles = ceil_divide(output_length, tile_length);
+
+      // Each work item computes all output channels of a group for a tile of output positions,
+      // accumulating over all input channels in registers.
+      parallel_for(0, batch_size * groups * num_tiles, 1, [&](dim_t begin, dim_t end) {
+        std::vector<float> tile_input(group_in_channels * channel_stride);
+
+        for (dim_t item = begin; item < end; ++item) {
+          const dim_t tile = item % num_tiles;
+          const dim_t g = (item / num_tiles) % groups;
+          const dim_t b = item / num_tiles / groups;
+
+          const dim_t t_begin = tile * tile_length;
+          const dim_t t_end = std::min(t_begin + tile_length, output_length);
+          const dim_t x_begin = t_begin * stride - padding;
+
+          for (dim_t i = 0; i < group_in_channels; ++i) {
+            const float* x = input + (b * in_channels + g * group_in_channels + i) * input_length;
+            for (dim_t r = 0; r < stride; ++r) {
+              float* y = tile_input.data() + i * channel_stride + r * phase_length;
+              // Valid range of j such that 0 <= x_begin + j * stride + r < input_length.
+              const dim_t offset = x_begin + r;
+              const dim_t j_begin = std::min(std::max(ceil_divide(-offset, stride), dim_t(0)),
+                                             phase_length);
+              const dim_t j_end = std::max(std::min(ceil_divide(input_length - offset, stride),
+                                                    phase_length),
+                                           j_begin);
+              std::fill(y, y + j_begin, 0.f);
+              if (stride == 1)
+                std::copy(x + offset + j_begin, x + offset + j_end, y + j_begin);
+              else
+                for (dim_t j = j_begin; j < j_end; ++j)
+                  y[j] = x[offset + j * stride];
+              std::fill(y + j_end, y + phase_length, 0.f);
+            }
+          }
+
+          float* y_g = output + (b * out_channels + g * group_out_channels) * output_length;
+
+          for (dim_t oc = 0; oc < group_out_channels;) {
+            const dim_t num_channels = oc < full_channels ? block_channels : 1;
+            const float* w = packed_weight + (g * group_out_channels + oc) * group_kernel_size;
+            const float* bias_oc = bias ? bias + g * group_out_channels + oc : nullptr;
+
+            for (dim_t t = t_begin; t < t_end; t += block_length) {
+              const float* x = tile_input.data() + (t - t_begin);
+              float* y = y_g + oc * output_length + t;
+              const dim_t count = std::min(block_length, t_end - t);
+
+              if (num_channels == block_channels)
+                conv1d_block<block_channels>(x, channel_stride, tap_offsets.data(), w, bias_oc,
+                                             group_in_channels, kernel_size,
+                                             y, output_length, count);
+              else
+                conv1d_block<1>(x, channel_stride, tap_offsets.data(), w, bias_oc,
+                                group_in_channels, kernel_size,
+                                y, output_length, count);
+            }
+
+            // Apply the activation while the output rows are still in cache.
+            if (activation_type) {
+              for (dim_t c = 0; c < num_channels; ++c)
+                apply_activation(y_g + (oc + c) * output_length + t_begin, t_end - t_begin,
+                                 *activation_type);
+            }
+
+            oc += num_channels;
+          }
+        }
+      });
+    }
+
   }
 }
@@ -72,6 +72,26 @@ namespace ctranslate2 {
                  dim_t depth,
                  bool log);
 
+    // Returns the k largest values of each row, sorted by decreasing value.
+    template <CpuIsa ISA>
+    void topk(const float* x,
+              float* values,
+              int32_t* indices,
+              dim_t batch_size,
+              dim_t depth,
+              dim_t k);
+
+    // Sets y to x for the smallest set of largest probabilities with a cumulative
+    // probability of at least p, and to mask_value otherwise. x and y can be the same.
+    template <CpuIsa ISA>
+    void topp_mask(const float* x,
+                   const float* probs,
+                   float p,
+                   float mask_value,
+                   float* y,
+                   dim_t batch_size,
+                   dim_t depth);
+
     template <CpuIsa ISA>
     void layer_norm(const float* input,
                     const float* gamma,
@@ -109,6 +129,26 @@ namespace ctranslate2 {
                      bool shift_to_uint8,
                      bool round_before_cast);
 
+    // Computes norm(input + residual) row by row so that each row is only loaded once.
+    // The normalization is a LayerNorm when beta is set, a RMSNorm otherwise.
+    // residual, sum and output are optional. When qoutput is set, the normalized
+    // row is also quantized to INT8 (see quantize_s8).
+    template <CpuIsa ISA>
+    void residual_norm(const float* input,
+                       const float* residual,
+                       const float* gamma,
+                       const float* beta,
+                       float* sum,
+                       float* output,
+                       int8_t* qoutput,
+                       float* qscales,
+                       dim_t batch_size,
+                       dim_t depth,
+                       float epsilon,
+                       bool rms_use_residual,
+                       bool shift_to_uint8,
+                       bool round_before_cast);
+
     // Assumes transpose_a=false, transpose_b=true.
     template <CpuIsa ISA>
     void dequantize_gemm_output(const int32_t* c,
@@ -120,6 +160,47 @@ namespace ctranslate2 {
                                 const float* bias = nullptr,
                                 const ops::ActivationType* activation_type = nullptr);
 
+    // Computes y = activation(gate) * up where each row of x is the concatenation [gate, up]
+    // of size 2 * depth.
+    template <CpuIsa ISA>
+    void gated_activation(const float* x,
+                          float* y,
+                          dim_t batch_size,
+                          dim_t depth,
+                          const ops::ActivationType activation_type);
+
+    // Packs the weight [out_channels, in_channels / groups, kernel_size] for conv1d. int8
+    // weights are dequantized with one scale per output channel. The packed weight has the
+    // same number of elements and its layout depends on the ISA.
+    template <CpuIsa ISA, typename T>
+    void conv1d_pack_weight(const T* weight,
+                            const float* weight_scale,
+                            float* packed_weight,
+                            dim_t in_channels,
+                            dim_t out_channels,
+                            dim_t kernel_size,
+                            dim_t groups);
+
+    // Direct 1D convolution that does not build an im2col buffer. The input is
+    // [batch_size, in_channels, input_length], the weight is packed with conv1d_pack_weight
+    // and the output is [batch_size, out_channels, output_length]. The bias and activation
+    // are optional.
+    template <CpuIsa ISA>
+    void conv1d(const float* input,
+                const float* packed_weight,
+                const float* bias,
+                float* output,
+                dim_t batch_size,
+                dim_t in_channels,
+                dim_t input_length,
+                dim_t out_channels,
+                dim_t kernel_size,
+                dim_t output_length,
+                dim_t stride,
+                dim_t padding,
+                dim_t groups,
+                const ops::ActivationType* activation_type = nullptr);
+
     struct identity {
       template <typename T>
       constexpr T&& operator()(T&& v) const noexcept {
@@ -0,0 +1,386 @@
+#include "ctranslate2/ctc_decoding.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "ctranslate2/filesystem.h"
+#include "ctranslate2/utils.h"
+
+#include "cpu/parallel.h"
+
+namespace ctranslate2 {
+
+  // ARPA files store log10 probabilities.
+  static constexpr float log10_to_ln = 2.302585093f;
+
+  // Log probability of unknown words when the model does not define <unk>.
+  static constexpr float unk_log_prob = -100.f * log10_to_ln;
+
+  static constexpr float neg_inf = -std::numeric_limits<float>::infinity();
+
+  static inline float log_sum_exp(float a, float b) {
+    if (a == neg_inf)
+      return b;
+    if (b == neg_inf)
+      return a;
+    return std::max(a, b) + std::log1p(std::exp(-std::abs(a - b)));
+  }
+
+  static inline size_t hash_ids(const std::vector<size_t>& ids) {
+    size_t hash = ids.size();
+    for (const size_t id : ids)
+      hash ^= id + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash;
+  }
+
+
+  std::shared_ptr<const NGramLanguageModel>
+  NGramLanguageModel::from_arpa_file(const std::string& path) {
+    auto in = open_file_read(path);
+    return std::make_shared<NGramLanguageModel>(in);
+  }
+
+  NGramLanguageModel::NGramLanguageModel(std::istream& in) {
+    size_t section_order = 0;
+    bool in_data = false;
+    bool ended = false;
+    std::string line;
+
+    while (!ended && ctranslate2::getline(in, line)) {
+      if (line.empty())
+        continue;
+
+      if (line == "\\data\\") {
+        in_data = true;
+        continue;
+      }
+      if (line == "\\end\\") {
+        ended = true;
+        continue;
+      }
+      if (line[0] == '\\') {
+        // Section header: \N-grams:
+        section_order = std::stoul(line.substr(1));
+        if (section_order == 0 || section_order > _order)
+          throw std::invalid_argument("Invalid ARPA section " + line);
+        in_data = false;
+        continue;
+      }
+
+      if (in_data) {
+        // Count line: ngram N=count
+        if (starts_with(line, "ngram ")) {
+          const size_t order = std::stoul(line.substr(6));
+          _order = std::max(_order, order);
+        }
+        continue;
+      }
+
+      if (section_order == 0)
+        continue;
+
+      std::istringstream fields(line);
+      NGramEntry entry;
+      fields >> entry.log_prob;
+
+      std::vector<size_t> ngram;
+      ngram.reserve(section_order);
+      std::string word;
+      for (size_t i = 0; i < section_order; ++i) {
+        if (!(fields >> word))
+          throw std::invalid_argument("Invalid ARPA entry: " + line);
+        ngram.emplace_back(add_word(word));
+      }
+
+      if (fields >> entry.backoff)
+        entry.backoff *= log10_to_ln;
+      entry.log_prob *= log10_to_ln;
+
+      _ngrams[std::move(ngram)] = entry;
+    }
+
+    if (_order == 0 || _ngrams.empty())
+      throw std::invalid_argument("The ARPA file does not contain any n-gram");
+
+    _bos_id = add_word("<s>");
+    _eos_id = add_word("</s>");
+    const auto it = _words.find("<unk>");
+    _unk_id = it != _words.end() ? it->second : _words.size();
+  }
+
+  size_t NGramLanguageModel::add_word(const std::string& word) {
+    return _words.emplace(word, _words.size()).first->second;
+  }
+
+  size_t NGramLanguageModel::to_id(const std::string& word) const {
+    const auto it = _words.find(word);
+    return it != _words.end() ? it->second : _unk_id;
+  }
+
+  size_t NGramLanguageModel::NGramHash::operator()(const std::vector<size_t>& ngram) const {
+    return hash_ids(ngram);
+  }
+
+  float NGramLanguageModel::score(const size_t* context,
+                                  size_t context_length,
+                                  size_t word) const {
+    const size_t* context_end = context + context_length;
+    context_length = std::min(context_length, _order - 1);
+
+    // Back off to shorter contexts until the n-gram is found:
+    // P(w | h) = backoff(h) * P(w | h without its first word)
+    std::vector<size_t> key;
+    key.reserve(context_length + 1);
+    float backoff = 0;
+
+    for (size_t n = context_length;; --n) {
+      const size_t* history = context_end - n;
+      key.assign(history, history + n);
+      key.emplace_back(word);
+
+      const auto it = _ngrams.find(key);
+      if (it != _ngrams.end())
+        return backoff + it->second.log_prob;
+      if (n == 0)
+        return backoff + unk_log_prob;
+
+      key.pop_back();
+      const auto history_it = _ngrams.find(key);
+      if (history_it != _ngrams.end())
+        backoff += history_it->second.backoff;
+    }
+  }
+
+
+  static void greedy_ctc_search(const float* log_probs,
+                                dim_t time,
+                                dim_t vocabulary_size,
+                                size_t blank_id,
+                                CTCDecodingResult& result) {
+    std::vector<size_t> ids;
+    float score = 0;
+    size_t previous_id = blank_id;
+
+    for (dim_t t = 0; t < time; ++t) {
+      const float* frame = log_probs + t * vocabulary_size;
+      const size_t best_id = std::max_element(frame, frame + vocabulary_size) - frame;
+      score += frame[best_id];
+      if (best_id != blank_id && best_id != previous_id)
+        ids.emplace_back(best_id);
+      previous_id = best_id;
+    }
+
+    result.sequences_ids.emplace_back(std::move(ids));
+    result.scores.emplace_back(score);
+  }
+
+  namespace {
+
+    struct CTCPrefix {
+      std::vector<size_t> ids;
+      // Language model context: <s> followed by the language model ids of the prefix.
+      std::vector<size_t> lm_ids;
+      // Log probabilities of the alignments ending with a blank and with a token.
+      float blank = neg_inf;
+      float non_blank = neg_inf;
+      // Weighted language model and token scores.
+      float lm_score = 0;
+
+      float acoustic_score() const {
+        return log_sum_exp(blank, non_blank);
+      }
+
+      float score() const {
+        return acoustic_score() + lm_score;
+      }
+    };
+
+    struct IdsHash {
+      size_t operator()(const std::vector<size_t>& ids) const {
+        return hash_ids(ids);
+      }
+    };
+
+  }
+
+  // CTC prefix beam search: the probability of a prefix is the sum over all alignments that
+  // collapse to it. The language model is applied when a prefix is extended with a token.
+  static void beam_ctc_search(const float* log_probs,
+                              dim_t time,
+                              dim_t vocabulary_size,
+                              const CTCDecodingOptions& options,
+                              const std::vector<size_t>& lm_ids,
+                              CTCDecodingResult& result) {
+    const size_t blank_id = options.blank_id;
+    const NGramLanguageModel* lm = options.language_model.get();
+
+    std::vector<CTCPrefix> beams(1);
+    beams[0].blank = 0;
+    if (lm)
+      beams[0].lm_ids.emplace_back(lm->bos_id());
+
+    std::vector<CTCPrefix> next_beams;
+    std::unordered_map<std::vector<size_t>, size_t, IdsHash> next_index;
+    std::vector<size_t> candidates;
+    candidates.reserve(vocabulary_size);
+
+    for (dim_t t = 0; t < time; ++t) {
+      const float* frame = log_probs + t * vocabulary_size;
+
+      // Only expand the likely tokens, and always the best one.
+      const size_t best_id = std::max_element(frame, frame + vocabulary_size) - frame;
+      candidates.clear();
+      for (dim_t v = 0; v < vocabulary_size; ++v) {
+        if (size_t(v) != blank_id
+            && (frame[v] >= options.min_token_log_prob || size_t(v) == best_id))
+          candidates.emplace_back(v);
+      }
+
+      next_beams.clear();
+      next_index.clear();
+
+      const auto get_prefix = [&](const CTCPrefix& parent, const size_t* token) -> CTCPrefix& {
+        std::vector<size_t> ids = parent.ids;
+        if (token)
+          ids.emplace_back(*token);
+
+        const auto it = next_index.find(ids);
+        if (it != next_index.end())
+          return next_beams[it->second];
+
+        next_index.emplace(ids, next_beams.size());
+        next_beams.emplace_back();
+        CTCPrefix& prefix = next_beams.back();
+        prefix.ids = std::move(ids);
+        prefix.lm_ids = parent.lm_ids;
+        prefix.lm_score = parent.lm_score;
+
+        if (token) {
+          prefix.lm_score += options.token_score;
+          if (lm) {
+            const size_t lm_id = lm_ids[*token];
+            prefix.lm_score += options.lm_weight * lm->score(parent.lm_ids.data(),
+                                                             parent.lm_ids.size(),
+                                                             lm_id);
+            prefix.lm_ids.emplace_back(lm_id);
+          }
+        }
+
+        return prefix;
+      };
+
+      for (const CTCPrefix& beam : beams) {
+        const float acoustic_score = beam.acoustic_score();
+
+        {
+          CTCPrefix& same = get_prefix(beam, nullptr);
+          same.blank = log_sum_exp(same.blank, acoustic_score + frame[blank_id]);
+        }
+
+        for (const size_t id : candidates) {
+          const float log_prob = frame[id];
+
+          if (!beam.ids.empty() && beam.ids.back() == id) {
+            // A repeated token is collapsed unless it is separated by a blank.
+            CTCPrefix& same = get_prefix(beam, nullptr);
+            same.non_blank = log_sum_exp(same.non_blank, beam.non_blank + log_prob);
+            CTCPrefix& extended = get_prefix(beam, &id);
+            extended.non_blank = log_sum_exp(extended.non_blank, beam.blank + log_prob);
+          } else {
+            CTCPrefix& extended = get_prefix(beam, &id);
+            extended.non_blank = log_sum_exp(extended.non_blank, acoustic_score + log_prob);
+          }
+        }
+      }
+
+      const size_t beam_size = std::min(options.beam_size, next_beams.size());
+      std::partial_sort(next_beams.begin(),
+                        next_beams.begin() + beam_size,
+                        next_beams.end(),
+                        [](const CTCPrefix& a, const CTCPrefix& b) {
+                          return a.score() > b.score();
+                        });
+      next_beams.resize(beam_size);
+      beams.swap(next_beams);
+    }
+
+    std::vector<float> scores;
+    scores.reserve(beams.size());
+    for (const CTCPrefix& beam : beams) {
+      float score = beam.score();
+      if (lm)
+        score += options.lm_weight * lm->score(beam.lm_ids.data(),
+                                               beam.lm_ids.size(),
+                                               lm->eos_id());
+      scores.emplace_back(score);
+    }
+
+    std::vector<size_t> order(beams.size());
+    for (size_t i = 0; i < order.size(); ++i)
+      order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&scores](size_t a, size_t b) { return scores[a] > scores[b]; });
+
+    const size_t num_hypotheses = std::min(options.num_hypotheses, order.size());
+    for (size_t i = 0; i < num_hypotheses; ++i) {
+      result.sequences_ids.emplace_back(std::move(beams[order[i]].ids));
+      result.scores.emplace_back(scores[order[i]]);
+    }
+  }
+
+  std::vector<CTCDecodingResult> ctc_decode(const StorageView& log_probs,
+                                            const CTCDecodingOptions& options,
+                                            const Vocabulary* vocabulary) {
+    if (log_probs.device() != Device::CPU || log_probs.dtype() != DataType::FLOAT32)
+      throw std::invalid_argument("ctc_decode expects float32 log probabilities on the CPU");
+    if (log_probs.rank() != 3)
+      throw std::invalid_argument("ctc_decode expects log probabilities with shape "
+                                  "[batch_size, time, vocabulary_size]");
+    if (options.beam_size == 0)
+      throw std::invalid_argument("The beam size must be greater than 0");
+    if (options.num_hypotheses > options.beam_size)
+      throw std::invalid_argument("The number of hypotheses cannot be greater than the beam size");
+
+    const dim_t batch_size = log_probs.dim(0);
+    const dim_t time = log_probs.dim(1);
+    const dim_t vocabulary_size = log_probs.dim(2);
+    if (options.blank_id >= size_t(vocabulary_size))
+      throw std::invalid_argument("The blank id " + std::to_string(options.blank_id)
+                                  + " is out of the vocabulary range");
+
+    std::vector<size_t> lm_ids;
+    if (options.language_model) {
+      if (!vocabulary)
+        throw std::invalid_argument("A vocabulary is required to decode with a language model");
+      lm_ids.resize(vocabulary_size);
+      for (dim_t v = 0; v < vocabulary_size; ++v)
+        lm_ids[v] = options.language_model->to_id(vocabulary->to_token(v));
+    }
+
+    const bool greedy = options.beam_size == 1 && !options.language_model;
+
+    std::vector<CTCDecodingResult> results(batch_size);
+    const float* data = log_probs.data<float>();
+
+    cpu::parallel_for(0, batch_size, 1, [&](dim_t begin, dim_t end) {
+      for (dim_t b = begin; b < end; ++b) {
+        const float* batch_log_probs = data + b * time * vocabulary_size;
+        if (greedy)
+          greedy_ctc_search(batch_log_probs, time, vocabulary_size, options.blank_id, results[b]);
+        else
+          beam_ctc_search(batch_log_probs, time, vocabulary_size, options, lm_ids, results[b]);
+      }
+    });
+
+    if (vocabulary) {
+      for (auto& result : results)
+        result.sequences = vocabulary->to_tokens(result.sequences_ids);
+    }
+
+    return results;
+  }
+
+}
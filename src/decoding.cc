@@ -2,10 +2,14 @@
 
 #include <algorithm>
 #include <cmath>
+#include <map>
 #include <memory>
 #include <numeric>
+#include <random>
+#include <unordered_map>
 
 #include "ctranslate2/ops/ops.h"
+#include "ctranslate2/random.h"
 #include "dispatch.h"
 
 namespace ctranslate2 {
@@ -114,44 +118,74 @@ namespace ctranslate2 {
     return beam_origins;
   }
 
-  static void append_step_output(StorageView& history,    // [batch, beam, time, ...]
-                                 StorageView step_output,  // [batch, beam, ...]
-                                 const StorageView* beam_origins = nullptr) {
-    step_output.expand_dims(2);  // Insert time dimension.
-
-    if (history) {
-      if (beam_origins)
-        gather_beam_flat(history, *beam_origins, step_output.dim(1));
-      const StorageView cur_history(std::move(history));
-      ops::Concat(2)({&cur_history, &step_output}, history);
-    } else {
-      history = std::move(step_output);
+  // Builds the history of the next step with a single copy instead of gathering and
+  // concatenating the full history: output row i is the history row history_rows[i]
+  // followed by the step output row step_rows[i].
+  template <typename T>
+  static StorageView extend_history(const StorageView& history,      // [batch, beam, time, ...]
+                                    const StorageView& step_output,  // [rows, ...]
+                                    const std::vector<int32_t>& history_rows,
+                                    const std::vector<int32_t>& step_rows,
+                                    const dim_t beam_size) {
+    const dim_t num_rows = history_rows.size();
+    const dim_t time = history ? history.dim(2) : 0;
+    const dim_t depth = step_output.size() / step_output.dim(0);
+
+    Shape shape = step_output.shape();
+    shape.erase(shape.begin());
+    shape.insert(shape.begin(), {num_rows / beam_size, beam_size, time + 1});
+    StorageView new_history(std::move(shape), step_output.dtype());
+
+    const T* history_data = history ? history.data<T>() : nullptr;
+    const T* step_data = step_output.data<T>();
+    T* new_history_data = new_history.data<T>();
+
+    for (dim_t i = 0; i < num_rows; ++i) {
+      T* dst = new_history_data + i * (time + 1) * depth;
+      if (history_data)
+        dst = std::copy_n(history_data + history_rows[i] * time * depth, time * depth, dst);
+      std::copy_n(step_data + step_rows[i] * depth, depth, dst);
     }
+
+    return new_history;
   }
 
-  static std::vector<size_t> build_hypothesis(const StorageView& history,
-                                              const dim_t batch,
-                                              const dim_t beam,
+  // The hypothesis is the history row at index origin followed by the last sampled id.
+  static std::vector<size_t> build_hypothesis(const StorageView& history,  // [batch, beam, time]
+                                              const dim_t origin,
+                                              const size_t last_id,
                                               const dim_t start,
                                               const dim_t end) {
-    const auto* ids = history.index<int32_t>({batch, beam, 0});
-    return std::vector<size_t>(ids + start, ids + end);
+    const dim_t time = history ? history.dim(2) : 0;
+
+    std::vector<size_t> hypothesis;
+    hypothesis.reserve(end - start);
+    if (start < time) {
+      const auto* ids = history.data<int32_t>() + origin * time;
+      hypothesis.insert(hypothesis.end(), ids + start, ids + std::min(end, time));
+    }
+    if (end > time)
+      hypothesis.emplace_back(last_id);
+    return hypothesis;
   }
 
   static std::vector<std::vector<float>> build_attention(const StorageView& history,
-                                                         const dim_t batch,
-                                                         const dim_t beam,
+                                                         const StorageView& step_attention,
+                                                         const dim_t origin,
                                                          const dim_t start,
                                                          const dim_t end) {
-    if (!history)
+    if (!step_attention)
       return {};
 
-    const auto source_length = history.dim(-1);
+    const dim_t time = history ? history.dim(2) : 0;
+    const dim_t source_length = step_attention.dim(-1);
 
     std::vector<std::vector<float>> attention;
     attention.reserve(end - start);
     for (dim_t t = start; t < end; ++t) {
-      const auto* vector = history.index<float>({batch, beam, t, 0});
+      const auto* vector = (t < time
+                            ? history.data<float>() + (origin * time + t) * source_length
+                            : step_attention.data<float>() + origin * source_length);
       attention.emplace_back(vector, vector + source_length);
     }
     return attention;
@@ -173,12 +207,16 @@ namespace ctranslate2 {
     return logits;
   }
 
+  // The attention can include one more step than the hypothesis (see
+  // include_eos_in_attention) which is not included in the penalty.
   static float compute_coverage_penalty(const std::vector<std::vector<float>>& attention,
+                                        const size_t length,
                                         const float beta) {
+    const size_t num_rows = std::min(attention.size(), length);
     float penalty = 0;
     for (size_t column = 0; column < attention[0].size(); column++) {
       float coverage = 0;
-      for (size_t row = 0; row < attention.size(); row++)
+      for (size_t row = 0; row < num_rows; row++)
         coverage += attention[row][column];
       if (coverage > 0)
         penalty += std::log(std::min(coverage, 1.f));
@@ -196,7 +234,7 @@ namespace ctranslate2 {
     if (coverage_penalty != 0) {
       if (!attention)
         throw std::runtime_error("The attention weights are required to apply the coverage penalty");
-      score += compute_coverage_penalty(*attention, coverage_penalty);
+      score += compute_coverage_penalty(*attention, size_t(length), coverage_penalty);
     }
 
     return score;
@@ -436,6 +474,7 @@ namespace ctranslate2 {
                      const bool return_prefix,
                      const size_t num_hypotheses,
                      const bool include_eos_in_hypotheses,
+                     const bool include_eos_in_attention,
                      const std::vector<std::shared_ptr<LogitsProcessor>>& logits_processors,
                      const std::vector<std::vector<size_t>>* prefix_ids) const {
     PROFILE("beam_search");
@@ -584,16 +623,10 @@ namespace ctranslate2 {
         }
       }
 
-      // Append last prediction.
-      append_step_output(alive_seq, topk_ids, &gather_indices);
-
-      if (attention_step) {
-        if (!is_expanded)
-          repeat_batch(attention_step, _beam_size);
-        split_batch_beam(attention_step, _beam_size);
-        append_step_output(alive_attention, attention_step.to_float32().to(Device::CPU));
-        gather_beam_flat(alive_attention, gather_indices, num_candidates);
-      }
+      // The history is not updated with the last prediction until we know which candidates
+      // are kept: finished hypotheses are built from the previous history row of their beam.
+      if (attention_step)
+        attention_step = attention_step.to_float32().to(Device::CPU);
 
       // Check if some hypotheses are finished.
       std::vector<int32_t> non_finished_index;
@@ -622,14 +655,21 @@ namespace ctranslate2 {
               top_beam_finished[i] = true;
 
             const bool ignore_last_token = is_eos(last_id, end_ids) && !include_eos_in_hypotheses;
+            const bool ignore_last_attention = ignore_last_token && !include_eos_in_attention;
             const dim_t start = return_prefix ? 0 : prefix_length;
             const dim_t end = ignore_last_token ? step : step + 1;
+            const dim_t attention_end = ignore_last_attention ? step : step + 1;
 
             // Register this hypothesis.
             result.scores.emplace_back(topk_scores.scalar_at<float>({i, k}));
-            result.hypotheses.emplace_back(build_hypothesis(alive_seq, i, k, start, end));
-            if (alive_attention)
-              result.attention.emplace_back(build_attention(alive_attention, i, k, start, end));
+            const dim_t origin = gather_indices.at<int32_t>(i * num_candidates + k);
+            result.hypotheses.emplace_back(build_hypothesis(alive_seq, origin, last_id, start, end));
+            if (attention_step)
+              result.attention.emplace_back(build_attention(alive_attention,
+                                                            attention_step,
+                                                            origin,
+                                                            start,
+                                                            attention_end));
             if (return_logits_vocab) {
               result.logits_vocab.emplace_back(std::move(logits_vec[i * k]));
             }
@@ -680,12 +720,42 @@ namespace ctranslate2 {
         break;
       }
 
+      // Append the last prediction of the kept beams and reorder the history accordingly.
+      {
+        std::vector<int32_t> history_rows;
+        std::vector<int32_t> step_rows;
+        history_rows.reserve(next_batch_size * _beam_size);
+        step_rows.reserve(next_batch_size * _beam_size);
+        for (const int32_t i : non_finished_index) {
+          for (dim_t k = 0; k < _beam_size; ++k) {
+            const int32_t candidate = active_beams.at<int32_t>(i * _beam_size + k);
+            step_rows.emplace_back(candidate);
+            history_rows.emplace_back(gather_indices.at<int32_t>(candidate));
+          }
+        }
+
+        for (const auto& logits_processor : logits_processors)
+          logits_processor->update_state(history_rows);
+
+        StorageView step_ids;
+        step_ids.shallow_copy(topk_ids);
+        step_ids.reshape({-1});
+        alive_seq = extend_history<int32_t>(alive_seq,
+                                            step_ids,
+                                            history_rows,
+                                            step_rows,
+                                            _beam_size);
+        if (attention_step)
+          alive_attention = extend_history<float>(alive_attention,
+                                                  attention_step,
+                                                  history_rows,
+                                                  history_rows,
+                                                  _beam_size);
+      }
+
       gather(gather_indices, active_beams);
       gather_beam_flat(topk_ids, active_beams, _beam_size);
       gather_beam_flat(topk_scores, active_beams, _beam_size);
-      gather_beam_flat(alive_seq, active_beams, _beam_size);
-      if (alive_attention)
-        gather_beam_flat(alive_attention, active_beams, _beam_size);
 
       // If some sentences finished on this step, ignore them for the next step.
       std::unique_ptr<StorageView> keep_batches;
@@ -698,9 +768,6 @@ namespace ctranslate2 {
         keep_batches = std::make_unique<StorageView>(Shape{next_batch_size}, non_finished_index);
         gather(topk_ids, *keep_batches);
         gather(topk_scores, *keep_batches);
-        gather(alive_seq, *keep_batches);
-        if (alive_attention)
-          gather(alive_attention, *keep_batches);
         if (keep_batches->device() != device)
           *keep_batches = keep_batches->to(device);
       }
@@ -720,6 +787,404 @@ namespace ctranslate2 {
   }
 
 
+  DiverseBeamSearch::DiverseBeamSearch(const dim_t beam_size,
+                                       const dim_t num_groups,
+                                       const float diversity_penalty,
+                                       const float length_penalty,
+                                       const float coverage_penalty,
+                                       const float patience)
+    : _beam_size(beam_size)
+    , _num_groups(num_groups)
+    , _group_size(num_groups > 0 ? beam_size / num_groups : 0)
+    , _diversity_penalty(diversity_penalty)
+    , _length_penalty(length_penalty)
+    , _coverage_penalty(coverage_penalty)
+    , _max_candidates(get_max_candidates(_group_size, patience))
+  {
+    if (num_groups <= 0 || beam_size % num_groups != 0)
+      throw std::invalid_argument("The beam size should be a multiple of the number of "
+                                  "beam groups");
+  }
+
+  // Merges the best hypotheses of each group and keeps the best num_hypotheses.
+  static void finalize_group_results(std::vector<DecodingResult>& group_results,
+                                     DecodingResult& result,
+                                     const size_t num_hypotheses,
+                                     const float length_penalty,
+                                     const float coverage_penalty,
+                                     const bool keep_scores,
+                                     const bool keep_attention,
+                                     const bool keep_logits_vocab) {
+    const size_t num_groups = group_results.size();
+    const size_t group_num_hypotheses = (num_hypotheses + num_groups - 1) / num_groups;
+
+    for (auto& group_result : group_results) {
+      finalize_result(group_result,
+                      group_num_hypotheses,
+                      length_penalty,
+                      coverage_penalty,
+                      /*keep_scores=*/true,
+                      keep_attention,
+                      keep_logits_vocab);
+
+      for (size_t i = 0; i < group_result.hypotheses.size(); ++i) {
+        result.hypotheses.emplace_back(std::move(group_result.hypotheses[i]));
+        result.scores.emplace_back(group_result.scores[i]);
+        if (keep_attention)
+          result.attention.emplace_back(std::move(group_result.attention[i]));
+        if (keep_logits_vocab)
+          result.logits_vocab.emplace_back(std::move(group_result.logits_vocab[i]));
+      }
+    }
+
+    sort_hypotheses(result, num_hypotheses, keep_scores, keep_attention, keep_logits_vocab);
+  }
+
+  std::vector<DecodingResult>
+  DiverseBeamSearch::search(layers::Decoder& decoder,
+                            layers::DecoderState& state,
+                            const Sampler& sampler,
+                            const std::vector<size_t>& start_ids,
+                            const std::vector<size_t>& end_ids,
+                            const dim_t start_step,
+                            const dim_t max_length,
+                            const dim_t min_length,
+                            const bool return_scores,
+                            const bool return_attention,
+                            const bool return_logits_vocab,
+                            const bool return_prefix,
+                            const size_t num_hypotheses,
+                            const bool include_eos_in_hypotheses,
+                            const bool include_eos_in_attention,
+                            const std::vector<std::shared_ptr<LogitsProcessor>>& logits_processors,
+                            const std::vector<std::vector<size_t>>* prefix_ids) const {
+    PROFILE("diverse_beam_search");
+    const Device device = decoder.device();
+    const DataType dtype = decoder.output_type();
+    const dim_t vocabulary_size = decoder.output_size();
+    const dim_t batch_size = start_ids.size();
+    const dim_t group_size = _group_size;
+    const dim_t num_candidates = group_size * 2;
+    const size_t group_num_hypotheses = (num_hypotheses + _num_groups - 1) / _num_groups;
+
+    // The diversity penalty only lowers the scores of the tokens selected by the previous
+    // groups, so the candidates of a group are selected among its best candidates before
+    // the penalty plus one candidate per beam and penalized token.
+    const dim_t num_group_candidates = std::min(
+      num_candidates + (_diversity_penalty != 0 ? group_size * group_size * (_num_groups - 1) : 0),
+      group_size * vocabulary_size);
+
+    const bool allow_early_exit = (_length_penalty == 0 && _coverage_penalty == 0);
+
+    // The groups are forked from the same decoder state. Only the first beam of each
+    // group is considered in the first step.
+    decoder.replicate_state(state, _beam_size);
+
+    StorageView topk_ids({batch_size * _beam_size}, DataType::INT32);
+    StorageView topk_scores(DataType::FLOAT32);
+    initialize_beam_scores<float>(topk_scores, batch_size * _num_groups, group_size);
+    for (dim_t i = 0; i < batch_size * _beam_size; ++i)
+      topk_ids.at<int32_t>(i) = start_ids[i / _beam_size];
+
+    std::vector<dim_t> batch_offset(batch_size);
+    std::iota(batch_offset.begin(), batch_offset.end(), 0);
+    std::vector<DecodingResult> results(batch_size);
+    std::vector<std::vector<DecodingResult>> group_results(
+      batch_size, std::vector<DecodingResult>(_num_groups));
+    std::vector<std::vector<bool>> top_beam_finished(
+      batch_size, std::vector<bool>(_num_groups, false));
+
+    StorageView logits(dtype, device);
+    StorageView alive_seq(DataType::INT32);
+    StorageView alive_attention;
+
+    const dim_t max_step = get_max_step(max_length, return_prefix, prefix_ids);
+
+    for (dim_t step = 0; step < max_step; ++step) {
+      StorageView attention_step(dtype, device);
+      convert_to_original_word_ids(decoder, topk_ids);
+      decoder(start_step + step,
+              topk_ids.to(device),
+              state,
+              &logits,
+              (return_attention || _coverage_penalty != 0) ? &attention_step : nullptr);
+
+      const dim_t cur_batch_size = logits.dim(0) / _beam_size;
+
+      DisableTokens disable_tokens(logits);
+
+      apply_min_length(step,
+                       min_length,
+                       end_ids,
+                       disable_tokens,
+                       batch_offset,
+                       return_prefix,
+                       prefix_ids);
+
+      if (!logits_processors.empty()) {
+        if (alive_seq)
+          merge_batch_beam(alive_seq);
+        for (const auto& logits_processor : logits_processors)
+          logits_processor->apply(step, logits, disable_tokens, alive_seq, batch_offset, prefix_ids);
+        if (alive_seq)
+          split_batch_beam(alive_seq, _beam_size);
+      }
+
+      disable_tokens.apply();
+      std::vector<StorageView> logits_vec;
+      if (return_logits_vocab)
+        logits_vec = build_logits(logits, cur_batch_size * _beam_size);
+
+      ops::LogSoftMax()(logits);
+
+      // Multiply by the current beam log probs.
+      const StorageView beam_scores = topk_scores.to(dtype).to(device);
+      DEVICE_AND_TYPE_DISPATCH(logits.device(), logits.dtype(),
+                               primitives<D>::add_depth_broadcast(beam_scores.data<T>(),
+                                                                  logits.data<T>(),
+                                                                  beam_scores.size(),
+                                                                  logits.size()));
+
+      // Get the best candidates of all groups in a single TopK and select the candidates
+      // of each group on the host.
+      logits.reshape({cur_batch_size * _num_groups, group_size * vocabulary_size});
+      StorageView candidate_scores(dtype, device);
+      StorageView candidate_ids(DataType::INT32, device);
+      const ops::TopK topk_op(num_group_candidates);
+      topk_op(logits, candidate_scores, candidate_ids);
+      candidate_scores = candidate_scores.to_float32().to(Device::CPU);
+      candidate_ids = candidate_ids.to(Device::CPU);
+
+      if (attention_step)
+        attention_step = attention_step.to_float32().to(Device::CPU);
+
+      // Selected candidates indexed by (batch * num_groups + group) * num_candidates + k.
+      const dim_t num_selected = cur_batch_size * _num_groups * num_candidates;
+      StorageView step_ids({num_selected}, DataType::INT32);
+      std::vector<float> step_scores(num_selected);
+      std::vector<int32_t> step_origins(num_selected);
+
+      // Selected candidate of each beam, indexed by batch * beam_size + beam.
+      std::vector<int32_t> active_beams(cur_batch_size * _beam_size);
+
+      // Number of times each token was selected by the previous groups in this step.
+      std::vector<std::unordered_map<int32_t, int32_t>> token_counts(cur_batch_size);
+
+      StorageView group_scores({cur_batch_size, num_group_candidates}, DataType::FLOAT32);
+      StorageView group_ids({cur_batch_size, num_candidates}, DataType::INT32);
+      StorageView group_step_scores({cur_batch_size, num_candidates}, DataType::FLOAT32);
+      StorageView group_origins({cur_batch_size * num_candidates}, DataType::INT32);
+      StorageView sampled_ids(DataType::INT32);
+      StorageView sampled_scores(DataType::FLOAT32);
+
+      for (dim_t g = 0; g < _num_groups; ++g) {
+        for (dim_t i = 0; i < cur_batch_size; ++i) {
+          const dim_t row = i * _num_groups + g;
+          const auto* scores = candidate_scores.data<float>() + row * num_group_candidates;
+          const auto* ids = candidate_ids.data<int32_t>() + row * num_group_candidates;
+          auto* penalized_scores = group_scores.data<float>() + i * num_group_candidates;
+          const auto& counts = token_counts[i];
+
+          for (dim_t c = 0; c < num_group_candidates; ++c) {
+            penalized_scores[c] = scores[c];
+            if (!counts.empty()) {
+              const auto it = counts.find(ids[c] % vocabulary_size);
+              if (it != counts.end())
+                penalized_scores[c] -= _diversity_penalty * it->second;
+            }
+          }
+        }
+
+        sampler(group_scores, sampled_ids, sampled_scores, num_candidates);
+
+        // The selected scores do not include the diversity penalty.
+        for (dim_t i = 0; i < cur_batch_size; ++i) {
+          const dim_t row = i * _num_groups + g;
+          for (dim_t k = 0; k < num_candidates; ++k) {
+            const int32_t position = sampled_ids.at<int32_t>({i, k});
+            const int32_t flat_id = candidate_ids.at<int32_t>({row, position});
+            group_ids.at<int32_t>({i, k}) = flat_id % vocabulary_size;
+            group_step_scores.at<float>({i, k}) = candidate_scores.at<float>({row, position});
+            group_origins.at<int32_t>(i * num_candidates + k) = (i * group_size
+                                                                 + flat_id / vocabulary_size);
+          }
+        }
+
+        if (prefix_ids)
+          update_sample_with_prefix(step,
+                                    group_ids,
+                                    group_step_scores,
+                                    *prefix_ids,
+                                    end_ids,
+                                    batch_offset,
+                                    group_size,
+                                    &group_origins);
+
+        for (dim_t i = 0; i < cur_batch_size; ++i) {
+          const dim_t batch_id = batch_offset[i];
+          const dim_t prefix_length = prefix_ids ? prefix_ids->at(batch_id).size() : 0;
+          const bool is_last_step_for_batch = is_last_step(step,
+                                                           max_length,
+                                                           prefix_length,
+                                                           return_prefix);
+
+          // Map the candidates to the rows of the step output.
+          const dim_t row = i * _num_groups + g;
+          for (dim_t k = 0; k < num_candidates; ++k) {
+            const dim_t index = row * num_candidates + k;
+            const int32_t beam = group_origins.at<int32_t>(i * num_candidates + k) - i * group_size;
+            step_ids.at<int32_t>(index) = group_ids.at<int32_t>({i, k});
+            step_scores[index] = group_step_scores.at<float>({i, k});
+            step_origins[index] = row * group_size + beam;
+          }
+
+          auto& result = group_results[batch_id][g];
+          dim_t secondary_candidates_offset = group_size;
+
+          for (dim_t k = 0; k < group_size; ++k) {
+            const size_t last_id = group_ids.at<int32_t>({i, k});
+            dim_t next_beam_id = k;
+
+            if ((is_eos(last_id, end_ids) && step >= prefix_length) || is_last_step_for_batch) {
+              if (k == 0)
+                top_beam_finished[i][g] = true;
+
+              const bool ignore_last_token = is_eos(last_id, end_ids) && !include_eos_in_hypotheses;
+              const bool ignore_last_attention = ignore_last_token && !include_eos_in_attention;
+              const dim_t start = return_prefix ? 0 : prefix_length;
+              const dim_t end = ignore_last_token ? step : step + 1;
+              const dim_t attention_end = ignore_last_attention ? step : step + 1;
+              const dim_t origin = step_origins[row * num_candidates + k];
+
+              // Register this hypothesis.
+              result.scores.emplace_back(step_scores[row * num_candidates + k]);
+              result.hypotheses.emplace_back(build_hypothesis(alive_seq, origin, last_id, start, end));
+              if (attention_step)
+                result.attention.emplace_back(build_attention(alive_attention,
+                                                              attention_step,
+                                                              origin,
+                                                              start,
+                                                              attention_end));
+              if (return_logits_vocab)
+                result.logits_vocab.emplace_back(std::vector<StorageView>{logits_vec[origin]});
+
+              // Move another active beam to this position.
+              for (dim_t j = secondary_candidates_offset; j < num_candidates; ++j) {
+                const auto candidate = group_ids.at<int32_t>({i, j});
+                if (!is_eos(candidate, end_ids)) {
+                  next_beam_id = j;
+                  secondary_candidates_offset = j + 1;
+                  break;
+                }
+              }
+            }
+
+            active_beams[row * group_size + k] = row * num_candidates + next_beam_id;
+            if (_diversity_penalty != 0)
+              token_counts[i][group_ids.at<int32_t>({i, next_beam_id})] += 1;
+          }
+        }
+      }
+
+      // Check if some batches are finished.
+      std::vector<int32_t> non_finished_index;
+      non_finished_index.reserve(cur_batch_size);
+
+      for (dim_t i = 0; i < cur_batch_size; ++i) {
+        const dim_t batch_id = batch_offset[i];
+        const dim_t prefix_length = prefix_ids ? prefix_ids->at(batch_id).size() : 0;
+        bool is_finished = is_last_step(step, max_length, prefix_length, return_prefix);
+
+        if (!is_finished) {
+          is_finished = true;
+          for (dim_t g = 0; g < _num_groups; ++g) {
+            const size_t num_group_hypotheses = group_results[batch_id][g].hypotheses.size();
+            if (allow_early_exit)
+              is_finished = (is_finished
+                             && top_beam_finished[i][g]
+                             && num_group_hypotheses >= group_num_hypotheses);
+            else
+              is_finished = is_finished && num_group_hypotheses >= _max_candidates;
+          }
+        }
+
+        if (is_finished) {
+          finalize_group_results(group_results[batch_id],
+                                 results[batch_id],
+                                 num_hypotheses,
+                                 _length_penalty,
+                                 _coverage_penalty,
+                                 return_scores,
+                                 return_attention,
+                                 return_logits_vocab);
+        } else {
+          non_finished_index.emplace_back(i);
+        }
+      }
+
+      const dim_t next_batch_size = non_finished_index.size();
+
+      // If all remaining sentences are finished, no need to go further.
+      if (next_batch_size == 0)
+        break;
+
+      // Append the last prediction of the kept beams and reorder the history accordingly.
+      std::vector<int32_t> history_rows;
+      std::vector<int32_t> step_rows;
+      history_rows.reserve(next_batch_size * _beam_size);
+      step_rows.reserve(next_batch_size * _beam_size);
+      topk_ids = StorageView({next_batch_size * _beam_size}, DataType::INT32);
+      topk_scores = StorageView({next_batch_size * _beam_size}, DataType::FLOAT32);
+
+      for (const int32_t i : non_finished_index) {
+        for (dim_t k = 0; k < _beam_size; ++k) {
+          const int32_t candidate = active_beams[i * _beam_size + k];
+          topk_ids.at<int32_t>(step_rows.size()) = step_ids.at<int32_t>(candidate);
+          topk_scores.at<float>(step_rows.size()) = step_scores[candidate];
+          step_rows.emplace_back(candidate);
+          history_rows.emplace_back(step_origins[candidate]);
+        }
+      }
+
+      for (const auto& logits_processor : logits_processors)
+        logits_processor->update_state(history_rows);
+
+      alive_seq = extend_history<int32_t>(alive_seq,
+                                          step_ids,
+                                          history_rows,
+                                          step_rows,
+                                          _beam_size);
+      if (attention_step)
+        alive_attention = extend_history<float>(alive_attention,
+                                                attention_step,
+                                                history_rows,
+                                                history_rows,
+                                                _beam_size);
+
+      // The decoder state is reordered for all batches before the finished batches are removed.
+      StorageView gather_indices({cur_batch_size * _beam_size}, DataType::INT32);
+      for (dim_t i = 0; i < cur_batch_size * _beam_size; ++i)
+        gather_indices.at<int32_t>(i) = step_origins[active_beams[i]];
+
+      std::unique_ptr<StorageView> keep_batches;
+      if (next_batch_size != cur_batch_size) {
+        batch_offset = index_vector(batch_offset, non_finished_index);
+        top_beam_finished = index_vector(top_beam_finished, non_finished_index);
+
+        keep_batches = std::make_unique<StorageView>(Shape{next_batch_size}, non_finished_index);
+        if (keep_batches->device() != device)
+          *keep_batches = keep_batches->to(device);
+      }
+
+      if (gather_indices.device() != device)
+        gather_indices = gather_indices.to(device);
+      decoder.update_state(state, gather_indices, _beam_size, keep_batches.get());
+    }
+
+    return results;
+  }
+
+
   GreedySearch::GreedySearch(const float length_penalty,
                              const float coverage_penalty,
                              std::function<bool(DecodingStepResult)> callback)
@@ -744,17 +1209,17 @@ namespace ctranslate2 {
                        const bool return_prefix,
                        const size_t num_hypotheses,
                        const bool include_eos_in_hypotheses,
+                       const bool include_eos_in_attention,
                        const std::vector<std::shared_ptr<LogitsProcessor>>& logits_processors,
                        const std::vector<std::vector<size_t>>* prefix_ids) const {
     const dim_t batch_size = start_ids.size();
 
     // We can return multiple hypotheses from greedy search when random sampling is enabled.
     // In that case we replicate the batches and then merge the hypotheses in a single result.
+    // Like in beam search, the states that are the same for each hypothesis (e.g. the
+    // encoder output and its projections) are not replicated.
     if (num_hypotheses > 1) {
-      for (auto& [name, value] : state) {
-        if (value)
-          repeat_batch(value, num_hypotheses);
-      }
+      decoder.replicate_state(state, num_hypotheses);
 
       std::vector<size_t> repeat_start_ids = repeat_vector(start_ids, num_hypotheses);
       std::vector<std::vector<size_t>> repeat_prefix_ids;
@@ -790,6 +1255,7 @@ namespace ctranslate2 {
         return_prefix,
         /*num_hypotheses=*/1,
         include_eos_in_hypotheses,
+        include_eos_in_attention,
         logits_processors,
         prefix_ids ? &repeat_prefix_ids : nullptr);
 
@@ -907,10 +1373,11 @@ namespace ctranslate2 {
           results[batch_id].logits_vocab[0].emplace_back(std::move(logits_vec[i]));
         }
 
-        if ((!is_eos(word_id, end_ids) || include_eos_in_hypotheses)
-            && (return_prefix || step >= prefix_length)) {
-          results[batch_id].hypotheses[0].push_back(word_id);
-          if (attention_step) {
+        if (return_prefix || step >= prefix_length) {
+          const bool ignore_last_token = is_eos(word_id, end_ids) && !include_eos_in_hypotheses;
+          if (!ignore_last_token)
+            results[batch_id].hypotheses[0].push_back(word_id);
+          if (attention_step && (!ignore_last_token || include_eos_in_attention)) {
             const auto* attn = attention_step.index<float>({i, 0});
             results[batch_id].attention[0].emplace_back(attn, attn + attention_step.dim(-1));
           }
@@ -962,6 +1429,9 @@ namespace ctranslate2 {
       if (count_alive != cur_batch_size) {
         batch_offset = index_vector(batch_offset, non_finished_index);
 
+        for (const auto& logits_processor : logits_processors)
+          logits_processor->update_state(non_finished_index);
+
         StorageView alive({count_alive}, non_finished_index);
         if (alive_seq)
           gather(alive_seq, alive);
@@ -973,6 +1443,701 @@ namespace ctranslate2 {
     return results;
   }
 
+  // Returns the state of the batches in batch_ids.
+  static layers::DecoderState select_state(const layers::Decoder& decoder,
+                                           const layers::DecoderState& state,
+                                           const std::vector<int32_t>& batch_ids) {
+    layers::DecoderState selected = state;
+    const StorageView indices({dim_t(batch_ids.size())}, batch_ids);
+    decoder.update_state(selected, indices.to(decoder.device()));
+    return selected;
+  }
+
+  // Appends the batches of other to state. The states should have the same time dimension.
+  static void concat_states(layers::DecoderState& state, const layers::DecoderState& other) {
+    for (auto& [name, value] : state) {
+      const StorageView& other_value = other.at(name);
+      if (!value && !other_value)
+        continue;
+
+      StorageView merged(value.dtype(), value.device());
+      ops::Concat(0)({&value, &other_value}, merged);
+      value = std::move(merged);
+    }
+  }
+
+  DecoderDrafter::DecoderDrafter(layers::Decoder& decoder, layers::DecoderState state)
+    : _decoder(decoder)
+    , _state(std::move(state))
+  {
+  }
+
+  void DecoderDrafter::propose(const std::vector<std::vector<size_t>>& sequences,
+                               const dim_t step,
+                               const dim_t num_tokens,
+                               const Sampler& sampler,
+                               std::vector<std::vector<size_t>>& draft_ids,
+                               StorageView* draft_probs) {
+    PROFILE("DecoderDrafter");
+    const Device device = _decoder.device();
+    const dim_t batch_size = sequences.size();
+    const dim_t length = sequences[0].size();
+    const dim_t start_step = step - length + 1;
+
+    if (_forwarded_ids.empty())
+      _forwarded_ids.resize(batch_size);
+
+    // Keep the forwarded tokens that are still part of all sequences. The last token is
+    // always forwarded again to get the distribution of the first draft token.
+    const dim_t num_forwarded = _forwarded_ids[0].size();
+    dim_t num_valid = std::min(num_forwarded, length - 1);
+    for (dim_t i = 0; i < batch_size; ++i) {
+      const auto& forwarded = _forwarded_ids[i];
+      const auto mismatch = std::mismatch(forwarded.begin(),
+                                          forwarded.begin() + num_valid,
+                                          sequences[i].begin());
+      num_valid = std::distance(forwarded.begin(), mismatch.first);
+    }
+
+    if (num_valid < num_forwarded)
+      _decoder.rewind_state(_state, num_forwarded - num_valid);
+
+    const dim_t num_pending = length - num_valid;
+    if (num_pending > 1) {
+      StorageView pending_ids({batch_size, num_pending - 1}, DataType::INT32);
+      for (dim_t i = 0; i < batch_size; ++i) {
+        for (dim_t t = 0; t < num_pending - 1; ++t)
+          pending_ids.at<int32_t>({i, t}) = sequences[i][num_valid + t];
+      }
+      _decoder(start_step + num_valid, pending_ids.to(device), _state);
+    }
+
+    StorageView input_ids({batch_size}, DataType::INT32);
+    for (dim_t i = 0; i < batch_size; ++i) {
+      _forwarded_ids[i] = sequences[i];
+      input_ids.at<int32_t>(i) = sequences[i].back();
+    }
+
+    draft_ids.assign(batch_size, std::vector<size_t>());
+    for (auto& ids : draft_ids)
+      ids.reserve(num_tokens);
+
+    StorageView logits(_decoder.output_type(), device);
+    StorageView sampled_ids(DataType::INT32);
+    StorageView sampled_scores(_decoder.output_type());
+    StorageView probs(DataType::FLOAT32);
+
+    for (dim_t t = 0; t < num_tokens; ++t) {
+      _decoder(step + t, input_ids.to(device), _state, &logits);
+
+      if (draft_probs) {
+        sampler.get_distribution(logits, probs);
+        ops::Multinomial(1)(probs, sampled_ids);
+
+        const dim_t vocabulary_size = probs.dim(-1);
+        if (t == 0)
+          *draft_probs = StorageView({batch_size, num_tokens, vocabulary_size}, DataType::FLOAT32);
+        for (dim_t i = 0; i < batch_size; ++i) {
+          const auto* src = probs.index<float>({i, 0});
+          std::copy(src, src + vocabulary_size, draft_probs->index<float>({i, t, 0}));
+        }
+
+      } else {
+        sampler(logits, sampled_ids, sampled_scores);
+      }
+
+      for (dim_t i = 0; i < batch_size; ++i) {
+        const size_t word_id = _decoder.to_original_word_id(sampled_ids.at<int32_t>(i));
+        draft_ids[i].push_back(word_id);
+        input_ids.at<int32_t>(i) = word_id;
+
+        // The last draft token is not forwarded.
+        if (t + 1 < num_tokens)
+          _forwarded_ids[i].push_back(word_id);
+      }
+    }
+  }
+
+  void DecoderDrafter::update_state(const std::vector<int32_t>& alive_batches) {
+    const StorageView alive({dim_t(alive_batches.size())}, alive_batches);
+    _decoder.update_state(_state, alive.to(_decoder.device()));
+    if (!_forwarded_ids.empty())
+      _forwarded_ids = index_vector(_forwarded_ids, alive_batches);
+  }
+
+  std::shared_ptr<Drafter>
+  DecoderDrafter::select(const std::vector<int32_t>& batch_ids) const {
+    auto drafter = std::make_shared<DecoderDrafter>(_decoder,
+                                                    select_state(_decoder, _state, batch_ids));
+    if (!_forwarded_ids.empty())
+      drafter->_forwarded_ids = index_vector(_forwarded_ids, batch_ids);
+    return drafter;
+  }
+
+  void DecoderDrafter::merge(Drafter& other) {
+    auto& other_drafter = dynamic_cast<DecoderDrafter&>(other);
+    if (_forwarded_ids.empty() || other_drafter._forwarded_ids.empty())
+      throw std::runtime_error("Only drafters that proposed tokens can be merged");
+
+    // Rewind both states to the same number of positions. The discarded tokens are
+    // forwarded again in the next call to propose.
+    const dim_t num_forwarded = _forwarded_ids[0].size();
+    const dim_t other_num_forwarded = other_drafter._forwarded_ids[0].size();
+    const dim_t num_kept = std::min(num_forwarded, other_num_forwarded);
+
+    _decoder.rewind_state(_state, num_forwarded - num_kept);
+    _decoder.rewind_state(other_drafter._state, other_num_forwarded - num_kept);
+    concat_states(_state, other_drafter._state);
+
+    for (auto& ids : _forwarded_ids)
+      ids.resize(num_kept);
+    for (auto& ids : other_drafter._forwarded_ids) {
+      ids.resize(num_kept);
+      _forwarded_ids.emplace_back(std::move(ids));
+    }
+  }
+
+
+  PromptLookupDrafter::PromptLookupDrafter(const dim_t max_ngram_size,
+                                           std::vector<std::vector<size_t>> contexts)
+    : _max_ngram_size(max_ngram_size)
+    , _contexts(std::move(contexts))
+  {
+  }
+
+  // Returns the tokens following the most recent previous occurrence of the longest
+  // suffix n-gram in the concatenation of context and sequence.
+  static std::vector<size_t> lookup_continuation(const std::vector<size_t>& context,
+                                                 const std::vector<size_t>& sequence,
+                                                 const dim_t max_ngram_size,
+                                                 const dim_t num_tokens) {
+    const dim_t context_size = context.size();
+    const dim_t size = context_size + sequence.size();
+    const auto token_at = [&](const dim_t i) {
+      return i < context_size ? context[i] : sequence[i - context_size];
+    };
+
+    for (dim_t n = std::min(max_ngram_size, size - 1); n > 0; --n) {
+      const dim_t ngram_start = size - n;
+
+      for (dim_t start = ngram_start - 1; start >= 0; --start) {
+        dim_t j = 0;
+        while (j < n && token_at(start + j) == token_at(ngram_start + j))
+          ++j;
+        if (j < n)
+          continue;
+
+        const dim_t continuation_start = start + n;
+        const dim_t continuation_end = std::min(continuation_start + num_tokens, size);
+        std::vector<size_t> continuation;
+        continuation.reserve(continuation_end - continuation_start);
+        for (dim_t i = continuation_start; i < continuation_end; ++i)
+          continuation.push_back(token_at(i));
+        return continuation;
+      }
+    }
+
+    return {};
+  }
+
+  void PromptLookupDrafter::propose(const std::vector<std::vector<size_t>>& sequences,
+                                    const dim_t,
+                                    const dim_t num_tokens,
+                                    const Sampler&,
+                                    std::vector<std::vector<size_t>>& draft_ids,
+                                    StorageView* draft_probs) {
+    PROFILE("PromptLookupDrafter");
+    const dim_t batch_size = sequences.size();
+    const std::vector<size_t> empty_context;
+
+    draft_ids.resize(batch_size);
+    dim_t num_proposed = 0;
+    for (dim_t i = 0; i < batch_size; ++i) {
+      const auto& context = _contexts.empty() ? empty_context : _contexts[i];
+      draft_ids[i] = lookup_continuation(context, sequences[i], _max_ngram_size, num_tokens);
+      num_proposed = std::max(num_proposed, dim_t(draft_ids[i].size()));
+    }
+
+    // All batches should propose the same number of tokens. Shorter proposals are
+    // completed by repeating their last token.
+    size_t max_id = 0;
+    for (dim_t i = 0; i < batch_size; ++i) {
+      const size_t filler = draft_ids[i].empty() ? sequences[i].back() : draft_ids[i].back();
+      draft_ids[i].resize(num_proposed, filler);
+      for (const size_t id : draft_ids[i])
+        max_id = std::max(max_id, id);
+    }
+
+    // The draft tokens are deterministic so their distributions are one-hot vectors.
+    if (draft_probs && num_proposed > 0) {
+      const dim_t vocabulary_size = max_id + 1;
+      *draft_probs = StorageView({batch_size, num_proposed, vocabulary_size}, float(0));
+      for (dim_t i = 0; i < batch_size; ++i) {
+        for (dim_t t = 0; t < num_proposed; ++t)
+          draft_probs->at<float>({i, t, dim_t(draft_ids[i][t])}) = 1;
+      }
+    }
+  }
+
+  void PromptLookupDrafter::update_state(const std::vector<int32_t>& alive_batches) {
+    if (!_contexts.empty())
+      _contexts = index_vector(_contexts, alive_batches);
+  }
+
+  std::shared_ptr<Drafter>
+  PromptLookupDrafter::select(const std::vector<int32_t>& batch_ids) const {
+    return std::make_shared<PromptLookupDrafter>(
+      _max_ngram_size,
+      _contexts.empty() ? _contexts : index_vector(_contexts, batch_ids));
+  }
+
+  void PromptLookupDrafter::merge(Drafter& other) {
+    auto& other_drafter = dynamic_cast<PromptLookupDrafter&>(other);
+    if (_contexts.empty() != other_drafter._contexts.empty())
+      throw std::runtime_error("Cannot merge prompt lookup drafters with and without contexts");
+    for (auto& context : other_drafter._contexts)
+      _contexts.emplace_back(std::move(context));
+  }
+
+
+  SpeculativeSearch::SpeculativeSearch(std::shared_ptr<Drafter> drafter,
+                                       const dim_t num_draft_tokens,
+                                       const float length_penalty,
+                                       const float coverage_penalty,
+                                       std::function<bool(DecodingStepResult)> callback)
+    : _drafter(std::move(drafter))
+    , _num_draft_tokens(num_draft_tokens)
+    , _length_penalty(length_penalty)
+    , _coverage_penalty(coverage_penalty)
+    , _callback(std::move(callback))
+  {
+  }
+
+  static size_t sample_from_probs(const float* probs, const dim_t size) {
+    std::discrete_distribution<size_t> distribution(probs, probs + size);
+    return distribution(get_random_generator());
+  }
+
+  // Samples from the normalized max(0, p - q) distribution after a draft token is rejected.
+  static size_t sample_from_residual(const float* p,
+                                     const dim_t p_size,
+                                     const float* q,
+                                     const dim_t q_size) {
+    std::vector<float> residual(p, p + p_size);
+    float residual_sum = 0;
+    for (dim_t i = 0; i < p_size; ++i) {
+      if (i < q_size)
+        residual[i] = std::max(residual[i] - q[i], 0.f);
+      residual_sum += residual[i];
+    }
+
+    if (residual_sum <= 0)
+      return sample_from_probs(p, p_size);
+    return sample_from_probs(residual.data(), p_size);
+  }
+
+  std::vector<DecodingResult>
+  SpeculativeSearch::search(layers::Decoder& decoder,
+                            layers::DecoderState& state,
+                            const Sampler& sampler,
+                            const std::vector<size_t>& start_ids,
+                            const std::vector<size_t>& end_ids,
+                            const dim_t start_step,
+                            const dim_t max_length,
+                            const dim_t min_length,
+                            const bool return_scores,
+                            const bool return_attention,
+                            const bool return_logits_vocab,
+                            const bool return_prefix,
+                            const size_t num_hypotheses,
+                            const bool include_eos_in_hypotheses,
+                            const bool include_eos_in_attention,
+                            const std::vector<std::shared_ptr<LogitsProcessor>>& logits_processors,
+                            const std::vector<std::vector<size_t>>* prefix_ids) const {
+    // Logits processors depend on the previous steps and the attention vectors
+    // are not collected when verifying the draft tokens.
+    if (_num_draft_tokens <= 0
+        || num_hypotheses > 1
+        || return_attention
+        || return_logits_vocab
+        || (return_scores && _coverage_penalty != 0)
+        || !logits_processors.empty()
+        || !decoder.support_state_rewind()) {
+      return GreedySearch(_length_penalty, _coverage_penalty, _callback).search(
+        decoder,
+        state,
+        sampler,
+        start_ids,
+        end_ids,
+        start_step,
+        max_length,
+        min_length,
+        return_scores,
+        return_attention,
+        return_logits_vocab,
+        return_prefix,
+        num_hypotheses,
+        include_eos_in_hypotheses,
+        include_eos_in_attention,
+        logits_processors,
+        prefix_ids);
+    }
+
+    PROFILE("speculative_search");
+    const Device device = decoder.device();
+    const DataType dtype = decoder.output_type();
+    const dim_t batch_size = start_ids.size();
+    const bool random_sampling = sampler.is_random();
+
+    // Batches that are decoded with the same decoder state.
+    struct Group {
+      layers::DecoderState state;
+      std::shared_ptr<Drafter> drafter;
+      std::vector<dim_t> batch_offset;
+      std::vector<std::vector<size_t>> sequences;
+      dim_t step = 0;
+    };
+
+    std::vector<DecodingResult> results(batch_size);
+    Group first_group;
+    first_group.state = std::move(state);
+    first_group.drafter = _drafter;
+    first_group.batch_offset.resize(batch_size);
+    first_group.sequences.resize(batch_size);
+    for (dim_t i = 0; i < batch_size; ++i) {
+      first_group.batch_offset[i] = i;
+      first_group.sequences[i].push_back(start_ids[i]);
+      results[i].hypotheses.resize(1);
+      if (return_scores)
+        results[i].scores.resize(1, 0.f);
+    }
+
+    const auto get_prefix_length = [prefix_ids](const size_t batch_id) -> dim_t {
+      return prefix_ids ? prefix_ids->at(batch_id).size() : 0;
+    };
+
+    // Adds the token decoded at token_step for the batch i of the group and returns true
+    // if the decoding is finished for this batch.
+    const auto add_token = [&](Group& group,
+                               const dim_t i,
+                               const size_t word_id,
+                               const float score,
+                               const dim_t token_step) {
+      const size_t batch_id = group.batch_offset[i];
+      const dim_t prefix_length = get_prefix_length(batch_id);
+      auto& result = results[batch_id];
+
+      if ((!is_eos(word_id, end_ids) || include_eos_in_hypotheses)
+          && (return_prefix || token_step >= prefix_length))
+        result.hypotheses[0].push_back(word_id);
+
+      if (return_scores)
+        result.scores[0] += score;
+
+      bool is_finished = ((is_eos(word_id, end_ids) && token_step >= prefix_length)
+                          || (is_last_step(token_step, max_length, prefix_length, return_prefix)));
+
+      if (_callback && (return_prefix || token_step >= prefix_length)) {
+        DecodingStepResult step_result;
+        step_result.step = token_step;
+        step_result.batch_id = batch_id;
+        step_result.token_id = word_id;
+        step_result.hypothesis_id = 0;
+        step_result.is_last = is_finished;
+        if (return_scores)
+          step_result.score = score;
+        if (_callback(std::move(step_result)))
+          is_finished = true;
+      }
+
+      if (is_finished)
+        finalize_result(result, 1, _length_penalty, _coverage_penalty, return_scores, false, false);
+      else
+        group.sequences[i].push_back(word_id);
+
+      return is_finished;
+    };
+
+    // Keeps the batches of the group in index.
+    const auto select_batches = [&](Group& group, const std::vector<int32_t>& index) {
+      const dim_t count_alive = index.size();
+      if (count_alive == dim_t(group.sequences.size()))
+        return;
+
+      group.batch_offset = index_vector(group.batch_offset, index);
+      group.sequences = index_vector(group.sequences, index);
+
+      if (count_alive > 0) {
+        const StorageView alive({count_alive}, index);
+        decoder.update_state(group.state, alive.to(device));
+        group.drafter->update_state(index);
+      }
+    };
+
+    // Returns a new group with the batches of the group in index.
+    const auto split_group = [&](const Group& group, const std::vector<int32_t>& index) {
+      Group new_group;
+      new_group.state = select_state(decoder, group.state, index);
+      new_group.drafter = group.drafter->select(index);
+      new_group.batch_offset = index_vector(group.batch_offset, index);
+      new_group.sequences = index_vector(group.sequences, index);
+      new_group.step = group.step;
+      return new_group;
+    };
+
+    const auto merge_group = [&](Group& group, Group& other) {
+      concat_states(group.state, other.state);
+      group.drafter->merge(*other.drafter);
+      group.batch_offset.insert(group.batch_offset.end(),
+                                other.batch_offset.begin(),
+                                other.batch_offset.end());
+      for (auto& sequence : other.sequences)
+        group.sequences.emplace_back(std::move(sequence));
+    };
+
+    // The groups are ordered by step.
+    std::vector<Group> groups;
+    const auto add_group = [&groups](Group group) {
+      const auto it = std::upper_bound(groups.begin(),
+                                       groups.end(),
+                                       group.step,
+                                       [](const dim_t step, const Group& g) {
+                                         return step < g.step;
+                                       });
+      groups.emplace(it, std::move(group));
+    };
+
+    const dim_t max_step = get_max_step(max_length, return_prefix, prefix_ids);
+
+    // The prefix positions that are shared by all batches are forwarded in a single call.
+    if (prefix_ids) {
+      dim_t num_forced = max_step - 1;
+      for (const auto& prefix : *prefix_ids)
+        num_forced = std::min(num_forced, dim_t(prefix.size()));
+
+      if (num_forced > 0) {
+        StorageView input_ids({batch_size, num_forced}, DataType::INT32);
+        for (dim_t i = 0; i < batch_size; ++i) {
+          input_ids.at<int32_t>({i, 0}) = start_ids[i];
+          for (dim_t t = 1; t < num_forced; ++t)
+            input_ids.at<int32_t>({i, t}) = prefix_ids->at(i)[t - 1];
+        }
+
+        convert_to_original_word_ids(decoder, input_ids);
+        decoder(start_step, input_ids.to(device), first_group.state);
+
+        std::vector<int32_t> non_finished_index;
+        non_finished_index.reserve(batch_size);
+
+        for (dim_t i = 0; i < batch_size; ++i) {
+          bool is_finished = false;
+          for (dim_t t = 0; t < num_forced && !is_finished; ++t)
+            is_finished = add_token(first_group, i, prefix_ids->at(i)[t], 0, t);
+          if (!is_finished)
+            non_finished_index.emplace_back(i);
+        }
+
+        first_group.step = num_forced;
+        select_batches(first_group, non_finished_index);
+      }
+    }
+
+    if (!first_group.sequences.empty())
+      groups.emplace_back(std::move(first_group));
+
+    StorageView logits(dtype, device);
+    StorageView best_ids(DataType::INT32);
+    StorageView best_scores(dtype);
+    StorageView target_probs(DataType::FLOAT32);
+    StorageView target_log_probs(DataType::FLOAT32);
+    StorageView draft_probs(DataType::FLOAT32);
+    std::vector<std::vector<size_t>> draft_ids;
+    std::uniform_real_distribution<float> uniform_distribution(0, 1);
+
+    while (!groups.empty()) {
+      // Decode the group with the smallest step with the groups that reached the same step.
+      Group group = std::move(groups.front());
+      groups.erase(groups.begin());
+      while (!groups.empty() && groups.front().step == group.step) {
+        merge_group(group, groups.front());
+        groups.erase(groups.begin());
+      }
+
+      const dim_t step = group.step;
+      if (step >= max_step)
+        continue;
+
+      // Do not decode past the next group so that it can be merged with this group.
+      const dim_t next_step = groups.empty() ? max_step : groups.front().step;
+      const dim_t cur_batch_size = group.sequences.size();
+      const dim_t num_tokens = std::min({_num_draft_tokens,
+                                         max_step - step - 1,
+                                         next_step - step - 1});
+
+      if (num_tokens > 0)
+        group.drafter->propose(group.sequences,
+                               start_step + step,
+                               num_tokens,
+                               sampler,
+                               draft_ids,
+                               random_sampling ? &draft_probs : nullptr);
+      else
+        draft_ids.assign(cur_batch_size, std::vector<size_t>());
+
+      const dim_t num_draft = draft_ids[0].size();
+      const dim_t num_positions = num_draft + 1;
+
+      // Returns true if the token at this position is forced by the prefix.
+      const auto is_forced = [&](const dim_t i, const dim_t t) {
+        return step + t < get_prefix_length(group.batch_offset[i]);
+      };
+
+      // Verify the draft tokens in a single forward. The prefix tokens replace the draft tokens.
+      StorageView input_ids({cur_batch_size, num_positions}, DataType::INT32);
+      for (dim_t i = 0; i < cur_batch_size; ++i) {
+        if (dim_t(draft_ids[i].size()) != num_draft)
+          throw std::runtime_error("The drafter should propose the same number of tokens "
+                                   "for each batch");
+
+        input_ids.at<int32_t>({i, 0}) = group.sequences[i].back();
+        for (dim_t t = 0; t < num_draft; ++t) {
+          if (is_forced(i, t))
+            draft_ids[i][t] = prefix_ids->at(group.batch_offset[i])[step + t];
+          input_ids.at<int32_t>({i, t + 1}) = draft_ids[i][t];
+        }
+      }
+
+      convert_to_original_word_ids(decoder, input_ids);
+      decoder(start_step + step, input_ids.to(device), group.state, &logits);
+
+      const dim_t vocabulary_size = logits.dim(-1);
+      logits.reshape({cur_batch_size * num_positions, vocabulary_size});
+
+      // Prevent the generation of end_id until the minimum length is reached.
+      DisableTokens disable_tokens(logits);
+      for (dim_t i = 0; i < cur_batch_size; ++i) {
+        const dim_t min_step = ((prefix_ids && !return_prefix)
+                                ? get_prefix_length(group.batch_offset[i]) + min_length
+                                : min_length);
+        for (dim_t t = 0; t < num_positions && step + t < min_step; ++t) {
+          for (const size_t end_id : end_ids)
+            disable_tokens.add(i * num_positions + t, end_id);
+        }
+      }
+      disable_tokens.apply();
+
+      if (return_scores)
+        ops::LogSoftMax()(logits);
+
+      if (random_sampling) {
+        sampler.get_distribution(logits, target_probs);
+        if (return_scores)
+          target_log_probs = logits.to_float32().to(Device::CPU);
+      } else {
+        sampler(logits, best_ids, best_scores);
+      }
+
+      const auto get_score = [&](const dim_t i, const dim_t t, const size_t word_id) -> float {
+        if (!return_scores || is_forced(i, t))
+          return 0;
+        const dim_t row = i * num_positions + t;
+        if (random_sampling)
+          return target_log_probs.at<float>({row, dim_t(word_id)});
+        return best_scores.scalar_at<float>({row, 0});
+      };
+
+      // The non finished batches of the group for each number of decoded positions.
+      std::map<dim_t, std::vector<int32_t>> non_finished_index;
+
+      for (dim_t i = 0; i < cur_batch_size; ++i) {
+        auto& result = results[group.batch_offset[i]];
+
+        // Count the draft tokens accepted by the decoder.
+        dim_t num_accepted = 0;
+        for (; num_accepted < num_draft; ++num_accepted) {
+          const dim_t t = num_accepted;
+          if (is_forced(i, t))
+            continue;
+
+          const dim_t row = i * num_positions + t;
+          const size_t draft_id = draft_ids[i][t];
+
+          if (random_sampling) {
+            // Accept the draft token with probability min(1, p / q).
+            const float p = (dim_t(draft_id) < vocabulary_size
+                             ? target_probs.at<float>({row, dim_t(draft_id)})
+                             : 0.f);
+            const float q = (dim_t(draft_id) < draft_probs.dim(-1)
+                             ? draft_probs.at<float>({i, t, dim_t(draft_id)})
+                             : 0.f);
+            if (uniform_distribution(get_random_generator()) * q >= p)
+              break;
+          } else if (draft_id != size_t(best_ids.at<int32_t>(row))) {
+            break;
+          }
+        }
+
+        for (dim_t t = 0; t < num_draft; ++t) {
+          if (!is_forced(i, t)) {
+            result.num_draft_tokens += 1;
+            if (t < num_accepted)
+              result.num_accepted_draft_tokens += 1;
+          }
+        }
+
+        bool is_finished = false;
+        for (dim_t t = 0; t < num_accepted && !is_finished; ++t)
+          is_finished = add_token(group, i, draft_ids[i][t], get_score(i, t, draft_ids[i][t]), step + t);
+
+        // The decoder output after the accepted tokens gives the next token.
+        if (!is_finished) {
+          const dim_t t = num_accepted;
+          const dim_t row = i * num_positions + t;
+          size_t word_id = 0;
+
+          if (is_forced(i, t))
+            word_id = prefix_ids->at(group.batch_offset[i])[step + t];
+          else if (!random_sampling)
+            word_id = best_ids.at<int32_t>(row);
+          else if (t == num_draft)
+            word_id = sample_from_probs(target_probs.index<float>({row, 0}), vocabulary_size);
+          else
+            word_id = sample_from_residual(target_probs.index<float>({row, 0}),
+                                           vocabulary_size,
+                                           draft_probs.index<float>({i, t, 0}),
+                                           draft_probs.dim(-1));
+
+          is_finished = add_token(group, i, word_id, get_score(i, t, word_id), step + t);
+        }
+
+        if (!is_finished)
+          non_finished_index[num_accepted + 1].emplace_back(i);
+      }
+
+      // The batches that decoded a different number of positions continue in separate
+      // groups. The last group reuses the current state.
+      for (auto it = non_finished_index.begin(); it != non_finished_index.end(); ++it) {
+        const dim_t num_decoded = it->first;
+        const auto& index = it->second;
+
+        Group new_group;
+        if (std::next(it) == non_finished_index.end()) {
+          select_batches(group, index);
+          new_group = std::move(group);
+        } else {
+          new_group = split_group(group, index);
+        }
+
+        // Discard the positions of the rejected draft tokens.
+        decoder.rewind_state(new_group.state, num_positions - num_decoded);
+        new_group.step = step + num_decoded;
+        add_group(std::move(new_group));
+      }
+    }
+
+    return results;
+  }
+
   static layers::DecoderState get_batch_state(const layers::DecoderState& state,
                                               const int32_t batch_id) {
     const Device device = state.begin()->second.device();
@@ -1049,6 +2214,15 @@ namespace ctranslate2 {
             || options.min_alternative_expansion_prob > 1))
       throw std::invalid_argument("The minimum alternative expansion probability must be "
                                   "between 0 and 1");
+    if (options.num_beam_groups == 0)
+      throw std::invalid_argument("The number of beam groups must be > 0");
+    if (options.num_beam_groups > 1) {
+      if (options.beam_size % options.num_beam_groups != 0)
+        throw std::invalid_argument("The beam size must be a multiple of the number of "
+                                    "beam groups");
+      if (options.prefix_bias_beta > 0)
+        throw std::invalid_argument("Biased decoding is not compatible with beam groups");
+    }
     if (options.callback && (options.beam_size != 1 || options.prefix_bias_beta > 0))
       throw std::invalid_argument("The callback function is not compatible with "
                                   "beam_size > 1 or prefix_bias_beta > 0");
@@ -1075,10 +2249,23 @@ namespace ctranslate2 {
 
   static std::unique_ptr<const SearchStrategy>
   make_search_strategy(const DecodingOptions& options) {
-    if (options.beam_size == 1 && options.prefix_bias_beta == 0)
+    if (options.beam_size == 1 && options.prefix_bias_beta == 0 && options.drafter)
+      return std::make_unique<SpeculativeSearch>(options.drafter,
+                                                 options.num_speculative_tokens,
+                                                 options.length_penalty,
+                                                 options.coverage_penalty,
+                                                 options.callback);
+    else if (options.beam_size == 1 && options.prefix_bias_beta == 0)
       return std::make_unique<GreedySearch>(options.length_penalty,
                                             options.coverage_penalty,
                                             options.callback);
+    else if (options.num_beam_groups > 1)
+      return std::make_unique<DiverseBeamSearch>(options.beam_size,
+                                                 options.num_beam_groups,
+                                                 options.diversity_penalty,
+                                                 options.length_penalty,
+                                                 options.coverage_penalty,
+                                                 options.patience);
     else
       return std::make_unique<BeamSearch>(options.beam_size,
                                           options.length_penalty,
@@ -1199,6 +2386,7 @@ namespace ctranslate2 {
                                                   options.return_prefix,
                                                   options.num_hypotheses,
                                                   options.include_eos_in_hypotheses,
+                                                  options.include_eos_in_attention,
                                                   logits_processors)[0];
 
     start_ids.clear();
@@ -1263,6 +2451,7 @@ namespace ctranslate2 {
                                                   options.return_prefix,
                                                   /*num_hypotheses=*/1,
                                                   options.include_eos_in_hypotheses,
+                                                  options.include_eos_in_attention,
                                                   logits_processors);
 
     // Update the result with the suffix decoding.
@@ -1330,6 +2519,9 @@ namespace ctranslate2 {
     }
 
     if (options.return_alternatives) {
+      // The drafter state cannot follow the expansion of the alternatives.
+      options.drafter.reset();
+
       results.reserve(batch_size);
       for (size_t i = 0; i < batch_size; ++i) {
         layers::DecoderState batch_state = get_batch_state(state, i);
@@ -1362,6 +2554,7 @@ namespace ctranslate2 {
                                         options.return_prefix,
                                         options.num_hypotheses,
                                         options.include_eos_in_hypotheses,
+                                        options.include_eos_in_attention,
                                         logits_processors,
                                         prefix_ids.empty() ? nullptr : &prefix_ids);
     }
@@ -2,7 +2,9 @@
 
 #include <set>
 
+#include "ctranslate2/grammar.h"
 #include "ctranslate2/ops/ops.h"
+#include "ctranslate2/utils.h"
 #include "dispatch.h"
 
 namespace ctranslate2 {
@@ -193,4 +195,128 @@ namespace ctranslate2 {
     }
   }
 
+
+
+  ConstrainedDecoding::ConstrainedDecoding(std::shared_ptr<TokenAutomaton> automaton,
+                                           std::vector<size_t> end_ids)
+    : _automaton(std::move(automaton))
+    , _end_tokens((_automaton->num_tokens() + 63) / 64, 0)
+  {
+    for (const size_t end_id : end_ids) {
+      if (end_id < _automaton->num_tokens())
+        _end_tokens[end_id / 64] |= uint64_t(1) << (end_id % 64);
+    }
+  }
+
+  const std::vector<int32_t>&
+  ConstrainedDecoding::get_disabled_tokens(int32_t state, dim_t vocabulary_size) {
+    auto it = _disabled_tokens.find(state);
+    if (it != _disabled_tokens.end())
+      return it->second;
+
+    const dim_t num_words = _end_tokens.size();
+    std::vector<uint64_t> allowed;
+
+    if (state == TokenAutomaton::dead_state) {
+      allowed = _end_tokens;
+    } else {
+      allowed = _automaton->allowed_tokens(state);
+      if (_automaton->is_accepting(state)) {
+        for (dim_t w = 0; w < num_words; ++w)
+          allowed[w] |= _end_tokens[w];
+      }
+
+      // Stop the generation if no tokens can continue the match.
+      if (std::all_of(allowed.begin(), allowed.end(), [](uint64_t bits) { return bits == 0; }))
+        allowed = _end_tokens;
+    }
+
+    std::vector<int32_t> disabled;
+
+    for (dim_t token_id = 0; token_id < vocabulary_size; ++token_id) {
+      const dim_t w = token_id / 64;
+
+      // Skip blocks of 64 allowed tokens.
+      if (token_id % 64 == 0 && w < num_words && allowed[w] == ~uint64_t(0)) {
+        token_id += 63;
+        continue;
+      }
+
+      if (w < num_words && ((allowed[w] >> (token_id % 64)) & 1))
+        continue;
+
+      disabled.emplace_back(token_id);
+    }
+
+    return _disabled_tokens.emplace(state, std::move(disabled)).first->second;
+  }
+
+  void ConstrainedDecoding::apply(dim_t step,
+                                  StorageView& logits,
+                                  DisableTokens& disable_tokens,
+                                  const StorageView& sequences,
+                                  const std::vector<dim_t>& batch_offset,
+                                  const std::vector<std::vector<size_t>>* prefix) {
+    const dim_t batch_size = logits.dim(0);
+    const dim_t vocabulary_size = logits.dim(1);
+    const bool on_cpu = logits.device() == Device::CPU;
+
+    StorageView sequences_cpu;
+    if (sequences)
+      sequences_cpu = sequences.to(Device::CPU);
+    const dim_t length = sequences_cpu ? sequences_cpu.dim(1) : 0;
+
+    // The states are reset on the first decoding step.
+    if (length == 0 || dim_t(_states.size()) != batch_size) {
+      _states.assign(batch_size, _automaton->initial_state());
+      _num_read_tokens.assign(batch_size, 0);
+    }
+
+    // On GPU the disabled positions are filled in a single call.
+    std::vector<int32_t> flat_indices;
+
+    for (dim_t batch_id = 0; batch_id < batch_size; ++batch_id) {
+      const dim_t sample_begin = get_sample_begin(batch_size, batch_id, batch_offset, prefix);
+      if (step < sample_begin)
+        continue;
+
+      // Read the tokens generated since the previous step, usually a single token.
+      int32_t& state = _states[batch_id];
+      dim_t& num_read_tokens = _num_read_tokens[batch_id];
+      for (dim_t t = std::max(num_read_tokens, sample_begin);
+           t < length && state != TokenAutomaton::dead_state;
+           ++t)
+        state = _automaton->next_state(state, sequences_cpu.at<int32_t>({batch_id, t}));
+      num_read_tokens = length;
+
+      for (const int32_t token_id : get_disabled_tokens(state, vocabulary_size)) {
+        if (on_cpu)
+          disable_tokens.add(batch_id, token_id);
+        else
+          flat_indices.emplace_back(batch_id * vocabulary_size + token_id);
+      }
+    }
+
+    if (flat_indices.empty())
+      return;
+
+    const dim_t num_indices = flat_indices.size();
+    const Device device = logits.device();
+    const DataType dtype = logits.dtype();
+    const StorageView indices({num_indices}, flat_indices, device);
+
+    DEVICE_AND_TYPE_DISPATCH(device, dtype,
+                             primitives<D>::indexed_fill(logits.data<T>(),
+                                                         static_cast<T>(std::numeric_limits<float>::lowest()),
+                                                         indices.data<int32_t>(),
+                                                         num_indices));
+  }
+
+  void ConstrainedDecoding::update_state(const std::vector<int32_t>& origins) {
+    if (_states.empty())
+      return;
+    _states = index_vector(_states, origins);
+    _num_read_tokens = index_vector(_num_read_tokens, origins);
+  }
+
 }
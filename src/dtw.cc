@@ -3,22 +3,26 @@
 #include <algorithm>
 #include <limits>
 
+#include "cpu/parallel.h"
+
 namespace ctranslate2 {
 
-  static std::vector<std::pair<dim_t, dim_t>> backtrace(std::vector<std::vector<int>> trace,
+  // The cost and trace matrices are stored by anti-diagonals: the cell (i, j) is at the
+  // index (i + j) * (n + 1) + i. The cells of a diagonal only depend on the two previous
+  // diagonals, so the loop over a diagonal has no loop-carried dependency.
+
+  static std::vector<std::pair<dim_t, dim_t>> backtrace(const std::vector<int8_t>& trace,
                                                         dim_t i,
                                                         dim_t j) {
-    for (dim_t k = 0; k <= j; ++k)
-      trace[0][k] = 2;
-    for (dim_t k = 0; k <= i; ++k)
-      trace[k][0] = 1;
+    const dim_t n = i;
 
     std::vector<std::pair<dim_t, dim_t>> result;
+    result.reserve(i + j);
 
     while (i > 0 || j > 0) {
       result.emplace_back(i - 1, j - 1);
 
-      const int t = trace[i][j];
+      const int t = (i == 0 ? 2 : j == 0 ? 1 : trace[(i + j) * (n + 1) + i]);
 
       if (t == 0) {
         --i;
@@ -37,46 +41,76 @@ namespace ctranslate2 {
     return result;
   }
 
+  // Computes the cells [begin, end) of a diagonal from the two previous diagonals. The
+  // selects are branch-free so that the compiler vectorizes this loop.
+  static void update_diagonal(const float* __restrict cost_prev2,
+                              const float* __restrict cost_prev1,
+                              const float* __restrict x_diagonal,
+                              float* __restrict cost_cur,
+                              int8_t* __restrict trace_cur,
+                              const dim_t begin,
+                              const dim_t end) {
+    for (dim_t i = begin; i < end; ++i) {
+      const float c0 = cost_prev2[i - 1];  // (i - 1, j - 1)
+      const float c1 = cost_prev1[i - 1];  // (i - 1, j)
+      const float c2 = cost_prev1[i];      // (i, j - 1)
+
+      // t0 and t1 cannot both be true.
+      const bool t0 = (c0 < c1) & (c0 < c2);
+      const bool t1 = (c1 < c0) & (c1 < c2);
+      float c = t0 ? c0 : c2;
+      c = t1 ? c1 : c;
+
+      cost_cur[i] = c - x_diagonal[i];
+      trace_cur[i] = int8_t(2 - 2 * t0 - t1);
+    }
+  }
+
   std::vector<std::pair<dim_t, dim_t>> negative_dtw(const StorageView& x) {
     constexpr float inf = std::numeric_limits<float>::infinity();
     const dim_t n = x.dim(0);
     const dim_t m = x.dim(1);
+    const dim_t num_diagonals = n + m + 1;
+    const dim_t stride = n + 1;
 
-    std::vector<std::vector<float>> cost(n + 1, std::vector<float>(m + 1, inf));
-    std::vector<std::vector<int>> trace(n + 1, std::vector<int>(m + 1, -1));
+    std::vector<float> cost(num_diagonals * stride, inf);
+    std::vector<int8_t> trace(num_diagonals * stride, -1);
 
-    cost[0][0] = 0;
+    cost[0] = 0;
 
     const auto* x_data = x.data<float>();
-
-    for (dim_t j = 1; j < m + 1; ++j) {
-      for (dim_t i = 1; i < n + 1; ++i) {
-        const float c0 = cost[i - 1][j - 1];
-        const float c1 = cost[i - 1][j];
-        const float c2 = cost[i][j - 1];
-
-        float c = 0;
-        int t = 0;
-
-        if (c0 < c1 && c0 < c2) {
-          c = c0;
-          t = 0;
-        } else if (c1 < c0 && c1 < c2) {
-          c = c1;
-          t = 1;
-        } else {
-          c = c2;
-          t = 2;
-        }
-
-        const float v = x_data[(i - 1) * x.dim(1) + (j - 1)];
-
-        cost[i][j] = -v + c;
-        trace[i][j] = t;
-      }
+    std::vector<float> x_diagonal(stride);
+
+    for (dim_t d = 2; d < num_diagonals; ++d) {
+      const dim_t i_begin = std::max(d - m, dim_t(1));
+      const dim_t i_end = std::min(d - 1, n);
+
+      // Copy the diagonal of x so that the loop below only reads contiguous values.
+      for (dim_t i = i_begin; i <= i_end; ++i)
+        x_diagonal[i] = x_data[(i - 1) * m + (d - i - 1)];
+
+      update_diagonal(cost.data() + (d - 2) * stride,
+                      cost.data() + (d - 1) * stride,
+                      x_diagonal.data(),
+                      cost.data() + d * stride,
+                      trace.data() + d * stride,
+                      i_begin,
+                      i_end + 1);
     }
 
-    return backtrace(std::move(trace), n, m);
+    return backtrace(trace, n, m);
+  }
+
+  std::vector<std::vector<std::pair<dim_t, dim_t>>>
+  negative_dtw(const std::vector<StorageView>& x) {
+    std::vector<std::vector<std::pair<dim_t, dim_t>>> results(x.size());
+
+    cpu::parallel_for(0, x.size(), 1, [&](const dim_t begin, const dim_t end) {
+      for (dim_t b = begin; b < end; ++b)
+        results[b] = negative_dtw(x[b]);
+    });
+
+    return results;
   }
 
 }
@@ -7,4 +7,8 @@ namespace ctranslate2 {
   // Dynamic time wrapping function, but x values are negated.
   std::vector<std::pair<dim_t, dim_t>> negative_dtw(const StorageView& x);
 
+  // Same as above for a batch of matrices which are processed in parallel.
+  std::vector<std::vector<std::pair<dim_t, dim_t>>>
+  negative_dtw(const std::vector<StorageView>& x);
+
 }
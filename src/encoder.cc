@@ -35,4 +35,78 @@ namespace ctranslate2 {
       });
   }
 
+
+  std::future<EmbeddingOutput>
+  Encoder::embed_batch_async(std::vector<std::vector<std::string>> tokens,
+                             const EmbeddingOptions& options,
+                             std::vector<std::vector<size_t>> token_type_ids) {
+    return post<EmbeddingOutput>(
+      [tokens = std::move(tokens), options, token_type_ids = std::move(token_type_ids)]
+      (models::SequenceEncoderReplica& encoder) {
+        return encoder.embed(tokens, options, token_type_ids);
+      });
+  }
+
+  std::future<EmbeddingOutput>
+  Encoder::embed_batch_async(std::vector<std::vector<size_t>> ids,
+                             const EmbeddingOptions& options,
+                             std::vector<std::vector<size_t>> token_type_ids) {
+    return post<EmbeddingOutput>(
+      [ids = std::move(ids), options, token_type_ids = std::move(token_type_ids)]
+      (models::SequenceEncoderReplica& encoder) {
+        return encoder.embed(ids, options, token_type_ids);
+      });
+  }
+
+  std::future<EmbeddingOutput>
+  Encoder::embed_batch_async(const StorageView& ids,
+                             const StorageView& lengths,
+                             const EmbeddingOptions& options,
+                             std::vector<std::vector<size_t>> token_type_ids) {
+    return post<EmbeddingOutput>(
+      [ids = ids.sync_copy(),
+       lengths = lengths.sync_copy(),
+       options,
+       token_type_ids = std::move(token_type_ids)]
+      (models::SequenceEncoderReplica& encoder) {
+        return encoder.embed(ids, lengths, options, token_type_ids);
+      });
+  }
+
+  std::future<EncoderClassificationOutput>
+  Encoder::classify_batch_async(std::vector<std::vector<std::string>> tokens,
+                                const EarlyExitOptions& options,
+                                std::vector<std::vector<size_t>> token_type_ids) {
+    return post<EncoderClassificationOutput>(
+      [tokens = std::move(tokens), options, token_type_ids = std::move(token_type_ids)]
+      (models::SequenceEncoderReplica& encoder) {
+        return encoder.classify(tokens, options, token_type_ids);
+      });
+  }
+
+  std::future<EncoderClassificationOutput>
+  Encoder::classify_batch_async(std::vector<std::vector<size_t>> ids,
+                                const EarlyExitOptions& options,
+                                std::vector<std::vector<size_t>> token_type_ids) {
+    return post<EncoderClassificationOutput>(
+      [ids = std::move(ids), options, token_type_ids = std::move(token_type_ids)]
+      (models::SequenceEncoderReplica& encoder) {
+        return encoder.classify(ids, options, token_type_ids);
+      });
+  }
+
+  std::future<EncoderClassificationOutput>
+  Encoder::classify_batch_async(const StorageView& ids,
+                                const StorageView& lengths,
+                                const EarlyExitOptions& options,
+                                std::vector<std::vector<size_t>> token_type_ids) {
+    return post<EncoderClassificationOutput>(
+      [ids = ids.sync_copy(),
+       lengths = lengths.sync_copy(),
+       options,
+       token_type_ids = std::move(token_type_ids)]
+      (models::SequenceEncoderReplica& encoder) {
+        return encoder.classify(ids, lengths, options, token_type_ids);
+      });
+  }
 }
@@ -0,0 +1,29 @@
+#include "ctranslate2/encoding.h"
+
+#include <stdexcept>
+
+namespace ctranslate2 {
+
+  EmbeddingPooling str_to_embedding_pooling(const std::string& pooling) {
+    if (pooling == "cls")
+      return EmbeddingPooling::CLS;
+    if (pooling == "mean")
+      return EmbeddingPooling::Mean;
+    if (pooling == "max")
+      return EmbeddingPooling::Max;
+    if (pooling == "last_token")
+      return EmbeddingPooling::LastToken;
+    throw std::invalid_argument("Invalid embedding pooling: " + pooling);
+  }
+
+  EmbeddingQuantization str_to_embedding_quantization(const std::string& quantization) {
+    if (quantization == "none")
+      return EmbeddingQuantization::None;
+    if (quantization == "int8")
+      return EmbeddingQuantization::Int8;
+    if (quantization == "binary")
+      return EmbeddingQuantization::Binary;
+    throw std::invalid_argument("Invalid embedding quantization: " + quantization);
+  }
+
+}
@@ -2,6 +2,8 @@
 
 #include <spdlog/spdlog.h>
 
+#include "ctranslate2/utils.h"
+
 namespace ctranslate2 {
 
   std::vector<std::future<GenerationResult>>
@@ -9,15 +11,21 @@ namespace ctranslate2 {
                                   const GenerationOptions& options,
                                   const size_t max_batch_size,
                                   const BatchType batch_type) {
+    if (!options.adapters.empty() && options.adapters.size() != start_tokens.size())
+      throw std::invalid_argument("The number of adapters does not match the number of "
+                                  "examples: expected " + std::to_string(start_tokens.size())
+                                  + " adapters but got " + std::to_string(options.adapters.size()));
+
     return post_examples<GenerationResult>(
       load_examples({start_tokens}),
       max_batch_size,
       batch_type,
       [options](models::SequenceGeneratorReplica& generator, const Batch& batch) {
         spdlog::debug("Running batch generation on {} examples", batch.num_examples());
-        auto results = generator.generate(
-          batch.get_stream(0),
-          restore_batch_ids_in_callback(options, batch.example_index));
+        auto batch_options = restore_batch_ids_in_callback(options, batch.example_index);
+        if (!options.adapters.empty())
+          batch_options.adapters = index_vector(options.adapters, batch.example_index);
+        auto results = generator.generate(batch.get_stream(0), batch_options);
         spdlog::debug("Finished batch generation");
         return results;
       });
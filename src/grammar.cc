@@ -0,0 +1,1118 @@
+#include "ctranslate2/grammar.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <limits>
+#include <map>
+#include <stdexcept>
+
+#include <nlohmann/json.hpp>
+
+#include "lru_cache.h"
+
+namespace ctranslate2 {
+
+  using ByteSet = std::bitset<256>;
+
+  static constexpr size_t unbounded = std::numeric_limits<size_t>::max();
+  static constexpr size_t max_nfa_states = 1000000;
+  static constexpr size_t max_dfa_states = 50000;
+
+  namespace {
+
+    struct RegexNode {
+      enum class Type {
+        Empty,
+        Bytes,
+        Concat,
+        Alternation,
+        Repeat,
+      };
+
+      Type type = Type::Empty;
+      ByteSet bytes;
+      std::vector<RegexNode> children;
+      size_t min = 0;
+      size_t max = 0;
+
+      static RegexNode make_bytes(ByteSet bytes) {
+        RegexNode node;
+        node.type = Type::Bytes;
+        node.bytes = bytes;
+        return node;
+      }
+
+      static RegexNode make_byte(unsigned char byte) {
+        ByteSet bytes;
+        bytes.set(byte);
+        return make_bytes(bytes);
+      }
+
+      static RegexNode make_list(Type type, std::vector<RegexNode> children) {
+        if (children.empty())
+          return RegexNode();
+        if (children.size() == 1)
+          return std::move(children[0]);
+        RegexNode node;
+        node.type = type;
+        node.children = std::move(children);
+        return node;
+      }
+    };
+
+    static ByteSet byte_range(unsigned char first, unsigned char last) {
+      ByteSet bytes;
+      for (size_t c = first; c <= last; ++c)
+        bytes.set(c);
+      return bytes;
+    }
+
+    static std::string encode_utf8(uint32_t code_point) {
+      std::string bytes;
+      if (code_point < 0x80) {
+        bytes += char(code_point);
+      } else if (code_point < 0x800) {
+        bytes += char(0xC0 | (code_point >> 6));
+        bytes += char(0x80 | (code_point & 0x3F));
+      } else if (code_point < 0x10000) {
+        bytes += char(0xE0 | (code_point >> 12));
+        bytes += char(0x80 | ((code_point >> 6) & 0x3F));
+        bytes += char(0x80 | (code_point & 0x3F));
+      } else {
+        bytes += char(0xF0 | (code_point >> 18));
+        bytes += char(0x80 | ((code_point >> 12) & 0x3F));
+        bytes += char(0x80 | ((code_point >> 6) & 0x3F));
+        bytes += char(0x80 | (code_point & 0x3F));
+      }
+      return bytes;
+    }
+
+    static std::vector<uint32_t> decode_utf8(const std::string& text) {
+      std::vector<uint32_t> code_points;
+      code_points.reserve(text.size());
+      for (size_t i = 0; i < text.size();) {
+        const auto lead = static_cast<unsigned char>(text[i]);
+        size_t length = 1;
+        uint32_t code_point = lead;
+        if (lead >= 0xF0) {
+          length = 4;
+          code_point = lead & 0x07;
+        } else if (lead >= 0xE0) {
+          length = 3;
+          code_point = lead & 0x0F;
+        } else if (lead >= 0xC0) {
+          length = 2;
+          code_point = lead & 0x1F;
+        }
+        for (size_t j = 1; j < length && i + j < text.size(); ++j)
+          code_point = (code_point << 6) | (static_cast<unsigned char>(text[i + j]) & 0x3F);
+        code_points.push_back(code_point);
+        i += length;
+      }
+      return code_points;
+    }
+
+    class RegexParser {
+    public:
+      RegexParser(const std::string& pattern)
+        : _pattern(pattern)
+        , _pos(0)
+      {
+      }
+
+      RegexNode parse() {
+        RegexNode node = parse_alternation();
+        if (!at_end())
+          error("unbalanced parenthesis");
+        return node;
+      }
+
+    private:
+      const std::string& _pattern;
+      size_t _pos;
+
+      [[noreturn]] void error(const std::string& message) const {
+        throw std::invalid_argument("Invalid regular expression '" + _pattern + "' at position "
+                                    + std::to_string(_pos) + ": " + message);
+      }
+
+      bool at_end() const {
+        return _pos >= _pattern.size();
+      }
+
+      unsigned char peek() const {
+        return _pattern[_pos];
+      }
+
+      unsigned char next() {
+        if (at_end())
+          error("unexpected end of expression");
+        return _pattern[_pos++];
+      }
+
+      RegexNode parse_alternation() {
+        std::vector<RegexNode> branches;
+        branches.emplace_back(parse_concatenation());
+        while (!at_end() && peek() == '|') {
+          ++_pos;
+          branches.emplace_back(parse_concatenation());
+        }
+        if (branches.size() == 1)
+          return std::move(branches[0]);
+        RegexNode node;
+        node.type = RegexNode::Type::Alternation;
+        node.children = std::move(branches);
+        return node;
+      }
+
+      RegexNode parse_concatenation() {
+        std::vector<RegexNode> items;
+        while (!at_end() && peek() != '|' && peek() != ')') {
+          RegexNode item = parse_atom();
+          while (!at_end() && (peek() == '*' || peek() == '+' || peek() == '?' || peek() == '{'))
+            item = parse_quantifier(std::move(item));
+          if (item.type != RegexNode::Type::Empty)
+            items.emplace_back(std::move(item));
+        }
+        return RegexNode::make_list(RegexNode::Type::Concat, std::move(items));
+      }
+
+      RegexNode parse_quantifier(RegexNode item) {
+        size_t min = 0;
+        size_t max = unbounded;
+
+        switch (next()) {
+        case '*':
+          break;
+        case '+':
+          min = 1;
+          break;
+        case '?':
+          max = 1;
+          break;
+        case '{':
+          min = parse_number();
+          if (peek() == ',') {
+            ++_pos;
+            if (peek() != '}')
+              max = parse_number();
+          } else {
+            max = min;
+          }
+          if (next() != '}')
+            error("expected '}'");
+          if (max < min)
+            error("invalid repetition range");
+          break;
+        }
+
+        // Lazy quantifiers match the same language.
+        if (!at_end() && peek() == '?')
+          ++_pos;
+
+        RegexNode node;
+        node.type = RegexNode::Type::Repeat;
+        node.children.emplace_back(std::move(item));
+        node.min = min;
+        node.max = max;
+        return node;
+      }
+
+      size_t parse_number() {
+        const size_t start = _pos;
+        while (!at_end() && std::isdigit(peek()))
+          ++_pos;
+        if (_pos == start)
+          error("expected a number");
+        return std::stoul(_pattern.substr(start, _pos - start));
+      }
+
+      RegexNode parse_atom() {
+        const unsigned char c = next();
+
+        switch (c) {
+        case '(': {
+          if (!at_end() && peek() == '?') {
+            ++_pos;
+            if (next() != ':')
+              error("only non capturing groups (?:...) are supported");
+          }
+          RegexNode node = parse_alternation();
+          if (next() != ')')
+            error("expected ')'");
+          return node;
+        }
+        case '[':
+          return RegexNode::make_bytes(parse_class());
+        case '.':
+          return RegexNode::make_bytes(~ByteSet().set('\n'));
+        case '^':
+        case '$':
+          return RegexNode();
+        case '\\':
+          return parse_escape();
+        case '*':
+        case '+':
+        case '?':
+        case '{':
+          --_pos;
+          error("nothing to repeat");
+        default:
+          break;
+        }
+
+        // Multi-byte UTF-8 characters are repeated as a whole.
+        if (c >= 0xC0) {
+          std::vector<RegexNode> bytes;
+          bytes.emplace_back(RegexNode::make_byte(c));
+          while (!at_end() && (peek() & 0xC0) == 0x80)
+            bytes.emplace_back(RegexNode::make_byte(next()));
+          return RegexNode::make_list(RegexNode::Type::Concat, std::move(bytes));
+        }
+
+        return RegexNode::make_byte(c);
+      }
+
+      uint32_t parse_hex(size_t num_digits) {
+        if (_pos + num_digits > _pattern.size())
+          error("incomplete hexadecimal escape");
+        const std::string digits = _pattern.substr(_pos, num_digits);
+        if (!std::all_of(digits.begin(), digits.end(), [](char d) { return std::isxdigit(d); }))
+          error("invalid hexadecimal escape");
+        _pos += num_digits;
+        return std::stoul(digits, nullptr, 16);
+      }
+
+      // Parses an escape sequence after the backslash and returns the matched string,
+      // or the matched set of bytes when the string is empty.
+      std::string parse_escape_sequence(ByteSet& bytes) {
+        const unsigned char c = next();
+        switch (c) {
+        case 'd':
+          bytes = byte_range('0', '9');
+          return "";
+        case 'D':
+          bytes = ~byte_range('0', '9');
+          return "";
+        case 'w':
+          bytes = byte_range('a', 'z') | byte_range('A', 'Z') | byte_range('0', '9');
+          bytes.set('_');
+          return "";
+        case 'W':
+          bytes = ~(byte_range('a', 'z') | byte_range('A', 'Z') | byte_range('0', '9'));
+          bytes.reset('_');
+          return "";
+        case 's':
+          bytes = ByteSet().set(' ').set('\t').set('\n').set('\r').set('\f').set('\v');
+          return "";
+        case 'S':
+          bytes = ~ByteSet().set(' ').set('\t').set('\n').set('\r').set('\f').set('\v');
+          return "";
+        case 'n':
+          return "\n";
+        case 't':
+          return "\t";
+        case 'r':
+          return "\r";
+        case 'f':
+          return "\f";
+        case 'v':
+          return "\v";
+        case '0':
+          return std::string(1, '\0');
+        case 'x':
+          return std::string(1, char(parse_hex(2)));
+        case 'u':
+          return encode_utf8(parse_hex(4));
+        case 'b':
+        case 'B':
+        case 'A':
+        case 'z':
+        case 'Z':
+          error("anchors and word boundaries are not supported");
+        default:
+          if (std::isalnum(c))
+            error("unsupported escape sequence");
+          return std::string(1, char(c));
+        }
+      }
+
+      RegexNode parse_escape() {
+        ByteSet bytes;
+        const std::string literal = parse_escape_sequence(bytes);
+        if (literal.empty())
+          return RegexNode::make_bytes(bytes);
+
+        std::vector<RegexNode> nodes;
+        for (const char byte : literal)
+          nodes.emplace_back(RegexNode::make_byte(byte));
+        return RegexNode::make_list(RegexNode::Type::Concat, std::move(nodes));
+      }
+
+      // Parses a class item and returns its single byte value, or -1 if it is a set.
+      int parse_class_item(ByteSet& bytes) {
+        unsigned char c = next();
+        if (c == '\\') {
+          const std::string literal = parse_escape_sequence(bytes);
+          if (literal.empty())
+            return -1;
+          if (literal.size() > 1)
+            error("non ASCII characters are not supported in character classes");
+          c = literal[0];
+        } else if (c >= 0x80) {
+          error("non ASCII characters are not supported in character classes");
+        }
+        bytes.set(c);
+        return c;
+      }
+
+      ByteSet parse_class() {
+        ByteSet bytes;
+        bool negate = false;
+        if (!at_end() && peek() == '^') {
+          negate = true;
+          ++_pos;
+        }
+
+        bool first = true;
+        while (first || peek() != ']') {
+          first = false;
+          ByteSet item;
+          const int low = parse_class_item(item);
+
+          if (low >= 0
+              && !at_end() && peek() == '-'
+              && _pos + 1 < _pattern.size() && _pattern[_pos + 1] != ']') {
+            ++_pos;
+            ByteSet unused;
+            const int high = parse_class_item(unused);
+            if (high < low)
+              error("invalid character range");
+            item = byte_range(low, high);
+          }
+
+          bytes |= item;
+          if (at_end())
+            error("expected ']'");
+        }
+
+        ++_pos;
+        return negate ? ~bytes : bytes;
+      }
+    };
+
+    // Thompson construction of a non deterministic automaton.
+    class Nfa {
+    public:
+      struct State {
+        std::vector<int32_t> epsilon;
+        ByteSet bytes;
+        int32_t next = -1;
+      };
+
+      Nfa(const RegexNode& root) {
+        const auto range = build(root);
+        start = range.first;
+        end = range.second;
+      }
+
+      std::vector<State> states;
+      int32_t start;
+      int32_t end;
+
+    private:
+      int32_t add_state() {
+        if (states.size() >= max_nfa_states)
+          throw std::invalid_argument("The regular expression is too large");
+        states.emplace_back();
+        return states.size() - 1;
+      }
+
+      void add_epsilon(int32_t from, int32_t to) {
+        states[from].epsilon.push_back(to);
+      }
+
+      std::pair<int32_t, int32_t> build(const RegexNode& node) {
+        switch (node.type) {
+        case RegexNode::Type::Empty: {
+          const int32_t state = add_state();
+          return {state, state};
+        }
+
+        case RegexNode::Type::Bytes: {
+          const int32_t start = add_state();
+          const int32_t end = add_state();
+          states[start].bytes = node.bytes;
+          states[start].next = end;
+          return {start, end};
+        }
+
+        case RegexNode::Type::Concat: {
+          const auto first = build(node.children[0]);
+          int32_t end = first.second;
+          for (size_t i = 1; i < node.children.size(); ++i) {
+            const auto child = build(node.children[i]);
+            add_epsilon(end, child.first);
+            end = child.second;
+          }
+          return {first.first, end};
+        }
+
+        case RegexNode::Type::Alternation: {
+          const int32_t start = add_state();
+          const int32_t end = add_state();
+          for (const auto& child_node : node.children) {
+            const auto child = build(child_node);
+            add_epsilon(start, child.first);
+            add_epsilon(child.second, end);
+          }
+          return {start, end};
+        }
+
+        case RegexNode::Type::Repeat: {
+          const auto& child_node = node.children[0];
+          const int32_t start = add_state();
+          int32_t current = start;
+
+          for (size_t i = 0; i < node.min; ++i) {
+            const auto child = build(child_node);
+            add_epsilon(current, child.first);
+            current = child.second;
+          }
+
+          if (node.max == unbounded) {
+            const int32_t loop = add_state();
+            const auto child = build(child_node);
+            add_epsilon(current, loop);
+            add_epsilon(loop, child.first);
+            add_epsilon(child.second, loop);
+            return {start, loop};
+          }
+
+          const int32_t end = add_state();
+          for (size_t i = node.min; i < node.max; ++i) {
+            const auto child = build(child_node);
+            add_epsilon(current, end);
+            add_epsilon(current, child.first);
+            current = child.second;
+          }
+          add_epsilon(current, end);
+          return {start, end};
+        }
+        }
+
+        throw std::logic_error("Unknown regular expression node");
+      }
+    };
+
+    static void epsilon_closure(const Nfa& nfa, std::vector<int32_t>& states) {
+      std::vector<bool> visited(nfa.states.size(), false);
+      std::vector<int32_t> stack = states;
+      states.clear();
+
+      while (!stack.empty()) {
+        const int32_t state = stack.back();
+        stack.pop_back();
+        if (visited[state])
+          continue;
+        visited[state] = true;
+        states.push_back(state);
+        for (const int32_t next : nfa.states[state].epsilon)
+          stack.push_back(next);
+      }
+
+      std::sort(states.begin(), states.end());
+    }
+
+  }
+
+  RegexAutomaton::RegexAutomaton(const std::string& pattern) {
+    const Nfa nfa(RegexParser(pattern).parse());
+
+    // Subset construction.
+    std::map<std::vector<int32_t>, int32_t> ids;
+    std::vector<std::vector<int32_t>> subsets;
+
+    std::vector<int32_t> initial = {nfa.start};
+    epsilon_closure(nfa, initial);
+    ids.emplace(initial, 0);
+    subsets.emplace_back(std::move(initial));
+
+    for (size_t id = 0; id < subsets.size(); ++id) {
+      std::array<int32_t, 256> transitions;
+      transitions.fill(dead_state);
+
+      std::array<std::vector<int32_t>, 256> moves;
+      for (const int32_t state : subsets[id]) {
+        const auto& nfa_state = nfa.states[state];
+        if (nfa_state.next < 0)
+          continue;
+        for (size_t c = 0; c < 256; ++c) {
+          if (nfa_state.bytes.test(c))
+            moves[c].push_back(nfa_state.next);
+        }
+      }
+
+      for (size_t c = 0; c < 256; ++c) {
+        auto& move = moves[c];
+        if (move.empty())
+          continue;
+        epsilon_closure(nfa, move);
+
+        auto it = ids.find(move);
+        if (it == ids.end()) {
+          if (subsets.size() >= max_dfa_states)
+            throw std::invalid_argument("The regular expression '" + pattern
+                                        + "' produces too many automaton states");
+          it = ids.emplace(move, subsets.size()).first;
+          subsets.emplace_back(std::move(move));
+        }
+
+        transitions[c] = it->second;
+      }
+
+      _transitions.emplace_back(transitions);
+      _accepting.push_back(std::binary_search(subsets[id].begin(), subsets[id].end(), nfa.end));
+    }
+
+    // Remove the transitions to states that can never reach an accepting state so that
+    // any non dead state can complete the match.
+    const size_t num_states = _transitions.size();
+    std::vector<std::vector<int32_t>> predecessors(num_states);
+    for (size_t state = 0; state < num_states; ++state) {
+      for (const int32_t next : _transitions[state]) {
+        if (next != dead_state)
+          predecessors[next].push_back(state);
+      }
+    }
+
+    std::vector<bool> productive(_accepting);
+    std::vector<int32_t> stack;
+    for (size_t state = 0; state < num_states; ++state) {
+      if (productive[state])
+        stack.push_back(state);
+    }
+    while (!stack.empty()) {
+      const int32_t state = stack.back();
+      stack.pop_back();
+      for (const int32_t previous : predecessors[state]) {
+        if (!productive[previous]) {
+          productive[previous] = true;
+          stack.push_back(previous);
+        }
+      }
+    }
+
+    if (!productive[initial_state()])
+      throw std::invalid_argument("The regular expression '" + pattern + "' cannot match any input");
+
+    for (auto& transitions : _transitions) {
+      for (auto& next : transitions) {
+        if (next != dead_state && !productive[next])
+          next = dead_state;
+      }
+    }
+  }
+
+  bool RegexAutomaton::matches(const std::string& text) const {
+    int32_t state = initial_state();
+    for (const char c : text) {
+      state = next_state(state, static_cast<unsigned char>(c));
+      if (state == dead_state)
+        return false;
+    }
+    return is_accepting(state);
+  }
+
+
+  namespace {
+
+    using Json = nlohmann::ordered_json;
+
+    const std::string whitespace = "[ ]?";
+    const std::string string_char = R"((?:[^"\\\x00-\x1F\x7F]|\\["\\/bfnrt]|\\u[0-9a-fA-F]{4}))";
+    const std::string integer_pattern = R"(-?(?:0|[1-9][0-9]*))";
+    const std::string number_pattern = integer_pattern + R"((?:\.[0-9]+)?(?:[eE][+-]?[0-9]+)?)";
+    const std::string boolean_pattern = "(?:true|false)";
+    const std::string null_pattern = "null";
+    const std::string string_pattern = "\"" + string_char + "*\"";
+    const std::string primitive_pattern = ("(?:" + string_pattern
+                                           + "|" + number_pattern
+                                           + "|" + boolean_pattern
+                                           + "|" + null_pattern + ")");
+
+    const std::map<std::string, std::string> format_patterns = {
+      {"date", R"([0-9]{4}-[0-9]{2}-[0-9]{2})"},
+      {"time", R"([0-9]{2}:[0-9]{2}:[0-9]{2}(?:\.[0-9]+)?(?:Z|[+-][0-9]{2}:[0-9]{2})?)"},
+      {"date-time", (R"([0-9]{4}-[0-9]{2}-[0-9]{2}T[0-9]{2}:[0-9]{2}:[0-9]{2})"
+                     R"((?:\.[0-9]+)?(?:Z|[+-][0-9]{2}:[0-9]{2})?)")},
+      {"uuid", R"([0-9a-fA-F]{8}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{12})"},
+    };
+
+    std::string escape_regex(const std::string& text) {
+      static const std::string special_characters = ".^$|?*+()[]{}\\";
+      std::string escaped;
+      escaped.reserve(text.size());
+      for (const char c : text) {
+        if (special_characters.find(c) != std::string::npos)
+          escaped += '\\';
+        escaped += c;
+      }
+      return escaped;
+    }
+
+    std::string join_alternatives(const std::vector<std::string>& alternatives) {
+      std::string pattern = "(?:";
+      for (size_t i = 0; i < alternatives.size(); ++i) {
+        if (i > 0)
+          pattern += '|';
+        pattern += alternatives[i];
+      }
+      pattern += ')';
+      return pattern;
+    }
+
+    std::string repeat_range(size_t min, size_t max) {
+      if (max == unbounded)
+        return min == 0 ? "*" : "{" + std::to_string(min) + ",}";
+      if (min == max)
+        return "{" + std::to_string(min) + "}";
+      return "{" + std::to_string(min) + "," + std::to_string(max) + "}";
+    }
+
+    class JsonSchemaConverter {
+    public:
+      JsonSchemaConverter(const Json& root)
+        : _root(root)
+      {
+      }
+
+      std::string convert(const Json& schema, size_t depth = 0) {
+        if (depth > max_depth)
+          throw std::invalid_argument("The JSON schema is too deep or recursive");
+
+        if (schema.is_boolean() || (schema.is_object() && schema.empty()))
+          return primitive_pattern;
+        if (!schema.is_object())
+          throw std::invalid_argument("Invalid JSON schema: " + schema.dump());
+
+        if (schema.contains("$ref"))
+          return convert(resolve_reference(schema["$ref"].get<std::string>()), depth + 1);
+
+        if (schema.contains("const"))
+          return escape_regex(schema["const"].dump());
+
+        if (schema.contains("enum")) {
+          std::vector<std::string> alternatives;
+          for (const auto& value : schema["enum"])
+            alternatives.emplace_back(escape_regex(value.dump()));
+          return join_alternatives(alternatives);
+        }
+
+        for (const char* key : {"anyOf", "oneOf"}) {
+          if (schema.contains(key)) {
+            std::vector<std::string> alternatives;
+            for (const auto& subschema : schema[key])
+              alternatives.emplace_back(convert(subschema, depth + 1));
+            return join_alternatives(alternatives);
+          }
+        }
+
+        if (schema.contains("allOf")) {
+          const auto& subschemas = schema["allOf"];
+          if (subschemas.size() != 1)
+            throw std::invalid_argument("allOf is only supported with a single schema");
+          return convert(subschemas[0], depth + 1);
+        }
+
+        if (!schema.contains("type")) {
+          if (schema.contains("properties"))
+            return convert_object(schema, depth);
+          if (schema.contains("items"))
+            return convert_array(schema, depth);
+          return primitive_pattern;
+        }
+
+        const auto& type = schema["type"];
+        if (type.is_array()) {
+          std::vector<std::string> alternatives;
+          for (const auto& single_type : type) {
+            Json subschema = schema;
+            subschema["type"] = single_type;
+            alternatives.emplace_back(convert(subschema, depth + 1));
+          }
+          return join_alternatives(alternatives);
+        }
+
+        const auto type_name = type.get<std::string>();
+        if (type_name == "string")
+          return convert_string(schema);
+        if (type_name == "integer")
+          return integer_pattern;
+        if (type_name == "number")
+          return number_pattern;
+        if (type_name == "boolean")
+          return boolean_pattern;
+        if (type_name == "null")
+          return null_pattern;
+        if (type_name == "array")
+          return convert_array(schema, depth);
+        if (type_name == "object")
+          return convert_object(schema, depth);
+
+        throw std::invalid_argument("Unsupported JSON schema type: " + type_name);
+      }
+
+    private:
+      static constexpr size_t max_depth = 32;
+      const Json& _root;
+
+      const Json& resolve_reference(const std::string& reference) const {
+        if (reference.empty() || reference[0] != '#')
+          throw std::invalid_argument("Only local JSON schema references are supported, got "
+                                      + reference);
+        return _root.at(Json::json_pointer(reference.substr(1)));
+      }
+
+      std::string convert_string(const Json& schema) const {
+        if (schema.contains("pattern")) {
+          std::string pattern = schema["pattern"].get<std::string>();
+          if (!pattern.empty() && pattern.front() == '^')
+            pattern.erase(0, 1);
+          if (!pattern.empty() && pattern.back() == '$')
+            pattern.pop_back();
+          return "\"(?:" + pattern + ")\"";
+        }
+
+        if (schema.contains("format")) {
+          const auto format = schema["format"].get<std::string>();
+          const auto it = format_patterns.find(format);
+          if (it == format_patterns.end())
+            throw std::invalid_argument("Unsupported JSON schema string format: " + format);
+          return "\"" + it->second + "\"";
+        }
+
+        const size_t min_length = schema.value("minLength", size_t(0));
+        const size_t max_length = schema.value("maxLength", unbounded);
+        return "\"" + string_char + repeat_range(min_length, max_length) + "\"";
+      }
+
+      std::string convert_array(const Json& schema, size_t depth) {
+        const std::string item = (schema.contains("items")
+                                  ? convert(schema["items"], depth + 1)
+                                  : primitive_pattern);
+
+        const size_t min_items = schema.value("minItems", size_t(0));
+        const size_t max_items = schema.value("maxItems", unbounded);
+        if (max_items == 0)
+          return "\\[" + whitespace + "\\]";
+
+        const std::string separator = whitespace + "," + whitespace;
+        std::string items = item + "(?:" + separator + item + ")";
+        items += repeat_range(min_items > 0 ? min_items - 1 : 0,
+                              max_items == unbounded ? unbounded : max_items - 1);
+        if (min_items == 0)
+          items = "(?:" + items + ")?";
+
+        return "\\[" + whitespace + items + whitespace + "\\]";
+      }
+
+      std::string convert_object(const Json& schema, size_t depth) {
+        const std::string separator = whitespace + "," + whitespace;
+
+        if (!schema.contains("properties")) {
+          std::string value = primitive_pattern;
+          if (schema.contains("additionalProperties")
+              && schema["additionalProperties"].is_object())
+            value = convert(schema["additionalProperties"], depth + 1);
+
+          const std::string member = string_pattern + whitespace + ":" + whitespace + value;
+          return ("\\{" + whitespace
+                  + "(?:" + member + "(?:" + separator + member + ")*)?"
+                  + whitespace + "\\}");
+        }
+
+        std::vector<std::string> members;
+        std::vector<bool> required;
+        for (const auto& property : schema["properties"].items()) {
+          members.emplace_back("\"" + escape_regex(property.key()) + "\""
+                               + whitespace + ":" + whitespace
+                               + convert(property.value(), depth + 1));
+          required.emplace_back(false);
+        }
+
+        if (schema.contains("required")) {
+          size_t index = 0;
+          for (const auto& property : schema["properties"].items()) {
+            for (const auto& name : schema["required"]) {
+              if (name.get<std::string>() == property.key())
+                required[index] = true;
+            }
+            ++index;
+          }
+        }
+
+        const size_t num_members = members.size();
+        const size_t first_required = std::find(required.begin(), required.end(), true)
+                                      - required.begin();
+
+        // Enumerate the first member that is present: it is not preceded by a separator
+        // and all members before it are optional.
+        std::vector<std::string> alternatives;
+        for (size_t first = 0; first < std::min(first_required + 1, num_members); ++first) {
+          std::string alternative = members[first];
+          for (size_t i = first + 1; i < num_members; ++i) {
+            if (required[i])
+              alternative += separator + members[i];
+            else
+              alternative += "(?:" + separator + members[i] + ")?";
+          }
+          alternatives.emplace_back(std::move(alternative));
+        }
+
+        std::string body;
+        if (!alternatives.empty()) {
+          body = join_alternatives(alternatives);
+          if (first_required == num_members)
+            body += '?';
+        }
+
+        return "\\{" + whitespace + body + whitespace + "\\}";
+      }
+    };
+
+  }
+
+  std::string json_schema_to_regex(const std::string& schema) {
+    Json root;
+    try {
+      root = Json::parse(schema);
+    } catch (const nlohmann::json::exception& e) {
+      throw std::invalid_argument("Invalid JSON schema: " + std::string(e.what()));
+    }
+    return JsonSchemaConverter(root).convert(root);
+  }
+
+
+  // Inverse of the byte to unicode mapping used by byte-level BPE tokenizers (GPT-2).
+  static std::unordered_map<uint32_t, unsigned char> get_unicode_to_byte() {
+    std::unordered_map<uint32_t, unsigned char> unicode_to_byte;
+    uint32_t offset = 0;
+    for (uint32_t byte = 0; byte < 256; ++byte) {
+      const bool printable = ((byte >= '!' && byte <= '~')
+                              || (byte >= 0xA1 && byte <= 0xAC)
+                              || (byte >= 0xAE && byte <= 0xFF));
+      if (printable)
+        unicode_to_byte.emplace(byte, byte);
+      else
+        unicode_to_byte.emplace(256 + offset++, byte);
+    }
+    return unicode_to_byte;
+  }
+
+  static bool is_special_token(const std::string& token, const Vocabulary& vocabulary) {
+    if (token.empty()
+        || token == vocabulary.unk_token()
+        || token == vocabulary.bos_token()
+        || token == vocabulary.eos_token()
+        || token == "<pad>")
+      return true;
+    return (token.size() > 4
+            && token.compare(0, 2, "<|") == 0
+            && token.compare(token.size() - 2, 2, "|>") == 0);
+  }
+
+  std::vector<std::string> get_tokens_bytes(const Vocabulary& vocabulary) {
+    static const std::string sentencepiece_space = "\xe2\x96\x81";
+    const bool byte_level = vocabulary.contains("\xc4\xa0");  // "Ġ"
+    const auto unicode_to_byte = byte_level ? get_unicode_to_byte()
+                                            : std::unordered_map<uint32_t, unsigned char>();
+
+    const size_t size = vocabulary.size();
+    std::vector<std::string> tokens_bytes(size);
+
+    for (size_t i = 0; i < size; ++i) {
+      const auto& token = vocabulary.to_token(i);
+      if (is_special_token(token, vocabulary))
+        continue;
+
+      auto& bytes = tokens_bytes[i];
+
+      if (byte_level) {
+        bool valid = true;
+        for (const uint32_t code_point : decode_utf8(token)) {
+          const auto it = unicode_to_byte.find(code_point);
+          if (it == unicode_to_byte.end()) {
+            valid = false;
+            break;
+          }
+          bytes += char(it->second);
+        }
+
+        // Tokens added after training are not mapped to bytes.
+        if (!valid)
+          bytes = token;
+
+      } else if (token.size() == 6
+                 && token.compare(0, 3, "<0x") == 0
+                 && token.back() == '>'
+                 && std::isxdigit(token[3])
+                 && std::isxdigit(token[4])) {
+        bytes = std::string(1, char(std::stoul(token.substr(3, 2), nullptr, 16)));
+
+      } else {
+        for (size_t pos = 0; pos < token.size();) {
+          if (token.compare(pos, sentencepiece_space.size(), sentencepiece_space) == 0) {
+            bytes += ' ';
+            pos += sentencepiece_space.size();
+          } else {
+            bytes += token[pos++];
+          }
+        }
+      }
+    }
+
+    return tokens_bytes;
+  }
+
+
+  TokenTrie::TokenTrie(const std::vector<std::string>& tokens_bytes)
+    : _num_tokens(tokens_bytes.size())
+  {
+    _nodes.emplace_back();
+
+    for (size_t token_id = 0; token_id < tokens_bytes.size(); ++token_id) {
+      const auto& bytes = tokens_bytes[token_id];
+      if (bytes.empty())
+        continue;
+
+      int32_t node = 0;
+      for (const char c : bytes) {
+        const auto byte = static_cast<unsigned char>(c);
+        auto& children = _nodes[node].children;
+        auto it = std::find_if(children.begin(), children.end(),
+                               [byte](const auto& child) { return child.first == byte; });
+        if (it != children.end()) {
+          node = it->second;
+        } else {
+          const int32_t child = _nodes.size();
+          children.emplace_back(byte, child);
+          _nodes.emplace_back();
+          node = child;
+        }
+      }
+
+      _nodes[node].tokens.push_back(token_id);
+    }
+  }
+
+
+  TokenAutomaton::TokenAutomaton(RegexAutomaton automaton, std::shared_ptr<const TokenTrie> trie)
+    : _automaton(std::move(automaton))
+    , _trie(std::move(trie))
+    , _states(_automaton.num_states())
+  {
+  }
+
+  const TokenAutomaton::State& TokenAutomaton::get_state(int32_t state) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+
+    auto& token_state = _states[state];
+    if (token_state)
+      return *token_state;
+
+    token_state = std::make_unique<State>();
+    token_state->allowed_tokens.resize((num_tokens() + 63) / 64, 0);
+
+    // Match all tokens in a single traversal of the trie, skipping the subtrees that
+    // lead to the dead state.
+    const auto& nodes = _trie->_nodes;
+    std::vector<std::pair<int32_t, int32_t>> stack = {{0, state}};
+
+    while (!stack.empty()) {
+      const auto [node, automaton_state] = stack.back();
+      stack.pop_back();
+
+      for (const auto& [byte, child] : nodes[node].children) {
+        const int32_t next_state = _automaton.next_state(automaton_state, byte);
+        if (next_state == dead_state)
+          continue;
+
+        for (const int32_t token_id : nodes[child].tokens) {
+          token_state->allowed_tokens[token_id / 64] |= uint64_t(1) << (token_id % 64);
+          token_state->transitions.emplace_back(token_id, next_state);
+        }
+
+        stack.emplace_back(child, next_state);
+      }
+    }
+
+    std::sort(token_state->transitions.begin(), token_state->transitions.end());
+    return *token_state;
+  }
+
+  const std::vector<uint64_t>& TokenAutomaton::allowed_tokens(int32_t state) {
+    return get_state(state).allowed_tokens;
+  }
+
+  int32_t TokenAutomaton::next_state(int32_t state, size_t token_id) {
+    const auto& transitions = get_state(state).transitions;
+    const auto it = std::lower_bound(transitions.begin(),
+                                     transitions.end(),
+                                     std::make_pair(int32_t(token_id), dead_state));
+    if (it == transitions.end() || it->first != int32_t(token_id))
+      return dead_state;
+    return it->second;
+  }
+
+
+  GrammarCache::GrammarCache(std::shared_ptr<const Vocabulary> vocabulary, size_t max_size)
+    : _vocabulary(std::move(vocabulary))
+    , _max_size(max_size)
+    , _automata(std::make_unique<AutomatonLru>(max_size))
+  {
+  }
+
+  GrammarCache::~GrammarCache() = default;
+
+  std::shared_ptr<const TokenTrie> GrammarCache::get_trie() {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    if (!_trie)
+      _trie = std::make_shared<TokenTrie>(get_tokens_bytes(*_vocabulary));
+    return _trie;
+  }
+
+  std::shared_ptr<TokenAutomaton> GrammarCache::get(const std::string& pattern) {
+    {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      const auto* automaton = _automata->get(pattern);
+      if (automaton)
+        return *automaton;
+    }
+
+    // The compilation is done without holding the lock.
+    auto automaton = std::make_shared<TokenAutomaton>(RegexAutomaton(pattern), get_trie());
+
+    // A max_size of 0 disables the cache, while LruCache would not limit its size.
+    if (_max_size == 0)
+      return automaton;
+
+    // Another thread may have compiled the same pattern in the meantime.
+    const std::lock_guard<std::mutex> lock(_mutex);
+    if (!_automata->put(pattern, automaton))
+      return *_automata->get(pattern);
+    return automaton;
+  }
+
+  size_t GrammarCache::size() const {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    return _automata->stats().num_entries;
+  }
+
+  void GrammarCache::clear() {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _automata->clear();
+  }
+
+}
@@ -1,4 +1,5 @@
 #include "ctranslate2/layers/attention.h"
+#include "ctranslate2/ops/ragged_attention.h"
 #include "ctranslate2/ops/split.h"
 #include "ctranslate2/utils.h"
 
@@ -293,6 +294,14 @@ namespace ctranslate2 {
       x.reshape({x.dim(0), x.dim(1) * x.dim(2), x.dim(3), x.dim(4)});
     }
 
+    static void move_to_cache(StorageView& x, StorageView& cache) {
+      // x can be a view on a temporary buffer, in which case the data should be copied.
+      if (x.owns_data())
+        cache = std::move(x);
+      else
+        cache = x;
+    }
+
     MultiHeadAttention::MultiHeadAttention(const models::Model& model,
                                            const std::string& scope,
                                            dim_t num_heads,
@@ -353,18 +362,33 @@ namespace ctranslate2 {
       StorageView queries_proj(dtype, device);
       StorageView keys_proj(dtype, device);
       StorageView values_proj(dtype, device);
+      StorageView fused_qkv(dtype, device);
 
-      const StorageView* q = &queries;
       if (_layer_norm && _pre_norm) {
-        (*_layer_norm)(queries, queries_proj);
-        q = &queries_proj;
+        if (_linear[0].accepts_quantized_input(queries)) {
+          StorageView qinput(DataType::INT8, device);
+          StorageView qinput_scale(DataType::FLOAT32, device);
+          (*_layer_norm)(queries, nullptr, _linear[0], qinput, qinput_scale);
+          _linear[0](qinput, qinput_scale, fused_proj);
+        } else {
+          (*_layer_norm)(queries, queries_proj);
+          _linear[0](queries_proj, fused_proj);
+        }
+      } else {
+        _linear[0](queries, fused_proj);
       }
 
-      _linear[0](*q, fused_proj);
+      if (use_ragged_attention(queries, cached_keys, attention, queries_padder, values_padder)) {
+        StorageView context(dtype, device);
+        ragged_attention(fused_proj, values, *queries_padder, values_padder, context);
+        project_output(queries, context, output);
+        return;
+      }
 
       dim_t beam_size = 1;
 
       bool prefilling = (_sliding_window > 0 && values_lengths);
+      bool rotary_applied = false;
 
       if (!_self_attention) {
         queries_proj = std::move(fused_proj);
@@ -400,30 +424,54 @@ namespace ctranslate2 {
 
       } else {
 
-        if (_num_heads_kv < _num_heads) {
+        if (_num_heads_kv < _num_heads && _merge_time_and_head_dims) {
           if (queries_padder)
             queries_padder->add_padding(fused_proj);
 
           const ops::Split split_op(2, {_num_heads * _d_head, _num_heads_kv * _d_head, _num_heads_kv * _d_head});
           split_op(fused_proj, queries_proj, keys_proj, values_proj);
+          queries_proj.reshape({queries_proj.dim(0), -1, _d_head});
 
-          if (_merge_time_and_head_dims) {
-            queries_proj.reshape({queries_proj.dim(0), -1, _d_head});
+        } else {
+          const std::vector<dim_t> split_sizes{_num_heads, _num_heads_kv, _num_heads_kv};
+          const dim_t num_heads_qkv = _num_heads + 2 * _num_heads_kv;
+
+          if (_rotary_embeddings && RotaryEmbeddings::support_split_heads(fused_proj)) {
+            // Queries and keys are rotated while the heads are split.
+            if (queries_padder)
+              queries_padder->add_padding(fused_proj);
+            fused_proj.reshape({fused_proj.dim(0), fused_proj.dim(1), num_heads_qkv, _d_head});
+            _rotary_embeddings->apply_and_split_heads(fused_proj,
+                                                      _num_heads + _num_heads_kv,
+                                                      fused_qkv,
+                                                      offset);
+            fused_proj = std::move(fused_qkv);
+            rotary_applied = true;
           } else {
-            split_heads(queries_proj, _num_heads);
-            split_heads(keys_proj, _num_heads_kv);
-            split_heads(values_proj, _num_heads_kv);
+            split_heads(fused_proj, num_heads_qkv, queries_padder);
+          }
 
+          if (fused_proj.dim(0) == 1) {
+            // The heads are the outer dimension so the projections can be split without a copy.
+            fused_qkv = std::move(fused_proj);
+            fused_qkv.reshape({fused_qkv.dim(1), fused_qkv.dim(2), fused_qkv.dim(3)});
+            ops::Split(0, split_sizes, /*no_copy=*/true)(fused_qkv,
+                                                          queries_proj,
+                                                          keys_proj,
+                                                          values_proj);
+            for (StorageView* x : {&queries_proj, &keys_proj, &values_proj})
+              x->reshape({1, x->dim(0), x->dim(1), x->dim(2)});
+          } else {
+            ops::Split(1, split_sizes)(fused_proj, queries_proj, keys_proj, values_proj);
+          }
+
+          if (_num_heads_kv < _num_heads) {
             replicate_heads(keys_proj, _num_heads / _num_heads_kv);
             replicate_heads(values_proj, _num_heads / _num_heads_kv);
           }
-
-        } else {
-          split_heads(fused_proj, 3 * _num_heads, queries_padder);
-          ops::Split(1)(fused_proj, queries_proj, keys_proj, values_proj);
         }
 
-        if (_rotary_embeddings) {
+        if (_rotary_embeddings && !rotary_applied) {
           if (_merge_time_and_head_dims) {
             queries_proj.reshape({queries_proj.dim(0), -1, _d_model});
             split_heads(queries_proj, _num_heads);
@@ -440,8 +488,8 @@ namespace ctranslate2 {
 
         if (cached_keys != nullptr) {
           if (cached_keys->empty()) {
-            *cached_keys = std::move(keys_proj);
-            *cached_values = std::move(values_proj);
+            move_to_cache(keys_proj, *cached_keys);
+            move_to_cache(values_proj, *cached_values);
           } else {
             const ops::Concat concat_op(_cache_time_dim);
             StorageView& tmp = fused_proj;  // Reuse storage.
@@ -506,6 +554,72 @@ namespace ctranslate2 {
       } else {
         combine_heads(context, _num_heads, queries_padder, beam_size);
       }
+
+      project_output(queries, context, output);
+    }
+
+    bool MultiHeadAttention::use_ragged_attention(const StorageView& queries,
+                                                  const StorageView* cached_keys,
+                                                  const StorageView* attention,
+                                                  const Padder* queries_padder,
+                                                  const Padder* values_padder) const {
+      // The packed layout is kept when the attention does not need the padded positions:
+      // no cache to fill, no attention weights to return, and no position-dependent bias.
+      if (!queries_padder || !queries_padder->has_padding())
+        return false;
+      if (!_self_attention
+          && (!values_padder
+              || values_padder->offsets().size() != queries_padder->offsets().size()))
+        return false;
+      return (queries.device() == Device::CPU
+              && queries.dtype() == DataType::FLOAT32
+              && !cached_keys
+              && !attention
+              && !_relative_attention_bias
+              && !_relative_position_keys
+              && !_relative_asymmetric_position_keys
+              && !_relative_position_values
+              && !_rotary_embeddings
+              && !_alibi
+              && _sliding_window == 0);
+    }
+
+    void MultiHeadAttention::ragged_attention(StorageView& fused_proj,
+                                              const StorageView& values,
+                                              const Padder& queries_padder,
+                                              const Padder* values_padder,
+                                              StorageView& context) const {
+      const Device device = fused_proj.device();
+      const DataType dtype = fused_proj.dtype();
+      StorageView queries_proj(dtype, device);
+      StorageView keys_proj(dtype, device);
+      StorageView values_proj(dtype, device);
+
+      if (_self_attention) {
+        const ops::Split split_op(-1, {_num_heads * _d_head,
+                                       _num_heads_kv * _d_head,
+                                       _num_heads_kv * _d_head});
+        split_op(fused_proj, queries_proj, keys_proj, values_proj);
+      } else {
+        queries_proj = std::move(fused_proj);
+        _linear[1](values, fused_proj);
+        ops::Split(-1)(fused_proj, keys_proj, values_proj);
+      }
+
+      const ops::RaggedAttention attention_op(_num_heads,
+                                              _queries_scale,
+                                              /*is_causal=*/_self_attention && _is_decoder);
+      attention_op(queries_proj,
+                   keys_proj,
+                   values_proj,
+                   queries_padder.offsets(),
+                   _self_attention ? queries_padder.offsets() : values_padder->offsets(),
+                   context);
+    }
+
+    void MultiHeadAttention::project_output(const StorageView& queries,
+                                            StorageView& context,
+                                            StorageView& output) const {
       _linear.back()(context, output);
 
       if (_tensor_parallel) {
@@ -516,10 +630,10 @@ namespace ctranslate2 {
         output = std::move(tmp);
       }
       if (_layer_norm) {
-        ops::Add()(queries, output, output);
-
-        if (!_pre_norm)
-          (*_layer_norm)(output, output);
+        if (_pre_norm)
+          ops::Add()(queries, output, output);
+        else
+          (*_layer_norm)(output, &queries, output);
       }
     }
 
@@ -3,7 +3,10 @@
 
 #include <algorithm>
 #include <cmath>
+#include <map>
+#include <mutex>
 #include <numeric>
+#include <tuple>
 
 #include "dispatch.h"
 #include "cpu/parallel.h"
@@ -216,10 +219,8 @@ namespace ctranslate2 {
       const dim_t max_time = _transpose ? x.dim(-2) : x.dim(-3);
       const dim_t dim = _dim == 0 ? x.dim(-1) : _dim;
 
-      if (!_sin || offset + max_time > _sin.dim(0)) {
-        const dim_t cur_num_positions = _sin ? _sin.dim(0) : 0;
-        const dim_t new_num_positions = std::max(offset + max_time, cur_num_positions + _num_initial_positions);
-        initialize(new_num_positions, dim, device, dtype);
+      if (!_sin || offset + max_time > _sin->dim(0)) {
+        ensure_positions(offset + max_time, dim, device, dtype);
         if (fa2) {
           if (!_sin_half)
           {
@@ -227,8 +228,8 @@ namespace ctranslate2 {
             _cos_half = std::make_unique<StorageView>(dtype, device);
           }
           const ops::Slide slide_op(1, 0, dim / 2);
-          slide_op(_cos, *_cos_half);
-          slide_op(_sin, *_sin_half);
+          slide_op(*_cos, *_cos_half);
+          slide_op(*_sin, *_sin_half);
           if (offset != 0)
             return;
         }
@@ -240,8 +241,8 @@ namespace ctranslate2 {
       StorageView cos(dtype, device);
       TYPE_DISPATCH(dtype,
                     {
-                      sin.view(_sin.index<T>({offset, 0}), {max_time, dim});
-                      cos.view(_cos.index<T>({offset, 0}), {max_time, dim});
+                      sin.view(const_cast<T*>(_sin->index<T>({offset, 0})), {max_time, dim});
+                      cos.view(const_cast<T*>(_cos->index<T>({offset, 0})), {max_time, dim});
                     });
 
       StorageView y(dtype, device);
@@ -249,10 +250,123 @@ namespace ctranslate2 {
       x = std::move(y);
     }
 
+    void RotaryEmbeddings::apply_and_split_heads(const StorageView& x,
+                                                 const dim_t num_rotary_heads,
+                                                 StorageView& output,
+                                                 const dim_t offset) {
+      const Device device = x.device();
+      const DataType dtype = x.dtype();
+      const dim_t max_time = x.dim(1);
+      const dim_t dim = _dim == 0 ? x.dim(-1) : _dim;
+
+      if (!_sin || offset + max_time > _sin->dim(0))
+        ensure_positions(offset + max_time, dim, device, dtype);
+
+      StorageView sin(dtype, device);
+      StorageView cos(dtype, device);
+      TYPE_DISPATCH(dtype,
+                    {
+                      sin.view(const_cast<T*>(_sin->index<T>({offset, 0})), {max_time, dim});
+                      cos.view(const_cast<T*>(_cos->index<T>({offset, 0})), {max_time, dim});
+                    });
+
+      _rotary_op(x, sin, cos, num_rotary_heads, output);
+    }
+
+    struct RotaryEmbeddings::Tables {
+      std::mutex mutex;
+      std::shared_ptr<const StorageView> sin;
+      std::shared_ptr<const StorageView> cos;
+    };
+
+    using RotaryTablesKey = std::tuple<dim_t,
+                                       bool,
+                                       RotaryScalingType,
+                                       float,
+                                       float,
+                                       float,
+                                       float,
+                                       dim_t,
+                                       dim_t,
+                                       Device,
+                                       int,
+                                       DataType>;
+
+    void RotaryEmbeddings::ensure_positions(const dim_t num_positions,
+                                            const dim_t dim,
+                                            const Device device,
+                                            const DataType dtype) {
+      if (!_tables) {
+        // The Su scaling factors are model weights so these tables are not shared.
+        if (_scaling_type == RotaryScalingType::Su)
+          _tables = std::make_shared<Tables>();
+        else {
+          static std::mutex registry_mutex;
+          static std::map<RotaryTablesKey, std::weak_ptr<Tables>> registry;
+
+          const RotaryTablesKey key(dim,
+                                    _interleave,
+                                    _scaling_type,
+                                    _scaling_factor,
+                                    _base,
+                                    _rotary_low_freq_factor,
+                                    _rotary_high_freq_factor,
+                                    _original_max_position_embeddings,
+                                    _max_position_embeddings,
+                                    device,
+                                    get_device_index(device),
+                                    dtype);
+
+          const std::lock_guard<std::mutex> lock(registry_mutex);
+          auto& tables = registry[key];
+          _tables = tables.lock();
+          if (!_tables) {
+            _tables = std::make_shared<Tables>();
+            tables = _tables;
+          }
+        }
+      }
+
+      const std::lock_guard<std::mutex> lock(_tables->mutex);
+
+      // Another layer may have already grown the shared tables.
+      const dim_t cur_num_positions = _tables->sin ? _tables->sin->dim(0) : 0;
+      if (num_positions > cur_num_positions) {
+        auto sin = std::make_shared<StorageView>(dtype, device);
+        auto cos = std::make_shared<StorageView>(dtype, device);
+        initialize(get_table_size(num_positions, cur_num_positions), dim, device, dtype, *sin, *cos);
+
+        // Layers still using the previous tables keep a reference to them.
+        _tables->sin = std::move(sin);
+        _tables->cos = std::move(cos);
+      }
+
+      _sin = _tables->sin;
+      _cos = _tables->cos;
+    }
+
+    dim_t RotaryEmbeddings::get_table_size(const dim_t num_positions,
+                                           const dim_t cur_num_positions) const {
+      // The Su scaling depends on the number of positions so the table is updated
+      // incrementally as before.
+      if (_scaling_type == RotaryScalingType::Su)
+        return std::max(num_positions, cur_num_positions + _num_initial_positions);
+
+      // Grow the table geometrically so that it is recomputed a logarithmic number of
+      // times while decoding, without allocating all positions for short sequences.
+      dim_t size = std::max(num_positions,
+                            cur_num_positions == 0 ? _num_initial_positions : cur_num_positions * 2);
+      if (_max_position_embeddings > 0 && num_positions <= _max_position_embeddings)
+        size = std::min(size, _max_position_embeddings);
+      return size;
+    }
+
     void RotaryEmbeddings::initialize(const dim_t num_positions,
                                       const dim_t dim,
                                       const Device device,
-                                      const DataType dtype) {
+                                      const DataType dtype,
+                                      StorageView& sin,
+                                      StorageView& cos) const {
       StorageView inv_freq({1, dim / 2});
       if (_scaling_type == RotaryScalingType::Su) {
         StorageView* scaling_factor;
@@ -315,19 +429,19 @@ namespace ctranslate2 {
         emb.reshape({num_positions, dim});
       }
 
-      StorageView sin(device);
-      ops::Sin()(emb, sin);
-      if (sin.dtype() == dtype)
-        _sin = std::move(sin);
+      StorageView sin_float(device);
+      ops::Sin()(emb, sin_float);
+      if (sin_float.dtype() == dtype)
+        sin = std::move(sin_float);
       else
-        _sin = sin.to(dtype);
+        sin = sin_float.to(dtype);
 
-      StorageView cos(device);
-      ops::Cos()(emb, cos);
-      if (cos.dtype() == dtype)
-        _cos = std::move(cos);
+      StorageView cos_float(device);
+      ops::Cos()(emb, cos_float);
+      if (cos_float.dtype() == dtype)
+        cos = std::move(cos_float);
       else
-        _cos = cos.to(dtype);
+        cos = cos_float.to(dtype);
 
       if (_original_max_position_embeddings != 0 && _max_position_embeddings != 0 && _scaling_type != RotaryScalingType::Llama3) {
         StorageView scaling_factor;
@@ -337,8 +451,8 @@ namespace ctranslate2 {
         else
           scaling_factor = StorageView(static_cast<float>(sqrt(1 + std::log(scale) / std::log(_original_max_position_embeddings))));
 
-        ops::Mul()(_sin, scaling_factor, _sin);
-        ops::Mul()(_cos, scaling_factor, _cos);
+        ops::Mul()(sin, scaling_factor, sin);
+        ops::Mul()(cos, scaling_factor, cos);
       }
     }
 
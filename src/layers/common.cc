@@ -2,6 +2,7 @@
 
 #include <cmath>
 
+#include "ctranslate2/lora.h"
 #include "ctranslate2/ops/activation.h"
 #include "cpu/backend.h"
 #include "dispatch.h"
@@ -267,7 +268,8 @@ namespace ctranslate2 {
                  const std::string& scope,
                  const ops::ActivationType* activation_type,
                  const bool is_layer_out)
-      : _packed_weight(false)
+      : _scope(scope)
+      , _packed_weight(false)
       , _weight(get_linear_weight(model, scope, &_packed_weight))
       , _bias(model.get_variable_if_exists(scope + "/bias"))
       , _qscale(model.get_variable_if_exists(scope + "/weight_scale"))
@@ -336,8 +338,67 @@ namespace ctranslate2 {
       }
     }
 
+    bool Dense::accepts_quantized_input(const StorageView& input) const {
+      // The LoRA update is computed from the input before quantization.
+      const LoraBatch* lora_batch = get_current_lora_batch();
+      if (lora_batch && lora_batch->adapts(_scope))
+        return false;
+
+      return (_weight.dtype() == DataType::INT8
+              && input.device() == Device::CPU
+              && input.dtype() == DataType::FLOAT32
+              && !(ScopedMPISetter::getNRanks() > 1 && _is_layer_out));
+    }
+
+    void Dense::operator()(const StorageView& qinput,
+                           const StorageView& qinput_scale,
+                           StorageView& output) const {
+      PROFILE("Dense");
+      const StorageView* qscale = _partial_qscale.empty() ? _qscale : &_partial_qscale;
+      const StorageView* weight = _partial_weight.empty() ? &_weight : &_partial_weight;
+      const StorageView* bias = _partial_bias.empty() ? _bias : &_partial_bias;
+      const StorageView* compensation = (_partial_u8_shift_compensation.empty()
+                                         ? _u8_shift_compensation
+                                         : &_partial_u8_shift_compensation);
+
+      StorageView qoutput(DataType::INT32, qinput.device());
+      _gemm_op(qinput, *weight, qoutput, compensation);
+      _dequantize_op(qoutput,
+                     qinput_scale,
+                     *qscale,
+                     /*trans_a=*/false,
+                     /*trans_b=*/true,
+                     output,
+                     bias);
+    }
+
     void Dense::operator()(const StorageView& input, StorageView& output) const {
       PROFILE("Dense");
+      const LoraBatch* lora_batch = get_current_lora_batch();
+      if (!lora_batch || !lora_batch->adapts(_scope)) {
+        compute(input, output, _gemm_op, _dequantize_op, _activation_type);
+        return;
+      }
+
+      // The activation is applied after adding the low-rank update to the base projection.
+      const ops::Gemm gemm_op(/*alpha=*/1,
+                              /*beta=*/0,
+                              /*trans_a=*/false,
+                              /*trans_b=*/true,
+                              /*a_is_packed=*/false,
+                              _packed_weight);
+      const ops::Dequantize dequantize_op;
+      compute(input, output, gemm_op, dequantize_op, nullptr);
+      lora_batch->apply(_scope, input, output);
+      if (_activation_type)
+        ops::get_activation_op(*_activation_type)(output, output);
+    }
+
+    void Dense::compute(const StorageView& input,
+                        StorageView& output,
+                        const ops::Gemm& gemm_op,
+                        const ops::Dequantize& dequantize_op,
+                        const ops::ActivationType* activation_type) const {
       const StorageView* qscale = _partial_qscale.empty() ? _qscale : &_partial_qscale;
       const StorageView* weight = _partial_weight.empty() ? &_weight : &_partial_weight;
       const StorageView* bias = _partial_bias.empty() ? _bias : &_partial_bias;
@@ -387,14 +448,14 @@ namespace ctranslate2 {
           _quantize_op(input, qinput, qinput_scale);
         }
 
-        _gemm_op(qinput, *weight, qoutput, compensation);
-        _dequantize_op(qoutput,
-                       qinput_scale,
-                       *qscale,
-                       /*trans_a=*/false,
-                       /*trans_b=*/true,
-                       output,
-                       bias);
+        gemm_op(qinput, *weight, qoutput, compensation);
+        dequantize_op(qoutput,
+                      qinput_scale,
+                      *qscale,
+                      /*trans_a=*/false,
+                      /*trans_b=*/true,
+                      output,
+                      bias);
       } else if (_qzero && _qscale) {
         switch (_quant_method) {
           case models::QUANTIZATION_TYPE::AWQ_GEMM:
@@ -408,18 +469,18 @@ namespace ctranslate2 {
                                 /*trans_b=*/false,
                                 /*a_is_packed=*/false,
                                 /*b_is_packed*/false,
-                                _activation_type);
+                                activation_type);
               gemm_op(input, weight_dequant, output, nullptr, bias);
             } else {
               ops::GemmAwq gemm_awq_op(/*alpha=*/1, /*beta=*/0, /*trans_a=*/false, /*trans_b=*/false,
-                /*a_is_packed=*/false, /*b_is_packed=*/false, _activation_type);
+                /*a_is_packed=*/false, /*b_is_packed=*/false, activation_type);
               gemm_awq_op(input, *weight, *qscale, *_qzero, output, bias);
             }
             break;
           case models::QUANTIZATION_TYPE::AWQ_GEMV:
           {
             ops::GemvAwq gemv_awq_op(/*alpha=*/1, /*beta=*/0, /*trans_a=*/false, /*trans_b=*/false,
-              /*a_is_packed=*/false, /*b_is_packed=*/false, _activation_type);
+              /*a_is_packed=*/false, /*b_is_packed=*/false, activation_type);
             gemv_awq_op(input, *weight, *qscale, *_qzero, output, bias);
             break;
           }
@@ -428,7 +489,7 @@ namespace ctranslate2 {
                                         "support only ct2 and awq quantization");
         }
       } else {
-        _gemm_op(input, *weight, output, nullptr, bias);
+        gemm_op(input, *weight, output, nullptr, bias);
       }
     }
 
@@ -462,17 +523,44 @@ namespace ctranslate2 {
       }
     }
 
+    void LayerNorm::operator()(const StorageView& input,
+                               const StorageView* residual,
+                               StorageView& output,
+                               StorageView* residual_output) const {
+      const ops::ResidualNorm norm_op(_epsilon, _use_residual);
+      norm_op(_beta, _gamma, input, residual, output, residual_output);
+    }
+
+    void LayerNorm::operator()(const StorageView& input,
+                               const StorageView* residual,
+                               const Dense& next_layer,
+                               StorageView& qoutput,
+                               StorageView& qoutput_scale,
+                               StorageView* residual_output) const {
+      const ops::ResidualNorm norm_op(_epsilon, _use_residual);
+      norm_op(_beta,
+              _gamma,
+              input,
+              residual,
+              next_layer.quantize_op(),
+              qoutput,
+              qoutput_scale,
+              residual_output);
+    }
+
 
     Conv1D::Conv1D(const models::Model& model,
                    const std::string& scope,
                    dim_t stride,
                    dim_t padding,
                    dim_t dilation,
-                   dim_t groups)
-      : _conv_op(stride, padding, dilation, groups)
+                   dim_t groups,
+                   const ops::ActivationType* activation_type)
+      : _conv_op(stride, padding, dilation, groups, activation_type)
       , _weight(model.get_variable(scope + "/weight"))
       , _bias(model.get_variable_if_exists(scope + "/bias"))
-      , _qscale(model.get_variable_if_exists(scope + "/weight_scale")) {
+      , _qscale(model.get_variable_if_exists(scope + "/weight_scale"))
+      , _packed_weight(_conv_op.pack_weight(_weight, _qscale)) {
     }
 
     DataType Conv1D::output_type() const {
@@ -488,10 +576,11 @@ namespace ctranslate2 {
     }
 
     void Conv1D::operator()(const StorageView& input, StorageView& output) const {
+      const StorageView* packed_weight = _packed_weight ? &_packed_weight : nullptr;
       if (_bias)
-        _conv_op(input, _weight, *_bias, output, _qscale);
+        _conv_op(input, _weight, *_bias, output, _qscale, packed_weight);
       else
-        _conv_op(input, _weight, output, _qscale);
+        _conv_op(input, _weight, output, _qscale, packed_weight);
     }
 
   }
@@ -1,11 +1,13 @@
 #include "ctranslate2/layers/decoder.h"
 
 #include <algorithm>
+#include <map>
 #include <numeric>
 
 #include "ctranslate2/decoding_utils.h"
 #include "ctranslate2/ops/ops.h"
 #include "dispatch.h"
+#include "lru_cache.h"
 
 namespace ctranslate2 {
   namespace layers {
@@ -30,9 +32,59 @@ namespace ctranslate2 {
       : _device(device) {
     }
 
+    // Returns the index of the groups of consecutive batches that are all alive, or an
+    // empty storage if a group is partially alive.
+    static StorageView get_alive_groups(const StorageView& alive_batches, const dim_t group_size) {
+      const StorageView alive = alive_batches.to(Device::CPU);
+      const dim_t num_alive = alive.size();
+      const auto* alive_ids = alive.data<int32_t>();
+
+      if (num_alive % group_size != 0)
+        return StorageView(DataType::INT32, alive_batches.device());
+
+      const dim_t num_groups = num_alive / group_size;
+      StorageView groups({num_groups}, DataType::INT32);
+
+      for (dim_t g = 0; g < num_groups; ++g) {
+        const int32_t first = alive_ids[g * group_size];
+        if (first % group_size != 0)
+          return StorageView(DataType::INT32, alive_batches.device());
+        for (dim_t i = 1; i < group_size; ++i) {
+          if (alive_ids[g * group_size + i] != first + i)
+            return StorageView(DataType::INT32, alive_batches.device());
+        }
+        groups.at<int32_t>(g) = first / group_size;
+      }
+
+      return groups.to(alive_batches.device());
+    }
+
     void Decoder::update_state(DecoderState& state, const StorageView& alive_batches) const {
-      for (auto& pair : state) {
-        ops::Gather()(pair.second, alive_batches);
+      // The states that are not replicated can be shared by groups of consecutive batches,
+      // e.g. the hypotheses of the same example. They are replicated once a group is
+      // partially finished.
+      dim_t batch_size = 0;
+      for (const auto& [name, value] : state) {
+        if (value && replicate_state(name)) {
+          batch_size = value.dim(0);
+          break;
+        }
+      }
+
+      for (auto& [name, value] : state) {
+        if (value && batch_size > value.dim(0) && !replicate_state(name)) {
+          const dim_t group_size = batch_size / value.dim(0);
+          const StorageView alive_groups = get_alive_groups(alive_batches, group_size);
+
+          if (alive_groups) {
+            ops::Gather()(value, alive_groups);
+            continue;
+          }
+
+          repeat_batch(value, group_size);
+        }
+
+        ops::Gather()(value, alive_batches);
       }
     }
 
@@ -69,6 +121,10 @@ namespace ctranslate2 {
       return true;
     }
 
+    void Decoder::rewind_state(DecoderState&, const dim_t) const {
+      throw std::runtime_error("This decoder does not support rewinding its state");
+    }
+
     void Decoder::update_output_layer(const dim_t size_multiple,
                                       const std::vector<size_t>& restrict_ids) {
       const dim_t current_output_size = output_size();
@@ -139,15 +195,196 @@ namespace ctranslate2 {
     }
 
 
-    void DecoderStateCache::save(std::vector<size_t> prompt, DecoderState state) {
+    struct DecoderStateCache::Node {
+      // Tokens on the edge from the parent node.
+      std::vector<size_t> tokens;
+      // Number of tokens from the root to the end of this node.
+      size_t length = 0;
+      Node* parent = nullptr;
+      std::map<size_t, std::unique_ptr<Node>> children;
+    };
+
+    static size_t get_state_size(const DecoderState& state) {
+      size_t size = 0;
+      for (const auto& [name, value] : state)
+        size += value.size() * value.item_size();
+      return size;
+    }
+
+    DecoderStateCache::DecoderStateCache(size_t max_size_in_bytes)
+      : _root(std::make_unique<Node>())
+      , _states(std::make_unique<StateLru>(
+                  max_size_in_bytes,
+                  [](Node*, const auto& state) { return get_state_size(*state); },
+                  [this](Node* node, auto&) { prune(node); }))
+    {
+    }
+
+    DecoderStateCache::~DecoderStateCache() = default;
+
+    void DecoderStateCache::save(const std::vector<size_t>& ids, DecoderState state) {
+      const std::lock_guard<std::mutex> lock(_mutex);
+
+      Node* node = _root.get();
+      size_t offset = 0;
+
+      while (offset < ids.size()) {
+        auto it = node->children.find(ids[offset]);
+
+        if (it == node->children.end()) {
+          auto child = std::make_unique<Node>();
+          child->tokens.assign(ids.begin() + offset, ids.end());
+          child->length = ids.size();
+          child->parent = node;
+          node = node->children.emplace(ids[offset], std::move(child)).first->second.get();
+          break;
+        }
+
+        Node* child = it->second.get();
+        size_t matched = 0;
+        while (matched < child->tokens.size()
+               && offset + matched < ids.size()
+               && child->tokens[matched] == ids[offset + matched])
+          ++matched;
+
+        if (matched < child->tokens.size()) {
+          // Split the edge at the first mismatch.
+          auto middle = std::make_unique<Node>();
+          middle->tokens.assign(child->tokens.begin(), child->tokens.begin() + matched);
+          middle->length = child->length - child->tokens.size() + matched;
+          middle->parent = node;
+
+          child->tokens.erase(child->tokens.begin(), child->tokens.begin() + matched);
+          child->parent = middle.get();
+          middle->children.emplace(child->tokens[0], std::move(it->second));
+          it->second = std::move(middle);
+          child = it->second.get();
+        }
+
+        node = child;
+        offset += matched;
+      }
+
+      // An existing state is kept and marked as recently used.
+      _states->put(node, std::make_shared<const DecoderState>(std::move(state)));
+    }
+
+    DecoderStateCache::Match
+    DecoderStateCache::lookup(const std::vector<size_t>& ids, bool allow_truncation) {
+      const std::lock_guard<std::mutex> lock(_mutex);
+
+      Node* best_node = _states->contains(_root.get()) ? _root.get() : nullptr;
+      Node* node = _root.get();
+      size_t offset = 0;
+
+      while (offset < ids.size()) {
+        auto it = node->children.find(ids[offset]);
+        if (it == node->children.end())
+          break;
+
+        Node* child = it->second.get();
+        size_t matched = 0;
+        while (matched < child->tokens.size()
+               && offset + matched < ids.size()
+               && child->tokens[matched] == ids[offset + matched])
+          ++matched;
+
+        offset += matched;
+        if (matched < child->tokens.size()) {
+          // The query ends inside this edge.
+          node = child;
+          break;
+        }
+
+        node = child;
+        if (_states->contains(node))
+          best_node = node;
+      }
+
+      Match match;
+
+      if (best_node) {
+        match.state_length = best_node->length;
+        match.length = best_node->length;
+      }
+
+      if (allow_truncation && offset > match.length) {
+        Node* longer_node = find_state_in_subtree(node);
+        if (longer_node) {
+          best_node = longer_node;
+          match.state_length = longer_node->length;
+          match.length = offset;
+        }
+      }
+
+      if (best_node)
+        match.state = *_states->get(best_node);
+
+      _stats.num_lookups += 1;
+      _stats.num_lookup_tokens += ids.size();
+      if (match.length > 0) {
+        _stats.num_hits += 1;
+        _stats.num_reused_tokens += match.length;
+      }
+
+      return match;
+    }
+
+    DecoderStateCache::Node* DecoderStateCache::find_state_in_subtree(Node* node) const {
+      if (_states->contains(node))
+        return node;
+      for (const auto& [token, child] : node->children) {
+        Node* state_node = find_state_in_subtree(child.get());
+        if (state_node)
+          return state_node;
+      }
+      return nullptr;
+    }
+
+    void DecoderStateCache::prune(Node* node) {
+      // Remove the nodes that no longer lead to a state and merge the nodes
+      // that only have a single child.
+      while (node != _root.get() && !_states->contains(node) && node->children.size() <= 1) {
+        Node* parent = node->parent;
+        auto& slot = parent->children.at(node->tokens[0]);
+
+        if (node->children.empty()) {
+          parent->children.erase(node->tokens[0]);
+        } else {
+          std::unique_ptr<Node> child = std::move(node->children.begin()->second);
+          child->tokens.insert(child->tokens.begin(), node->tokens.begin(), node->tokens.end());
+          child->parent = parent;
+          slot = std::move(child);
+        }
+
+        node = parent;
+      }
+    }
+
+    void DecoderStateCache::set_max_size(size_t max_size_in_bytes) {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      _states->set_max_size(max_size_in_bytes);
+    }
+
+    size_t DecoderStateCache::max_size() const {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      return _states->max_size();
+    }
+
+    DecoderStateCache::Stats DecoderStateCache::get_stats() const {
       const std::lock_guard<std::mutex> lock(_mutex);
-      _cache.emplace(std::move(prompt), std::move(state));
+      const auto& lru_stats = _states->stats();
+      Stats stats = _stats;
+      stats.num_evictions = lru_stats.num_evictions;
+      stats.num_states = lru_stats.num_entries;
+      stats.size_in_bytes = lru_stats.size;
+      return stats;
     }
 
-    const DecoderState* DecoderStateCache::get(const std::vector<size_t>& prompt) const {
+    void DecoderStateCache::clear() {
       const std::lock_guard<std::mutex> lock(_mutex);
-      const auto it = _cache.find(prompt);
-      return it == _cache.end() ? nullptr : &it->second;
+      _root = std::make_unique<Node>();
+      _states->clear();
     }
 
   }
@@ -1,6 +1,10 @@
 #include "ctranslate2/layers/transformer.h"
 
+#include <algorithm>
 #include <cmath>
+#include <numeric>
+
+#include "ctranslate2/lora.h"
 
 namespace ctranslate2 {
   namespace layers {
@@ -12,27 +16,53 @@ namespace ctranslate2 {
       : _layer_norm(build_optional_layer<LayerNorm>(model, scope + "/layer_norm"))
       , _pre_norm(pre_norm)
       , _activation_type(activation_type)
-      , _ff1(model, scope + "/linear_0", &_activation_type)
+      , _ff1_gated(build_optional_layer<Dense>(model, scope + "/linear_0_gated"))
+      , _ff1(_ff1_gated
+             ? nullptr
+             : std::make_unique<Dense>(model, scope + "/linear_0", &_activation_type))
       , _ff1_noact(build_optional_layer<Dense>(model, scope + "/linear_0_noact"))
+      , _gated_activation(activation_type)
       , _ff2(model, scope + "/linear_1", nullptr, true)
       , _tensor_parallel(model.tensor_parallel()) {
     }
 
     void FeedForwardNetwork::operator()(const StorageView& input, StorageView& output) const {
-      const StorageView* x = &input;
-      if (_layer_norm && _pre_norm) {
-        (*_layer_norm)(input, output);
-        x = &output;
-      }
-
       const Device device = input.device();
       const DataType dtype = input.dtype();
 
+      const Dense& ff1 = _ff1_gated ? *_ff1_gated : *_ff1;
       StorageView inner(dtype, device);
-      _ff1(*x, inner);
-      if (_ff1_noact) {
-        StorageView linear(dtype, device);
-        (*_ff1_noact)(*x, linear);
+      StorageView linear(dtype, device);
+
+      if (_layer_norm && _pre_norm
+          && ff1.accepts_quantized_input(input)
+          && (!_ff1_noact || _ff1_noact->accepts_quantized_input(input))) {
+        // The normalized input is quantized once and shared by the input projections.
+        StorageView qinput(DataType::INT8, device);
+        StorageView qinput_scale(DataType::FLOAT32, device);
+        (*_layer_norm)(input, nullptr, ff1, qinput, qinput_scale);
+
+        ff1(qinput, qinput_scale, inner);
+        if (_ff1_noact)
+          (*_ff1_noact)(qinput, qinput_scale, linear);
+
+      } else {
+        const StorageView* x = &input;
+        if (_layer_norm && _pre_norm) {
+          (*_layer_norm)(input, output);
+          x = &output;
+        }
+
+        ff1(*x, inner);
+        if (_ff1_noact)
+          (*_ff1_noact)(*x, linear);
+      }
+
+      if (_ff1_gated) {
+        StorageView gated(dtype, device);
+        _gated_activation(inner, gated);
+        inner = std::move(gated);
+      } else if (_ff1_noact) {
         ops::Mul()(linear, inner, inner);
       }
 
@@ -47,10 +77,10 @@ namespace ctranslate2 {
       }
 
       if (_layer_norm) {
-        ops::Add()(input, output, output);
-
-        if (!_pre_norm)
-          (*_layer_norm)(output, output);
+        if (_pre_norm)
+          ops::Add()(input, output, output);
+        else
+          (*_layer_norm)(output, &input, output);
       }
     }
 
@@ -173,11 +203,8 @@ namespace ctranslate2 {
                              position_bias,
                              offset);
 
-        (*_post_attention_layer_norm)(context, output);
-        ops::Add()(output, input, output);
-
-        context = std::move(output);
-        (*_pre_feedforward_layer_norm)(context, output);
+        (*_post_attention_layer_norm)(context, hidden);
+        (*_pre_feedforward_layer_norm)(hidden, &input, output, &context);
         hidden = std::move(output);
 
         _ff(hidden, output);
@@ -317,11 +344,8 @@ namespace ctranslate2 {
     {
     }
 
-    void TransformerEncoder::operator()(const std::vector<StorageView>& ids,
-                                        const StorageView* lengths,
-                                        StorageView& output) {
-      PROFILE("TransformerEncoder");
-      StorageView input(output.dtype(), output.device());
+    void TransformerEncoder::embed_inputs(const std::vector<StorageView>& ids,
+                                          StorageView& input) {
       _embeddings(ids, input);
       if (_embeddings_scale)
         ops::Mul()(input, *_embeddings_scale, input);
@@ -329,6 +353,23 @@ namespace ctranslate2 {
         (*_position_encoder)(input);
       if (_layernorm_embedding)
         (*_layernorm_embedding)(input, input);
+    }
+
+    StorageView TransformerEncoder::make_lengths_mask(const StorageView& lengths,
+                                                      const dim_t max_time) const {
+      int num_heads = _num_heads;
+      if (_tensor_parallel) {
+        num_heads = SAFE_DIVIDE(num_heads, ScopedMPISetter::getNRanks());
+      }
+      return layers::MultiHeadAttention::prepare_length_mask(lengths, num_heads, max_time);
+    }
+
+    void TransformerEncoder::operator()(const std::vector<StorageView>& ids,
+                                        const StorageView* lengths,
+                                        StorageView& output) {
+      PROFILE("TransformerEncoder");
+      StorageView input(output.dtype(), output.device());
+      embed_inputs(ids, input);
 
       const dim_t max_time = input.dim(1);
 
@@ -342,12 +383,7 @@ namespace ctranslate2 {
           padder->remove_padding(input);
         }
 
-        int num_heads = _num_heads;
-        if (_tensor_parallel) {
-          num_heads = SAFE_DIVIDE(num_heads, ScopedMPISetter::getNRanks());
-        }
-        lengths_mask = std::make_unique<StorageView>(
-          layers::MultiHeadAttention::prepare_length_mask(*lengths, num_heads, max_time));
+        lengths_mask = std::make_unique<StorageView>(make_lengths_mask(*lengths, max_time));
       }
 
       StorageView position_bias(output.dtype(), output.device());
@@ -363,6 +399,122 @@ namespace ctranslate2 {
         padder->add_padding(output);
     }
 
+    void TransformerEncoder::forward_with_early_exit(const std::vector<StorageView>& ids,
+                                                     const StorageView& lengths,
+                                                     const std::vector<dim_t>& exit_layers,
+                                                     const EarlyExitFunction& exit_fn) {
+      PROFILE("TransformerEncoder::forward_with_early_exit");
+      const DataType dtype = output_type();
+      const Device device = lengths.device();
+
+      StorageView input(dtype, device);
+      embed_inputs(ids, input);
+
+      const dim_t num_layers = _layers.size();
+      dim_t max_time = input.dim(1);
+      const bool remove_padding = Padder::allow_padding_removal(device, _compute_type);
+
+      std::vector<bool> is_exit_layer(num_layers, false);
+      for (const dim_t layer : exit_layers) {
+        if (layer < 0 || layer >= num_layers)
+          throw std::invalid_argument("Invalid exit layer " + std::to_string(layer)
+                                      + ": the encoder has " + std::to_string(num_layers)
+                                      + " layers");
+        is_exit_layer[layer] = true;
+      }
+
+      StorageView batch_lengths(lengths);
+      std::vector<dim_t> batch_ids(lengths.size());
+      std::iota(batch_ids.begin(), batch_ids.end(), 0);
+
+      std::unique_ptr<Padder> padder;
+      StorageView lengths_mask;
+      StorageView position_bias(dtype, device);
+
+      const auto prepare_batch = [&]() {
+        if (remove_padding) {
+          padder = std::make_unique<Padder>(batch_lengths, max_time);
+          padder->remove_padding(input);
+        }
+        lengths_mask = make_lengths_mask(batch_lengths, max_time);
+        // The position bias is computed by the first layer for the current max_time.
+        position_bias = StorageView(dtype, device);
+      };
+
+      prepare_batch();
+
+      StorageView output(dtype, device);
+
+      for (dim_t l = 0; l < num_layers; ++l) {
+        (*_layers[l])(input, &lengths_mask, output, padder.get(), &position_bias);
+        input = std::move(output);
+
+        const bool is_last_layer = l + 1 == num_layers;
+        if (!is_last_layer && !is_exit_layer[l])
+          continue;
+
+        // The exit function receives the same representation as the final encoder output.
+        StorageView hidden_states(dtype, device);
+        if (is_last_layer)
+          hidden_states = std::move(input);
+        else
+          hidden_states.copy_from(input);
+        if (_output_norm)
+          (*_output_norm)(hidden_states, hidden_states);
+        if (padder)
+          padder->add_padding(hidden_states);
+
+        const std::vector<bool> should_exit = exit_fn(l, hidden_states, batch_lengths, batch_ids);
+        if (is_last_layer)
+          break;
+        if (should_exit.size() != batch_ids.size())
+          throw std::runtime_error("The early exit function returned "
+                                   + std::to_string(should_exit.size())
+                                   + " values, but the batch has "
+                                   + std::to_string(batch_ids.size()) + " examples");
+
+        std::vector<int32_t> keep_index;
+        std::vector<dim_t> keep_batch_ids;
+        for (size_t i = 0; i < batch_ids.size(); ++i) {
+          if (!should_exit[i]) {
+            keep_index.emplace_back(i);
+            keep_batch_ids.emplace_back(batch_ids[i]);
+          }
+        }
+
+        if (keep_index.empty())
+          break;
+        if (keep_index.size() == batch_ids.size())
+          continue;
+
+        // Compact the batch to the examples that are still running.
+        const StorageView index({dim_t(keep_index.size())}, keep_index, device);
+        const ops::Gather gather_op;
+
+        if (padder)
+          padder->add_padding(input);
+        StorageView compact_input(dtype, device);
+        gather_op(input, index, compact_input);
+        input = std::move(compact_input);
+
+        StorageView compact_lengths(batch_lengths.dtype(), device);
+        gather_op(batch_lengths, index, compact_lengths);
+        batch_lengths = std::move(compact_lengths);
+
+        // The remaining examples can be shorter than the longest example of the batch.
+        const std::vector<int32_t> remaining_lengths = batch_lengths.to_vector<int32_t>();
+        max_time = *std::max_element(remaining_lengths.begin(), remaining_lengths.end());
+        if (max_time < input.dim(1)) {
+          StorageView sliced_input(dtype, device);
+          ops::Slide(1, 0, max_time)(input, sliced_input);
+          input = std::move(sliced_input);
+        }
+
+        batch_ids = std::move(keep_batch_ids);
+        prepare_batch();
+      }
+    }
+
 
     static std::unique_ptr<Alibi> make_alibi(const models::Model& model, const std::string& scope) {
       const bool use_alibi = model.get_flag_with_default(scope + "/alibi", false);
@@ -454,6 +606,43 @@ namespace ctranslate2 {
       return !_with_encoder_attention || !starts_with(name, "memory");
     }
 
+    bool TransformerDecoder::support_state_rewind() const {
+      // The sliding window and flash attention caches do not keep all previous positions.
+      return _sliding_window == 0 && !_use_flash_attention;
+    }
+
+    void TransformerDecoder::rewind_state(DecoderState& state, const dim_t num_steps) const {
+      if (!support_state_rewind())
+        throw std::runtime_error("The decoder state cannot be rewound when using a sliding "
+                                 "window or flash attention");
+      if (num_steps <= 0)
+        return;
+
+      for (size_t l = 0; l < _layers.size(); ++l) {
+        const std::string l_str = std::to_string(l);
+
+        for (const auto& name : {"self_keys_" + l_str, "self_values_" + l_str}) {
+          StorageView& cache = state.at(name);
+          if (cache.empty())
+            continue;
+
+          // The cache is [batch, heads, time, depth], or [batch, time, depth] when
+          // the time and head dimensions are merged.
+          const dim_t time_dim = cache.rank() == 4 ? 2 : 1;
+          const dim_t new_length = cache.dim(time_dim) - num_steps;
+          if (new_length < 0)
+            throw std::invalid_argument("Cannot rewind the decoder state by "
+                                        + std::to_string(num_steps)
+                                        + " steps");
+
+          StorageView rewound(cache.dtype(), cache.device());
+          if (new_length > 0)
+            ops::Slide(time_dim, 0, new_length)(cache, rewound);
+          cache = std::move(rewound);
+        }
+      }
+    }
+
     void TransformerDecoder::set_alignment_heads(const dim_t layer,
                                                  const dim_t num_heads_to_average) {
       std::vector<dim_t> range(num_heads_to_average);
@@ -522,6 +711,15 @@ namespace ctranslate2 {
       const Device device = ids.device();
       const bool is_sequence = ids.rank() > 1;
 
+      // The linear layers add the updates of the LoRA adapters selected for each batch entry.
+      std::unique_ptr<const ScopedLoraBatch> lora_batch;
+      const auto lora_ids = state.find("lora_ids");
+      if (lora_ids != state.end())
+        lora_batch = std::make_unique<ScopedLoraBatch>(
+          lora_ids->second,
+          Padder::allow_padding_removal(_device, _compute_type) ? lengths : nullptr,
+          is_sequence ? ids.dim(1) : 1);
+
       StorageView layer_in(dtype, device);
       StorageView layer_out(dtype, device);
 
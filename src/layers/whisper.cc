@@ -4,8 +4,11 @@ namespace ctranslate2 {
   namespace layers {
 
     WhisperEncoder::WhisperEncoder(const models::Model& model, const std::string& scope)
-      : _conv1(model, scope + "/conv1", /*stride=*/1, /*padding=*/1)
-      , _conv2(model, scope + "/conv2", /*stride=*/2, /*padding=*/1)
+      : _activation_type(ops::ActivationType::GELU)
+      , _conv1(model, scope + "/conv1", /*stride=*/1, /*padding=*/1,
+               /*dilation=*/1, /*groups=*/1, &_activation_type)
+      , _conv2(model, scope + "/conv2", /*stride=*/2, /*padding=*/1,
+               /*dilation=*/1, /*groups=*/1, &_activation_type)
       , _transpose({0, 2, 1})
       , _position_embedding(model, scope + "/position_encodings")
       , _num_heads(model.get_attribute_with_default<int32_t>(scope + "/num_heads", 8))
@@ -44,10 +47,7 @@ namespace ctranslate2 {
       StorageView input(output_type(), features.device());
 
       _conv1(features, input);
-      _gelu(input, input);
-
       _conv2(input, output);
-      _gelu(output, output);
 
       _transpose(output, input);
       _position_embedding(input);
@@ -61,12 +61,24 @@ namespace ctranslate2 {
     }
 
 
+    void WhisperDecoder::operator()(dim_t step,
+                                    const StorageView& ids,
+                                    DecoderState& state,
+                                    StorageView* logits,
+                                    StorageView* attention) {
+      TransformerDecoder::operator()(step, ids, state, logits, attention);
+
+      if (attention && attention->rank() == 3)
+        attention->reshape({attention->dim(0), -1});
+    }
+
     void WhisperDecoder::forward_prompt(const StorageView& prompt,
                                         DecoderState& state,
-                                        StorageView* outputs) {
+                                        StorageView* outputs,
+                                        dim_t step) {
       decode(prompt,
              /*lengths=*/nullptr,
-             /*step=*/0,
+             step,
              state,
              outputs,
              /*attention=*/nullptr,
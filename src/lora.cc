@@ -0,0 +1,388 @@
+#include "ctranslate2/lora.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "ctranslate2/models/model.h"
+#include "ctranslate2/ops/gemm.h"
+#include "ctranslate2/utils.h"
+#include "lru_cache.h"
+
+namespace ctranslate2 {
+
+  static const std::string lora_a_suffix = "/lora_a";
+  static const std::string lora_b_suffix = "/lora_b";
+
+  static StorageView to_host_float32(const StorageView& variable, const std::string& name) {
+    if (!is_float_type(variable.dtype()))
+      throw std::invalid_argument("LoRA variable " + name + " should have a floating point type, "
+                                  "but got " + dtype_name(variable.dtype()));
+    if (variable.rank() != 2)
+      throw std::invalid_argument("LoRA variable " + name + " should be a 2D matrix, but got "
+                                  "a tensor of rank " + std::to_string(variable.rank()));
+    const StorageView host = variable.device() == Device::CPU ? variable : variable.to(Device::CPU);
+    return host.to_float32();
+  }
+
+  LoraAdapter::LoraAdapter(std::unordered_map<std::string, StorageView> variables,
+                           float scale,
+                           const models::Model* model)
+    : _scale(scale)
+  {
+    for (const auto& [name, variable] : variables) {
+      if (ends_with(name, lora_b_suffix))
+        continue;
+      if (!ends_with(name, lora_a_suffix))
+        throw std::invalid_argument("Invalid LoRA variable name " + name + ": the name should "
+                                    "end with " + lora_a_suffix + " or " + lora_b_suffix);
+
+      const std::string scope = name.substr(0, name.size() - lora_a_suffix.size());
+      const auto it = variables.find(scope + lora_b_suffix);
+      if (it == variables.end())
+        throw std::invalid_argument("LoRA variable " + scope + lora_b_suffix + " is missing");
+
+      Weights weights;
+      weights.a = to_host_float32(variable, name);
+      weights.b = to_host_float32(it->second, it->first);
+      if (weights.a.dim(0) != weights.b.dim(1))
+        throw std::invalid_argument("The LoRA matrices of " + scope + " have different ranks: "
+                                    + std::to_string(weights.a.dim(0)) + " and "
+                                    + std::to_string(weights.b.dim(1)));
+
+      _weights.emplace(scope, std::move(weights));
+    }
+
+    for (const auto& [name, variable] : variables) {
+      if (ends_with(name, lora_b_suffix)
+          && !has_layer(name.substr(0, name.size() - lora_b_suffix.size())))
+        throw std::invalid_argument("LoRA variable "
+                                    + name.substr(0, name.size() - lora_b_suffix.size())
+                                    + lora_a_suffix + " is missing");
+    }
+
+    if (model)
+      map_layers(*model);
+  }
+
+  static bool is_linear_layer(const models::Model& model, const std::string& scope) {
+    return (model.get_variable_if_exists(scope + "/weight")
+            || model.get_variable_if_exists(scope + "/weight_packed"));
+  }
+
+  void LoraAdapter::map_layers(const models::Model& model) {
+    std::vector<std::string> scopes;
+    scopes.reserve(_weights.size());
+    for (const auto& [scope, weights] : _weights)
+      scopes.emplace_back(scope);
+
+    for (const auto& scope : scopes) {
+      if (!has_layer(scope) || is_linear_layer(model, scope))
+        continue;
+
+      // The input projections of gated feed forward layers can be merged in linear_0_gated,
+      // see Model::process_linear_weights.
+      bool merged = false;
+      for (const std::string suffix : {"/linear_0", "/linear_0_noact"}) {
+        if (!ends_with(scope, suffix))
+          continue;
+        const std::string ffn_scope = scope.substr(0, scope.size() - suffix.size());
+        const std::string gated_scope = ffn_scope + "/linear_0_gated";
+        if (is_linear_layer(model, gated_scope)) {
+          merge_layers({ffn_scope + "/linear_0", ffn_scope + "/linear_0_noact"}, gated_scope);
+          merged = true;
+        }
+        break;
+      }
+
+      if (!merged)
+        throw std::invalid_argument("LoRA layer " + scope + " does not match a linear layer "
+                                    "of the model");
+    }
+  }
+
+  void LoraAdapter::merge_layers(const std::vector<std::string>& scopes,
+                                 const std::string& merged_scope) {
+    std::vector<const Weights*> weights;
+    weights.reserve(scopes.size());
+    dim_t input_size = 0;
+    dim_t output_size = 0;
+    dim_t rank = 0;
+
+    for (const auto& scope : scopes) {
+      const auto it = _weights.find(scope);
+      if (it == _weights.end()) {
+        weights.emplace_back(nullptr);
+        continue;
+      }
+
+      const Weights& layer_weights = it->second;
+      if (rank > 0 && (layer_weights.a.dim(1) != input_size
+                       || layer_weights.b.dim(0) != output_size))
+        throw std::invalid_argument("The LoRA layers merged in " + merged_scope
+                                    + " should have the same input and output sizes");
+
+      input_size = layer_weights.a.dim(1);
+      output_size = layer_weights.b.dim(0);
+      rank += layer_weights.a.dim(0);
+      weights.emplace_back(&layer_weights);
+    }
+
+    if (rank == 0)
+      return;
+
+    // The down projections are concatenated and the up projections form a block diagonal
+    // matrix so that each layer output is only updated by its own adapter.
+    Weights merged;
+    merged.a = StorageView({rank, input_size}, 0.f);
+    merged.b = StorageView({output_size * dim_t(scopes.size()), rank}, 0.f);
+
+    dim_t rank_offset = 0;
+    for (size_t i = 0; i < weights.size(); ++i) {
+      if (!weights[i])
+        continue;
+
+      const dim_t layer_rank = weights[i]->a.dim(0);
+      const float* a = weights[i]->a.data<float>();
+      const float* b = weights[i]->b.data<float>();
+      std::copy(a, a + layer_rank * input_size, merged.a.index<float>({rank_offset, 0}));
+      for (dim_t row = 0; row < output_size; ++row)
+        std::copy(b + row * layer_rank,
+                  b + (row + 1) * layer_rank,
+                  merged.b.index<float>({dim_t(i) * output_size + row, rank_offset}));
+
+      rank_offset += layer_rank;
+    }
+
+    for (const auto& scope : scopes)
+      _weights.erase(scope);
+    _weights[merged_scope] = std::move(merged);
+
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _converted_weights.clear();
+  }
+
+  const LoraAdapter::Weights* LoraAdapter::get_weights(const std::string& scope,
+                                                       Device device,
+                                                       int device_index,
+                                                       DataType dtype) const {
+    const auto it = _weights.find(scope);
+    if (it == _weights.end())
+      return nullptr;
+    if (device == Device::CPU && dtype == DataType::FLOAT32)
+      return &it->second;
+
+    const std::lock_guard<std::mutex> lock(_mutex);
+    auto& converted_weights = _converted_weights[ConversionKey(device, device_index, dtype)];
+
+    if (converted_weights.empty()) {
+      for (const auto& [name, weights] : _weights) {
+        Weights& converted = converted_weights[name];
+        converted.a = weights.a.to(device).to(dtype);
+        converted.b = weights.b.to(device).to(dtype);
+      }
+    }
+
+    return &converted_weights.at(scope);
+  }
+
+
+  LoraRegistry::LoraRegistry(size_t max_size)
+    : _adapters(std::make_unique<AdapterLru>(
+                  max_size,
+                  nullptr,
+                  [this](const std::string& name, std::shared_ptr<const LoraAdapter>&) {
+                    _evicted.emplace_back(name);
+                  }))
+  {
+  }
+
+  LoraRegistry::~LoraRegistry() = default;
+
+  std::vector<std::string> LoraRegistry::load(const std::string& name,
+                                              std::shared_ptr<const LoraAdapter> adapter) {
+    if (!adapter)
+      throw std::invalid_argument("Cannot load an empty adapter");
+
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _adapters->erase(name);
+    _adapters->put(name, std::move(adapter));
+
+    // The adapters used by running requests are kept alive by their shared pointers.
+    std::vector<std::string> evicted = std::move(_evicted);
+    _evicted.clear();
+    return evicted;
+  }
+
+  bool LoraRegistry::unload(const std::string& name) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    return _adapters->erase(name);
+  }
+
+  std::shared_ptr<const LoraAdapter> LoraRegistry::get(const std::string& name) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    const auto* adapter = _adapters->get(name);
+    if (!adapter)
+      throw std::invalid_argument("No adapter is loaded with the name " + name);
+    return *adapter;
+  }
+
+  bool LoraRegistry::contains(const std::string& name) const {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    return _adapters->contains(name);
+  }
+
+  std::vector<std::string> LoraRegistry::list() const {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    return _adapters->keys();
+  }
+
+  size_t LoraRegistry::size() const {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    return _adapters->stats().num_entries;
+  }
+
+  void LoraRegistry::set_max_size(size_t max_size) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _adapters->set_max_size(max_size);
+    _evicted.clear();
+  }
+
+  size_t LoraRegistry::max_size() const {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    return _adapters->max_size();
+  }
+
+  void LoraRegistry::clear() {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _adapters->clear();
+  }
+
+
+  LoraBatch::LoraBatch(std::vector<const LoraAdapter*> adapters, std::vector<dim_t> row_offsets)
+    : _adapters(std::move(adapters))
+    , _row_offsets(std::move(row_offsets))
+  {
+    if (!_row_offsets.empty() && _row_offsets.size() != _adapters.size() + 1)
+      throw std::invalid_argument("The LoRA batch should have one row offset per batch entry "
+                                  "plus the total number of rows");
+  }
+
+  bool LoraBatch::adapts(const std::string& scope) const {
+    return std::any_of(_adapters.begin(), _adapters.end(),
+                       [&scope](const LoraAdapter* adapter) {
+                         return adapter && adapter->has_layer(scope);
+                       });
+  }
+
+  void LoraBatch::apply(const std::string& scope,
+                        const StorageView& input,
+                        StorageView& output) const {
+    const dim_t batch_size = _adapters.size();
+    const dim_t input_depth = input.dim(-1);
+    const dim_t output_depth = output.dim(-1);
+    const dim_t num_rows = input.size() / input_depth;
+
+    // The input has either the rows of the batch without padding or the same number of
+    // rows for each batch entry.
+    const bool uniform_rows = _row_offsets.empty() || _row_offsets.back() != num_rows;
+    if (uniform_rows && num_rows % batch_size != 0)
+      throw std::invalid_argument("Cannot apply the LoRA adapters of " + std::to_string(batch_size)
+                                  + " batch entries to " + std::to_string(num_rows) + " rows");
+    const dim_t rows_per_entry = num_rows / batch_size;
+    const auto row_offset = [&](dim_t b) {
+      return uniform_rows ? b * rows_per_entry : _row_offsets[b];
+    };
+
+    const Device device = output.device();
+    const DataType dtype = output.dtype();
+    auto* input_data = static_cast<int8_t*>(const_cast<void*>(input.buffer()));
+    auto* output_data = static_cast<int8_t*>(output.buffer());
+
+    StorageView tmp(dtype, device);
+
+    // Consecutive batch entries using the same adapter are updated with a single GEMM.
+    for (dim_t begin = 0; begin < batch_size;) {
+      const LoraAdapter* adapter = _adapters[begin];
+      dim_t end = begin + 1;
+      while (end < batch_size && _adapters[end] == adapter)
+        ++end;
+
+      const dim_t first_row = row_offset(begin);
+      const dim_t segment_rows = row_offset(end) - first_row;
+      const auto* weights = (adapter
+                             ? adapter->get_weights(scope, device, output.device_index(), dtype)
+                             : nullptr);
+
+      if (weights && segment_rows > 0) {
+        StorageView x(input.dtype(), device);
+        StorageView y(dtype, device);
+        x.view(static_cast<void*>(input_data + first_row * input_depth * input.item_size()),
+               {segment_rows, input_depth});
+        y.view(static_cast<void*>(output_data + first_row * output_depth * output.item_size()),
+               {segment_rows, output_depth});
+
+        const ops::Gemm down_proj(/*alpha=*/1, /*beta=*/0, /*trans_a=*/false, /*trans_b=*/true);
+        const ops::Gemm up_proj(adapter->scale(), /*beta=*/1, /*trans_a=*/false, /*trans_b=*/true);
+        down_proj(x, weights->a, tmp);
+        up_proj(tmp, weights->b, y);
+      }
+
+      begin = end;
+    }
+  }
+
+
+  static thread_local const LoraBatch* current_lora_batch = nullptr;
+  static thread_local const std::vector<std::shared_ptr<const LoraAdapter>>* current_adapters = nullptr;
+
+  const LoraBatch* get_current_lora_batch() {
+    return current_lora_batch;
+  }
+
+  ScopedLoraBatch::ScopedLoraBatch(const StorageView& lora_ids,
+                                   const StorageView* lengths,
+                                   dim_t max_time)
+    : _previous_batch(current_lora_batch)
+  {
+    if (!current_adapters)
+      return;
+
+    const std::vector<int32_t> ids = lora_ids.to_vector<int32_t>();
+    std::vector<const LoraAdapter*> adapters;
+    adapters.reserve(ids.size());
+    for (const int32_t id : ids)
+      adapters.emplace_back(id >= 0 ? current_adapters->at(id).get() : nullptr);
+
+    if (std::all_of(adapters.begin(), adapters.end(),
+                    [](const LoraAdapter* adapter) { return !adapter; }))
+      return;
+
+    std::vector<dim_t> row_offsets;
+    if (lengths) {
+      const std::vector<int32_t> lengths_vec = lengths->to_vector<int32_t>();
+      row_offsets.reserve(lengths_vec.size() + 1);
+      row_offsets.emplace_back(0);
+      for (const int32_t length : lengths_vec)
+        row_offsets.emplace_back(row_offsets.back() + std::min(dim_t(length), max_time));
+    }
+
+    _batch = std::make_unique<LoraBatch>(std::move(adapters), std::move(row_offsets));
+    current_lora_batch = _batch.get();
+  }
+
+  ScopedLoraBatch::~ScopedLoraBatch() {
+    current_lora_batch = _previous_batch;
+  }
+
+  ScopedLoraAdapters::ScopedLoraAdapters(
+    const std::vector<std::shared_ptr<const LoraAdapter>>& adapters)
+    : _previous_adapters(current_adapters)
+  {
+    current_adapters = &adapters;
+  }
+
+  ScopedLoraAdapters::~ScopedLoraAdapters() {
+    current_adapters = _previous_adapters;
+  }
+
+}
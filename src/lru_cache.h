@@ -0,0 +1,158 @@
+#pragma once
+
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+namespace ctranslate2 {
+
+  // Least recently used cache with a size-aware capacity: the least recently used
+  // entries are evicted when the sum of the entry sizes exceeds the maximum size.
+  // The entry size is returned by get_size (1 when not set, i.e. the capacity is
+  // a number of entries) and can include the key size. A max_size of 0 means the
+  // cache size is not limited. This class is not thread safe.
+  template <typename Key, typename Value, typename Hash>
+  class LruCache {
+  public:
+    struct Stats {
+      size_t num_lookups = 0;
+      size_t num_hits = 0;
+      size_t num_evictions = 0;
+      size_t num_entries = 0;
+      size_t size = 0;
+
+      float hit_rate() const {
+        return num_lookups == 0 ? 0 : float(num_hits) / float(num_lookups);
+      }
+    };
+
+    using SizeFunction = std::function<size_t(const Key&, const Value&)>;
+    // Called after an entry is evicted to make room for other entries.
+    using EvictCallback = std::function<void(const Key&, Value&)>;
+
+    LruCache(size_t max_size = 0,
+             SizeFunction get_size = nullptr,
+             EvictCallback on_evict = nullptr)
+      : _max_size(max_size)
+      , _get_size(std::move(get_size))
+      , _on_evict(std::move(on_evict))
+    {
+    }
+
+    // Adds an entry and evicts the least recently used entries if needed. If the key
+    // is already cached, the existing value is kept and marked as recently used.
+    // Returns false in this case.
+    bool put(const Key& key, Value value) {
+      auto it = _entries.find(key);
+      if (it != _entries.end()) {
+        _lru.splice(_lru.begin(), _lru, it->second.lru_position);
+        return false;
+      }
+
+      const size_t size = _get_size ? _get_size(key, value) : 1;
+      it = _entries.emplace(key, Entry{std::move(value), size, {}}).first;
+      _lru.push_front(&it->first);
+      it->second.lru_position = _lru.begin();
+
+      _stats.num_entries += 1;
+      _stats.size += size;
+      evict();
+      return true;
+    }
+
+    // Returns the cached value and marks it as recently used, or nullptr if the key
+    // is not cached. The pointer is invalidated by the next modification.
+    Value* get(const Key& key) {
+      _stats.num_lookups += 1;
+
+      const auto it = _entries.find(key);
+      if (it == _entries.end())
+        return nullptr;
+
+      _stats.num_hits += 1;
+      _lru.splice(_lru.begin(), _lru, it->second.lru_position);
+      return &it->second.value;
+    }
+
+    bool contains(const Key& key) const {
+      return _entries.find(key) != _entries.end();
+    }
+
+    // Returns the keys from the most to the least recently used.
+    std::vector<Key> keys() const {
+      std::vector<Key> keys;
+      keys.reserve(_lru.size());
+      for (const Key* key : _lru)
+        keys.emplace_back(*key);
+      return keys;
+    }
+
+    // Removes an entry without calling the eviction callback.
+    bool erase(const Key& key) {
+      const auto it = _entries.find(key);
+      if (it == _entries.end())
+        return false;
+
+      remove(it);
+      return true;
+    }
+
+    void set_max_size(size_t max_size) {
+      _max_size = max_size;
+      evict();
+    }
+
+    size_t max_size() const {
+      return _max_size;
+    }
+
+    const Stats& stats() const {
+      return _stats;
+    }
+
+    void clear() {
+      _entries.clear();
+      _lru.clear();
+      _stats.num_entries = 0;
+      _stats.size = 0;
+    }
+
+  private:
+    struct Entry {
+      Value value;
+      size_t size = 0;
+      typename std::list<const Key*>::iterator lru_position;
+    };
+
+    using Entries = std::unordered_map<Key, Entry, Hash>;
+
+    void remove(typename Entries::iterator it) {
+      _lru.erase(it->second.lru_position);
+      _stats.num_entries -= 1;
+      _stats.size -= it->second.size;
+      _entries.erase(it);
+    }
+
+    void evict() {
+      while (_max_size > 0 && _stats.size > _max_size && !_lru.empty()) {
+        const auto it = _entries.find(*_lru.back());
+        Key key = it->first;
+        Value value = std::move(it->second.value);
+        remove(it);
+        _stats.num_evictions += 1;
+
+        if (_on_evict)
+          _on_evict(key, value);
+      }
+    }
+
+    Entries _entries;
+    std::list<const Key*> _lru;  // The most recently used first.
+    size_t _max_size;
+    SizeFunction _get_size;
+    EvictCallback _on_evict;
+    Stats _stats;
+  };
+
+}
@@ -1,12 +1,19 @@
 #include "ctranslate2/models/language_model.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "ctranslate2/decoding.h"
+#include "ctranslate2/lora.h"
+
+#include "env.h"
 
 namespace ctranslate2 {
   namespace models {
 
     LanguageModel::LanguageModel()
-      : _state_cache(std::make_shared<layers::DecoderStateCache>())
+      : _state_cache(std::make_shared<layers::DecoderStateCache>(
+                       size_t(read_int_from_env("CT2_DECODER_STATE_CACHE_SIZE_MB", 0)) << 20))
     {
     }
 
@@ -18,6 +25,10 @@ namespace ctranslate2 {
       return *_state_cache;
     }
 
+    GrammarCache& LanguageModel::get_grammar_cache() const {
+      return *_grammar_cache;
+    }
+
     void LanguageModel::initialize(ModelReader& model_reader) {
       if (binary_version() < 6) {
         config["unk_token"] = get_attribute_with_default<std::string>("unk_token", "<unk>");
@@ -33,6 +44,8 @@ namespace ctranslate2 {
       _vocabulary = load_vocabulary(model_reader, "vocabulary", std::move(vocab_info));
       if (!_vocabulary)
         throw std::runtime_error("Cannot load the vocabulary from the model directory");
+
+      _grammar_cache = std::make_shared<GrammarCache>(_vocabulary);
     }
 
 
@@ -146,6 +159,67 @@ namespace ctranslate2 {
       }
     }
 
+    // Forwards the prompt shared by all batches and reuses the longest prefix that is
+    // found in the model cache.
+    static void initialize_shared_prompt(layers::Decoder& decoder,
+                                         const LanguageModel& model,
+                                         const std::vector<size_t>& shared_prompt_ids,
+                                         const bool use_cache,
+                                         const dim_t batch_size,
+                                         layers::DecoderState& state) {
+      auto& cache = model.get_state_cache();
+      layers::DecoderState shared_state = decoder.initial_state();
+      size_t cached_length = 0;
+
+      if (use_cache) {
+        const auto match = cache.lookup(shared_prompt_ids, decoder.support_state_rewind());
+        if (match.state) {
+          copy_state(*match.state, shared_state, 1);
+          if (match.state_length > match.length)
+            decoder.rewind_state(shared_state, match.state_length - match.length);
+          cached_length = match.length;
+        }
+      }
+
+      if (cached_length < shared_prompt_ids.size()) {
+        const std::vector<size_t> remaining_ids(shared_prompt_ids.begin() + cached_length,
+                                                shared_prompt_ids.end());
+        const StorageView remaining_prompt = layers::make_sequence_inputs({remaining_ids},
+                                                                          decoder.device());
+
+        decoder(cached_length, remaining_prompt, shared_state);
+
+        if (use_cache)
+          cache.save(shared_prompt_ids, shared_state);
+      }
+
+      copy_state(shared_state, state, batch_size);
+    }
+
+    const DecoderReplica&
+    DecoderReplica::get_draft_replica(const std::shared_ptr<const Model>& draft_model) {
+      if (_draft_replica && _draft_replica->_model == draft_model)
+        return *_draft_replica;
+
+      if (draft_model->device() != _model->device()
+          || draft_model->device_index() != _model->device_index())
+        throw std::invalid_argument("The draft model should be loaded on the same device "
+                                    "as the model");
+
+      auto replica = draft_model->as_sequence_generator();
+      auto* draft_replica = dynamic_cast<DecoderReplica*>(replica.get());
+      if (!draft_replica)
+        throw std::invalid_argument("The draft model should be a decoder-only model");
+      if (draft_replica->_model->get_vocabulary().size()
+          != _model->get_vocabulary().size())
+        throw std::invalid_argument("The draft model should use the same vocabulary "
+                                    "as the model");
+
+      replica.release();
+      _draft_replica.reset(draft_replica);
+      return *_draft_replica;
+    }
+
     std::vector<GenerationResult>
     DecoderReplica::run_generation(const std::vector<std::vector<std::string>>& start_tokens,
                                    const GenerationOptions& options) {
@@ -155,6 +229,8 @@ namespace ctranslate2 {
       DecodingOptions decoding_options;
       decoding_options.beam_size = options.beam_size;
       decoding_options.patience = options.patience;
+      decoding_options.num_beam_groups = options.num_beam_groups;
+      decoding_options.diversity_penalty = options.diversity_penalty;
       decoding_options.length_penalty = options.length_penalty;
       decoding_options.repetition_penalty = options.repetition_penalty;
       decoding_options.no_repeat_ngram_size = options.no_repeat_ngram_size;
@@ -181,38 +257,49 @@ namespace ctranslate2 {
           return options.callback(GenerationStepResult(step_result, vocabulary));
         };
 
-      std::vector<std::vector<size_t>> start_ids = vocabulary.to_ids(start_tokens);
-      layers::DecoderState state = _decoder->initial_state();
+      const auto end_ids(std::visit(ResolveEndToken(vocabulary), options.end_token));
 
-      if (!options.static_prompt.empty()) {
-        std::vector<size_t> static_prompt_ids;
-        static_prompt_ids.reserve(options.static_prompt.size());
-        for (const auto& token : options.static_prompt)
-          static_prompt_ids.emplace_back(vocabulary.to_id(token));
+      if (!options.regex_constraint.empty() || !options.json_schema_constraint.empty()) {
+        if (!options.regex_constraint.empty() && !options.json_schema_constraint.empty())
+          throw std::invalid_argument("The options regex_constraint and json_schema_constraint "
+                                      "cannot be used together");
 
-        auto& cache = _model->get_state_cache();
-        const dim_t batch_size = start_ids.size();
-        const layers::DecoderState* cached_state = (options.cache_static_prompt
-                                                    ? cache.get(static_prompt_ids)
-                                                    : nullptr);
+        const std::string pattern = (options.json_schema_constraint.empty()
+                                     ? options.regex_constraint
+                                     : json_schema_to_regex(options.json_schema_constraint));
 
-        if (cached_state) {
-          copy_state(*cached_state, state, batch_size);
+        decoding_options.logits_processors.emplace_back(
+          std::make_shared<ConstrainedDecoding>(_model->get_grammar_cache().get(pattern), end_ids));
+      }
 
-        } else {
-          layers::DecoderState static_state = _decoder->initial_state();
-          StorageView static_prompt = layers::make_sequence_inputs({static_prompt_ids},
-                                                                   _decoder->device());
+      std::vector<std::vector<size_t>> start_ids = vocabulary.to_ids(start_tokens);
+      layers::DecoderState state = _decoder->initial_state();
 
-          (*_decoder)(0, static_prompt, static_state);
-          copy_state(static_state, state, batch_size);
+      // The decoder state "lora_ids" selects the adapter of each batch entry and is
+      // reordered with the other states during the decoding.
+      const bool use_adapters = std::any_of(options.adapters.begin(),
+                                            options.adapters.end(),
+                                            [](const auto& adapter) { return bool(adapter); });
+      std::unique_ptr<ScopedLoraAdapters> scoped_adapters;
+      if (use_adapters) {
+        if (options.adapters.size() != start_ids.size())
+          throw std::invalid_argument("The number of adapters does not match the batch size");
+
+        StorageView lora_ids({dim_t(start_ids.size())}, DataType::INT32);
+        for (size_t i = 0; i < start_ids.size(); ++i)
+          lora_ids.at<int32_t>(i) = options.adapters[i] ? int32_t(i) : -1;
+
+        state.emplace("lora_ids", lora_ids.to(_decoder->device()));
+        scoped_adapters = std::make_unique<ScopedLoraAdapters>(options.adapters);
+      }
 
-          if (options.cache_static_prompt)
-            cache.save(static_prompt_ids, std::move(static_state));
-        }
+      std::vector<size_t> static_prompt_ids;
+      static_prompt_ids.reserve(options.static_prompt.size());
+      for (const auto& token : options.static_prompt)
+        static_prompt_ids.emplace_back(vocabulary.to_id(token));
 
-        decoding_options.start_step += static_prompt_ids.size();
-      }
+      std::vector<std::vector<size_t>> prompt_ids;
+      decoding_options.start_step += static_prompt_ids.size();
 
       if (!options.include_prompt_in_result) {
         size_t min_prompt_length = start_ids[0].size();
@@ -222,22 +309,104 @@ namespace ctranslate2 {
         size_t forward_length = min_prompt_length - 1;
 
         if (forward_length > 0) {
-          std::vector<std::vector<size_t>> prompt_ids;
           prompt_ids.reserve(start_ids.size());
           for (auto& start_sequence : start_ids) {
             prompt_ids.emplace_back(start_sequence.begin(), start_sequence.begin() + forward_length);
             start_sequence.erase(start_sequence.begin(), start_sequence.begin() + forward_length);
           }
 
-          StorageView prompt = layers::make_sequence_inputs(prompt_ids, _decoder->device());
-          (*_decoder)(decoding_options.start_step, prompt, state);
-
-          decoding_options.start_step += prompt.dim(1);
+          decoding_options.start_step += forward_length;
           decoding_options.return_prefix = false;
         }
       }
 
-      const auto end_ids(std::visit(ResolveEndToken(vocabulary), options.end_token));
+      // The prompt states depend on the adapters, so the static prompt is forwarded
+      // with each batch entry.
+      if (use_adapters && !static_prompt_ids.empty()) {
+        prompt_ids.resize(start_ids.size());
+        for (auto& ids : prompt_ids)
+          ids.insert(ids.begin(), static_prompt_ids.begin(), static_prompt_ids.end());
+        static_prompt_ids.clear();
+      }
+
+      // The prompt part that is common to all batches is forwarded once and can be cached.
+      std::vector<size_t> shared_prompt_ids = static_prompt_ids;
+      size_t shared_length = 0;
+
+      if (options.cache_prompt && !use_adapters && !prompt_ids.empty()) {
+        shared_length = prompt_ids[0].size();
+        for (const auto& ids : prompt_ids) {
+          size_t length = 0;
+          while (length < shared_length && ids[length] == prompt_ids[0][length])
+            ++length;
+          shared_length = length;
+        }
+
+        shared_prompt_ids.insert(shared_prompt_ids.end(),
+                                 prompt_ids[0].begin(),
+                                 prompt_ids[0].begin() + shared_length);
+      }
+
+      StorageView prompt(DataType::INT32, _decoder->device());
+      if (!prompt_ids.empty() && shared_length < prompt_ids[0].size()) {
+        std::vector<std::vector<size_t>> remaining_ids;
+        remaining_ids.reserve(prompt_ids.size());
+        for (const auto& ids : prompt_ids)
+          remaining_ids.emplace_back(ids.begin() + shared_length, ids.end());
+        prompt = layers::make_sequence_inputs(remaining_ids, _decoder->device());
+      }
+
+      const bool use_cache = options.cache_prompt || options.cache_static_prompt;
+      const auto initialize_state = [&](layers::Decoder& decoder,
+                                        const LanguageModel& model,
+                                        layers::DecoderState& decoder_state) {
+        if (!shared_prompt_ids.empty())
+          initialize_shared_prompt(decoder,
+                                   model,
+                                   shared_prompt_ids,
+                                   use_cache,
+                                   start_ids.size(),
+                                   decoder_state);
+        if (prompt)
+          decoder(shared_prompt_ids.size(), prompt, decoder_state);
+      };
+
+      initialize_state(*_decoder, *_model, state);
+
+      if (options.draft_model && options.prompt_lookup_ngram_size > 0)
+        throw std::invalid_argument("The options draft_model and prompt_lookup_ngram_size "
+                                    "cannot be used together");
+
+      const bool speculative_decoding = options.beam_size == 1 && !options.return_alternatives;
+
+      if (options.draft_model && speculative_decoding) {
+        // The draft decoder state is initialized with the same prompt.
+        const auto& draft_replica = get_draft_replica(options.draft_model);
+        auto& draft_decoder = *draft_replica._decoder;
+        draft_decoder.update_output_layer(draft_replica._model->preferred_size_multiple());
+
+        layers::DecoderState draft_state = draft_decoder.initial_state();
+        initialize_state(draft_decoder, *draft_replica._model, draft_state);
+
+        decoding_options.drafter = std::make_shared<DecoderDrafter>(draft_decoder,
+                                                                    std::move(draft_state));
+        decoding_options.num_speculative_tokens = options.num_speculative_tokens;
+
+      } else if (options.prompt_lookup_ngram_size > 0 && speculative_decoding) {
+        // The prompt tokens forwarded before the decoding are not part of the sequences
+        // so they are passed as context.
+        std::vector<std::vector<size_t>> contexts;
+        if (!static_prompt_ids.empty() || !prompt_ids.empty()) {
+          contexts.resize(start_ids.size(), static_prompt_ids);
+          for (size_t i = 0; i < prompt_ids.size(); ++i)
+            contexts[i].insert(contexts[i].end(), prompt_ids[i].begin(), prompt_ids[i].end());
+        }
+
+        decoding_options.drafter = std::make_shared<PromptLookupDrafter>(
+          options.prompt_lookup_ngram_size, std::move(contexts));
+        decoding_options.num_speculative_tokens = options.num_speculative_tokens;
+      }
+
       std::vector<DecodingResult> results = decode(*_decoder,
                                                    state,
                                                    start_ids,
@@ -270,6 +439,8 @@ namespace ctranslate2 {
         final_result.sequences_ids = std::move(result.hypotheses);
         final_result.scores = std::move(result.scores);
         final_result.logits = std::move(result.logits_vocab);
+        final_result.num_draft_tokens = result.num_draft_tokens;
+        final_result.num_accepted_draft_tokens = result.num_accepted_draft_tokens;
         final_results.emplace_back(std::move(final_result));
       }
 
@@ -337,6 +508,222 @@ namespace ctranslate2 {
     }
 
 
+    EmbeddingOutput
+    SequenceEncoderReplica::embed(const std::vector<std::vector<std::string>>& tokens,
+                                  const EmbeddingOptions& options,
+                                  const std::vector<std::vector<size_t>>& token_type_ids) {
+      const auto& vocabulary = _model->get_vocabulary();
+      return embed(vocabulary.to_ids(tokens), options, token_type_ids);
+    }
+
+    EmbeddingOutput
+    SequenceEncoderReplica::embed(const std::vector<std::vector<size_t>>& ids,
+                                  const EmbeddingOptions& options,
+                                  const std::vector<std::vector<size_t>>& token_type_ids) {
+      StorageView lengths;
+      StorageView input_ids = layers::make_sequence_inputs(ids, Device::CPU, 1, &lengths);
+      return embed(input_ids, lengths, options, token_type_ids);
+    }
+
+    // Reduces the hidden states [batch_size, max_length, hidden_size] to [batch_size,
+    // hidden_size], ignoring the padding positions.
+    static StorageView pool_hidden_states(const StorageView& hidden_states,
+                                          const std::vector<int32_t>& lengths,
+                                          const EmbeddingPooling pooling) {
+      const Device device = hidden_states.device();
+      const DataType dtype = hidden_states.dtype();
+      const dim_t batch_size = hidden_states.dim(0);
+      const dim_t max_length = hidden_states.dim(1);
+      const dim_t hidden_size = hidden_states.dim(2);
+
+      StorageView pooled(dtype, device);
+
+      if (pooling == EmbeddingPooling::CLS || pooling == EmbeddingPooling::LastToken) {
+        std::vector<int32_t> positions(batch_size, 0);
+        if (pooling == EmbeddingPooling::LastToken) {
+          for (dim_t b = 0; b < batch_size; ++b)
+            positions[b] = std::max(lengths[b] - 1, 0);
+        }
+
+        const StorageView indices({batch_size}, positions, device);
+        ops::Gather(/*axis=*/1, /*batch_dims=*/1)(hidden_states, indices, pooled);
+        return pooled;
+      }
+
+      // Sequences have different lengths so each one is reduced on a view of its
+      // non padding positions.
+      const ops::Mean mean_op(0);
+      const ops::Transpose transpose_op({1, 0});
+      const ops::TopK max_op(1);
+
+      std::vector<StorageView> rows;
+      rows.reserve(batch_size);
+
+      auto* data = static_cast<int8_t*>(const_cast<void*>(hidden_states.buffer()));
+
+      for (dim_t b = 0; b < batch_size; ++b) {
+        const dim_t length = std::min(std::max(dim_t(lengths[b]), dim_t(1)), max_length);
+
+        StorageView states(dtype, device);
+        void* states_data = data + b * max_length * hidden_size * hidden_states.item_size();
+        states.view(states_data, {length, hidden_size});
+
+        StorageView row(dtype, device);
+
+        if (pooling == EmbeddingPooling::Mean) {
+          mean_op(states, row);
+        } else {
+          StorageView transposed_states(dtype, device);
+          StorageView indices(DataType::INT32, device);
+          transpose_op(states, transposed_states);
+          max_op(transposed_states, row, indices);
+        }
+
+        row.reshape({1, hidden_size});
+        rows.emplace_back(std::move(row));
+      }
+
+      std::vector<const StorageView*> rows_ptr;
+      rows_ptr.reserve(rows.size());
+      for (const auto& row : rows)
+        rows_ptr.emplace_back(&row);
+
+      ops::Concat(0)(rows_ptr, pooled);
+      return pooled;
+    }
+
+    // Packs the sign bits of the embeddings [batch_size, hidden_size] in bytes.
+    static StorageView pack_sign_bits(const StorageView& embeddings) {
+      const dim_t batch_size = embeddings.dim(0);
+      const dim_t hidden_size = embeddings.dim(1);
+      const dim_t num_bytes = ceil_divide(hidden_size, dim_t(8));
+
+      const std::vector<float> values = embeddings.to_vector<float>();
+      std::vector<int8_t> bits(batch_size * num_bytes, 0);
+
+      for (dim_t b = 0; b < batch_size; ++b) {
+        for (dim_t i = 0; i < hidden_size; ++i) {
+          if (values[b * hidden_size + i] > 0)
+            bits[b * num_bytes + i / 8] |= int8_t(1 << (7 - i % 8));
+        }
+      }
+
+      return StorageView({batch_size, num_bytes}, bits, embeddings.device());
+    }
+
+    EmbeddingOutput
+    SequenceEncoderReplica::embed(const StorageView& ids,
+                                  const StorageView& lengths,
+                                  const EmbeddingOptions& options,
+                                  const std::vector<std::vector<size_t>>& token_type_ids) {
+      PROFILE("SequenceEncoderReplica::embed");
+      const auto& model = *this->model();
+      const auto device = model.device();
+      const auto scoped_device_setter = model.get_scoped_device_setter();
+
+      StorageView input_token_type_ids = layers::make_sequence_inputs(token_type_ids, device);
+      EncoderForwardOutput forward_output;
+
+      if (ids.device() != device)
+        forward_output = forward_impl(ids.to(device), lengths.to(device), input_token_type_ids);
+      else
+        forward_output = forward_impl(ids, lengths, input_token_type_ids);
+
+      StorageView embeddings = pool_hidden_states(forward_output.last_hidden_state,
+                                                  lengths.to_vector<int32_t>(),
+                                                  options.pooling);
+      if (embeddings.dtype() != DataType::FLOAT32)
+        embeddings = embeddings.to_float32();
+
+      if (options.normalize) {
+        // The RMS normalization with gamma = 1 / sqrt(hidden_size) is the L2 normalization.
+        const dim_t hidden_size = embeddings.dim(-1);
+        const StorageView gamma({hidden_size},
+                                1.f / std::sqrt(float(hidden_size)),
+                                device);
+        ops::RMSNorm(/*epsilon=*/1e-12f / hidden_size)(gamma, embeddings, embeddings);
+      }
+
+      EmbeddingOutput output;
+
+      switch (options.quantization) {
+      case EmbeddingQuantization::None: {
+        output.embeddings = std::move(embeddings);
+        break;
+      }
+
+      case EmbeddingQuantization::Int8: {
+        StorageView qembeddings(DataType::INT8, device);
+        StorageView scales(DataType::FLOAT32, device);
+        ops::Quantize(ops::Quantize::ScaleType::PER_LAYER,
+                      /*shift_to_uint8=*/false,
+                      /*round_before_cast=*/true)(embeddings, qembeddings, scales);
+        output.embeddings = std::move(qembeddings);
+        output.scales = std::move(scales);
+        break;
+      }
+
+      case EmbeddingQuantization::Binary: {
+        output.embeddings = pack_sign_bits(embeddings);
+        break;
+      }
+      }
+
+      // Ensure all operations are finished before returning the output.
+      synchronize_stream(device);
+      return output;
+    }
+
+
+    EncoderClassificationOutput
+    SequenceEncoderReplica::classify(const std::vector<std::vector<std::string>>& tokens,
+                                     const EarlyExitOptions& options,
+                                     const std::vector<std::vector<size_t>>& token_type_ids) {
+      const auto& vocabulary = _model->get_vocabulary();
+      return classify(vocabulary.to_ids(tokens), options, token_type_ids);
+    }
+
+    EncoderClassificationOutput
+    SequenceEncoderReplica::classify(const std::vector<std::vector<size_t>>& ids,
+                                     const EarlyExitOptions& options,
+                                     const std::vector<std::vector<size_t>>& token_type_ids) {
+      StorageView lengths;
+      StorageView input_ids = layers::make_sequence_inputs(ids, Device::CPU, 1, &lengths);
+      return classify(input_ids, lengths, options, token_type_ids);
+    }
+
+    EncoderClassificationOutput
+    SequenceEncoderReplica::classify(const StorageView& ids,
+                                     const StorageView& lengths,
+                                     const EarlyExitOptions& options,
+                                     const std::vector<std::vector<size_t>>& token_type_ids) {
+      PROFILE("SequenceEncoderReplica::classify");
+      const auto& model = *this->model();
+      const auto device = model.device();
+      const auto scoped_device_setter = model.get_scoped_device_setter();
+
+      StorageView input_token_type_ids = layers::make_sequence_inputs(token_type_ids, device);
+      EncoderClassificationOutput output;
+
+      if (ids.device() != device)
+        output = classify_impl(ids.to(device), lengths.to(device), input_token_type_ids, options);
+      else
+        output = classify_impl(ids, lengths, input_token_type_ids, options);
+
+      // Ensure all operations are finished before returning the output.
+      synchronize_stream(device);
+      return output;
+    }
+
+    EncoderClassificationOutput
+    SequenceEncoderReplica::classify_impl(const StorageView&,
+                                          const StorageView&,
+                                          const StorageView&,
+                                          const EarlyExitOptions&) {
+      throw std::runtime_error("This model does not support the classification with early exit");
+    }
+
+
     EncoderReplica::EncoderReplica(const std::shared_ptr<const LanguageModel>& model,
                                    std::unique_ptr<layers::Encoder> encoder)
       : SequenceEncoderReplica(model)
@@ -349,10 +736,24 @@ namespace ctranslate2 {
     {
     }
 
-    EncoderForwardOutput
-    EncoderReplica::forward_impl(const StorageView& ids,
-                                 const StorageView& lengths,
-                                 const StorageView& token_type_ids) {
+    std::vector<StorageView> EncoderReplica::make_inputs(const StorageView& ids,
+                                                         const StorageView& token_type_ids) const {
+      std::vector<StorageView> inputs{ids};
+
+      if (_encoder->num_input_features() > 1) {
+        if (token_type_ids.empty()) {
+          StorageView placeholder_type_ids(ids.shape(), ids.dtype(), ids.device());
+          placeholder_type_ids.zero();
+          inputs.emplace_back(std::move(placeholder_type_ids));
+        } else {
+          inputs.emplace_back(token_type_ids);
+        }
+      }
+
+      return inputs;
+    }
+
+    static void validate_encoder_inputs(const StorageView& ids, const StorageView& lengths) {
       if (ids.rank() != 2)
         throw std::invalid_argument("Expected input ids to have 2 dimensions, but got "
                                     + std::to_string(ids.rank())
@@ -363,21 +764,18 @@ namespace ctranslate2 {
                                     + ", but got size "
                                     + std::to_string(lengths.size())
                                     + " instead");
+    }
+
+    EncoderForwardOutput
+    EncoderReplica::forward_impl(const StorageView& ids,
+                                 const StorageView& lengths,
+                                 const StorageView& token_type_ids) {
+      validate_encoder_inputs(ids, lengths);
 
       const Device device = _model->device();
       const DataType dtype = _encoder->output_type();
 
-      std::vector<StorageView> inputs{ids};
-
-      if (_encoder->num_input_features() > 1) {
-        if (token_type_ids.empty()) {
-          StorageView placeholder_type_ids(ids.shape(), ids.dtype(), device);
-          placeholder_type_ids.zero();
-          inputs.emplace_back(std::move(placeholder_type_ids));
-        } else {
-          inputs.emplace_back(token_type_ids);
-        }
-      }
+      const std::vector<StorageView> inputs = make_inputs(ids, token_type_ids);
 
       StorageView last_hidden_state(dtype, device);
       (*_encoder)(inputs, lengths, last_hidden_state);
@@ -402,5 +800,91 @@ namespace ctranslate2 {
       return output;
     }
 
+
+    EncoderClassificationOutput
+    EncoderReplica::classify_impl(const StorageView& ids,
+                                  const StorageView& lengths,
+                                  const StorageView& token_type_ids,
+                                  const EarlyExitOptions& options) {
+      validate_encoder_inputs(ids, lengths);
+
+      const Device device = _model->device();
+      const DataType dtype = _encoder->output_type();
+      const dim_t batch_size = ids.dim(0);
+      const dim_t hidden_size = _encoder->output_size();
+
+      const StorageView& weight = options.classifier_weight;
+      if (weight.rank() != 2 || weight.dim(1) != hidden_size)
+        throw std::invalid_argument("Expected the classifier weight to have shape [num_classes, "
+                                    + std::to_string(hidden_size) + "]");
+      const dim_t num_classes = weight.dim(0);
+      if (options.classifier_bias && options.classifier_bias->size() != num_classes)
+        throw std::invalid_argument("Expected the classifier bias to have size "
+                                    + std::to_string(num_classes) + ", but got size "
+                                    + std::to_string(options.classifier_bias->size()));
+
+      // The classifier is a small float32 head computed on the model device.
+      const StorageView classifier_weight = weight.to(device).to_float32();
+      const StorageView classifier_bias = (options.classifier_bias
+                                           ? options.classifier_bias->to(device).to_float32()
+                                           : StorageView(device));
+
+      std::vector<float> logits(batch_size * num_classes, 0.f);
+      std::vector<size_t> exit_layers(batch_size, 0);
+
+      const layers::EarlyExitFunction exit_fn = [&](dim_t layer,
+                                                   const StorageView& hidden_states,
+                                                   const StorageView& batch_lengths,
+                                                   const std::vector<dim_t>& batch_ids) {
+        StorageView pooled = pool_hidden_states(hidden_states,
+                                                batch_lengths.to_vector<int32_t>(),
+                                                options.pooling);
+        if (options.pooling == EmbeddingPooling::CLS && _pooler_dense) {
+          StorageView pooler_output(dtype, device);
+          (*_pooler_dense)(pooled, pooler_output);
+          pooled = std::move(pooler_output);
+        }
+        if (pooled.dtype() != DataType::FLOAT32)
+          pooled = pooled.to_float32();
+
+        StorageView batch_logits(device);
+        ops::Gemm(1, 0, false, true)(pooled, classifier_weight, batch_logits);
+        if (!classifier_bias.empty())
+          ops::BiasAdd()(batch_logits, classifier_bias, batch_logits);
+
+        StorageView probs(device);
+        ops::SoftMax()(batch_logits, probs);
+
+        const std::vector<float> batch_logits_host = batch_logits.to_vector<float>();
+        const std::vector<float> probs_host = probs.to_vector<float>();
+
+        // The examples are recorded at each evaluation, so the examples reaching the last
+        // layer keep the logits of the last layer.
+        std::vector<bool> should_exit(batch_ids.size());
+        for (size_t i = 0; i < batch_ids.size(); ++i) {
+          const dim_t b = batch_ids[i];
+          const auto* probs_i = probs_host.data() + i * num_classes;
+          std::copy_n(batch_logits_host.data() + i * num_classes,
+                      num_classes,
+                      logits.data() + b * num_classes);
+          exit_layers[b] = layer;
+          should_exit[i] = (*std::max_element(probs_i, probs_i + num_classes)
+                            >= options.confidence_threshold);
+        }
+
+        return should_exit;
+      };
+
+      _encoder->forward_with_early_exit(make_inputs(ids, token_type_ids),
+                                        lengths,
+                                        std::vector<dim_t>(options.exit_layers.begin(),
+                                                           options.exit_layers.end()),
+                                        exit_fn);
+
+      EncoderClassificationOutput output;
+      output.logits = StorageView({batch_size, num_classes}, logits, device);
+      output.exit_layers = std::move(exit_layers);
+      return output;
+    }
   }
 }
@@ -388,6 +388,21 @@ namespace ctranslate2 {
       if (_device != Device::CPU)
         return;  // There is currently no processing for non CPU device.
 
+      // Gated feed forward layers (e.g. SwiGLU) have 2 input projections that are applied
+      // on the same input. Concatenate them so that a single GEMM is run.
+      {
+        const std::string gated_suffix = "/linear_0_noact/weight";
+        std::vector<std::string> gated_scopes;
+        for (const auto& pair : _variable_index) {
+          const std::string& name = pair.first;
+          if (ends_with(name, gated_suffix))
+            gated_scopes.emplace_back(name.substr(0, name.size() - gated_suffix.size()));
+        }
+        for (const auto& scope : gated_scopes)
+          merge_linear_layers({scope + "/linear_0", scope + "/linear_0_noact"},
+                              scope + "/linear_0_gated");
+      }
+
       const bool pack_weights = cpu::pack_gemm_weights(_effective_compute_type);
       const bool transpose = true;
       const float alpha = 1;
@@ -421,6 +436,69 @@ namespace ctranslate2 {
       }
     }
 
+    bool Model::merge_linear_layers(const std::vector<std::string>& scopes,
+                                    const std::string& merged_scope) {
+      // Concatenates the output dimension of linear layers sharing the same input.
+      // The layers are only merged when their parameters are compatible.
+      std::vector<const StorageView*> weights;
+      std::vector<const StorageView*> scales;
+      std::vector<const StorageView*> biases;
+      weights.reserve(scopes.size());
+      scales.reserve(scopes.size());
+      biases.reserve(scopes.size());
+
+      for (const auto& scope : scopes) {
+        const std::string weight_name = scope + "/weight";
+        const auto it = _variable_index.find(weight_name);
+        if (it == _variable_index.end() || !is_linear_weight(weight_name))
+          return false;
+
+        // Skip aliased weights and formats with additional parameters.
+        const auto& weight = it->second;
+        if (weight.use_count() > 1
+            || weight->rank() != 2
+            || get_variable_if_exists(scope + "/weight_zero"))
+          return false;
+
+        const StorageView* scale = get_variable_if_exists(scope + "/weight_scale");
+        if (scale && scale->rank() != 1)
+          return false;
+
+        weights.emplace_back(weight.get());
+        scales.emplace_back(scale);
+        biases.emplace_back(get_variable_if_exists(scope + "/bias"));
+      }
+
+      for (size_t i = 1; i < scopes.size(); ++i) {
+        if (weights[i]->dtype() != weights[0]->dtype()
+            || weights[i]->dim(1) != weights[0]->dim(1)
+            || bool(scales[i]) != bool(scales[0])
+            || bool(biases[i]) != bool(biases[0]))
+          return false;
+      }
+
+      const auto merge = [this, &merged_scope](const std::vector<const StorageView*>& inputs,
+                                               const std::string& name) {
+        if (!inputs[0])
+          return;
+        StorageView merged(inputs[0]->dtype(), inputs[0]->device());
+        ops::Concat(0)(inputs, merged);
+        register_variable(merged_scope + "/" + name, std::move(merged));
+      };
+
+      merge(weights, "weight");
+      merge(scales, "weight_scale");
+      merge(biases, "bias");
+
+      for (const auto& scope : scopes) {
+        remove_variable(scope + "/weight");
+        remove_variable(scope + "/weight_scale");
+        remove_variable(scope + "/bias");
+      }
+
+      return true;
+    }
+
     static DataType get_dtype_from_item_size(uint8_t item_size) {
       // This is the old (and flawed) logic of resolving the dtype of saved variables.
       switch (item_size) {
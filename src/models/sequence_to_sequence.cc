@@ -3,6 +3,10 @@
 #include <algorithm>
 
 #include "ctranslate2/decoding.h"
+#include "ctranslate2/ops/ops.h"
+
+#include "env.h"
+#include "lru_cache.h"
 
 namespace ctranslate2 {
   namespace models {
@@ -10,6 +14,93 @@ namespace ctranslate2 {
     static const std::string vmap_file = "vmap.txt";
 
 
+    static size_t get_output_size(const EncoderOutputCache::Key&,
+                                  const std::shared_ptr<const StorageView>& output) {
+      return output->size() * output->item_size();
+    }
+
+    EncoderOutputCache::EncoderOutputCache(size_t max_size_in_bytes)
+      : _outputs(std::make_unique<OutputLru>(max_size_in_bytes, get_output_size))
+    {
+    }
+
+    EncoderOutputCache::~EncoderOutputCache() = default;
+
+    size_t EncoderOutputCache::KeyHash::operator()(const Key& key) const {
+      size_t hash = key.size();
+      const auto combine = [&hash](size_t value) {
+        hash ^= std::hash<size_t>()(value) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+      };
+
+      for (const auto& ids : key) {
+        combine(ids.size());
+        for (const size_t id : ids)
+          combine(id);
+      }
+
+      return hash;
+    }
+
+    void EncoderOutputCache::save(const Key& ids, StorageView output) {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      _outputs->put(ids, std::make_shared<const StorageView>(std::move(output)));
+    }
+
+    std::shared_ptr<const StorageView> EncoderOutputCache::get(const Key& ids) {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      const auto* output = _outputs->get(ids);
+      return output ? *output : nullptr;
+    }
+
+    void EncoderOutputCache::set_max_size(size_t max_size_in_bytes) {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      _outputs->set_max_size(max_size_in_bytes);
+    }
+
+    size_t EncoderOutputCache::max_size() const {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      return _outputs->max_size();
+    }
+
+    EncoderOutputCache::Stats EncoderOutputCache::get_stats() const {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      const auto& lru_stats = _outputs->stats();
+      Stats stats;
+      stats.num_lookups = lru_stats.num_lookups;
+      stats.num_hits = lru_stats.num_hits;
+      stats.num_evictions = lru_stats.num_evictions;
+      stats.num_entries = lru_stats.num_entries;
+      stats.size_in_bytes = lru_stats.size;
+      return stats;
+    }
+
+    void EncoderOutputCache::clear() {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      _outputs->clear();
+    }
+
+
+    static std::shared_ptr<EncoderOutputCache> make_encoder_cache() {
+      const size_t max_size_mb = read_int_from_env("CT2_ENCODER_OUTPUT_CACHE_SIZE_MB", 256);
+      return std::make_shared<EncoderOutputCache>(max_size_mb << 20);
+    }
+
+    SequenceToSequenceModel::SequenceToSequenceModel()
+      : _encoder_cache(make_encoder_cache())
+    {
+    }
+
+    // The cached outputs are on the model device so a copy should not share the cache.
+    SequenceToSequenceModel::SequenceToSequenceModel(const SequenceToSequenceModel& other)
+      : Model(other)
+      , _source_vocabularies(other._source_vocabularies)
+      , _target_vocabulary(other._target_vocabulary)
+      , _vocabulary_map(other._vocabulary_map)
+      , _encoder_cache(make_encoder_cache())
+    {
+    }
+
+
     void SequenceToSequenceModel::load_vocabularies(ModelReader& model_reader) {
       {
         VocabularyInfo vocab_info;
@@ -92,6 +183,10 @@ namespace ctranslate2 {
       return _vocabulary_map.get();
     }
 
+    EncoderOutputCache& SequenceToSequenceModel::get_encoder_cache() const {
+      return *_encoder_cache;
+    }
+
 
     std::vector<ScoringResult>
     SequenceToSequenceReplica::score(const std::vector<std::vector<std::string>>& source,
@@ -232,6 +327,138 @@ namespace ctranslate2 {
       (*_encoder)(ids, memory_lengths, memory);
     }
 
+    void
+    EncoderDecoderReplica::encode_with_cache(const std::vector<std::vector<std::vector<size_t>>>& features_ids,
+                                             StorageView& memory,
+                                             StorageView& memory_lengths) {
+      PROFILE("EncoderDecoderReplica::encode_with_cache");
+      auto& cache = _model->get_encoder_cache();
+      const size_t num_input_features = features_ids.size();
+      const size_t batch_size = features_ids[0].size();
+      const Device device = _model->device();
+
+      std::vector<std::shared_ptr<const StorageView>> outputs(batch_size);
+      std::vector<size_t> index_to_encode;
+      std::vector<EncoderOutputCache::Key> keys(batch_size);
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        keys[i].reserve(num_input_features);
+        for (size_t f = 0; f < num_input_features; ++f)
+          keys[i].emplace_back(features_ids[f][i]);
+
+        outputs[i] = cache.get(keys[i]);
+        if (!outputs[i])
+          index_to_encode.emplace_back(i);
+      }
+
+      if (!index_to_encode.empty()) {
+        std::vector<std::vector<std::vector<size_t>>> ids_to_encode;
+        ids_to_encode.reserve(num_input_features);
+        for (const auto& ids : features_ids)
+          ids_to_encode.emplace_back(index_vector(ids, index_to_encode));
+
+        StorageView new_memory(_encoder->output_type(), device);
+        StorageView new_memory_lengths(DataType::INT32, device);
+        encode(ids_to_encode, new_memory, new_memory_lengths);
+
+        for (size_t j = 0; j < index_to_encode.size(); ++j) {
+          const size_t i = index_to_encode[j];
+          const dim_t length = ids_to_encode[0][j].size();
+
+          StorageView row(new_memory.dtype(), device);
+          StorageView output(new_memory.dtype(), device);
+          ops::Slide(0, j, 1)(new_memory, row);
+          ops::Slide(1, 0, length)(row, output);
+
+          cache.save(keys[i], output);
+          outputs[i] = std::make_shared<const StorageView>(std::move(output));
+        }
+
+        // Nothing to assemble when no output was found in the cache.
+        if (index_to_encode.size() == batch_size) {
+          memory = std::move(new_memory);
+          memory_lengths = std::move(new_memory_lengths);
+          return;
+        }
+      }
+
+      // Assemble the batch by padding each output to the maximum length.
+      dim_t max_length = 0;
+      for (const auto& output : outputs)
+        max_length = std::max(max_length, output->dim(1));
+
+      const dim_t depth = outputs[0]->dim(2);
+      std::vector<StorageView> padded_outputs;
+      padded_outputs.reserve(batch_size);
+      StorageView lengths({dim_t(batch_size)}, DataType::INT32);
+
+      for (size_t i = 0; i < batch_size; ++i) {
+        const StorageView& output = *outputs[i];
+        const dim_t length = output.dim(1);
+        lengths.at<int32_t>(i) = length;
+
+        if (length == max_length) {
+          padded_outputs.emplace_back(output);
+        } else {
+          StorageView padding({1, max_length - length, depth}, output.dtype(), device);
+          padding.zero();
+          padded_outputs.emplace_back(output.dtype(), device);
+          ops::Concat(1)({&output, &padding}, padded_outputs.back());
+        }
+      }
+
+      std::vector<const StorageView*> padded_outputs_ptr;
+      padded_outputs_ptr.reserve(batch_size);
+      for (const auto& output : padded_outputs)
+        padded_outputs_ptr.emplace_back(&output);
+
+      ops::Concat(0)(padded_outputs_ptr, memory);
+      memory_lengths = lengths.to(device);
+    }
+
+    EncoderDecoderReplica&
+    EncoderDecoderReplica::get_draft_replica(const std::shared_ptr<const Model>& draft_model) {
+      if (_draft_replica && _draft_replica->_model == draft_model)
+        return *_draft_replica;
+
+      if (draft_model->device() != _model->device()
+          || draft_model->device_index() != _model->device_index())
+        throw std::invalid_argument("The draft model should be loaded on the same device "
+                                    "as the model");
+
+      auto replica = draft_model->as_sequence_to_sequence();
+      auto* draft_replica = dynamic_cast<EncoderDecoderReplica*>(replica.get());
+      if (!draft_replica)
+        throw std::invalid_argument("The draft model should be an encoder-decoder model");
+      if (draft_replica->_model->get_target_vocabulary().size()
+          != _model->get_target_vocabulary().size())
+        throw std::invalid_argument("The draft model should use the same target vocabulary "
+                                    "as the model");
+
+      replica.release();
+      _draft_replica.reset(draft_replica);
+      return *_draft_replica;
+    }
+
+    std::shared_ptr<Drafter>
+    EncoderDecoderReplica::make_drafter(const std::vector<std::vector<std::string>>& source,
+                                        size_t max_input_length) {
+      const auto device = _model->device();
+      const auto source_features = extract_features(source, _encoder->num_input_features());
+      const auto source_ids = make_source_ids(source_features, max_input_length);
+
+      StorageView memory(_encoder->output_type(), device);
+      StorageView memory_lengths(DataType::INT32, device);
+      encode(source_ids, memory, memory_lengths);
+
+      layers::DecoderState state = _decoder->initial_state();
+      state.emplace("memory", std::move(memory));
+      state.emplace("memory_lengths", std::move(memory_lengths));
+
+      _decoder->update_output_layer(_model->preferred_size_multiple());
+      return std::make_shared<DecoderDrafter>(*_decoder, std::move(state));
+    }
+
     std::vector<ScoringResult>
     EncoderDecoderReplica::run_scoring(const std::vector<std::vector<std::string>>& source,
                                        const std::vector<std::vector<std::string>>& target,
@@ -320,7 +547,10 @@ namespace ctranslate2 {
       // Encode the sequence.
       StorageView memory(_encoder->output_type(), device);
       StorageView memory_lengths(DataType::INT32, device);
-      encode(source_ids, memory, memory_lengths);
+      if (options.cache_encoder_output)
+        encode_with_cache(source_ids, memory, memory_lengths);
+      else
+        encode(source_ids, memory, memory_lengths);
 
       layers::DecoderState state = _decoder->initial_state();
       state.emplace("memory", std::move(memory));
@@ -336,6 +566,8 @@ namespace ctranslate2 {
       DecodingOptions decoding_options;
       decoding_options.beam_size = options.beam_size;
       decoding_options.patience = options.patience;
+      decoding_options.num_beam_groups = options.num_beam_groups;
+      decoding_options.diversity_penalty = options.diversity_penalty;
       decoding_options.length_penalty = options.length_penalty;
       decoding_options.coverage_penalty = options.coverage_penalty;
       decoding_options.repetition_penalty = options.repetition_penalty;
@@ -365,6 +597,40 @@ namespace ctranslate2 {
           return options.callback(GenerationStepResult(step_result, target_vocabulary));
         };
 
+      if (options.draft_model && options.prompt_lookup_ngram_size > 0)
+        throw std::invalid_argument("The options draft_model and prompt_lookup_ngram_size "
+                                    "cannot be used together");
+
+      // The vocabulary map restricts the output layer so the draft tokens could not be verified.
+      const bool speculative_decoding = (options.beam_size == 1
+                                         && !options.return_alternatives
+                                         && restrict_ids.empty());
+
+      if (options.draft_model && speculative_decoding) {
+        decoding_options.drafter = get_draft_replica(options.draft_model).make_drafter(
+          source, options.max_input_length);
+        decoding_options.num_speculative_tokens = options.num_speculative_tokens;
+
+      } else if (options.prompt_lookup_ngram_size > 0 && speculative_decoding) {
+        // The source tokens that are also target tokens can be copied to the output.
+        std::vector<std::vector<size_t>> contexts;
+        contexts.reserve(batch_size);
+        for (const auto& tokens : source_features[0]) {
+          std::vector<size_t> context;
+          context.reserve(tokens.size());
+          for (const auto& token : tokens) {
+            const size_t id = target_vocabulary.to_id(token);
+            if (id != target_vocabulary.unk_id())
+              context.push_back(id);
+          }
+          contexts.emplace_back(std::move(context));
+        }
+
+        decoding_options.drafter = std::make_shared<PromptLookupDrafter>(
+          options.prompt_lookup_ngram_size, std::move(contexts));
+        decoding_options.num_speculative_tokens = options.num_speculative_tokens;
+      }
+
       const auto end_ids(std::visit(ResolveEndToken(target_vocabulary), options.end_token));
       std::vector<DecodingResult> results = decode(*_decoder,
                                                    state,
@@ -426,6 +692,8 @@ namespace ctranslate2 {
                                    std::move(result.scores),
                                    std::move(result.attention),
                                    std::move(result.logits_vocab));
+        final_results.back().num_draft_tokens = result.num_draft_tokens;
+        final_results.back().num_accepted_draft_tokens = result.num_accepted_draft_tokens;
       }
 
       return final_results;
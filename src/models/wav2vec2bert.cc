@@ -3,6 +3,7 @@
 #include <algorithm>
 
 #include "ctranslate2/decoding.h"
+#include "ctranslate2/ops/softmax.h"
 
 #include "dispatch.h"
 #include "dtw.h"
@@ -93,6 +94,27 @@ namespace ctranslate2 {
       return encoder_output;
     }
 
+    std::vector<CTCDecodingResult>
+    Wav2Vec2BertReplica::decode_ctc(StorageView features, const CTCDecodingOptions& options) {
+      PROFILE("Wav2Vec2BertReplica::decode_ctc");
+
+#ifdef CT2_WITH_CUDA
+      const cuda::UseTrueFp16GemmInScope use_true_fp16_gemm(false);
+#endif
+
+      const auto scoped_device_setter = _model->get_scoped_device_setter();
+      StorageView log_probs = maybe_encode(std::move(features));
+      ops::LogSoftMax()(log_probs);
+
+      // The search runs on the CPU.
+      if (log_probs.device() != Device::CPU)
+        log_probs = log_probs.to(Device::CPU);
+      if (log_probs.dtype() != DataType::FLOAT32)
+        log_probs = log_probs.to_float32();
+
+      return ctc_decode(log_probs, options, &_model->get_vocabulary());
+    }
+
     StorageView Wav2Vec2BertReplica::maybe_encode(StorageView features) {
       const Device device = _model->device();
       const DataType dtype = _encoder->output_type();
@@ -114,5 +136,13 @@ namespace ctranslate2 {
         });
     }
 
+    std::future<std::vector<CTCDecodingResult>>
+    Wav2Vec2Bert::decode_ctc(const StorageView& features, const CTCDecodingOptions& options) {
+      return post<std::vector<CTCDecodingResult>>(
+        [features = features.sync_copy(), options](Wav2Vec2BertReplica& replica) mutable {
+          return replica.decode_ctc(std::move(features), options);
+        });
+    }
+
   }
 }
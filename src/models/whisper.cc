@@ -1,6 +1,7 @@
 #include "ctranslate2/models/whisper.h"
 
 #include <algorithm>
+#include <map>
 
 #include "ctranslate2/decoding.h"
 
@@ -61,6 +62,7 @@ namespace ctranslate2 {
       , _model(model)
       , _encoder(std::make_unique<layers::WhisperEncoder>(*model, "encoder"))
       , _decoder(std::make_unique<layers::WhisperDecoder>(*model, "decoder"))
+      , _mel_spectrogram(_encoder->input_size())
     {
       const auto& vocabulary = model->get_vocabulary();
       _sot_id = vocabulary.bos_id();
@@ -74,7 +76,10 @@ namespace ctranslate2 {
       _num_languages = vocabulary.size() - 51765 - (_is_multilingual ? 1 : 0);
     }
 
-    StorageView WhisperReplica::encode(StorageView features, const bool to_cpu) {
+    StorageView WhisperReplica::encode(StorageView features,
+                                       const bool to_cpu,
+                                       const std::vector<size_t>& num_frames,
+                                       size_t min_frames) {
       PROFILE("WhisperReplica::encode");
 
 #ifdef CT2_WITH_CUDA
@@ -85,6 +90,7 @@ namespace ctranslate2 {
       const Device device = _model->device();
       const DataType dtype = _encoder->output_type();
       features.move_to(device, dtype);
+      trim_features(features, num_frames, min_frames);
 
       StorageView encoder_output(dtype, device);
       (*_encoder)(features, encoder_output);
@@ -115,6 +121,95 @@ namespace ctranslate2 {
       return encoder_output;
     }
 
+    void WhisperReplica::trim_features(StorageView& features,
+                                       const std::vector<size_t>& num_frames,
+                                       size_t min_frames) const {
+      if (num_frames.empty() || _encoder->is_encoded(features))
+        return;
+      if (num_frames.size() != size_t(features.dim(0)))
+        throw std::invalid_argument("Invalid batch size for argument num_frames");
+
+      // The length is rounded to a multiple of 1 second to limit the number of different
+      // shapes, which are cached by the memory allocators.
+      constexpr dim_t length_multiple = 100;
+
+      const dim_t max_frames = features.dim(2);
+      const dim_t batch_frames = *std::max_element(num_frames.begin(), num_frames.end());
+      dim_t length = ceil_divide(batch_frames, length_multiple) * length_multiple;
+      length = std::min(std::max(length, dim_t(min_frames)), max_frames);
+
+      if (length < max_frames) {
+        StorageView trimmed_features(features.dtype(), features.device());
+        ops::Slide(2, 0, length)(features, trimmed_features);
+        features = std::move(trimmed_features);
+      }
+    }
+
+    StorageView WhisperReplica::compute_features(StorageView audio) const {
+      PROFILE("WhisperReplica::compute_features");
+
+      // The features are computed on CPU from the audio padded to the 30-second window.
+      constexpr dim_t window_samples = 480000;
+
+      if (audio.rank() != 2)
+        throw std::invalid_argument("Expected audio samples with shape [batch_size, num_samples], "
+                                    "but got a tensor of rank " + std::to_string(audio.rank()));
+
+      const dim_t batch_size = audio.dim(0);
+      const dim_t num_samples = audio.dim(1);
+      if (num_samples > window_samples)
+        throw std::invalid_argument("The audio should contain at most "
+                                    + std::to_string(window_samples)
+                                    + " samples (30 seconds), but got "
+                                    + std::to_string(num_samples) + " samples");
+
+      audio.move_to(Device::CPU, DataType::FLOAT32);
+
+      StorageView padded_audio({batch_size, window_samples}, 0.f);
+      for (dim_t b = 0; b < batch_size && num_samples > 0; ++b) {
+        const float* samples = audio.index<float>({b, 0});
+        std::copy(samples, samples + num_samples, padded_audio.index<float>({b, 0}));
+      }
+
+      StorageView features;
+      _mel_spectrogram(padded_audio, features);
+      return features;
+    }
+
+    std::vector<WhisperGenerationResult>
+    WhisperReplica::generate_from_audio(StorageView audio,
+                                        const std::vector<std::vector<std::string>>& prompts,
+                                        const WhisperOptions& options) {
+      const auto& vocabulary = _model->get_vocabulary();
+      return generate_from_audio(std::move(audio), vocabulary.to_ids(prompts), options);
+    }
+
+    std::vector<WhisperGenerationResult>
+    WhisperReplica::generate_from_audio(StorageView audio,
+                                        const std::vector<std::vector<size_t>>& prompts,
+                                        const WhisperOptions& options) {
+      PROFILE("WhisperReplica::generate_from_audio");
+
+      // The audio length is the default number of non padding frames.
+      WhisperOptions audio_options = options;
+      if (audio_options.num_frames.empty() && audio.rank() == 2)
+        audio_options.num_frames.resize(audio.dim(0), audio.dim(1) / _mel_spectrogram.hop_length());
+
+      return generate(compute_features(std::move(audio)), prompts, audio_options);
+    }
+
+    void WhisperReplica::set_alignment_heads() {
+      const auto alignment_heads = _model->config.find("alignment_heads");
+      if (alignment_heads == _model->config.end())
+        throw std::runtime_error("The model configuration does not contain the field "
+                                 "'alignment_heads' which lists the cross-attention heads "
+                                 "that are highly correlated to the word-level timing. "
+                                 "Please reconvert this model with the current version "
+                                 "of ctranslate2.");
+
+      _decoder->set_alignment_heads(alignment_heads->get<std::vector<std::pair<dim_t, dim_t>>>());
+    }
+
     std::vector<WhisperGenerationResult>
     WhisperReplica::generate(StorageView features,
                              const std::vector<std::vector<std::string>>& prompts,
@@ -226,12 +321,85 @@ namespace ctranslate2 {
       }
     };
 
+    static void remove_padding(StorageView& x, dim_t axis, dim_t size) {
+      const dim_t max_size = x.dim(axis);
+
+      if (size < max_size) {
+        StorageView content(x.dtype(), x.device());
+        StorageView padding(x.dtype(), x.device());
+
+        const ops::Split split_op(axis, {size, max_size - size});
+        split_op(x, content, padding);
+
+        x = std::move(content);
+      }
+    }
+
+    // Returns the weights with shape [batch_size, num_tokens, num_frames] from the attention
+    // probabilities with shape [batch_size, num_heads, num_tokens, num_frames].
+    static StorageView compute_alignment_weights(StorageView& attention_probs,
+                                                 const dim_t median_filter_width) {
+      const ops::MedianFilter median_filter_op(median_filter_width);
+
+      // The remaining operations are not implemented on GPU, so move back to CPU.
+      attention_probs.move_to(Device::CPU, DataType::FLOAT32);
+
+      ops::LayerNorm(-2, 0)(attention_probs);
+
+      StorageView median_filter;
+      median_filter_op(attention_probs, median_filter);
+
+      StorageView weights;
+      ops::Mean(1)(median_filter, weights);
+      return weights;
+    }
+
+    // Returns a view on the rows [offset, offset + length) of the batch b in the weights.
+    static StorageView get_alignment_matrix(StorageView& weights,
+                                            const dim_t b,
+                                            const dim_t offset,
+                                            const dim_t length) {
+      StorageView matrix(Shape{length, weights.dim(2)});
+      if (weights)
+        matrix.view(weights.index<float>({b, offset, 0}), matrix.shape());
+      return matrix;
+    }
+
+    // Same as above from the attention of the alignment heads recorded during decoding,
+    // which contains one vector [num_heads * memory_time] per token.
+    static StorageView
+    compute_alignment_weights(const std::vector<std::vector<float>>& steps_attention,
+                              const dim_t memory_time,
+                              const dim_t num_frames,
+                              const dim_t median_filter_width) {
+      const dim_t num_tokens = steps_attention.size();
+      if (num_tokens == 0)
+        return StorageView(Shape{1, 0, num_frames});
+
+      const dim_t num_heads = steps_attention[0].size() / memory_time;
+
+      StorageView attention({num_tokens, num_heads, memory_time}, DataType::FLOAT32);
+      for (dim_t t = 0; t < num_tokens; ++t)
+        std::copy(steps_attention[t].begin(),
+                  steps_attention[t].end(),
+                  attention.index<float>({t, 0, 0}));
+
+      StorageView attention_probs;
+      ops::Transpose({1, 0, 2})(attention, attention_probs);
+      attention_probs.expand_dims(0);
+
+      remove_padding(attention_probs, 3, num_frames);
+      ops::SoftMax()(attention_probs);
+
+      return compute_alignment_weights(attention_probs, median_filter_width);
+    }
+
     std::vector<WhisperGenerationResult>
     WhisperReplica::generate(StorageView features,
-                             const std::vector<std::vector<size_t>>& prompts,
+                             const std::vector<std::vector<size_t>>& input_prompts,
                              const WhisperOptions& options) {
       PROFILE("WhisperReplica::generate");
-      if (prompts.empty())
+      if (input_prompts.empty())
         return {};
 
 #ifdef CT2_WITH_CUDA
@@ -240,16 +408,45 @@ namespace ctranslate2 {
 
       size_t sot_index = 0;
       size_t prompt_length = 0;  // Length of the prompt before the text tokens.
-      check_prompts(prompts, _sot_id, _no_timestamps_id, sot_index, prompt_length);
+      check_prompts(input_prompts, _sot_id, _no_timestamps_id, sot_index, prompt_length);
+
+      if (options.return_alignments) {
+        if (!options.num_frames.empty() && options.num_frames.size() != input_prompts.size())
+          throw std::invalid_argument("Invalid batch size for argument num_frames");
+        set_alignment_heads();
+      }
 
       const auto& vocabulary = _model->get_vocabulary();
       const auto scoped_device_setter = _model->get_scoped_device_setter();
+      const Device device = _decoder->device();
+      const DataType dtype = _decoder->output_type();
+
+      if (options.dynamic_encoder_length)
+        trim_features(features, options.num_frames, options.min_encoder_frames);
 
       layers::DecoderState state = _decoder->initial_state();
       state.emplace("memory", maybe_encode(std::move(features)));
+      const dim_t memory_time = state.at("memory").dim(1);
 
       _decoder->update_output_layer(_model->preferred_size_multiple());
 
+      // The language token of each prompt is predicted from the same encoder output and,
+      // when the prompts start with <|startoftranscript|>, from the same decoder state.
+      std::vector<std::vector<size_t>> language_prompts;
+      std::vector<std::pair<size_t, float>> languages;
+      StorageView sot_logits(dtype, device);
+      dim_t num_forwarded_tokens = 0;
+
+      if (options.detect_language) {
+        num_forwarded_tokens = detect_prompts_language(input_prompts,
+                                                       state,
+                                                       language_prompts,
+                                                       languages,
+                                                       sot_logits);
+        check_prompts(language_prompts, _sot_id, _no_timestamps_id, sot_index, prompt_length);
+      }
+
+      const auto& prompts = options.detect_language ? language_prompts : input_prompts;
       const bool sot_is_start_token = (sot_index == prompt_length - 1);
       std::vector<std::vector<size_t>> start_tokens;
       std::vector<float> no_speech_probs;
@@ -263,29 +460,36 @@ namespace ctranslate2 {
         prompt_tokens.reserve(prompts.size());
         start_tokens.reserve(prompts.size());
         for (const auto& prompt : prompts) {
-          prompt_tokens.emplace_back(prompt.begin(), prompt.begin() + prompt_length - 1);
+          prompt_tokens.emplace_back(prompt.begin() + num_forwarded_tokens,
+                                     prompt.begin() + prompt_length - 1);
           start_tokens.emplace_back(prompt.begin() + prompt_length - 1, prompt.end());
         }
 
-        const Device device = _decoder->device();
-        const DataType dtype = _decoder->output_type();
-        const StorageView inputs = layers::make_sequence_inputs(prompt_tokens, device);
+        const bool sot_is_forwarded = (num_forwarded_tokens > dim_t(sot_index));
 
-        // Initialize the decoder state with the prompt.
-        if (!options.return_no_speech_prob || sot_is_start_token)
-          _decoder->forward_prompt(inputs, state);
-        else {
-          StorageView outputs(dtype, device);
-          _decoder->forward_prompt(inputs, state, &outputs);
-
-          // Get the probability of the no speech token at the start of transcript step.
-          StorageView sot_index_batch({inputs.dim(0)}, int32_t(sot_index), device);
-          StorageView logits(dtype, device);
-          _decoder->compute_logits_for_steps(outputs, sot_index_batch, logits);
-          no_speech_probs = get_no_speech_probs_from_logits(logits, _no_speech_id);
+        if (options.return_no_speech_prob && sot_is_forwarded) {
+          no_speech_probs = get_no_speech_probs_from_logits(sot_logits, _no_speech_id);
         }
 
-        start_step = inputs.dim(1);
+        if (!prompt_tokens[0].empty()) {
+          const StorageView inputs = layers::make_sequence_inputs(prompt_tokens, device);
+
+          // Initialize the decoder state with the prompt.
+          if (!options.return_no_speech_prob || sot_is_start_token || sot_is_forwarded)
+            _decoder->forward_prompt(inputs, state, nullptr, num_forwarded_tokens);
+          else {
+            StorageView outputs(dtype, device);
+            _decoder->forward_prompt(inputs, state, &outputs, num_forwarded_tokens);
+
+            // Get the probability of the no speech token at the start of transcript step.
+            StorageView sot_index_batch({inputs.dim(0)}, int32_t(sot_index), device);
+            StorageView logits(dtype, device);
+            _decoder->compute_logits_for_steps(outputs, sot_index_batch, logits);
+            no_speech_probs = get_no_speech_probs_from_logits(logits, _no_speech_id);
+          }
+        }
+
+        start_step = prompt_length - 1;
       }
 
       const dim_t total_max_length = options.max_length;
@@ -304,6 +508,9 @@ namespace ctranslate2 {
       decoding_options.return_scores = options.return_scores;
       decoding_options.return_logits_vocab = options.return_logits_vocab;
       decoding_options.include_eos_in_hypotheses = false;
+      decoding_options.return_attention = options.return_alignments;
+      // The attention at the end of text step is also aligned.
+      decoding_options.include_eos_in_attention = options.return_alignments;
 
       for (const auto& id : options.suppress_tokens) {
         if (id >= 0)
@@ -350,6 +557,32 @@ namespace ctranslate2 {
       std::vector<WhisperGenerationResult> final_results;
       final_results.reserve(results.size());
 
+      std::vector<StorageView> alignment_weights;
+      std::vector<StorageView> alignment_matrices;
+
+      if (options.return_alignments) {
+        for (size_t i = 0; i < results.size(); ++i) {
+          const dim_t num_frames = (options.num_frames.empty()
+                                    ? memory_time
+                                    : std::min(dim_t(options.num_frames[i] / 2), memory_time));
+
+          for (const auto& attention : results[i].attention) {
+            alignment_weights.emplace_back(compute_alignment_weights(attention,
+                                                                     memory_time,
+                                                                     num_frames,
+                                                                     options.median_filter_width));
+          }
+        }
+
+        alignment_matrices.reserve(alignment_weights.size());
+        for (auto& weights : alignment_weights)
+          alignment_matrices.emplace_back(get_alignment_matrix(weights, 0, 0, weights.dim(1)));
+      }
+
+      // The DTW of all sequences in the batch runs in parallel.
+      std::vector<std::vector<std::pair<dim_t, dim_t>>> alignments = negative_dtw(alignment_matrices);
+      auto alignments_it = alignments.begin();
+
       for (size_t i = 0; i < results.size(); ++i) {
         auto& result = results[i];
 
@@ -360,6 +593,16 @@ namespace ctranslate2 {
         final_result.logits = std::move(result.logits_vocab);
         if (options.return_no_speech_prob)
           final_result.no_speech_prob = no_speech_probs[i];
+        if (options.detect_language) {
+          final_result.language = vocabulary.to_token(languages[i].first);
+          final_result.language_prob = languages[i].second;
+        }
+        if (options.return_alignments) {
+          final_result.alignments.assign(
+            std::make_move_iterator(alignments_it),
+            std::make_move_iterator(alignments_it + result.attention.size()));
+          alignments_it += result.attention.size();
+        }
 
         final_results.emplace_back(std::move(final_result));
       }
@@ -367,56 +610,6 @@ namespace ctranslate2 {
       return final_results;
     }
 
-    static void remove_padding(StorageView& x, dim_t axis, dim_t size) {
-      const dim_t max_size = x.dim(axis);
-
-      if (size < max_size) {
-        StorageView content(x.dtype(), x.device());
-        StorageView padding(x.dtype(), x.device());
-
-        const ops::Split split_op(axis, {size, max_size - size});
-        split_op(x, content, padding);
-
-        x = std::move(content);
-      }
-    }
-
-    static std::vector<std::vector<std::pair<dim_t, dim_t>>>
-    compute_alignments(StorageView& attention_probs,
-                       const std::vector<size_t>& start_sequence,
-                       const std::vector<std::vector<size_t>>& text_tokens,
-                       const dim_t median_filter_width) {
-      const ops::MedianFilter median_filter_op(median_filter_width);
-      const dim_t batch_size = attention_probs.dim(0);
-
-      // The remaining operations are not implemented on GPU, so move back to CPU.
-      attention_probs.move_to(Device::CPU, DataType::FLOAT32);
-
-      ops::LayerNorm(-2, 0)(attention_probs);
-
-      StorageView median_filter;
-      median_filter_op(attention_probs, median_filter);
-
-      StorageView weights;
-      ops::Mean(1)(median_filter, weights);
-
-      std::vector<std::vector<std::pair<dim_t, dim_t>>> alignments;
-      alignments.reserve(batch_size);
-
-      for (dim_t b = 0; b < batch_size; ++b) {
-        const dim_t text_length = text_tokens[b].size();
-        const dim_t sot_length = start_sequence.size();
-
-        StorageView matrix(Shape{text_length + 1, weights.dim(2)});
-        if (weights)
-          matrix.view(weights.index<float>({b, sot_length, 0}), matrix.shape());
-
-        alignments.emplace_back(negative_dtw(matrix));
-      }
-
-      return alignments;
-    }
-
     std::vector<WhisperAlignmentResult>
     WhisperReplica::align(StorageView features,
                           const std::vector<size_t>& start_sequence,
@@ -433,15 +626,7 @@ namespace ctranslate2 {
       if (num_frames.size() != size_t(batch_size))
         throw std::invalid_argument("Invalid batch size for argument num_frames");
 
-      const auto alignment_heads = _model->config.find("alignment_heads");
-      if (alignment_heads == _model->config.end())
-        throw std::runtime_error("The model configuration does not contain the field "
-                                 "'alignment_heads' which lists the cross-attention heads "
-                                 "that are highly correlated to the word-level timing. "
-                                 "Please reconvert this model with the current version "
-                                 "of ctranslate2.");
-
-      _decoder->set_alignment_heads(alignment_heads->get<std::vector<std::pair<dim_t, dim_t>>>());
+      set_alignment_heads();
 
       std::vector<std::vector<size_t>> input_tokens;
       std::vector<std::vector<size_t>> output_tokens;
@@ -504,7 +689,11 @@ namespace ctranslate2 {
           variable_num_frames = true;
       }
 
-      std::vector<std::vector<std::pair<dim_t, dim_t>>> alignments;
+      const dim_t sot_length = start_sequence.size();
+      std::vector<StorageView> weights;
+      std::vector<StorageView> matrices;
+      weights.reserve(batch_size);
+      matrices.reserve(batch_size);
 
       if (variable_num_frames) {
         const StorageView frame_sizes({batch_size},
@@ -517,8 +706,6 @@ namespace ctranslate2 {
 
         ops::SoftMax()(attention_weights, frame_sizes_mask, attention_weights);
 
-        alignments.reserve(batch_size);
-
         for (dim_t b = 0; b < batch_size; ++b) {
           // Retrieve attention probs for batch and remove padding.
           StorageView batch_id({1}, int32_t(b), device);
@@ -528,22 +715,27 @@ namespace ctranslate2 {
           remove_padding(attention_probs, 3, num_frames[b]);
           remove_padding(attention_probs, 2, input_tokens[b].size());
 
-          alignments.emplace_back(compute_alignments(attention_probs,
-                                                     start_sequence,
-                                                     {text_tokens[b]},
-                                                     median_filter_width)[0]);
+          weights.emplace_back(compute_alignment_weights(attention_probs, median_filter_width));
+          matrices.emplace_back(get_alignment_matrix(weights.back(),
+                                                     0,
+                                                     sot_length,
+                                                     text_tokens[b].size() + 1));
         }
 
       } else {
         remove_padding(attention_weights, 3, num_frames[0]);
         ops::SoftMax()(attention_weights);
 
-        alignments = compute_alignments(attention_weights,
-                                        start_sequence,
-                                        text_tokens,
-                                        median_filter_width);
+        weights.emplace_back(compute_alignment_weights(attention_weights, median_filter_width));
+        for (dim_t b = 0; b < batch_size; ++b)
+          matrices.emplace_back(get_alignment_matrix(weights.back(),
+                                                     b,
+                                                     sot_length,
+                                                     text_tokens[b].size() + 1));
       }
 
+      std::vector<std::vector<std::pair<dim_t, dim_t>>> alignments = negative_dtw(matrices);
+
       token_probs.move_to(Device::CPU, DataType::FLOAT32);
 
       std::vector<WhisperAlignmentResult> results;
@@ -553,7 +745,7 @@ namespace ctranslate2 {
         WhisperAlignmentResult result;
 
         const dim_t length = text_tokens[b].size();
-        const dim_t offset = start_sequence.size();
+        const dim_t offset = sot_length;
 
         result.alignments = std::move(alignments[b]);
 
@@ -566,6 +758,112 @@ namespace ctranslate2 {
       return results;
     }
 
+    std::vector<int32_t> WhisperReplica::get_language_ids() const {
+      std::vector<int32_t> lang_ids;
+      for (const auto& id : _model->config["lang_ids"])
+        lang_ids.push_back(id);
+      return lang_ids;
+    }
+
+    // Returns the probability of each language on CPU with shape [batch_size, num_languages].
+    static StorageView get_language_probs(const StorageView& logits,
+                                          const std::vector<int32_t>& lang_ids) {
+      const Device device = logits.device();
+      const dim_t batch_size = logits.dim(0);
+      const dim_t num_langs = lang_ids.size();
+
+      StorageView score_ids({batch_size, num_langs}, DataType::INT32);
+      for (dim_t i = 0; i < batch_size; ++i) {
+        for (dim_t j = 0; j < num_langs; ++j)
+          score_ids.at<int32_t>({i, j}) = lang_ids[j];
+      }
+      if (score_ids.device() != device)
+        score_ids = score_ids.to(device);
+
+      StorageView lang_probs(logits.dtype(), device);
+      ops::Gather(/*axis=*/-1, /*batch_dims=*/1)(logits, score_ids, lang_probs);
+      ops::SoftMax()(lang_probs);
+
+      if (lang_probs.dtype() != DataType::FLOAT32)
+        lang_probs = lang_probs.to_float32();
+      if (lang_probs.device() != Device::CPU)
+        lang_probs = lang_probs.to(Device::CPU);
+      return lang_probs;
+    }
+
+    dim_t WhisperReplica::detect_prompts_language(
+      const std::vector<std::vector<size_t>>& prompts,
+      layers::DecoderState& state,
+      std::vector<std::vector<size_t>>& language_prompts,
+      std::vector<std::pair<size_t, float>>& languages,
+      StorageView& sot_logits) {
+      if (!is_multilingual())
+        throw std::runtime_error("detect_language can only be enabled with multilingual models");
+
+      PROFILE("WhisperReplica::detect_prompts_language");
+      const Device device = _decoder->device();
+      const DataType dtype = _decoder->output_type();
+      const dim_t batch_size = prompts.size();
+
+      // When the prompts start with <|startoftranscript|>, this step is the first step of the
+      // prompt and the decoder state is reused to generate. Otherwise the previous text is
+      // ignored and the language is detected with a separate state.
+      const bool share_state = std::all_of(prompts.begin(), prompts.end(),
+                                           [this](const std::vector<size_t>& prompt) {
+                                             return prompt.front() == _sot_id;
+                                           });
+
+      const StorageView sot_ids({batch_size, 1}, int32_t(_sot_id), device);
+      StorageView outputs(dtype, device);
+
+      if (share_state) {
+        _decoder->forward_prompt(sot_ids, state, &outputs);
+      } else {
+        layers::DecoderState detection_state = _decoder->initial_state();
+        StorageView memory(dtype, device);
+        memory.shallow_copy(state.at("memory"));
+        detection_state.emplace("memory", std::move(memory));
+        _decoder->forward_prompt(sot_ids, detection_state, &outputs);
+      }
+
+      const StorageView steps({batch_size}, int32_t(0), device);
+      _decoder->compute_logits_for_steps(outputs, steps, sot_logits);
+
+      const std::vector<int32_t> lang_ids = get_language_ids();
+      const StorageView lang_probs = get_language_probs(sot_logits, lang_ids);
+      const dim_t num_langs = lang_ids.size();
+
+      language_prompts.clear();
+      languages.clear();
+      language_prompts.reserve(batch_size);
+      languages.reserve(batch_size);
+
+      for (dim_t i = 0; i < batch_size; ++i) {
+        const float* probs = lang_probs.index<float>({i, 0});
+        std::vector<size_t> prompt = prompts[i];
+        const size_t sot_index = get_sot_index(prompt, _sot_id);
+
+        // Keep the language token that is already set in the prompt.
+        dim_t lang_index = std::max_element(probs, probs + num_langs) - probs;
+        bool has_language = false;
+        if (sot_index + 1 < prompt.size()) {
+          const auto it = std::find(lang_ids.begin(), lang_ids.end(), prompt[sot_index + 1]);
+          if (it != lang_ids.end()) {
+            lang_index = std::distance(lang_ids.begin(), it);
+            has_language = true;
+          }
+        }
+
+        if (!has_language)
+          prompt.insert(prompt.begin() + sot_index + 1, lang_ids[lang_index]);
+
+        languages.emplace_back(lang_ids[lang_index], probs[lang_index]);
+        language_prompts.emplace_back(std::move(prompt));
+      }
+
+      return share_state ? 1 : 0;
+    }
+
     std::vector<std::vector<std::pair<std::string, float>>>
     WhisperReplica::detect_language(StorageView features) {
       if (!is_multilingual())
@@ -582,35 +880,19 @@ namespace ctranslate2 {
       const auto device = _model->device();
 
       const int32_t sot = vocabulary.bos_id();
-      std::vector<int32_t> lang_ids;
-      for (const auto& id : _model->config["lang_ids"])
-        lang_ids.push_back(id);
+      const std::vector<int32_t> lang_ids = get_language_ids();
 
       const dim_t batch_size = features.dim(0);
       const dim_t num_langs = lang_ids.size();
 
       StorageView start_ids({batch_size}, sot, device);
-      StorageView score_ids({batch_size, num_langs}, DataType::INT32);
-      for (dim_t i = 0; i < batch_size; ++i) {
-        for (dim_t j = 0; j < num_langs; ++j)
-          score_ids.at<int32_t>({i, j}) = lang_ids[j];
-      }
-      if (score_ids.device() != device)
-        score_ids = score_ids.to(device);
 
       layers::DecoderState state = _decoder->initial_state();
       state.emplace("memory", maybe_encode(std::move(features)));
 
       StorageView logits(_decoder->output_type(), device);
-      StorageView lang_probs(logits.dtype(), device);
       (*_decoder)(0, start_ids, state, &logits);
-      ops::Gather(/*axis=*/-1, /*batch_dims=*/1)(logits, score_ids, lang_probs);
-      ops::SoftMax()(lang_probs);
-
-      if (lang_probs.dtype() != DataType::FLOAT32)
-        lang_probs = lang_probs.to_float32();
-      if (lang_probs.device() != Device::CPU)
-        lang_probs = lang_probs.to(Device::CPU);
+      const StorageView lang_probs = get_language_probs(logits, lang_ids);
 
       std::vector<std::vector<std::pair<std::string, float>>> results;
       results.reserve(batch_size);
@@ -638,6 +920,358 @@ namespace ctranslate2 {
     }
 
 
+    WhisperStream::WhisperStream(std::vector<std::string> prompt, WhisperStreamingOptions options)
+      : _prompt(std::move(prompt))
+      , _options(std::move(options))
+    {
+      if (_prompt.empty() || _prompt.front() != "<|startoftranscript|>")
+        throw std::invalid_argument("The stream prompt should start with <|startoftranscript|>");
+      if (_prompt.back() == "<|notimestamps|>")
+        throw std::invalid_argument("The stream prompt should not end with <|notimestamps|>: "
+                                    "the timestamps are required to commit the segments");
+    }
+
+    void WhisperStream::append_features(const StorageView& features) {
+      if (features.rank() != 2)
+        throw std::invalid_argument("The stream features should have shape [n_mels, num_frames], "
+                                    "but got a tensor of rank " + std::to_string(features.rank()));
+
+      StorageView frames = features.device() == Device::CPU ? features : features.to(Device::CPU);
+      if (frames.dtype() != DataType::FLOAT32)
+        frames = frames.to_float32();
+
+      const std::lock_guard<std::mutex> lock(_mutex);
+      if (_ended)
+        throw std::runtime_error("Cannot append features after the end of the stream");
+
+      if (!_features)
+        _features = std::move(frames);
+      else {
+        if (frames.dim(0) != _features.dim(0))
+          throw std::invalid_argument("Expected " + std::to_string(_features.dim(0))
+                                      + " mel bins but got " + std::to_string(frames.dim(0)));
+        StorageView buffer;
+        ops::Concat(1)({&_features, &frames}, buffer);
+        _features = std::move(buffer);
+      }
+
+      _pending_frames += features.dim(1);
+    }
+
+    void WhisperStream::end_of_stream() {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      _ended = true;
+    }
+
+    bool WhisperStream::has_pending_update() const {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      return has_pending_update_unlocked();
+    }
+
+    bool WhisperStream::has_pending_update_unlocked() const {
+      if (_finished || _updating)
+        return false;
+      return (_ended
+              || _pending_frames >= std::max(_options.partial_interval, size_t(1))
+              || num_buffered_frames_unlocked() >= window_frames);
+    }
+
+    bool WhisperStream::is_finished() const {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      return _finished;
+    }
+
+    size_t WhisperStream::num_buffered_frames() const {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      return num_buffered_frames_unlocked();
+    }
+
+    size_t WhisperStream::num_buffered_frames_unlocked() const {
+      return _features ? _features.dim(1) : 0;
+    }
+
+    std::vector<std::string> WhisperStream::transcription() const {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      return _transcription;
+    }
+
+    bool WhisperStream::start_update() {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      if (_updating)
+        throw std::invalid_argument("The stream is already being updated");
+      if (!has_pending_update_unlocked())
+        return false;
+
+      if (_ended && num_buffered_frames_unlocked() == 0) {
+        // No audio left to transcribe.
+        _finished = true;
+        return false;
+      }
+
+      _updating = true;
+      return true;
+    }
+
+    void WhisperStream::cancel_update() {
+      const std::lock_guard<std::mutex> lock(_mutex);
+      _updating = false;
+    }
+
+    WhisperStream::Window WhisperStream::get_window() const {
+      const std::lock_guard<std::mutex> lock(_mutex);
+
+      Window window;
+      const size_t num_frames = num_buffered_frames_unlocked();
+      window.num_frames = std::min(num_frames, window_frames);
+      window.last = _ended && num_frames <= window_frames;
+      window.commit = window.last || num_frames >= window_frames;
+
+      if (window.num_frames < num_frames)
+        ops::Slide(1, 0, window.num_frames)(_features, window.features);
+      else
+        window.features = _features;
+
+      if (_options.condition_on_previous_text) {
+        const size_t num_previous = std::min(_previous_tokens.size(), _options.max_previous_tokens);
+        window.previous_tokens.assign(_previous_tokens.end() - num_previous,
+                                      _previous_tokens.end());
+      }
+
+      return window;
+    }
+
+    WhisperStreamingResult WhisperStream::update(const Window& window,
+                                                 const std::vector<size_t>& tokens,
+                                                 const size_t timestamp_begin_id,
+                                                 const Vocabulary& vocabulary) {
+      // Split the tokens in segments delimited by timestamps. The positions are in frames
+      // from the beginning of the window.
+      std::vector<WhisperStreamSegment> segments;
+      std::vector<std::pair<size_t, size_t>> segments_frames;
+      std::vector<size_t> text;
+      size_t segment_start = 0;
+
+      for (const size_t token : tokens) {
+        if (token < timestamp_begin_id) {
+          text.emplace_back(token);
+          continue;
+        }
+
+        const size_t position = std::min((token - timestamp_begin_id) * frames_per_timestamp,
+                                         window.num_frames);
+        if (text.empty()) {
+          segment_start = position;
+        } else {
+          WhisperStreamSegment segment;
+          segment.tokens_ids = std::move(text);
+          segments.emplace_back(std::move(segment));
+          segments_frames.emplace_back(segment_start, position);
+          text.clear();
+          segment_start = position;
+        }
+      }
+
+      WhisperStreamingResult result;
+
+      const std::lock_guard<std::mutex> lock(_mutex);
+      _updating = false;
+
+      if (!window.commit) {
+        for (const auto& segment : segments)
+          result.partial_ids.insert(result.partial_ids.end(),
+                                    segment.tokens_ids.begin(),
+                                    segment.tokens_ids.end());
+        result.partial_ids.insert(result.partial_ids.end(), text.begin(), text.end());
+        result.partial = vocabulary.to_tokens({result.partial_ids})[0];
+        _pending_frames = num_buffered_frames_unlocked() - window.num_frames;
+        return result;
+      }
+
+      // Position of the first frame that is not committed.
+      size_t consumed = window.num_frames;
+
+      if (!text.empty()) {
+        if (window.last || segments.empty()) {
+          // Commit the incomplete segment with the remaining audio.
+          WhisperStreamSegment segment;
+          segment.tokens_ids = std::move(text);
+          segments.emplace_back(std::move(segment));
+          segments_frames.emplace_back(segment_start, window.num_frames);
+        } else {
+          // The incomplete segment is transcribed again in the next window.
+          consumed = segments_frames.back().second;
+          if (consumed == 0)
+            consumed = window.num_frames;
+        }
+      }
+
+      for (size_t i = 0; i < segments.size(); ++i) {
+        auto& segment = segments[i];
+        segment.start = float(_offset + segments_frames[i].first) * frame_duration;
+        segment.end = float(_offset + segments_frames[i].second) * frame_duration;
+        segment.tokens = vocabulary.to_tokens({segment.tokens_ids})[0];
+
+        _previous_tokens.insert(_previous_tokens.end(),
+                                segment.tokens_ids.begin(),
+                                segment.tokens_ids.end());
+        _transcription.insert(_transcription.end(), segment.tokens.begin(), segment.tokens.end());
+      }
+
+      if (_previous_tokens.size() > _options.max_previous_tokens)
+        _previous_tokens.erase(_previous_tokens.begin(),
+                               _previous_tokens.end() - _options.max_previous_tokens);
+
+      const size_t num_frames = num_buffered_frames_unlocked();
+      if (consumed >= num_frames)
+        _features = StorageView();
+      else {
+        StorageView remaining;
+        ops::Slide(1, consumed, num_frames - consumed)(_features, remaining);
+        _features = std::move(remaining);
+      }
+
+      _offset += consumed;
+      _pending_frames = num_frames - consumed;
+      _finished = window.last;
+
+      result.segments = std::move(segments);
+      result.finished = _finished;
+      return result;
+    }
+
+    // Scaled log-Mel value of zero samples when no audio is above the 1e-10 power floor.
+    static constexpr float min_log_mel = -1.5f;
+
+    StorageView pad_log_mel_features(const StorageView& features, dim_t length) {
+      if (features.rank() != 2)
+        throw std::invalid_argument("Expected log-Mel features with shape [n_mels, num_frames], "
+                                    "but got a tensor of rank "
+                                    + std::to_string(features.rank()));
+
+      const dim_t num_mels = features.dim(0);
+      const dim_t num_frames = features.dim(1);
+      if (num_frames > length)
+        throw std::invalid_argument("Cannot pad " + std::to_string(num_frames)
+                                    + " frames to a length of " + std::to_string(length));
+
+      const StorageView features_cpu = features.to(Device::CPU).to_float32();
+      const auto* src = features_cpu.data<float>();
+      const float max_value = (features_cpu.empty()
+                               ? min_log_mel
+                               : *std::max_element(src, src + features_cpu.size()));
+      const float silence_value = std::max(max_value - 2.f, min_log_mel);
+
+      StorageView padded({num_mels, length}, silence_value);
+      for (dim_t m = 0; m < num_mels; ++m)
+        std::copy(src + m * num_frames, src + (m + 1) * num_frames, padded.index<float>({m, 0}));
+      return padded;
+    }
+
+    std::vector<WhisperStreamingResult>
+    WhisperReplica::transcribe_streams(const std::vector<std::shared_ptr<WhisperStream>>& streams,
+                                       const WhisperOptions& options) {
+      PROFILE("WhisperReplica::transcribe_streams");
+
+      const dim_t batch_size = streams.size();
+      if (batch_size == 0)
+        return {};
+
+      try {
+        const auto& vocabulary = _model->get_vocabulary();
+        const size_t timestamp_begin_id = _no_timestamps_id + 1;
+        const size_t start_of_prev_id = vocabulary.to_id("<|startofprev|>");
+
+        std::vector<WhisperStream::Window> windows;
+        windows.reserve(batch_size);
+        for (const auto& stream : streams)
+          windows.emplace_back(stream->get_window());
+
+        // The windows are padded with the features of silent audio, as if the audio was
+        // padded before computing the features.
+        const dim_t window_frames = WhisperStream::window_frames;
+        const dim_t window_size = _n_mels * window_frames;
+        StorageView features({batch_size, dim_t(_n_mels), window_frames}, min_log_mel);
+        std::vector<std::vector<size_t>> prompts;
+        prompts.reserve(batch_size);
+
+        for (dim_t b = 0; b < batch_size; ++b) {
+          const auto& window = windows[b];
+
+          if (window.num_frames > 0) {
+            if (window.features.dim(0) != dim_t(_n_mels))
+              throw std::invalid_argument("The stream features have "
+                                          + std::to_string(window.features.dim(0))
+                                          + " mel bins but the model expects "
+                                          + std::to_string(_n_mels));
+
+            const StorageView padded = pad_log_mel_features(window.features, window_frames);
+            std::copy(padded.data<float>(),
+                      padded.data<float>() + window_size,
+                      features.index<float>({b, 0, 0}));
+          }
+
+          std::vector<size_t> prompt;
+          if (!window.previous_tokens.empty()) {
+            prompt.emplace_back(start_of_prev_id);
+            prompt.insert(prompt.end(),
+                          window.previous_tokens.begin(),
+                          window.previous_tokens.end());
+          }
+
+          const auto task_ids = vocabulary.to_ids({streams[b]->prompt()})[0];
+          prompt.insert(prompt.end(), task_ids.begin(), task_ids.end());
+          prompts.emplace_back(std::move(prompt));
+        }
+
+        // The encoder runs on the full batch. The decoding is grouped by prompt length since
+        // the <|startoftranscript|> token should be at the same position in all prompts.
+        std::map<size_t, std::vector<int32_t>> groups;
+        for (dim_t b = 0; b < batch_size; ++b)
+          groups[prompts[b].size()].emplace_back(b);
+
+        StorageView memory = encode(std::move(features), /*to_cpu=*/false);
+        std::vector<std::vector<size_t>> tokens(batch_size);
+
+        for (const auto& [prompt_size, indices] : groups) {
+          StorageView group_memory(memory.dtype(), memory.device());
+          if (groups.size() == 1) {
+            group_memory = std::move(memory);
+          } else {
+            const auto scoped_device_setter = _model->get_scoped_device_setter();
+            const StorageView group_ids({dim_t(indices.size())}, indices, memory.device());
+            ops::Gather()(memory, group_ids, group_memory);
+          }
+
+          WhisperOptions group_options = options;
+          group_options.num_hypotheses = 1;
+          group_options.num_frames.clear();
+          for (const int32_t b : indices)
+            group_options.num_frames.emplace_back(windows[b].num_frames);
+
+          auto results = generate(std::move(group_memory),
+                                  index_vector(prompts, indices),
+                                  group_options);
+          for (size_t i = 0; i < indices.size(); ++i)
+            tokens[indices[i]] = std::move(results[i].sequences_ids[0]);
+        }
+
+        std::vector<WhisperStreamingResult> stream_results;
+        stream_results.reserve(batch_size);
+        for (dim_t b = 0; b < batch_size; ++b)
+          stream_results.emplace_back(streams[b]->update(windows[b],
+                                                         tokens[b],
+                                                         timestamp_begin_id,
+                                                         vocabulary));
+        return stream_results;
+
+      } catch (...) {
+        for (const auto& stream : streams)
+          stream->cancel_update();
+        throw;
+      }
+    }
+
+
     bool Whisper::is_multilingual() const {
       const auto& replica = get_first_replica();
       return replica.is_multilingual();
@@ -653,10 +1287,14 @@ namespace ctranslate2 {
       return replica.num_languages();
     }
 
-    std::future<StorageView> Whisper::encode(const StorageView& features, const bool to_cpu) {
+    std::future<StorageView> Whisper::encode(const StorageView& features,
+                                             const bool to_cpu,
+                                             std::vector<size_t> num_frames,
+                                             size_t min_frames) {
       return post<StorageView>(
-        [features = features.sync_copy(), to_cpu](WhisperReplica& replica) mutable {
-          return replica.encode(std::move(features), to_cpu);
+        [features = features.sync_copy(), to_cpu, num_frames = std::move(num_frames), min_frames]
+        (WhisperReplica& replica) mutable {
+          return replica.encode(std::move(features), to_cpu, num_frames, min_frames);
         });
     }
 
@@ -690,6 +1328,36 @@ namespace ctranslate2 {
         batch_size);
     }
 
+    std::vector<std::future<WhisperGenerationResult>>
+    Whisper::generate_from_audio(const StorageView& audio,
+                                 std::vector<std::vector<std::string>> prompts,
+                                 WhisperOptions options) {
+      const size_t batch_size = audio.dim(0);
+      return post_batch<WhisperGenerationResult>(
+        [audio = audio.sync_copy(),
+         prompts = std::move(prompts),
+         options = std::move(options)]
+        (WhisperReplica& replica) mutable {
+          return replica.generate_from_audio(std::move(audio), prompts, options);
+        },
+        batch_size);
+    }
+
+    std::vector<std::future<WhisperGenerationResult>>
+    Whisper::generate_from_audio(const StorageView& audio,
+                                 std::vector<std::vector<size_t>> prompts,
+                                 WhisperOptions options) {
+      const size_t batch_size = audio.dim(0);
+      return post_batch<WhisperGenerationResult>(
+        [audio = audio.sync_copy(),
+         prompts = std::move(prompts),
+         options = std::move(options)]
+        (WhisperReplica& replica) mutable {
+          return replica.generate_from_audio(std::move(audio), prompts, options);
+        },
+        batch_size);
+    }
+
     std::vector<std::future<std::vector<std::pair<std::string, float>>>>
     Whisper::detect_language(const StorageView& features) {
       const size_t batch_size = features.dim(0);
@@ -723,6 +1391,48 @@ namespace ctranslate2 {
         batch_size);
     }
 
+    std::vector<std::future<WhisperStreamingResult>>
+    Whisper::transcribe_streams(const std::vector<std::shared_ptr<WhisperStream>>& streams,
+                                WhisperOptions options) {
+      std::vector<std::promise<WhisperStreamingResult>> promises(streams.size());
+      std::vector<std::future<WhisperStreamingResult>> futures;
+      futures.reserve(streams.size());
+      for (auto& promise : promises)
+        futures.emplace_back(promise.get_future());
+
+      // Group the streams that can be decoded in the same batch.
+      std::map<size_t, std::vector<size_t>> batches;
+
+      for (size_t i = 0; i < streams.size(); ++i) {
+        if (streams[i]->start_update())
+          batches[streams[i]->prompt().size()].emplace_back(i);
+        else {
+          WhisperStreamingResult result;
+          result.finished = streams[i]->is_finished();
+          promises[i].set_value(std::move(result));
+        }
+      }
+
+      for (const auto& [prompt_size, indices] : batches) {
+        std::vector<std::shared_ptr<WhisperStream>> batch_streams;
+        std::vector<std::promise<WhisperStreamingResult>> batch_promises;
+        batch_streams.reserve(indices.size());
+        batch_promises.reserve(indices.size());
+        for (const size_t index : indices) {
+          batch_streams.emplace_back(streams[index]);
+          batch_promises.emplace_back(std::move(promises[index]));
+        }
+
+        post_batch<WhisperStreamingResult>(
+          [streams = std::move(batch_streams), options](WhisperReplica& replica) {
+            return replica.transcribe_streams(streams, options);
+          },
+          std::move(batch_promises));
+      }
+
+      return futures;
+    }
+
 
     class ApplyTimestampRules : public LogitsProcessor {
     private:
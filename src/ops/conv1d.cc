@@ -5,11 +5,16 @@
 namespace ctranslate2 {
   namespace ops {
 
-    Conv1D::Conv1D(dim_t stride, dim_t padding, dim_t dilation, dim_t groups)
+    Conv1D::Conv1D(dim_t stride,
+                   dim_t padding,
+                   dim_t dilation,
+                   dim_t groups,
+                   const ActivationType* activation_type)
       : _stride(stride)
       , _padding(padding)
       , _dilation(dilation)
       , _groups(groups)
+      , _activation_type(activation_type)
     {
     }
 
@@ -17,22 +22,25 @@ namespace ctranslate2 {
                             const StorageView& weight,
                             const StorageView& bias,
                             StorageView& output,
-                            const StorageView* qscale) const {
-      operator()(input, weight, &bias, output, qscale);
+                            const StorageView* qscale,
+                            const StorageView* packed_weight) const {
+      operator()(input, weight, &bias, output, qscale, packed_weight);
     }
 
     void Conv1D::operator()(const StorageView& input,
                             const StorageView& weight,
                             StorageView& output,
-                            const StorageView* qscale) const {
-      operator()(input, weight, nullptr, output, qscale);
+                            const StorageView* qscale,
+                            const StorageView* packed_weight) const {
+      operator()(input, weight, nullptr, output, qscale, packed_weight);
     }
 
     void Conv1D::operator()(const StorageView& input,
                             const StorageView& weight,
                             const StorageView* bias,
                             StorageView& output,
-                            const StorageView* qscale) const {
+                            const StorageView* qscale,
+                            const StorageView* packed_weight) const {
       PROFILE("Conv1D");
       const dim_t batch_size = input.dim(0);
       const dim_t input_length = input.dim(2);
@@ -44,7 +52,7 @@ namespace ctranslate2 {
       output.resize({batch_size, out_channels, output_length});
 
       DEVICE_AND_FLOAT_DISPATCH("Conv1D", input.device(), input.dtype(),
-                                (compute<D, T>(input, weight, bias, output, qscale)));
+                                (compute<D, T>(input, weight, bias, output, qscale, packed_weight)));
     }
 
   }
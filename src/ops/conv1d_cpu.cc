@@ -6,12 +6,17 @@
 namespace ctranslate2 {
   namespace ops {
 
+    StorageView Conv1D::pack_weight(const StorageView& weight, const StorageView*) const {
+      return StorageView(weight.device());
+    }
+
     template<>
     void Conv1D::compute<Device::CPU, float>(const StorageView& input,
                                              const StorageView& weight,
                                              const StorageView* bias,
                                              StorageView& output,
-                                             const StorageView* qscale) const {
+                                             const StorageView* qscale,
+                                             const StorageView*) const {
       if (qscale)
         throw std::runtime_error("Quantization is not supported in this Conv1D implementation");
       dnnl::engine engine(dnnl::engine::kind::cpu, 0);
@@ -109,6 +114,9 @@ namespace ctranslate2 {
       }
 
       engine_stream.wait();
+
+      if (_activation_type)
+        get_activation_op(*_activation_type)(output, output);
     }
 
   }
@@ -117,6 +125,8 @@ namespace ctranslate2 {
 #else
 
 #  include "ctranslate2/ops/gemm.h"
+#  include "cpu/backend.h"
+#  include "cpu/kernels.h"
 #  include "cpu/parallel.h"
 #  include "ctranslate2/ops/quantize.h"
 #  include "ctranslate2/ops/dequantize.h"
@@ -124,13 +134,95 @@ namespace ctranslate2 {
 namespace ctranslate2 {
   namespace ops {
 
+    // The direct kernel handles the small kernels used by the speech front ends without
+    // materializing the im2col input, which is kernel_size times larger than the convolution
+    // input. It is on par with an AVX512 GEMM for float weights. For int8 weights, it avoids
+    // quantizing the input but it runs in float, so it is also only used with AVX512 or when
+    // there is no int8 GEMM backend.
+    static bool use_direct_kernel(const StorageView& weight, dim_t stride, dim_t dilation) {
+      const dim_t kernel_size = weight.dim(2);
+      if (dilation != 1
+          || kernel_size < 3 || kernel_size > 10
+          || stride < 1 || stride > 2)
+        return false;
+
+#ifdef CT2_X86_BUILD
+      const bool is_avx512 = cpu::get_cpu_isa() == cpu::CpuIsa::AVX512;
+#else
+      const bool is_avx512 = false;
+#endif
+
+      if (weight.dtype() == DataType::INT8)
+        return is_avx512 || !cpu::has_gemm_backend(ComputeType::INT8);
+      if (weight.dtype() == DataType::FLOAT32)
+        return is_avx512;
+      return false;
+    }
+
+    StorageView Conv1D::pack_weight(const StorageView& weight, const StorageView* qscale) const {
+      if (weight.device() != Device::CPU || !use_direct_kernel(weight, _stride, _dilation))
+        return StorageView(weight.device());
+
+      const dim_t out_channels = weight.dim(0);
+      const dim_t in_channels = weight.dim(1) * _groups;
+      const dim_t kernel_size = weight.dim(2);
+      const float* weight_scale = qscale ? qscale->data<float>() : nullptr;
+
+      StorageView packed_weight(weight.shape(), DataType::FLOAT32);
+
+      if (weight.dtype() == DataType::INT8) {
+        CPU_ISA_DISPATCH((cpu::conv1d_pack_weight<ISA>(weight.data<int8_t>(),
+                                                       weight_scale,
+                                                       packed_weight.data<float>(),
+                                                       in_channels,
+                                                       out_channels,
+                                                       kernel_size,
+                                                       _groups)));
+      } else {
+        CPU_ISA_DISPATCH((cpu::conv1d_pack_weight<ISA>(weight.data<float>(),
+                                                       weight_scale,
+                                                       packed_weight.data<float>(),
+                                                       in_channels,
+                                                       out_channels,
+                                                       kernel_size,
+                                                       _groups)));
+      }
+
+      return packed_weight;
+    }
+
     template<>
     void
     Conv1D::compute<Device::CPU, float>(const StorageView &input, const StorageView &weight, const StorageView *bias,
-                                        StorageView &output, const StorageView *qscale) const {
+                                        StorageView &output, const StorageView *qscale,
+                                        const StorageView *packed_weight) const {
       if (_dilation != 1)
         throw std::runtime_error("Dilation is not supported in this Conv1D implementation");
 
+      if (use_direct_kernel(weight, _stride, _dilation)) {
+        StorageView call_packed_weight;
+        if (!packed_weight) {
+          call_packed_weight = pack_weight(weight, qscale);
+          packed_weight = &call_packed_weight;
+        }
+
+        CPU_ISA_DISPATCH((cpu::conv1d<ISA>(input.data<float>(),
+                                           packed_weight->data<float>(),
+                                           bias ? bias->data<float>() : nullptr,
+                                           output.data<float>(),
+                                           input.dim(0),
+                                           input.dim(1),
+                                           input.dim(2),
+                                           weight.dim(0),
+                                           weight.dim(2),
+                                           output.dim(2),
+                                           _stride,
+                                           _padding,
+                                           _groups,
+                                           _activation_type)));
+        return;
+      }
+
       compute_with_gemm(input, weight, output, qscale);
       // Add bias
       if (bias) {
@@ -151,6 +243,9 @@ namespace ctranslate2 {
           }
         });
       }
+
+      if (_activation_type)
+        get_activation_op(*_activation_type)(output, output);
     }
 
     void Conv1D::compute_with_gemm(const StorageView &input, const StorageView &weight, StorageView &output,
@@ -10,7 +10,8 @@ namespace ctranslate2 {
                          const StorageView& weight,
                          const StorageView* bias,
                          StorageView& output,
-                         const StorageView* qscale) const {
+                         const StorageView* qscale,
+                         const StorageView*) const {
       if (qscale)
         throw std::runtime_error("Quantization is not supported in this Conv1D implementation");
 
@@ -143,6 +144,9 @@ namespace ctranslate2 {
       CUDNN_CHECK(cudnnDestroyFilterDescriptor(weight_desc));
       CUDNN_CHECK(cudnnDestroyTensorDescriptor(input_desc));
       CUDNN_CHECK(cudnnDestroyTensorDescriptor(output_desc));
+
+      if (_activation_type)
+        get_activation_op(*_activation_type)(output, output);
 #endif
     }
 
@@ -152,7 +156,8 @@ namespace ctranslate2 {
                                      const StorageView& weight,         \
                                      const StorageView* bias,           \
                                      StorageView& output,               \
-                                     const StorageView* qscale) const;
+                                     const StorageView* qscale,         \
+                                     const StorageView* packed_weight) const;
 
     DECLARE_IMPL(float)
     DECLARE_IMPL(float16_t)
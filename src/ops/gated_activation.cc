@@ -0,0 +1,40 @@
+#include "ctranslate2/ops/gated_activation.h"
+
+#include "ctranslate2/ops/mul.h"
+#include "ctranslate2/ops/split.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    GatedActivation::GatedActivation(const ActivationType activation_type)
+      : _activation_type(activation_type)
+    {
+    }
+
+    void GatedActivation::operator()(const StorageView& x, StorageView& y) const {
+      PROFILE("GatedActivation");
+
+      const dim_t depth = x.dim(-1);
+      if (depth % 2 != 0)
+        throw std::invalid_argument("GatedActivation: the last dimension of the input should "
+                                    "be divisible by 2, but got "
+                                    + std::to_string(depth));
+
+      Shape output_shape = x.shape();
+      output_shape.back() = depth / 2;
+
+      if (x.device() == Device::CPU && x.dtype() == DataType::FLOAT32) {
+        y.resize(std::move(output_shape));
+        compute<Device::CPU, float>(x, y);
+        return;
+      }
+
+      StorageView gate(x.dtype(), x.device());
+      StorageView up(x.dtype(), x.device());
+      Split(-1)(x, gate, up);
+      get_activation_op(_activation_type)(gate, gate);
+      Mul()(gate, up, y);
+    }
+
+  }
+}
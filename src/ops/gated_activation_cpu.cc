@@ -0,0 +1,27 @@
+#include "ctranslate2/ops/gated_activation.h"
+
+#include "cpu/kernels.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    template <Device D, typename T>
+    void GatedActivation::compute(const StorageView& x, StorageView& y) const {
+      const dim_t depth = y.dim(-1);
+      const dim_t batch_size = y.size() / depth;
+      CPU_ISA_DISPATCH((cpu::gated_activation<ISA>(x.data<T>(),
+                                                   y.data<T>(),
+                                                   batch_size,
+                                                   depth,
+                                                   _activation_type)));
+    }
+
+#define DECLARE_IMPL(T)                                                 \
+    template void                                                       \
+    GatedActivation::compute<Device::CPU, T>(const StorageView&,        \
+                                             StorageView&) const;
+
+    DECLARE_IMPL(float)
+
+  }
+}
@@ -0,0 +1,183 @@
+#include "ctranslate2/ops/mel_spectrogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "ctranslate2/primitives.h"
+#include "cpu/parallel.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    // Slaney Mel scale, as implemented by librosa.
+    constexpr double mel_frequency_step = 200. / 3.;
+    constexpr double mel_min_log_hz = 1000.;
+    constexpr double mel_min_log_mel = mel_min_log_hz / mel_frequency_step;
+    static const double mel_log_step = std::log(6.4) / 27.;
+
+    static double hz_to_mel(const double hz) {
+      if (hz >= mel_min_log_hz)
+        return mel_min_log_mel + std::log(hz / mel_min_log_hz) / mel_log_step;
+      return hz / mel_frequency_step;
+    }
+
+    static double mel_to_hz(const double mel) {
+      if (mel >= mel_min_log_mel)
+        return mel_min_log_hz * std::exp(mel_log_step * (mel - mel_min_log_mel));
+      return mel * mel_frequency_step;
+    }
+
+    MelSpectrogram::MelSpectrogram(dim_t num_mels,
+                                   dim_t n_fft,
+                                   dim_t hop_length,
+                                   dim_t sampling_rate)
+      : _num_mels(num_mels)
+      , _n_fft(n_fft)
+      , _hop_length(hop_length)
+      , _num_bins(n_fft / 2 + 1)
+      , _dft_basis({n_fft, 2 * _num_bins}, DataType::FLOAT32)
+      , _mel_filters({num_mels, _num_bins}, 0.f)
+    {
+      const double pi = std::acos(-1.);
+
+      auto* basis = _dft_basis.data<float>();
+      for (dim_t n = 0; n < n_fft; ++n) {
+        const double window = 0.5 - 0.5 * std::cos(2 * pi * n / n_fft);
+        for (dim_t k = 0; k < _num_bins; ++k) {
+          const double angle = 2 * pi * ((k * n) % n_fft) / n_fft;
+          basis[n * 2 * _num_bins + k] = window * std::cos(angle);
+          basis[n * 2 * _num_bins + _num_bins + k] = -window * std::sin(angle);
+        }
+      }
+
+      // Triangular filters between num_mels + 2 points evenly spaced on the Mel scale.
+      const double max_mel = hz_to_mel(sampling_rate / 2.);
+      std::vector<double> mel_points(num_mels + 2);
+      for (dim_t i = 0; i < num_mels + 2; ++i)
+        mel_points[i] = mel_to_hz(max_mel * i / (num_mels + 1));
+
+      auto* filters = _mel_filters.data<float>();
+      for (dim_t i = 0; i < num_mels; ++i) {
+        const double lower_width = mel_points[i + 1] - mel_points[i];
+        const double upper_width = mel_points[i + 2] - mel_points[i + 1];
+        const double norm = 2. / (mel_points[i + 2] - mel_points[i]);
+
+        for (dim_t k = 0; k < _num_bins; ++k) {
+          const double frequency = double(k) * sampling_rate / n_fft;
+          const double lower = (frequency - mel_points[i]) / lower_width;
+          const double upper = (mel_points[i + 2] - frequency) / upper_width;
+          filters[i * _num_bins + k] = std::max(0., std::min(lower, upper)) * norm;
+        }
+      }
+    }
+
+    void MelSpectrogram::operator()(const StorageView& audio, StorageView& features) const {
+      PROFILE("MelSpectrogram");
+
+      if (audio.device() != Device::CPU)
+        throw std::invalid_argument("MelSpectrogram currently only supports CPU execution");
+      if (audio.dtype() != DataType::FLOAT32)
+        throw std::invalid_argument("MelSpectrogram expects float32 audio samples");
+      if (audio.rank() != 2)
+        throw std::invalid_argument("MelSpectrogram expects audio samples with shape "
+                                    "[batch_size, num_samples], but got a tensor of rank "
+                                    + std::to_string(audio.rank()));
+
+      const dim_t batch_size = audio.dim(0);
+      const dim_t num_samples = audio.dim(1);
+      const dim_t padding = _n_fft / 2;
+
+      if (num_samples <= padding)
+        throw std::invalid_argument("MelSpectrogram expects more than "
+                                    + std::to_string(padding) + " samples, but got "
+                                    + std::to_string(num_samples));
+
+      // The STFT is centered and the last frame is dropped.
+      const dim_t num_frames = num_samples / _hop_length;
+      const dim_t num_rows = batch_size * num_frames;
+      const dim_t grain_size = std::max(cpu::GRAIN_SIZE / _n_fft, dim_t(1));
+
+      const auto* samples = audio.data<float>();
+      StorageView frames({num_rows, _n_fft}, DataType::FLOAT32);
+      auto* frames_data = frames.data<float>();
+
+      cpu::parallel_for(0, num_rows, grain_size, [&](const dim_t begin, const dim_t end) {
+        for (dim_t row = begin; row < end; ++row) {
+          const auto* src = samples + (row / num_frames) * num_samples;
+          auto* dst = frames_data + row * _n_fft;
+          const dim_t start = (row % num_frames) * _hop_length - padding;
+
+          for (dim_t n = 0; n < _n_fft; ++n) {
+            dim_t i = start + n;
+            if (i < 0)
+              i = -i;
+            else if (i >= num_samples)
+              i = 2 * (num_samples - 1) - i;
+            dst[n] = src[i];
+          }
+        }
+      });
+
+      StorageView spectrum({num_rows, 2 * _num_bins}, DataType::FLOAT32);
+      primitives<Device::CPU>::gemm(/*a_is_packed=*/false, /*b_is_packed=*/false,
+                                    /*transpose_a=*/false, /*transpose_b=*/false,
+                                    num_rows, 2 * _num_bins, _n_fft,
+                                    /*alpha=*/1.f,
+                                    frames_data, _n_fft,
+                                    _dft_basis.data<float>(), 2 * _num_bins,
+                                    /*beta=*/0.f,
+                                    spectrum.data<float>(), 2 * _num_bins);
+
+      // The power spectrum reuses the frames buffer.
+      frames.resize({num_rows, _num_bins});
+      auto* power = frames.data<float>();
+      const auto* spectrum_data = spectrum.data<float>();
+
+      cpu::parallel_for(0, num_rows, grain_size, [&](const dim_t begin, const dim_t end) {
+        for (dim_t row = begin; row < end; ++row) {
+          const auto* real = spectrum_data + row * 2 * _num_bins;
+          const auto* imag = real + _num_bins;
+          auto* dst = power + row * _num_bins;
+          for (dim_t k = 0; k < _num_bins; ++k)
+            dst[k] = real[k] * real[k] + imag[k] * imag[k];
+        }
+      });
+
+      StorageView mel({num_rows, _num_mels}, DataType::FLOAT32);
+      primitives<Device::CPU>::gemm(/*a_is_packed=*/false, /*b_is_packed=*/false,
+                                    /*transpose_a=*/false, /*transpose_b=*/true,
+                                    num_rows, _num_mels, _num_bins,
+                                    /*alpha=*/1.f,
+                                    power, _num_bins,
+                                    _mel_filters.data<float>(), _num_bins,
+                                    /*beta=*/0.f,
+                                    mel.data<float>(), _num_mels);
+
+      auto* mel_data = mel.data<float>();
+      cpu::parallel_for(0, num_rows * _num_mels, cpu::GRAIN_SIZE,
+                        [&](const dim_t begin, const dim_t end) {
+                          for (dim_t i = begin; i < end; ++i)
+                            mel_data[i] = std::log10(std::max(mel_data[i], 1e-10f));
+                        });
+
+      features.resize({batch_size, _num_mels, num_frames});
+      auto* features_data = features.data<float>();
+
+      cpu::parallel_for(0, batch_size, 1, [&](const dim_t begin, const dim_t end) {
+        for (dim_t b = begin; b < end; ++b) {
+          const auto* src = mel_data + b * num_frames * _num_mels;
+          auto* dst = features_data + b * _num_mels * num_frames;
+
+          const float max_value = primitives<Device::CPU>::max(src, num_frames * _num_mels);
+          const float min_value = max_value - 8.f;
+
+          for (dim_t t = 0; t < num_frames; ++t) {
+            for (dim_t m = 0; m < _num_mels; ++m)
+              dst[m * num_frames + t] = (std::max(src[t * _num_mels + m], min_value) + 4.f) / 4.f;
+          }
+        }
+      });
+    }
+
+  }
+}
@@ -0,0 +1,136 @@
+#include "ctranslate2/ops/ragged_attention.h"
+
+#include <algorithm>
+
+#include "ctranslate2/ops/softmax.h"
+#include "ctranslate2/primitives.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    RaggedAttention::RaggedAttention(dim_t num_heads, float queries_scale, bool is_causal)
+      : _num_heads(num_heads)
+      , _queries_scale(queries_scale)
+      , _is_causal(is_causal)
+    {
+    }
+
+    void RaggedAttention::operator()(const StorageView& queries,
+                                     const StorageView& keys,
+                                     const StorageView& values,
+                                     const std::vector<dim_t>& queries_offsets,
+                                     const std::vector<dim_t>& keys_offsets,
+                                     StorageView& output) const {
+      PROFILE("RaggedAttention");
+
+      if (queries.device() != Device::CPU)
+        throw std::invalid_argument("RaggedAttention currently only supports CPU execution");
+      if (queries.dtype() != DataType::FLOAT32)
+        throw std::invalid_argument("RaggedAttention currently only supports float32 inputs");
+      if (queries_offsets.empty() || queries_offsets.size() != keys_offsets.size())
+        throw std::invalid_argument("The queries and keys offsets should have the same non zero "
+                                    "size, but got " + std::to_string(queries_offsets.size())
+                                    + " and " + std::to_string(keys_offsets.size()));
+
+      const dim_t depth = queries.dim(-1);
+      const dim_t kv_depth = keys.dim(-1);
+      const dim_t head_dim = depth / _num_heads;
+      const dim_t num_heads_kv = kv_depth / head_dim;
+      if (depth % _num_heads != 0
+          || kv_depth % head_dim != 0
+          || num_heads_kv == 0
+          || _num_heads % num_heads_kv != 0
+          || values.dim(-1) != kv_depth)
+        throw std::invalid_argument("RaggedAttention: the queries depth " + std::to_string(depth)
+                                    + " and the keys depth " + std::to_string(kv_depth)
+                                    + " are incompatible with "
+                                    + std::to_string(_num_heads) + " heads");
+
+      const dim_t num_queries = queries.size() / depth;
+      const dim_t num_keys = keys.size() / kv_depth;
+      if (queries_offsets.back() > num_queries || keys_offsets.back() > num_keys)
+        throw std::invalid_argument("RaggedAttention: the offsets are out of range");
+
+      // Query heads sharing the same key/value head are processed in a single batched GEMM.
+      const dim_t queries_per_kv = _num_heads / num_heads_kv;
+      const dim_t num_gemms = num_heads_kv == _num_heads ? 1 : num_heads_kv;
+      const dim_t heads_per_gemm = num_heads_kv == _num_heads ? _num_heads : queries_per_kv;
+      const dim_t kv_stride = num_heads_kv == _num_heads ? head_dim : 0;
+
+      output.resize_as(queries);
+
+      const auto* queries_data = queries.data<float>();
+      const auto* keys_data = keys.data<float>();
+      const auto* values_data = values.data<float>();
+      auto* output_data = output.data<float>();
+
+      // The rows that do not belong to a sequence are set to 0.
+      primitives<Device::CPU>::fill(output_data + queries_offsets.back() * depth,
+                                    0.f,
+                                    (num_queries - queries_offsets.back()) * depth);
+
+      const ops::SoftMax softmax_op;
+      StorageView scores(DataType::FLOAT32);
+      StorageView lengths(DataType::INT32);
+
+      for (size_t b = 0; b + 1 < queries_offsets.size(); ++b) {
+        const dim_t queries_begin = queries_offsets[b];
+        const dim_t queries_length = queries_offsets[b + 1] - queries_begin;
+        const dim_t keys_begin = keys_offsets[b];
+        const dim_t keys_length = keys_offsets[b + 1] - keys_begin;
+
+        if (queries_length == 0)
+          continue;
+
+        auto* context = output_data + queries_begin * depth;
+        if (keys_length == 0) {
+          primitives<Device::CPU>::fill(context, 0.f, queries_length * depth);
+          continue;
+        }
+
+        const dim_t scores_stride = queries_length * keys_length;
+        scores.resize({_num_heads, queries_length, keys_length});
+        auto* scores_data = scores.data<float>();
+
+        for (dim_t g = 0; g < num_gemms; ++g) {
+          primitives<Device::CPU>::gemm_batch_strided(
+            /*transpose_a=*/false, /*transpose_b=*/true,
+            queries_length, keys_length, head_dim,
+            _queries_scale,
+            queries_data + queries_begin * depth + g * heads_per_gemm * head_dim, depth, head_dim,
+            keys_data + keys_begin * kv_depth + g * head_dim, kv_depth, kv_stride,
+            /*beta=*/0.f,
+            scores_data + g * heads_per_gemm * scores_stride, keys_length, scores_stride,
+            heads_per_gemm);
+        }
+
+        if (_is_causal) {
+          lengths.resize({_num_heads, queries_length});
+          auto* lengths_data = lengths.data<int32_t>();
+          for (dim_t i = 0; i < queries_length; ++i) {
+            const dim_t length = std::min(std::max(i + 1 + keys_length - queries_length, dim_t(0)),
+                                          keys_length);
+            for (dim_t h = 0; h < _num_heads; ++h)
+              lengths_data[h * queries_length + i] = length;
+          }
+          softmax_op(scores, &lengths, scores);
+        } else {
+          softmax_op(scores);
+        }
+
+        for (dim_t g = 0; g < num_gemms; ++g) {
+          primitives<Device::CPU>::gemm_batch_strided(
+            /*transpose_a=*/false, /*transpose_b=*/false,
+            queries_length, head_dim, keys_length,
+            /*alpha=*/1.f,
+            scores_data + g * heads_per_gemm * scores_stride, keys_length, scores_stride,
+            values_data + keys_begin * kv_depth + g * head_dim, kv_depth, kv_stride,
+            /*beta=*/0.f,
+            context + g * heads_per_gemm * head_dim, depth, head_dim,
+            heads_per_gemm);
+        }
+      }
+    }
+
+  }
+}
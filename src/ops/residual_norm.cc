@@ -0,0 +1,90 @@
+#include "ctranslate2/ops/residual_norm.h"
+
+#include "ctranslate2/ops/add.h"
+#include "ctranslate2/ops/layer_norm.h"
+#include "ctranslate2/ops/rms_norm.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    ResidualNorm::ResidualNorm(const float epsilon, const bool rms_use_residual)
+      : _epsilon(epsilon)
+      , _rms_use_residual(rms_use_residual)
+    {
+    }
+
+    static inline bool use_fused_kernel(const StorageView& input) {
+      return input.device() == Device::CPU && input.dtype() == DataType::FLOAT32;
+    }
+
+    void ResidualNorm::operator()(const StorageView* beta,
+                                  const StorageView& gamma,
+                                  const StorageView& input,
+                                  const StorageView* residual,
+                                  StorageView& output,
+                                  StorageView* sum) const {
+      PROFILE("ResidualNorm");
+
+      if (!use_fused_kernel(input)) {
+        unfused(beta, gamma, input, residual, output, sum);
+        return;
+      }
+
+      if (sum)
+        sum->resize_as(input);
+      output.resize_as(input);
+      compute<Device::CPU, float>(beta, gamma, input, residual, &output, sum,
+                                  nullptr, nullptr, nullptr);
+    }
+
+    void ResidualNorm::operator()(const StorageView* beta,
+                                  const StorageView& gamma,
+                                  const StorageView& input,
+                                  const StorageView* residual,
+                                  const Quantize& quantize_op,
+                                  StorageView& qoutput,
+                                  StorageView& qscale,
+                                  StorageView* sum) const {
+      PROFILE("ResidualNorm");
+
+      if (!use_fused_kernel(input) || qoutput.dtype() != DataType::INT8) {
+        StorageView output(input.dtype(), input.device());
+        unfused(beta, gamma, input, residual, output, sum);
+        quantize_op(output, qoutput, qscale);
+        return;
+      }
+
+      const dim_t depth = input.dim(-1);
+      const dim_t batch_size = input.size() / depth;
+      if (sum)
+        sum->resize_as(input);
+      qoutput.resize_as(input);
+      qscale.resize({batch_size});
+      compute<Device::CPU, float>(beta, gamma, input, residual, nullptr, sum,
+                                  &qoutput, &qscale, &quantize_op);
+    }
+
+    void ResidualNorm::unfused(const StorageView* beta,
+                               const StorageView& gamma,
+                               const StorageView& input,
+                               const StorageView* residual,
+                               StorageView& output,
+                               StorageView* sum) const {
+      StorageView local_sum(input.dtype(), input.device());
+      const StorageView* x = &input;
+
+      if (residual) {
+        if (!sum)
+          sum = &local_sum;
+        Add()(input, *residual, *sum);
+        x = sum;
+      }
+
+      if (beta)
+        LayerNorm(-1, _epsilon)(*beta, gamma, *x, output);
+      else
+        RMSNorm(_epsilon, _rms_use_residual)(gamma, *x, output);
+    }
+
+  }
+}
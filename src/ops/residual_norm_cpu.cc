@@ -0,0 +1,52 @@
+#include "ctranslate2/ops/residual_norm.h"
+
+#include "cpu/kernels.h"
+
+namespace ctranslate2 {
+  namespace ops {
+
+    template <Device D, typename T>
+    void ResidualNorm::compute(const StorageView* beta,
+                               const StorageView& gamma,
+                               const StorageView& input,
+                               const StorageView* residual,
+                               StorageView* output,
+                               StorageView* sum,
+                               StorageView* qoutput,
+                               StorageView* qscale,
+                               const Quantize* quantize_op) const {
+      const dim_t depth = input.dim(-1);
+      const dim_t batch_size = input.size() / depth;
+      CPU_ISA_DISPATCH((cpu::residual_norm<ISA>(
+                          input.data<T>(),
+                          residual ? residual->data<T>() : nullptr,
+                          gamma.data<T>(),
+                          beta ? beta->data<T>() : nullptr,
+                          sum ? sum->data<T>() : nullptr,
+                          output ? output->data<T>() : nullptr,
+                          qoutput ? qoutput->data<int8_t>() : nullptr,
+                          qscale ? qscale->data<float>() : nullptr,
+                          batch_size,
+                          depth,
+                          _epsilon,
+                          _rms_use_residual,
+                          quantize_op && quantize_op->shift_to_uint8(),
+                          !quantize_op || quantize_op->round_before_cast())));
+    }
+
+#define DECLARE_IMPL(T)                                                 \
+    template void                                                       \
+    ResidualNorm::compute<Device::CPU, T>(const StorageView*,           \
+                                          const StorageView&,           \
+                                          const StorageView&,           \
+                                          const StorageView*,           \
+                                          StorageView*,                 \
+                                          StorageView*,                 \
+                                          StorageView*,                 \
+                                          StorageView*,                 \
+                                          const Quantize*) const;
+
+    DECLARE_IMPL(float)
+
+  }
+}
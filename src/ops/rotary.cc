@@ -24,5 +24,23 @@ namespace ctranslate2 {
                                 (compute<D, T>(input, sin, cos, output, is_transposed)));
     }
 
+    void Rotary::operator()(const StorageView& input,
+                            const StorageView& sin,
+                            const StorageView& cos,
+                            const dim_t num_rotary_heads,
+                            StorageView& output) const {
+      PROFILE("RotarySplitHeads");
+
+      if (input.device() != Device::CPU || input.dtype() != DataType::FLOAT32)
+        throw std::invalid_argument("Rotary: splitting heads is only supported on CPU "
+                                    "with float32 inputs");
+      if (input.rank() != 4)
+        throw std::invalid_argument("Rotary: expected a 4D input to split heads, but got rank "
+                                    + std::to_string(input.rank()));
+
+      output.resize({input.dim(0), input.dim(2), input.dim(1), input.dim(3)});
+      compute_split_heads<Device::CPU, float>(input, sin, cos, num_rotary_heads, output);
+    }
+
   }
 }
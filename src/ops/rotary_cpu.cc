@@ -5,6 +5,26 @@
 namespace ctranslate2 {
   namespace ops {
 
+    template <typename T, bool interleave>
+    static inline void rotary_row(const T* x,
+                                  const T* s,
+                                  const T* c,
+                                  T* y,
+                                  const dim_t ndims,
+                                  const dim_t depth) {
+      const dim_t middle = ndims / 2;
+
+      for (dim_t i = 0; i < ndims; ++i) {
+        if (interleave)
+          y[i] = x[i] * c[i] + (i % 2 == 0 ? -x[i + 1] : x[i - 1]) * s[i];
+        else
+          y[i] = x[i] * c[i] + (i < middle ? -x[i + middle] : x[i - middle]) * s[i];
+      }
+
+      if (ndims < depth)
+        std::copy(x + ndims, x + depth, y + ndims);
+    }
+
     template <typename T, bool interleave>
     void rotary_kernel(const T* input,
                        const T* sin,
@@ -14,8 +34,6 @@ namespace ctranslate2 {
                        const dim_t max_time,
                        const dim_t ndims,
                        const dim_t depth) {
-      const dim_t middle = ndims / 2;
-
       cpu::parallel_for(0, batch_size, 1, [&](dim_t begin, dim_t end) {
         for (dim_t b = begin; b < end; ++b) {
           for (dim_t t = 0; t < max_time; ++t) {
@@ -25,15 +43,36 @@ namespace ctranslate2 {
             const T* x = input + b * (max_time * depth) + t * depth;
             T* y = output + b * (max_time * depth) + t * depth;
 
-            for (dim_t i = 0; i < ndims; ++i) {
-              if (interleave)
-                y[i] = x[i] * c[i] + (i % 2 == 0 ? -x[i + 1] : x[i - 1]) * s[i];
-              else
-                y[i] = x[i] * c[i] + (i < middle ? -x[i + middle] : x[i - middle]) * s[i];
-            }
+            rotary_row<T, interleave>(x, s, c, y, ndims, depth);
+          }
+        }
+      });
+    }
 
-            if (ndims < depth)
-              std::copy(x + ndims, x + depth, y + ndims);
+    template <typename T, bool interleave>
+    void rotary_split_heads_kernel(const T* input,
+                                   const T* sin,
+                                   const T* cos,
+                                   T* output,
+                                   const dim_t batch_size,
+                                   const dim_t max_time,
+                                   const dim_t num_heads,
+                                   const dim_t num_rotary_heads,
+                                   const dim_t ndims,
+                                   const dim_t depth) {
+      cpu::parallel_for(0, batch_size * num_heads, 1, [&](dim_t begin, dim_t end) {
+        for (dim_t i = begin; i < end; ++i) {
+          const dim_t b = i / num_heads;
+          const dim_t h = i % num_heads;
+
+          for (dim_t t = 0; t < max_time; ++t) {
+            const T* x = input + ((b * max_time + t) * num_heads + h) * depth;
+            T* y = output + (i * max_time + t) * depth;
+
+            if (h < num_rotary_heads)
+              rotary_row<T, interleave>(x, sin + t * ndims, cos + t * ndims, y, ndims, depth);
+            else
+              std::copy(x, x + depth, y);
           }
         }
       });
@@ -61,13 +100,46 @@ namespace ctranslate2 {
         rotary_kernel<T, false>(x, s, c, y, batch_size, max_time, ndims, depth);
     }
 
+    template <Device D, typename T>
+    void Rotary::compute_split_heads(const StorageView& input,
+                                     const StorageView& sin,
+                                     const StorageView& cos,
+                                     const dim_t num_rotary_heads,
+                                     StorageView& output) const {
+      const dim_t batch_size = input.dim(0);
+      const dim_t max_time = input.dim(1);
+      const dim_t num_heads = input.dim(2);
+      const dim_t depth = input.dim(3);
+      const dim_t ndims = _ndims == 0 ? depth : _ndims;
+
+      const auto* x = input.data<T>();
+      const auto* s = sin.data<T>();
+      const auto* c = cos.data<T>();
+      auto* y = output.data<T>();
+
+      if (_interleave)
+        rotary_split_heads_kernel<T, true>(x, s, c, y,
+                                           batch_size, max_time, num_heads, num_rotary_heads,
+                                           ndims, depth);
+      else
+        rotary_split_heads_kernel<T, false>(x, s, c, y,
+                                            batch_size, max_time, num_heads, num_rotary_heads,
+                                            ndims, depth);
+    }
+
 #define DECLARE_IMPL(T)                                                 \
     template void                                                       \
     Rotary::compute<Device::CPU, T>(const StorageView&,                 \
                                     const StorageView&,                 \
                                     const StorageView&,                 \
                                     StorageView&,                       \
-                                    bool) const;
+                                    bool) const;                        \
+    template void                                                       \
+    Rotary::compute_split_heads<Device::CPU, T>(const StorageView&,     \
+                                                const StorageView&,     \
+                                                const StorageView&,     \
+                                                const dim_t,            \
+                                                StorageView&) const;
 
     DECLARE_IMPL(float)
 
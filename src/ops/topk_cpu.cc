@@ -2,13 +2,18 @@
 
 #include <algorithm>
 #include <numeric>
+#include <type_traits>
 
+#include "cpu/kernels.h"
 #include "cpu/parallel.h"
 #include "type_dispatch.h"
 
 namespace ctranslate2 {
   namespace ops {
 
+    // Below this size, sorting the full row is fast enough.
+    constexpr dim_t min_depth_for_block_selection = 2048;
+
     template <Device D, typename DataType, typename IndexType>
     void TopK::compute(const StorageView& x,
                        StorageView& values,
@@ -30,6 +35,14 @@ namespace ctranslate2 {
           }
         });
 
+      } else if (std::is_same<DataType, float>::value && depth >= min_depth_for_block_selection) {
+        CPU_ISA_DISPATCH((cpu::topk<ISA>(reinterpret_cast<const float*>(x_data),
+                                         reinterpret_cast<float*>(v_data),
+                                         reinterpret_cast<int32_t*>(i_data),
+                                         batch_size,
+                                         depth,
+                                         _k)));
+
       } else {
         cpu::parallel_for(0, batch_size, 1, [&](dim_t begin, dim_t end) {
           for (dim_t i = begin; i < end; ++i) {
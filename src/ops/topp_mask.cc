@@ -27,6 +27,17 @@ namespace ctranslate2 {
       DEVICE_AND_FLOAT_DISPATCH("TopPMask", device, dtype, (compute<D, T>(input, probs, output)));
     }
 
+    void TopPMask::operator()(const StorageView& input,
+                              const StorageView& probs,
+                              StorageView& output) const {
+      PROFILE("TopPMask");
+
+      output.resize_as(input);
+
+      DEVICE_AND_FLOAT_DISPATCH("TopPMask", input.device(), input.dtype(),
+                                (compute<D, T>(input, probs, output)));
+    }
+
     dim_t TopPMask::max_num_classes(const Device device) {
       dim_t num_classes = 0;
       DEVICE_DISPATCH(device, num_classes = max_num_classes<D>());
@@ -18,6 +18,12 @@ namespace ctranslate2 {
                                          [this](const int32_t length) {
                                            return length != _max_time;
                                          });
+
+    _offsets.reserve(_batch_size + 1);
+    _offsets.emplace_back(0);
+    for (const int32_t length : lengths_vec)
+      _offsets.emplace_back(_offsets.back() + (has_padding ? length : _max_time));
+
     if (!has_padding)
       return;
 
@@ -1,5 +1,8 @@
 #include "ctranslate2/sampling.h"
 
+#include <algorithm>
+#include <numeric>
+
 #include "ctranslate2/ops/ops.h"
 
 namespace ctranslate2 {
@@ -22,6 +25,11 @@ namespace ctranslate2 {
   }
 
 
+  void Sampler::get_distribution(const StorageView&, StorageView&) const {
+    throw std::runtime_error("This sampler does not sample from a distribution");
+  }
+
+
   void BestSampler::sample(const StorageView& scores,
                            dim_t num_samples,
                            StorageView& sampled_ids,
@@ -73,26 +81,41 @@ namespace ctranslate2 {
       final_scores = &top_scores;
     }
 
-    if (_topp < 1) {
-      StorageView masked_scores(dtype, device);
-      const ops::TopPMask mask_op(_topp);
-      mask_op(*final_scores, masked_scores);
-      top_scores = std::move(masked_scores);
-      final_scores = &top_scores;
-    }
-
-    // The current Multinomial operator samples with replacement. We can use it when
-    // only 1 sample should be returned, otherwise we use the Gumbel-max trick.
-    if (num_samples > 1) {
-      StorageView log_probs(dtype, device);
-      ops::LogSoftMax()(*final_scores, log_probs);
-      const ops::GumbelMax gumbel_max_op(num_samples);
-      gumbel_max_op(log_probs, sampled_ids);
-    } else {
+    if (_topp < 1 && num_samples == 1 && device == Device::CPU) {
+      // The probabilities are computed once and the tokens outside of the top-p set
+      // get a null probability, so they can be directly used for sampling. The masked
+      // probabilities are not normalized, which is only supported by the CPU Multinomial
+      // (the CUDA kernel expects the probabilities to sum to 1).
       StorageView probs(dtype, device);
       ops::SoftMax()(*final_scores, probs);
+      StorageView masked_probs(dtype, device);
+      const ops::TopPMask mask_op(_topp, /*mask_value=*/0);
+      mask_op(probs, probs, masked_probs);
       const ops::Multinomial multinomial_op(num_samples);
-      multinomial_op(probs, sampled_ids);
+      multinomial_op(masked_probs, sampled_ids);
+
+    } else {
+      if (_topp < 1) {
+        StorageView masked_scores(dtype, device);
+        const ops::TopPMask mask_op(_topp);
+        mask_op(*final_scores, masked_scores);
+        top_scores = std::move(masked_scores);
+        final_scores = &top_scores;
+      }
+
+      // The current Multinomial operator samples with replacement. We can use it when
+      // only 1 sample should be returned, otherwise we use the Gumbel-max trick.
+      if (num_samples > 1) {
+        StorageView log_probs(dtype, device);
+        ops::LogSoftMax()(*final_scores, log_probs);
+        const ops::GumbelMax gumbel_max_op(num_samples);
+        gumbel_max_op(log_probs, sampled_ids);
+      } else {
+        StorageView probs(dtype, device);
+        ops::SoftMax()(*final_scores, probs);
+        const ops::Multinomial multinomial_op(num_samples);
+        multinomial_op(probs, sampled_ids);
+      }
     }
 
     if (top_ids)  // Return ids relative to the initial distribution.
@@ -100,4 +123,47 @@ namespace ctranslate2 {
     ops::Gather(-1, scores.rank() - 1)(scores, sampled_ids, sampled_scores);
   }
 
+  void RandomSampler::get_distribution(const StorageView& scores, StorageView& probs) const {
+    PROFILE("RandomSampler::get_distribution");
+    StorageView final_scores = scores.to_float32().to(Device::CPU);
+    const dim_t depth = final_scores.dim(-1);
+    const dim_t batch_size = final_scores.size() / depth;
+
+    if (_temperature != 1)
+      ops::Mul()(final_scores, StorageView(float(1) / _temperature), final_scores);
+
+    if (_from_topk > 0 && _from_topk < depth) {
+      StorageView top_scores(DataType::FLOAT32);
+      StorageView top_ids(DataType::INT32);
+      const ops::TopK topk_op(_from_topk);
+      topk_op(final_scores, top_scores, top_ids);
+      ops::SoftMax()(top_scores);
+
+      probs = StorageView(final_scores.shape(), float(0));
+      for (dim_t i = 0; i < batch_size; ++i) {
+        const auto* top_probs = top_scores.data<float>() + i * _from_topk;
+        const auto* ids = top_ids.data<int32_t>() + i * _from_topk;
+        auto* row = probs.data<float>() + i * depth;
+        for (dim_t k = 0; k < _from_topk; ++k)
+          row[ids[k]] = top_probs[k];
+      }
+    } else {
+      ops::SoftMax()(final_scores, probs);
+    }
+
+    if (_topp < 1) {
+      StorageView masked_probs(DataType::FLOAT32);
+      ops::TopPMask(_topp, /*mask_value=*/0)(probs, probs, masked_probs);
+      probs = std::move(masked_probs);
+
+      // Renormalize the remaining probabilities as the multinomial sampling does.
+      for (dim_t i = 0; i < batch_size; ++i) {
+        auto* row = probs.data<float>() + i * depth;
+        const float sum = std::accumulate(row, row + depth, float(0));
+        if (sum > 0)
+          std::transform(row, row + depth, row, [sum](float p) { return p / sum; });
+      }
+    }
+  }
+
 }
@@ -1,7 +1,11 @@
 #include "ctranslate2/translator.h"
 
+#include <sstream>
+
 #include <spdlog/spdlog.h>
 
+#include "lru_cache.h"
+
 namespace ctranslate2 {
 
   std::vector<std::future<TranslationResult>>
@@ -12,19 +16,73 @@ namespace ctranslate2 {
     return translate_batch_async(source, {}, options, max_batch_size, batch_type);
   }
 
+  static TranslationResultCache::Key make_cache_key(const Example& example,
+                                                    const std::string& options_key) {
+    TranslationResultCache::Key key;
+    key.source = example.streams[0];
+    if (example.num_streams() > 1)
+      key.target_prefix = example.streams[1];
+    key.options = options_key;
+    return key;
+  }
+
   std::vector<std::future<TranslationResult>>
   Translator::translate_batch_async(const std::vector<std::vector<std::string>>& source,
                                     const std::vector<std::vector<std::string>>& target_prefix,
                                     const TranslationOptions& options,
                                     const size_t max_batch_size,
                                     const BatchType batch_type) {
-    return post_examples<TranslationResult>(
-      load_examples({source, target_prefix}),
-      max_batch_size,
-      batch_type,
-      [options](models::SequenceToSequenceReplica& model, const Batch& batch) {
-        return run_translation(model, batch, options);
-      });
+    auto examples = load_examples({source, target_prefix});
+
+    const auto options_key = (_result_cache->enabled()
+                              ? TranslationResultCache::get_options_key(options)
+                              : std::nullopt);
+
+    if (!options_key)
+      return post_examples<TranslationResult>(
+        examples,
+        max_batch_size,
+        batch_type,
+        [options](models::SequenceToSequenceReplica& model, const Batch& batch) {
+          return run_translation(model, batch, options);
+        });
+
+    std::vector<std::promise<TranslationResult>> promises(examples.size());
+    std::vector<std::future<TranslationResult>> futures;
+    futures.reserve(promises.size());
+    for (auto& promise : promises)
+      futures.emplace_back(promise.get_future());
+
+    // The cached results are returned immediately, the other examples are posted.
+    std::vector<Example> examples_to_run;
+    std::vector<std::promise<TranslationResult>> promises_to_run;
+
+    for (size_t i = 0; i < examples.size(); ++i) {
+      auto result = _result_cache->get(make_cache_key(examples[i], *options_key));
+
+      if (result) {
+        promises[i].set_value(std::move(*result));
+      } else {
+        examples_to_run.emplace_back(std::move(examples[i]));
+        promises_to_run.emplace_back(std::move(promises[i]));
+      }
+    }
+
+    if (!examples_to_run.empty())
+      post_examples(
+        examples_to_run,
+        max_batch_size,
+        batch_type,
+        std::move(promises_to_run),
+        [options, options_key = *options_key, cache = _result_cache]
+        (models::SequenceToSequenceReplica& model, const Batch& batch) {
+          auto results = run_translation(model, batch, options);
+          for (size_t i = 0; i < results.size(); ++i)
+            cache->save(make_cache_key(batch.examples[i], options_key), results[i]);
+          return results;
+        });
+
+    return futures;
   }
 
   std::vector<std::future<ScoringResult>>
@@ -169,6 +227,178 @@ namespace ctranslate2 {
   }
 
 
+  static size_t get_tokens_size(const std::vector<std::string>& tokens) {
+    size_t size = sizeof (tokens);
+    for (const auto& token : tokens)
+      size += sizeof (token) + token.size();
+    return size;
+  }
+
+  // Approximate memory usage of a cache entry.
+  static size_t get_entry_size(const TranslationResultCache::Key& key,
+                               const TranslationResult& result) {
+    size_t size = sizeof (key) + sizeof (result);
+    size += get_tokens_size(key.source);
+    size += get_tokens_size(key.target_prefix);
+    size += key.options.size();
+
+    for (const auto& hypothesis : result.hypotheses)
+      size += get_tokens_size(hypothesis);
+    size += result.scores.size() * sizeof (float);
+    for (const auto& attention : result.attention) {
+      for (const auto& vector : attention)
+        size += sizeof (vector) + vector.size() * sizeof (float);
+    }
+    for (const auto& logits : result.logits) {
+      for (const auto& value : logits)
+        size += sizeof (value) + value.size() * value.item_size();
+    }
+    return size;
+  }
+
+  TranslationResultCache::TranslationResultCache(size_t max_size_in_bytes)
+    : _results(std::make_unique<ResultLru>(max_size_in_bytes, get_entry_size))
+  {
+  }
+
+  TranslationResultCache::~TranslationResultCache() = default;
+
+  template <typename T>
+  static void write_option(std::ostream& os, const T& value) {
+    os << value << '\x1f';
+  }
+
+  static void write_option(std::ostream& os, const std::vector<std::string>& tokens) {
+    for (const auto& token : tokens)
+      os << token << '\x1e';
+    os << '\x1f';
+  }
+
+  std::optional<std::string>
+  TranslationResultCache::get_options_key(const TranslationOptions& options) {
+    const bool random_sampling = (options.sampling_topk != 1
+                                  && options.sampling_temperature != 0);
+    if (random_sampling || options.callback)
+      return std::nullopt;
+
+    std::ostringstream os;
+    os << std::hexfloat;
+
+    write_option(os, options.beam_size);
+    write_option(os, options.patience);
+    write_option(os, options.num_beam_groups);
+    write_option(os, options.diversity_penalty);
+    write_option(os, options.length_penalty);
+    write_option(os, options.coverage_penalty);
+    write_option(os, options.repetition_penalty);
+    write_option(os, options.no_repeat_ngram_size);
+    write_option(os, options.disable_unk);
+    for (const auto& sequence : options.suppress_sequences)
+      write_option(os, sequence);
+    write_option(os, options.suppress_sequences.size());
+    write_option(os, options.prefix_bias_beta);
+
+    write_option(os, options.end_token.index());
+    if (const auto* token = std::get_if<std::string>(&options.end_token))
+      write_option(os, *token);
+    else if (const auto* tokens = std::get_if<std::vector<std::string>>(&options.end_token))
+      write_option(os, *tokens);
+    else
+      for (const size_t id : std::get<std::vector<size_t>>(options.end_token))
+        write_option(os, id);
+
+    write_option(os, options.return_end_token);
+    write_option(os, options.max_input_length);
+    write_option(os, options.max_decoding_length);
+    write_option(os, options.min_decoding_length);
+    write_option(os, options.sampling_topk);
+    write_option(os, options.sampling_topp);
+    write_option(os, options.sampling_temperature);
+    write_option(os, options.use_vmap);
+    write_option(os, options.num_hypotheses);
+    write_option(os, options.return_scores);
+    write_option(os, options.return_attention);
+    write_option(os, options.return_logits_vocab);
+    write_option(os, options.return_alternatives);
+    write_option(os, options.min_alternative_expansion_prob);
+    write_option(os, options.replace_unknowns);
+
+    // The speculative decoding options change the draft statistics of the results. The
+    // draft model is identified by its address.
+    const bool speculative = options.draft_model || options.prompt_lookup_ngram_size > 0;
+    write_option(os, static_cast<const void*>(options.draft_model.get()));
+    write_option(os, options.prompt_lookup_ngram_size);
+    write_option(os, speculative ? options.num_speculative_tokens : 0);
+    return os.str();
+  }
+
+  size_t TranslationResultCache::KeyHash::operator()(const Key& key) const {
+    size_t hash = 0;
+    const auto combine = [&hash](size_t value) {
+      hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    };
+
+    const std::hash<std::string> string_hash;
+    for (const auto& token : key.source)
+      combine(string_hash(token));
+    combine(key.source.size());
+    for (const auto& token : key.target_prefix)
+      combine(string_hash(token));
+    combine(key.target_prefix.size());
+    combine(string_hash(key.options));
+    return hash;
+  }
+
+  void TranslationResultCache::save(const Key& key, TranslationResult result) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    if (_results->max_size() == 0)
+      return;
+    _results->put(key, std::move(result));
+  }
+
+  std::optional<TranslationResult> TranslationResultCache::get(const Key& key) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    const auto* result = _results->get(key);
+    if (!result)
+      return std::nullopt;
+    return *result;
+  }
+
+  bool TranslationResultCache::enabled() const {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    return _results->max_size() > 0;
+  }
+
+  void TranslationResultCache::set_max_size(size_t max_size_in_bytes) {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _results->set_max_size(max_size_in_bytes);
+    if (max_size_in_bytes == 0)
+      _results->clear();
+  }
+
+  size_t TranslationResultCache::max_size() const {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    return _results->max_size();
+  }
+
+  TranslationResultCache::Stats TranslationResultCache::get_stats() const {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    const auto& lru_stats = _results->stats();
+    Stats stats;
+    stats.num_lookups = lru_stats.num_lookups;
+    stats.num_hits = lru_stats.num_hits;
+    stats.num_evictions = lru_stats.num_evictions;
+    stats.num_entries = lru_stats.num_entries;
+    stats.size_in_bytes = lru_stats.size;
+    return stats;
+  }
+
+  void TranslationResultCache::clear() {
+    const std::lock_guard<std::mutex> lock(_mutex);
+    _results->clear();
+  }
+
+
   std::vector<ScoringResult>
   run_scoring(models::SequenceToSequenceReplica& model,
               const Batch& batch,
@@ -79,6 +79,31 @@ void benchmark_topk(Device device) {
   BENCHMARK(op(input, values, indices), 2000);
 }
 
+StorageView rand_logits(dim_t batch_size, dim_t vocab_size, Device device) {
+  std::vector<float> logits = rand_vector(batch_size * vocab_size);
+  for (auto& v : logits)
+    v = v / RAND_MAX * 20 - 10;
+  return StorageView({batch_size, vocab_size}, logits, device);
+}
+
+void benchmark_topk_large_vocab(Device device, dim_t vocab_size) {
+  const dim_t k = 50;
+  const dim_t batch_size = 4;
+  StorageView input = rand_logits(batch_size, vocab_size, device);
+  StorageView values(input.dtype(), device);
+  StorageView indices(DataType::INT32, device);
+  const ops::TopK op(k);
+  BENCHMARK(op(input, values, indices), 500);
+}
+
+void benchmark_topp_mask(Device device, dim_t vocab_size) {
+  const dim_t batch_size = 4;
+  StorageView input = rand_logits(batch_size, vocab_size, device);
+  StorageView output(input.dtype(), device);
+  const ops::TopPMask op(0.9);
+  BENCHMARK(op(input, output), 500);
+}
+
 void benchmark_gemm(Device device, DataType dtype) {
   DataType output_dtype = dtype != DataType::FLOAT32 ? DataType::INT32 : dtype;
   StorageView a({32 * 32, 512}, dtype, device);
@@ -107,13 +132,22 @@ void benchmark_dequantize(Device device) {
   BENCHMARK(dequantize_op(x, input_scale, weight_scale, false, true, y, &bias), 10000);
 }
 
-void benchmark_conv1d(Device device) {
+void benchmark_conv1d(Device device, DataType dtype) {
   StorageView x({1, 768, 3000}, DataType::FLOAT32, device);
-  StorageView weight({768, 768, 3}, DataType::FLOAT32, device);
+  StorageView weight({768, 768, 3}, dtype, device);
   StorageView bias({768}, DataType::FLOAT32, device);
   StorageView y(device);
   const ops::Conv1D conv_op{2, 1};
-  BENCHMARK(conv_op(x, weight, bias, y), 100);
+  if (dtype == DataType::INT8) {
+    StorageView qscale({768}, 100.f, device);
+    const StorageView packed_weight = conv_op.pack_weight(weight, &qscale);
+    const StorageView* packed = packed_weight ? &packed_weight : nullptr;
+    BENCHMARK(conv_op(x, weight, bias, y, &qscale, packed), 100);
+  } else {
+    const StorageView packed_weight = conv_op.pack_weight(weight);
+    const StorageView* packed = packed_weight ? &packed_weight : nullptr;
+    BENCHMARK(conv_op(x, weight, bias, y, nullptr, packed), 100);
+  }
 }
 
 int main(int argc, char* argv[]) {
@@ -145,6 +179,14 @@ int main(int argc, char* argv[]) {
     benchmark_masked_softmax(device);
   else if (op == "topk")
     benchmark_topk(device);
+  else if (op == "topk_128k")
+    benchmark_topk_large_vocab(device, 128000);
+  else if (op == "topk_256k")
+    benchmark_topk_large_vocab(device, 256000);
+  else if (op == "topp_mask_128k")
+    benchmark_topp_mask(device, 128000);
+  else if (op == "topp_mask_256k")
+    benchmark_topp_mask(device, 256000);
   else if (op == "gemm")
     benchmark_gemm(device, dtype);
   else if (op == "quantize")
@@ -152,7 +194,7 @@ int main(int argc, char* argv[]) {
   else if (op == "dequantize")
     benchmark_dequantize(device);
   else if (op == "conv1d")
-    benchmark_conv1d(device);
+    benchmark_conv1d(device, dtype);
 
   return 0;
 }
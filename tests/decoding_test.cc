@@ -1,4 +1,11 @@
+#include <ctranslate2/ctc_decoding.h>
 #include <ctranslate2/decoding.h>
+#include <ctranslate2/grammar.h>
+#include <ctranslate2/sampling.h>
+
+#include <cmath>
+#include <map>
+#include <sstream>
 
 #include "test_utils.h"
 
@@ -14,3 +21,267 @@ TEST(DecodingTest, DisableTokens) {
 
   expect_storage_eq(input, expected);
 }
+
+TEST(DecodingTest, PromptLookupDrafter) {
+  PromptLookupDrafter drafter(2, {{7, 8, 9}, {}, {}});
+  const BestSampler sampler;
+  std::vector<std::vector<size_t>> draft_ids;
+  StorageView draft_probs(DataType::FLOAT32);
+
+  drafter.propose({{1, 7, 8}, {1, 2, 3, 4, 2, 3}, {1, 5}}, 0, 2, sampler, draft_ids, &draft_probs);
+
+  // Proposals without a match repeat the last token.
+  const std::vector<std::vector<size_t>> expected_ids = {{9, 1}, {4, 2}, {5, 5}};
+  EXPECT_EQ(draft_ids, expected_ids);
+  ASSERT_EQ(draft_probs.shape(), Shape({3, 2, 10}));
+  EXPECT_EQ(draft_probs.at<float>({0, 0, 9}), 1.f);
+  EXPECT_EQ(draft_probs.at<float>({1, 1, 2}), 1.f);
+  EXPECT_EQ(draft_probs.at<float>({1, 1, 3}), 0.f);
+
+  drafter.update_state({1});
+  drafter.propose({{1, 2, 3, 4, 2, 3, 4}}, 0, 4, sampler, draft_ids, nullptr);
+  EXPECT_EQ(draft_ids, (std::vector<std::vector<size_t>>{{2, 3, 4}}));
+}
+
+TEST(DecodingTest, PromptLookupDrafterSelectMerge) {
+  PromptLookupDrafter drafter(2, {{7, 8, 9}, {}, {3, 6}});
+  const BestSampler sampler;
+  std::vector<std::vector<size_t>> draft_ids;
+
+  auto selected = drafter.select({2, 0});
+  drafter.update_state({1});
+  drafter.merge(*selected);
+
+  drafter.propose({{1, 2}, {1, 3}, {1, 7, 8}}, 0, 1, sampler, draft_ids, nullptr);
+  EXPECT_EQ(draft_ids, (std::vector<std::vector<size_t>>{{2}, {6}, {9}}));
+}
+
+TEST(DecodingTest, RegexAutomaton) {
+  const RegexAutomaton automaton(R"(-?[0-9]+(\.[0-9]{1,2})?|(?:yes|no)!*)");
+  EXPECT_TRUE(automaton.matches("42"));
+  EXPECT_TRUE(automaton.matches("-3.14"));
+  EXPECT_TRUE(automaton.matches("yes!!"));
+  EXPECT_TRUE(automaton.matches("no"));
+  EXPECT_FALSE(automaton.matches(""));
+  EXPECT_FALSE(automaton.matches("3.141"));
+  EXPECT_FALSE(automaton.matches("yesno"));
+  EXPECT_THROW(RegexAutomaton("(a"), std::invalid_argument);
+  EXPECT_THROW(RegexAutomaton("a\\b"), std::invalid_argument);
+}
+
+TEST(DecodingTest, JsonSchemaToRegex) {
+  const std::string schema = R"({
+    "type": "object",
+    "properties": {
+      "name": {"type": "string", "maxLength": 8},
+      "age": {"type": "integer"},
+      "tags": {"type": "array", "items": {"enum": ["a", "b"]}, "maxItems": 2}
+    },
+    "required": ["name"]
+  })";
+
+  const RegexAutomaton automaton(json_schema_to_regex(schema));
+  EXPECT_TRUE(automaton.matches(R"({"name": "Ada"})"));
+  EXPECT_TRUE(automaton.matches(R"({"name":"Ada","age":36,"tags":["a", "b"]})"));
+  EXPECT_TRUE(automaton.matches(R"({"name": "Ada", "tags": []})"));
+  EXPECT_FALSE(automaton.matches(R"({"age": 36})"));
+  EXPECT_FALSE(automaton.matches(R"({"age": 36, "name": "Ada"})"));
+  EXPECT_FALSE(automaton.matches(R"({"name": "Ada Lovelace"})"));
+  EXPECT_FALSE(automaton.matches(R"({"name": "Ada", "tags": ["a", "b", "a"]})"));
+}
+
+TEST(DecodingTest, ConstrainedDecoding) {
+  // "\xe2\x96\x81" is the SentencePiece whitespace.
+  const Vocabulary vocabulary({"<unk>", "<s>", "</s>", "\xe2\x96\x81yes", "\xe2\x96\x81no",
+                               "y", "es", "no", "!", "<0x21>"});
+  const auto tokens_bytes = get_tokens_bytes(vocabulary);
+  EXPECT_EQ(tokens_bytes[1], "");
+  EXPECT_EQ(tokens_bytes[3], " yes");
+  EXPECT_EQ(tokens_bytes[9], "!");
+
+  GrammarCache cache(std::make_shared<Vocabulary>(vocabulary));
+  const auto automaton = cache.get("(?:yes|no)!?");
+  EXPECT_EQ(cache.get("(?:yes|no)!?"), automaton);
+  EXPECT_EQ(cache.size(), 1);
+
+  ConstrainedDecoding processor(automaton, {2});
+  const float disabled = std::numeric_limits<float>::lowest();
+  const dim_t vocabulary_size = vocabulary.size();
+
+  // Batch 0 starts the generation, batch 1 generated "y" and batch 2 generated "no".
+  StorageView logits({3, vocabulary_size}, 0.f);
+  const StorageView sequences({3, 2}, std::vector<int32_t>{1, 1, 1, 5, 1, 7});
+  const std::vector<std::vector<size_t>> prefix = {{1, 1}, {1}, {1}};
+  DisableTokens disable_tokens(logits);
+  processor.apply(2, logits, disable_tokens, sequences, {0, 1, 2}, &prefix);
+
+  const std::vector<std::vector<dim_t>> expected_allowed = {{5, 7}, {6}, {2, 8, 9}};
+  for (dim_t b = 0; b < 3; ++b) {
+    for (dim_t i = 0; i < vocabulary_size; ++i) {
+      const bool allowed = std::count(expected_allowed[b].begin(), expected_allowed[b].end(), i);
+      EXPECT_EQ(logits.at<float>({b, i}), allowed ? 0.f : disabled) << "batch " << b << ", token " << i;
+    }
+  }
+}
+
+TEST(DecodingTest, ConstrainedDecodingReorderHypotheses) {
+  const Vocabulary vocabulary({"<unk>", "<s>", "</s>", "\xe2\x96\x81yes", "\xe2\x96\x81no",
+                               "y", "es", "no", "!", "<0x21>"});
+  GrammarCache cache(std::make_shared<Vocabulary>(vocabulary));
+  ConstrainedDecoding processor(cache.get("(?:yes|no)!?"), {2});
+  const float disabled = std::numeric_limits<float>::lowest();
+  const dim_t vocabulary_size = vocabulary.size();
+
+  const auto apply = [&](dim_t step, const StorageView& sequences) {
+    StorageView logits({sequences ? sequences.dim(0) : 2, vocabulary_size}, 0.f);
+    DisableTokens disable_tokens(logits);
+    processor.apply(step, logits, disable_tokens, sequences, {0, 1}, nullptr);
+    return logits;
+  };
+
+  apply(0, StorageView(DataType::INT32));
+  apply(1, StorageView({2, 1}, std::vector<int32_t>{5, 7}));
+
+  // The hypotheses are swapped: "no" is continued by "!" and "y" by "es".
+  processor.update_state({1, 0});
+  const StorageView logits = apply(2, StorageView({2, 2}, std::vector<int32_t>{7, 8, 5, 6}));
+
+  const std::vector<std::vector<dim_t>> expected_allowed = {{2}, {2, 8, 9}};
+  for (dim_t b = 0; b < 2; ++b) {
+    for (dim_t i = 0; i < vocabulary_size; ++i) {
+      const bool allowed = std::count(expected_allowed[b].begin(), expected_allowed[b].end(), i);
+      EXPECT_EQ(logits.at<float>({b, i}), allowed ? 0.f : disabled) << "batch " << b << ", token " << i;
+    }
+  }
+}
+
+static StorageView log_probs_from_probs(Shape shape, std::vector<float> probs) {
+  for (auto& prob : probs)
+    prob = std::log(prob);
+  return StorageView(std::move(shape), std::move(probs));
+}
+
+TEST(DecodingTest, CTCGreedySearch) {
+  const Vocabulary vocabulary({"<pad>", "a", "b"});
+  const StorageView log_probs = log_probs_from_probs({2, 5, 3}, {
+      0.2, 0.7, 0.1,
+      0.1, 0.6, 0.3,
+      0.8, 0.1, 0.1,
+      0.3, 0.5, 0.2,
+      0.1, 0.2, 0.7,
+
+      0.1, 0.2, 0.7,
+      0.1, 0.1, 0.8,
+      0.2, 0.1, 0.7,
+      0.6, 0.2, 0.2,
+      0.9, 0.05, 0.05,
+    });
+
+  const auto results = ctc_decode(log_probs, CTCDecodingOptions(), &vocabulary);
+  ASSERT_EQ(results.size(), 2);
+  EXPECT_EQ(results[0].sequences_ids[0], (std::vector<size_t>{1, 1, 2}));
+  EXPECT_EQ(results[0].sequences[0], (std::vector<std::string>{"a", "a", "b"}));
+  EXPECT_NEAR(results[0].scores[0], std::log(0.7 * 0.6 * 0.8 * 0.5 * 0.7), 1e-5);
+  EXPECT_EQ(results[1].sequences_ids[0], (std::vector<size_t>{2}));
+}
+
+TEST(DecodingTest, CTCBeamSearch) {
+  // The most likely alignment is blank-blank, but "a" has a higher total probability.
+  const StorageView log_probs = log_probs_from_probs({1, 3, 3}, {
+      0.40, 0.35, 0.25,
+      0.40, 0.35, 0.25,
+      0.50, 0.30, 0.20,
+    });
+
+  // Reference probabilities of all label sequences.
+  std::map<std::vector<size_t>, double> reference;
+  for (size_t i = 0; i < 27; ++i) {
+    const size_t path[3] = {i / 9, (i / 3) % 3, i % 3};
+    std::vector<size_t> labels;
+    double prob = 1;
+    for (size_t t = 0; t < 3; ++t) {
+      prob *= std::exp(log_probs.at<float>({0, dim_t(t), dim_t(path[t])}));
+      if (path[t] != 0 && (t == 0 || path[t] != path[t - 1]))
+        labels.emplace_back(path[t]);
+    }
+    reference[labels] += prob;
+  }
+
+  CTCDecodingOptions options;
+  options.beam_size = 27;
+  options.num_hypotheses = 3;
+  options.min_token_log_prob = std::numeric_limits<float>::lowest();
+  const auto result = ctc_decode(log_probs, options)[0];
+
+  ASSERT_EQ(result.sequences_ids.size(), 3);
+  EXPECT_EQ(result.sequences_ids[0], std::vector<size_t>{1});
+  for (size_t i = 0; i < 3; ++i) {
+    EXPECT_NEAR(result.scores[i], std::log(reference.at(result.sequences_ids[i])), 1e-5);
+    if (i > 0) {
+      EXPECT_GE(result.scores[i - 1], result.scores[i]);
+    }
+  }
+}
+
+static const char* test_arpa = R"(
+\data\
+ngram 1=5
+ngram 2=3
+
+\1-grams:
+-1.0 <s> -0.5
+-0.5 </s>
+-0.3 a -0.2
+-0.7 b -0.1
+-2.0 <unk>
+
+\2-grams:
+-0.1 <s> b
+-0.2 b </s>
+-1.5 a b
+
+\end\
+)";
+
+TEST(DecodingTest, NGramLanguageModel) {
+  std::istringstream in(test_arpa);
+  const NGramLanguageModel lm(in);
+  EXPECT_EQ(lm.order(), 2);
+
+  const float ln10 = std::log(10.f);
+  const size_t a = lm.to_id("a");
+  const size_t b = lm.to_id("b");
+  const size_t bos = lm.bos_id();
+  EXPECT_EQ(lm.to_id("c"), lm.to_id("<unk>"));
+
+  const std::vector<size_t> context = {a, bos};
+  EXPECT_NEAR(lm.score(context.data() + 1, 1, b), -0.1 * ln10, 1e-5);
+  // <s> a is not a bigram: backoff(<s>) + P(a).
+  EXPECT_NEAR(lm.score(context.data() + 1, 1, a), (-0.5 - 0.3) * ln10, 1e-5);
+  // Only the last word of the context is used.
+  EXPECT_NEAR(lm.score(context.data(), 2, a), (-0.5 - 0.3) * ln10, 1e-5);
+  EXPECT_NEAR(lm.score(context.data(), 1, b), -1.5 * ln10, 1e-5);
+  EXPECT_NEAR(lm.score(context.data(), 0, lm.to_id("c")), -2.0 * ln10, 1e-5);
+}
+
+TEST(DecodingTest, CTCBeamSearchWithLanguageModel) {
+  const Vocabulary vocabulary({"<pad>", "a", "b"});
+  const StorageView log_probs = log_probs_from_probs({1, 2, 3}, {
+      0.1, 0.5, 0.4,
+      0.9, 0.05, 0.05,
+    });
+
+  CTCDecodingOptions options;
+  options.beam_size = 4;
+  EXPECT_EQ(ctc_decode(log_probs, options, &vocabulary)[0].sequences[0],
+            std::vector<std::string>{"a"});
+
+  std::istringstream in(test_arpa);
+  options.language_model = std::make_shared<NGramLanguageModel>(in);
+  options.lm_weight = 1;
+  EXPECT_EQ(ctc_decode(log_probs, options, &vocabulary)[0].sequences[0],
+            std::vector<std::string>{"b"});
+
+  // A language model requires the vocabulary to map the tokens.
+  EXPECT_THROW(ctc_decode(log_probs, options), std::invalid_argument);
+}
@@ -1,6 +1,9 @@
 #include "test_utils.h"
 #include "ctranslate2/layers/layers.h"
+#include "ctranslate2/lora.h"
+#include "ctranslate2/models/model.h"
 #include "ctranslate2/padder.h"
+#include "lru_cache.h"
 
 class LayerDeviceFPTest : public ::testing::TestWithParam<FloatType> {
 };
@@ -188,6 +191,52 @@ TEST_P(LayerDeviceFPTest, RotaryEmbedding) {
     rotary_embeddings.apply(x, 2);
     expect_storage_eq(x.to_float32(), permute(expected), error);
   }
+
+  if (layers::RotaryEmbeddings::support_split_heads(input.to(dtype))) {
+    // The heads are split and only the first 2 heads are rotated.
+    StorageView x(device);
+    ops::Transpose({0, 2, 1, 3})(input, x);
+
+    layers::RotaryEmbeddings rotary_embeddings;
+    StorageView y(dtype, device);
+    rotary_embeddings.apply_and_split_heads(x.to(dtype), 2, y, 2);
+
+    const std::vector<float> expected_values = expected.to_vector<float>();
+    std::vector<float> values = input.to_vector<float>();
+    for (dim_t b = 0; b < 2; ++b) {
+      const dim_t offset = b * 48;
+      std::copy(expected_values.begin() + offset,
+                expected_values.begin() + offset + 24,
+                values.begin() + offset);
+    }
+
+    expect_storage_eq(y.to_float32(), StorageView({2, 4, 2, 6}, values, device), error);
+  }
+}
+
+TEST(LayerTest, RotaryEmbeddingSharedTables) {
+  const dim_t time = 3;
+  const dim_t offset = 37;
+  StorageView input({1, 2, time, 8});
+  for (dim_t i = 0; i < input.size(); ++i)
+    input.at<float>(i) = std::sin(float(i));
+
+  StorageView expected = input;
+  layers::RotaryEmbeddings(0, true).apply(expected, offset);
+
+  // Both layers use the same tables which are grown by the first layer.
+  layers::RotaryEmbeddings first(0, true, layers::RotaryScalingType::None, 1, 10000, 4);
+  layers::RotaryEmbeddings second(0, true, layers::RotaryScalingType::None, 1, 10000, 4);
+
+  StorageView x = input;
+  first.apply(x, 0);
+  x = input;
+  first.apply(x, offset);
+  expect_storage_eq(x, expected, 1e-5);
+
+  x = input;
+  second.apply(x, offset);
+  expect_storage_eq(x, expected, 1e-5);
 }
 
 TEST(LayerTest, Padder) {
@@ -258,6 +307,204 @@ TEST(LayerTest, PositionEncoderNoSharedState) {
 }
 
 
+TEST(LayerTest, LruCache) {
+  std::vector<int> evicted;
+  LruCache<int, std::string, std::hash<int>> cache(
+    /*max_size=*/5,
+    [](const int&, const std::string& value) { return value.size(); },
+    [&evicted](const int& key, std::string&) { evicted.push_back(key); });
+
+  EXPECT_TRUE(cache.put(1, "ab"));
+  EXPECT_TRUE(cache.put(2, "cd"));
+  EXPECT_FALSE(cache.put(1, "xyz"));
+  EXPECT_EQ(*cache.get(1), "ab");
+  EXPECT_EQ(cache.get(3), nullptr);
+  EXPECT_EQ(cache.stats().size, 4);
+
+  // The least recently used entry 2 is evicted to make room for 3.
+  cache.put(3, "efg");
+  EXPECT_EQ(evicted, std::vector<int>{2});
+  EXPECT_FALSE(cache.contains(2));
+  EXPECT_TRUE(cache.contains(1));
+  EXPECT_TRUE(cache.contains(3));
+
+  // An erased entry is not reported as evicted.
+  EXPECT_TRUE(cache.erase(1));
+  EXPECT_FALSE(cache.erase(1));
+  cache.set_max_size(2);
+  EXPECT_EQ(evicted, (std::vector<int>{2, 3}));
+
+  const auto& stats = cache.stats();
+  EXPECT_EQ(stats.num_lookups, 2);
+  EXPECT_EQ(stats.num_hits, 1);
+  EXPECT_EQ(stats.num_evictions, 2);
+  EXPECT_EQ(stats.num_entries, 0);
+  EXPECT_EQ(stats.size, 0);
+}
+
+TEST(LayerTest, DecoderStateCache) {
+  // Each state has the size of 4 floats.
+  const auto make_state = [](float value) {
+    return layers::DecoderState{{"self_keys_0", StorageView({1, 4}, value)}};
+  };
+
+  layers::DecoderStateCache cache;
+  cache.save({1, 2, 3}, make_state(1));
+  cache.save({1, 2, 4, 5}, make_state(2));
+  cache.save({1, 2}, make_state(3));
+
+  auto match = cache.lookup({1, 2, 4, 5, 6}, false);
+  ASSERT_TRUE(match.state);
+  EXPECT_EQ(match.length, 4);
+  EXPECT_EQ(match.state_length, 4);
+  EXPECT_EQ(match.state->at("self_keys_0").at<float>({0, 0}), 2.f);
+
+  match = cache.lookup({1, 2, 9}, false);
+  ASSERT_TRUE(match.state);
+  EXPECT_EQ(match.length, 2);
+  EXPECT_EQ(match.state->at("self_keys_0").at<float>({0, 0}), 3.f);
+
+  // Truncate a longer state.
+  match = cache.lookup({1, 2, 4, 7}, true);
+  ASSERT_TRUE(match.state);
+  EXPECT_EQ(match.length, 3);
+  EXPECT_EQ(match.state_length, 4);
+
+  match = cache.lookup({7}, true);
+  EXPECT_FALSE(match.state);
+  EXPECT_EQ(match.length, 0);
+
+  auto stats = cache.get_stats();
+  EXPECT_EQ(stats.num_lookups, 4);
+  EXPECT_EQ(stats.num_hits, 3);
+  EXPECT_EQ(stats.num_states, 3);
+  EXPECT_EQ(stats.size_in_bytes, 3 * 4 * sizeof (float));
+
+  // The least recently used state {1, 2, 3} is evicted first.
+  cache.set_max_size(2 * 4 * sizeof (float));
+  stats = cache.get_stats();
+  EXPECT_EQ(stats.num_states, 2);
+  EXPECT_EQ(stats.num_evictions, 1);
+  match = cache.lookup({1, 2, 3}, false);
+  EXPECT_EQ(match.length, 2);
+
+  cache.save({1, 8}, make_state(4));
+  match = cache.lookup({1, 2, 4, 5}, true);
+  EXPECT_EQ(match.length, 2);
+  EXPECT_EQ(match.state_length, 2);
+  match = cache.lookup({1, 8}, false);
+  EXPECT_EQ(match.length, 2);
+
+  cache.clear();
+  EXPECT_FALSE(cache.lookup({1, 8}, true).state);
+}
+
+TEST(LayerTest, LoraBatch) {
+  // Rank 1 adapters with 2 input and output features.
+  const auto adapter_1 = std::make_shared<LoraAdapter>(
+    std::unordered_map<std::string, StorageView>{
+      {"linear/lora_a", StorageView({1, 2}, std::vector<float>{1, 0})},
+      {"linear/lora_b", StorageView({2, 1}, std::vector<float>{1, 2})}});
+  const auto adapter_2 = std::make_shared<LoraAdapter>(
+    std::unordered_map<std::string, StorageView>{
+      {"linear/lora_a", StorageView({1, 2}, std::vector<float>{0, 1})},
+      {"linear/lora_b", StorageView({2, 1}, std::vector<float>{1, 1})}},
+    /*scale=*/2);
+
+  const StorageView input({4, 2}, std::vector<float>{1, 2, 3, 4, 5, 6, 7, 8});
+
+  {
+    // One row per batch entry.
+    const LoraBatch batch({adapter_1.get(), adapter_1.get(), nullptr, adapter_2.get()});
+    EXPECT_TRUE(batch.adapts("linear"));
+    EXPECT_FALSE(batch.adapts("other"));
+
+    StorageView output({4, 2}, 0.f);
+    batch.apply("linear", input, output);
+    expect_storage_eq(output, StorageView({4, 2}, std::vector<float>{1, 2, 3, 6, 0, 0, 16, 16}));
+  }
+
+  {
+    // Batch entries with different numbers of rows.
+    const LoraBatch batch({adapter_1.get(), adapter_2.get()}, {0, 1, 4});
+    StorageView output({4, 2}, 1.f);
+    batch.apply("linear", input, output);
+    expect_storage_eq(output, StorageView({4, 2}, std::vector<float>{2, 3, 9, 9, 13, 13, 17, 17}));
+  }
+
+  EXPECT_THROW(LoraAdapter({{"linear/lora_a", StorageView({1, 2}, 0.f)}}), std::invalid_argument);
+}
+
+TEST(LayerTest, LoraAdapterMergeLayers) {
+  const StorageView input({2, 2}, std::vector<float>{1, 2, 3, 4});
+  const StorageView linear_a({1, 2}, std::vector<float>{1, 0});
+  const StorageView linear_b({2, 1}, std::vector<float>{1, 2});
+  const StorageView noact_a({2, 2}, std::vector<float>{0, 1, 1, 1});
+  const StorageView noact_b({2, 2}, std::vector<float>{1, 0, 0, 2});
+
+  LoraAdapter adapter({
+      {"ffn/linear_0/lora_a", linear_a},
+      {"ffn/linear_0/lora_b", linear_b},
+      {"ffn/linear_0_noact/lora_a", noact_a},
+      {"ffn/linear_0_noact/lora_b", noact_b}});
+  adapter.merge_layers({"ffn/linear_0", "ffn/linear_0_noact"}, "ffn/linear_0_gated");
+  EXPECT_EQ(adapter.num_layers(), 1);
+  EXPECT_FALSE(adapter.has_layer("ffn/linear_0"));
+
+  // The merged output is the concatenation of the layer outputs:
+  // linear_0 = [[1, 2], [3, 6]] and linear_0_noact = [[2, 6], [4, 14]].
+  const LoraBatch batch({&adapter});
+  StorageView output({2, 4}, 0.f);
+  batch.apply("ffn/linear_0_gated", input, output);
+  expect_storage_eq(output, StorageView({2, 4}, std::vector<float>{1, 2, 2, 6, 3, 6, 4, 14}));
+
+  // The layers without adapter are not updated.
+  LoraAdapter noact_adapter({
+      {"ffn/linear_0_noact/lora_a", noact_a},
+      {"ffn/linear_0_noact/lora_b", noact_b}});
+  noact_adapter.merge_layers({"ffn/linear_0", "ffn/linear_0_noact"}, "ffn/linear_0_gated");
+  const LoraBatch noact_batch({&noact_adapter});
+  output = StorageView({2, 4}, 0.f);
+  noact_batch.apply("ffn/linear_0_gated", input, output);
+  expect_storage_eq(output, StorageView({2, 4}, std::vector<float>{0, 0, 2, 6, 0, 0, 4, 14}));
+}
+
+TEST(LayerTest, LoraAdapterModelLayers) {
+  const auto model = models::Model::load(default_model_dir());
+  const auto make_variables = [](const std::string& scope) {
+    return std::unordered_map<std::string, StorageView>{
+      {scope + "/lora_a", StorageView({1, 4}, 0.f)},
+      {scope + "/lora_b", StorageView({4, 1}, 0.f)}};
+  };
+
+  const LoraAdapter adapter(make_variables("decoder/layer_0/ffn/linear_0"), 1, model.get());
+  EXPECT_TRUE(adapter.has_layer("decoder/layer_0/ffn/linear_0"));
+  EXPECT_THROW(LoraAdapter(make_variables("decoder/layer_0/ffn/linear_9"), 1, model.get()),
+               std::invalid_argument);
+  EXPECT_THROW(LoraAdapter(make_variables("decoder/layer_0/ffn"), 1, model.get()),
+               std::invalid_argument);
+}
+
+TEST(LayerTest, LoraRegistry) {
+  const auto make_adapter = []() {
+    return std::make_shared<LoraAdapter>(std::unordered_map<std::string, StorageView>());
+  };
+
+  LoraRegistry registry(/*max_size=*/2);
+  EXPECT_TRUE(registry.load("a", make_adapter()).empty());
+  EXPECT_TRUE(registry.load("b", make_adapter()).empty());
+  registry.get("a");
+
+  // The least recently used adapter is unloaded first.
+  EXPECT_EQ(registry.load("c", make_adapter()), std::vector<std::string>{"b"});
+  EXPECT_EQ(registry.list(), (std::vector<std::string>{"c", "a"}));
+  EXPECT_THROW(registry.get("b"), std::invalid_argument);
+
+  EXPECT_TRUE(registry.unload("a"));
+  EXPECT_FALSE(registry.unload("a"));
+  EXPECT_EQ(registry.size(), 1);
+}
+
 INSTANTIATE_TEST_SUITE_P(CPU, LayerDeviceFPTest,
                          ::testing::Values(FloatType{Device::CPU, DataType::FLOAT32, 1e-5}),
                          fp_test_name);
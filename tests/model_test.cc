@@ -1,6 +1,8 @@
 #include <ctranslate2/models/sequence_to_sequence.h>
+#include <ctranslate2/models/whisper.h>
 
 #include <ctranslate2/decoding.h>
+#include <ctranslate2/lora.h>
 
 #include "test_utils.h"
 
@@ -96,6 +98,49 @@ TEST(ModelTest, EncoderDecoderNoLength) {
   EXPECT_EQ(output_wo_length, output_w_length);
 }
 
+TEST(ModelTest, DecodeEosAttention) {
+  auto model = models::Model::load(default_model_dir())->as_sequence_to_sequence();
+  auto& encoder_decoder = dynamic_cast<models::EncoderDecoderReplica&>(*model);
+  auto& encoder = encoder_decoder.encoder();
+  auto& decoder = encoder_decoder.decoder();
+
+  StorageView input_ids({1, 6}, std::vector<int32_t>{31, 10, 19, 13, 5, 7});
+  StorageView encoder_output;
+  encoder(input_ids, encoder_output);
+
+  const auto run = [&](size_t beam_size, bool include_eos_in_attention) {
+    layers::DecoderState state = decoder.initial_state();
+    state.emplace("memory", encoder_output);
+
+    DecodingOptions options;
+    options.beam_size = beam_size;
+    options.num_hypotheses = beam_size;
+    options.length_penalty = 1;
+    options.coverage_penalty = 0.2;
+    options.include_eos_in_hypotheses = false;
+    options.include_eos_in_attention = include_eos_in_attention;
+    options.return_scores = true;
+    options.return_attention = true;
+    return decode(decoder, state, {{1}}, {2}, options)[0];
+  };
+
+  for (const size_t beam_size : {1, 2}) {
+    const auto reference = run(beam_size, false);
+    const auto result = run(beam_size, true);
+
+    // The end of sequence step only adds one attention vector.
+    EXPECT_EQ(result.hypotheses, reference.hypotheses);
+    EXPECT_EQ(result.scores, reference.scores);
+    ASSERT_EQ(result.attention.size(), reference.attention.size());
+    for (size_t i = 0; i < result.attention.size(); ++i) {
+      ASSERT_EQ(result.attention[i].size(), reference.attention[i].size() + 1);
+      EXPECT_TRUE(std::equal(reference.attention[i].begin(),
+                             reference.attention[i].end(),
+                             result.attention[i].begin()));
+    }
+  }
+}
+
 TEST(ModelTest, DecoderIterativeSequence) {
   auto model = models::Model::load(default_model_dir())->as_sequence_to_sequence();
   auto& encoder_decoder = dynamic_cast<models::EncoderDecoderReplica&>(*model);
@@ -149,3 +194,272 @@ TEST(ModelTest, DecoderIterativeSequence) {
     expect_storage_eq(state_sequence[key], state_by_step[key], 1e-5);
   }
 }
+
+static void check_encoder_early_exit(const models::Model& encoder_model) {
+  auto model = encoder_model.as_sequence_to_sequence();
+  auto& encoder = dynamic_cast<models::EncoderDecoderReplica&>(*model).encoder();
+
+  const StorageView ids({3, 6}, std::vector<int32_t>{
+      31, 10, 19, 13, 5, 7,
+      12, 8, 4, 0, 0, 0,
+      9, 11, 14, 22, 0, 0});
+  const StorageView lengths({3}, std::vector<int32_t>{6, 3, 4});
+
+  StorageView expected;
+  encoder(ids, lengths, expected);
+
+  std::vector<dim_t> layers;
+  std::vector<std::vector<dim_t>> batches;
+  StorageView last_hidden_states;
+  StorageView last_lengths;
+
+  // The second example exits after the first layer.
+  encoder.forward_with_early_exit(
+    {ids}, lengths, {0},
+    [&](dim_t layer,
+        const StorageView& hidden_states,
+        const StorageView& batch_lengths,
+        const std::vector<dim_t>& batch_ids) {
+      EXPECT_EQ(hidden_states.dim(0), dim_t(batch_ids.size()));
+      layers.emplace_back(layer);
+      batches.emplace_back(batch_ids);
+      last_hidden_states = hidden_states;
+      last_lengths = batch_lengths;
+
+      std::vector<bool> should_exit(batch_ids.size());
+      for (size_t i = 0; i < batch_ids.size(); ++i)
+        should_exit[i] = batch_ids[i] == 1;
+      return should_exit;
+    });
+
+  ASSERT_EQ(layers.size(), 2);
+  EXPECT_EQ(layers[0], 0);
+  EXPECT_GT(layers[1], 0);
+  EXPECT_EQ(batches[0], (std::vector<dim_t>{0, 1, 2}));
+  EXPECT_EQ(batches[1], (std::vector<dim_t>{0, 2}));
+  expect_storage_eq(last_lengths, StorageView({2}, std::vector<int32_t>{6, 4}));
+
+  // The examples that did not exit have the same output as the full encoder.
+  const dim_t depth = expected.dim(2);
+  for (dim_t i = 0; i < 2; ++i) {
+    const dim_t b = batches[1][i];
+    const dim_t length = lengths.at<int32_t>(b);
+    for (dim_t t = 0; t < length; ++t) {
+      for (dim_t d = 0; d < depth; ++d)
+        EXPECT_NEAR(last_hidden_states.at<float>({i, t, d}), expected.at<float>({b, t, d}), 1e-5);
+    }
+  }
+
+  // When the longest example exits, the time dimension is reduced to the remaining examples.
+  batches.clear();
+  encoder.forward_with_early_exit(
+    {ids}, lengths, {0},
+    [&](dim_t,
+        const StorageView& hidden_states,
+        const StorageView&,
+        const std::vector<dim_t>& batch_ids) {
+      batches.emplace_back(batch_ids);
+      last_hidden_states = hidden_states;
+
+      std::vector<bool> should_exit(batch_ids.size());
+      for (size_t i = 0; i < batch_ids.size(); ++i)
+        should_exit[i] = batch_ids[i] == 0;
+      return should_exit;
+    });
+
+  ASSERT_EQ(batches.size(), 2);
+  EXPECT_EQ(batches[1], (std::vector<dim_t>{1, 2}));
+  ASSERT_EQ(last_hidden_states.dim(1), 4);
+  for (dim_t i = 0; i < 2; ++i) {
+    const dim_t b = batches[1][i];
+    const dim_t length = lengths.at<int32_t>(b);
+    for (dim_t t = 0; t < length; ++t) {
+      for (dim_t d = 0; d < depth; ++d)
+        EXPECT_NEAR(last_hidden_states.at<float>({i, t, d}), expected.at<float>({b, t, d}), 1e-5);
+    }
+  }
+}
+
+TEST(ModelTest, EncoderEarlyExit) {
+  check_encoder_early_exit(*models::Model::load(default_model_dir()));
+}
+
+TEST(ModelTest, EncoderEarlyExitRelativeBias) {
+  // The position bias depends on the time dimension, which changes when the batch is compacted.
+  const dim_t num_buckets = 32;
+  const dim_t num_heads = 8;
+  std::vector<float> bias(num_buckets * num_heads);
+  for (size_t i = 0; i < bias.size(); ++i)
+    bias[i] = std::sin(0.7f * i);
+
+  std::unordered_map<std::string, StorageView> variables;
+  for (dim_t l = 0; l < 6; ++l) {
+    const std::string scope = "encoder/layer_" + std::to_string(l) + "/self_attention";
+    variables.emplace(scope + "/relative_attention_bias",
+                      StorageView({num_buckets, num_heads}, bias));
+    variables.emplace(scope + "/relative_attention_max_distance", StorageView(int32_t(128)));
+  }
+
+  check_encoder_early_exit(*load_default_model_with_variables(variables));
+}
+
+TEST(ModelTest, DecoderLoraAdapter) {
+  // Decoding with an adapter should be equivalent to decoding with the LoRA update merged
+  // into the weights: W' = W + scale * B A.
+  const auto base_model = models::Model::load(default_model_dir());
+  const dim_t rank = 2;
+  const float scale = 0.5;
+
+  std::unordered_map<std::string, StorageView> lora_variables;
+  std::unordered_map<std::string, StorageView> merged_variables;
+  for (const std::string layer : {"decoder/layer_0", "decoder/layer_1"}) {
+    for (const std::string linear : {"self_attention/linear_0",
+                                     "self_attention/linear_1",
+                                     "ffn/linear_0",
+                                     "ffn/linear_1"}) {
+      const std::string scope = layer + "/" + linear;
+      const StorageView& weight = base_model->get_variable(scope + "/weight");
+      const dim_t out_features = weight.dim(0);
+      const dim_t in_features = weight.dim(1);
+
+      std::vector<float> a(rank * in_features);
+      std::vector<float> b(out_features * rank);
+      for (size_t i = 0; i < a.size(); ++i)
+        a[i] = 0.3f * std::sin(0.5f * i + scope.size());
+      for (size_t i = 0; i < b.size(); ++i)
+        b[i] = 0.3f * std::cos(0.3f * i);
+
+      std::vector<float> merged_weight = weight.to_vector<float>();
+      for (dim_t o = 0; o < out_features; ++o) {
+        for (dim_t i = 0; i < in_features; ++i) {
+          for (dim_t r = 0; r < rank; ++r)
+            merged_weight[o * in_features + i] += scale * b[o * rank + r] * a[r * in_features + i];
+        }
+      }
+
+      lora_variables.emplace(scope + "/lora_a", StorageView({rank, in_features}, a));
+      lora_variables.emplace(scope + "/lora_b", StorageView({out_features, rank}, b));
+      merged_variables.emplace(scope + "/weight",
+                               StorageView({out_features, in_features}, merged_weight));
+    }
+  }
+
+  const auto adapter = std::make_shared<const LoraAdapter>(lora_variables,
+                                                           scale,
+                                                           base_model.get());
+  const auto merged_model = load_default_model_with_variables(merged_variables);
+
+  // The batch mixes entries with and without the adapter.
+  const std::vector<std::shared_ptr<const LoraAdapter>> adapters = {adapter, nullptr, adapter};
+  const StorageView source_ids({3, 6}, std::vector<int32_t>{
+      31, 10, 19, 13, 5, 7,
+      12, 24, 6, 4, 0, 0,
+      8, 30, 17, 0, 0, 0});
+  const StorageView source_lengths({3}, std::vector<int32_t>{6, 4, 3});
+  const StorageView target_ids({3, 4}, std::vector<int32_t>{
+      1, 3, 11, 23,
+      1, 7, 0, 0,
+      1, 13, 5, 0});
+  const StorageView target_lengths({3}, std::vector<int32_t>{4, 2, 3});
+
+  DecodingOptions options;
+  options.beam_size = 2;
+  options.max_length = 20;
+  options.return_scores = true;
+
+  struct Outputs {
+    std::vector<DecodingResult> results;
+    StorageView logits;
+  };
+
+  const auto run = [&](const models::Model& model, bool use_adapters) {
+    auto replica = model.as_sequence_to_sequence();
+    auto& encoder_decoder = dynamic_cast<models::EncoderDecoderReplica&>(*replica);
+    auto& encoder = encoder_decoder.encoder();
+    auto& decoder = encoder_decoder.decoder();
+
+    StorageView encoder_output;
+    encoder(source_ids, source_lengths, encoder_output);
+
+    std::unique_ptr<ScopedLoraAdapters> scoped_adapters;
+    if (use_adapters)
+      scoped_adapters = std::make_unique<ScopedLoraAdapters>(adapters);
+
+    const auto make_state = [&]() {
+      layers::DecoderState state = decoder.initial_state();
+      state.emplace("memory", encoder_output);
+      state.emplace("memory_lengths", source_lengths);
+      if (use_adapters)
+        state.emplace("lora_ids", StorageView({3}, std::vector<int32_t>{0, -1, 2}));
+      return state;
+    };
+
+    Outputs outputs;
+    layers::DecoderState state = make_state();
+    outputs.results = decode(decoder, state, {{1}, {1}, {1}}, {2}, options);
+
+    state = make_state();
+    decoder(target_ids, target_lengths, state, outputs.logits);
+    return outputs;
+  };
+
+  const Outputs lora_outputs = run(*base_model, true);
+  const Outputs base_outputs = run(*base_model, false);
+  const Outputs merged_outputs = run(*merged_model, false);
+
+  const auto logits_vec = lora_outputs.logits.to_vector<float>();
+  const auto base_logits_vec = base_outputs.logits.to_vector<float>();
+  const auto merged_logits_vec = merged_outputs.logits.to_vector<float>();
+  const dim_t batch_stride = lora_outputs.logits.size() / 3;
+  const dim_t vocabulary_size = lora_outputs.logits.dim(-1);
+
+  for (dim_t b = 0; b < 3; ++b) {
+    const Outputs& expected = adapters[b] ? merged_outputs : base_outputs;
+    const auto& expected_logits_vec = adapters[b] ? merged_logits_vec : base_logits_vec;
+
+    EXPECT_EQ(lora_outputs.results[b].hypotheses, expected.results[b].hypotheses);
+    expect_vector_eq(lora_outputs.results[b].scores, expected.results[b].scores, 1e-4f);
+
+    // Only the positions within the target length are compared.
+    const dim_t length = target_lengths.at<int32_t>(b) * vocabulary_size;
+    expect_array_eq(logits_vec.data() + b * batch_stride,
+                    expected_logits_vec.data() + b * batch_stride,
+                    length,
+                    1e-4f);
+  }
+
+  // The adapter changes the output of the adapted entries.
+  EXPECT_NE(base_logits_vec, merged_logits_vec);
+}
+
+TEST(ModelTest, WhisperPadLogMelFeatures) {
+  const dim_t num_samples = 8000;
+  const float pi = std::acos(-1.f);
+  std::vector<float> samples(2 * num_samples, 0.f);
+  for (dim_t i = 0; i < num_samples; ++i)
+    samples[i] = std::sin(2 * pi * 1000 * i / 16000);
+
+  // Features of the tone followed by the same duration of silence.
+  const ops::MelSpectrogram mel_spectrogram(80);
+  StorageView expected;
+  mel_spectrogram(StorageView({1, 2 * num_samples}, samples), expected);
+
+  StorageView features;
+  samples.resize(num_samples);
+  mel_spectrogram(StorageView({1, num_samples}, samples), features);
+  features.squeeze(0);
+
+  const dim_t num_frames = features.dim(1);
+  const dim_t length = expected.dim(2);
+  const StorageView padded = models::pad_log_mel_features(features, length);
+  assert_vector_eq(padded.shape(), {80, length});
+
+  for (dim_t m = 0; m < 80; ++m) {
+    EXPECT_EQ(padded.at<float>({m, 0}), features.at<float>({m, 0}));
+    // Skip the frames overlapping the end of the tone.
+    for (dim_t t = num_frames + 3; t < length; ++t)
+      EXPECT_NEAR(padded.at<float>({m, t}), expected.at<float>({0, m, t}), 1e-3);
+  }
+
+  EXPECT_THROW(models::pad_log_mel_features(features, num_frames - 1), std::invalid_argument);
+}
@@ -1,7 +1,12 @@
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <set>
 #include "test_utils.h"
 #include "ctranslate2/layers/attention.h"
 #include "ctranslate2/ops/ops.h"
+#include "dtw.h"
 
 TEST(OpTest, Transpose1D) {
   StorageView x({4}, std::vector<float>{1, 2, 3, 4});
@@ -134,6 +139,204 @@ TEST(OpTest, MedianFilter) {
   expect_storage_eq(y, expected);
 }
 
+static std::vector<float> naive_ragged_attention(const std::vector<float>& queries,
+                                                 const std::vector<float>& keys,
+                                                 const std::vector<float>& values,
+                                                 const std::vector<dim_t>& queries_offsets,
+                                                 const std::vector<dim_t>& keys_offsets,
+                                                 dim_t num_heads,
+                                                 dim_t num_heads_kv,
+                                                 dim_t head_dim,
+                                                 float scale,
+                                                 bool is_causal) {
+  const dim_t depth = num_heads * head_dim;
+  const dim_t kv_depth = num_heads_kv * head_dim;
+  std::vector<float> output(queries.size(), 0.f);
+
+  for (size_t b = 0; b + 1 < queries_offsets.size(); ++b) {
+    const dim_t queries_length = queries_offsets[b + 1] - queries_offsets[b];
+    const dim_t keys_length = keys_offsets[b + 1] - keys_offsets[b];
+
+    for (dim_t h = 0; h < num_heads; ++h) {
+      const dim_t kv_h = h / (num_heads / num_heads_kv);
+
+      for (dim_t i = 0; i < queries_length; ++i) {
+        const float* q = queries.data() + (queries_offsets[b] + i) * depth + h * head_dim;
+        const dim_t length = is_causal ? i + 1 + keys_length - queries_length : keys_length;
+
+        std::vector<float> weights(length);
+        for (dim_t j = 0; j < length; ++j) {
+          const float* k = keys.data() + (keys_offsets[b] + j) * kv_depth + kv_h * head_dim;
+          for (dim_t d = 0; d < head_dim; ++d)
+            weights[j] += scale * q[d] * k[d];
+        }
+
+        const float max = *std::max_element(weights.begin(), weights.end());
+        float sum = 0;
+        for (auto& weight : weights) {
+          weight = std::exp(weight - max);
+          sum += weight;
+        }
+
+        float* o = output.data() + (queries_offsets[b] + i) * depth + h * head_dim;
+        for (dim_t j = 0; j < length; ++j) {
+          const float* v = values.data() + (keys_offsets[b] + j) * kv_depth + kv_h * head_dim;
+          for (dim_t d = 0; d < head_dim; ++d)
+            o[d] += weights[j] / sum * v[d];
+        }
+      }
+    }
+  }
+
+  return output;
+}
+
+TEST(OpTest, RaggedAttention) {
+  const dim_t head_dim = 4;
+  const std::vector<dim_t> queries_offsets = {0, 5, 7, 13};
+  const std::vector<dim_t> keys_offsets = {0, 3, 11, 17};
+
+  for (const dim_t num_heads_kv : {4, 2}) {
+    for (const bool is_causal : {false, true}) {
+      const dim_t num_heads = 4;
+      // The causal attention uses the same offsets for queries and keys.
+      const auto& kv_offsets = is_causal ? queries_offsets : keys_offsets;
+      const dim_t num_queries = queries_offsets.back();
+      const dim_t num_keys = kv_offsets.back();
+      const dim_t depth = num_heads * head_dim;
+      const dim_t kv_depth = num_heads_kv * head_dim;
+
+      std::vector<float> queries(num_queries * depth);
+      std::vector<float> keys(num_keys * kv_depth);
+      std::vector<float> values(num_keys * kv_depth);
+      for (size_t i = 0; i < queries.size(); ++i)
+        queries[i] = std::sin(float(i) * 0.37f);
+      for (size_t i = 0; i < keys.size(); ++i) {
+        keys[i] = std::cos(float(i) * 0.53f);
+        values[i] = std::sin(float(i) * 0.71f + 1.f);
+      }
+
+      const float scale = 0.5f;
+      const auto expected = naive_ragged_attention(queries, keys, values,
+                                                   queries_offsets, kv_offsets,
+                                                   num_heads, num_heads_kv, head_dim,
+                                                   scale, is_causal);
+
+      StorageView output;
+      ops::RaggedAttention(num_heads, scale, is_causal)(
+        StorageView({num_queries, depth}, queries),
+        StorageView({num_keys, kv_depth}, keys),
+        StorageView({num_keys, kv_depth}, values),
+        queries_offsets,
+        kv_offsets,
+        output);
+
+      expect_storage_eq(output, StorageView({num_queries, depth}, expected), 1e-5);
+    }
+  }
+}
+
+static std::vector<std::pair<dim_t, dim_t>> naive_negative_dtw(const std::vector<float>& x,
+                                                                dim_t n,
+                                                                dim_t m) {
+  const float inf = std::numeric_limits<float>::infinity();
+  std::vector<std::vector<float>> cost(n + 1, std::vector<float>(m + 1, inf));
+  std::vector<std::vector<int>> trace(n + 1, std::vector<int>(m + 1, -1));
+  cost[0][0] = 0;
+
+  for (dim_t j = 1; j <= m; ++j) {
+    for (dim_t i = 1; i <= n; ++i) {
+      const float c0 = cost[i - 1][j - 1];
+      const float c1 = cost[i - 1][j];
+      const float c2 = cost[i][j - 1];
+      const int t = (c0 < c1 && c0 < c2) ? 0 : (c1 < c0 && c1 < c2) ? 1 : 2;
+      cost[i][j] = -x[(i - 1) * m + (j - 1)] + (t == 0 ? c0 : t == 1 ? c1 : c2);
+      trace[i][j] = t;
+    }
+  }
+
+  std::vector<std::pair<dim_t, dim_t>> path;
+  dim_t i = n;
+  dim_t j = m;
+  while (i > 0 || j > 0) {
+    path.emplace_back(i - 1, j - 1);
+    const int t = i == 0 ? 2 : j == 0 ? 1 : trace[i][j];
+    if (t != 2)
+      --i;
+    if (t != 1)
+      --j;
+  }
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+TEST(OpTest, NegativeDTW) {
+  const std::vector<std::pair<dim_t, dim_t>> shapes = {{1, 1}, {3, 7}, {7, 3}, {12, 40}, {5, 5}};
+
+  std::vector<StorageView> matrices;
+  std::vector<std::vector<std::pair<dim_t, dim_t>>> expected;
+
+  for (const auto& [n, m] : shapes) {
+    std::vector<float> x(n * m);
+    for (size_t k = 0; k < x.size(); ++k)
+      x[k] = std::sin(float(k) * 0.91f + float(n));
+
+    expected.emplace_back(naive_negative_dtw(x, n, m));
+    matrices.emplace_back(StorageView({n, m}, x));
+
+    EXPECT_EQ(negative_dtw(matrices.back()), expected.back());
+  }
+
+  EXPECT_EQ(negative_dtw(matrices), expected);
+}
+
+TEST(OpTest, MelSpectrogramSilence) {
+  const dim_t num_samples = 1600;
+  StorageView audio({2, num_samples}, 0.f);
+  StorageView features;
+  const ops::MelSpectrogram mel_spectrogram(80);
+  mel_spectrogram(audio, features);
+
+  assert_vector_eq(features.shape(), {2, 80, num_samples / 160});
+  // log10(1e-10) = -10 is then scaled to (-10 + 4) / 4.
+  expect_storage_eq(features, StorageView(features.shape(), -1.5f));
+}
+
+TEST(OpTest, MelSpectrogramTone) {
+  const dim_t sampling_rate = 16000;
+  const dim_t num_samples = 8000;
+  const dim_t num_mels = 80;
+  const float frequency = 1000;
+  const float pi = std::acos(-1.f);
+
+  std::vector<float> samples(num_samples);
+  for (dim_t i = 0; i < num_samples; ++i)
+    samples[i] = std::sin(2 * pi * frequency * i / sampling_rate);
+
+  StorageView features;
+  const ops::MelSpectrogram mel_spectrogram(num_mels);
+  mel_spectrogram(StorageView({1, num_samples}, samples), features);
+
+  const dim_t num_frames = features.dim(2);
+  ASSERT_EQ(num_frames, num_samples / 160);
+
+  // The Slaney scale is linear below 1 kHz with 3 mels per 200 Hz, and 1 kHz is the center
+  // of the filter 26 when 80 filters cover [0, 8 kHz].
+  const dim_t t = num_frames / 2;
+  dim_t best_mel = 0;
+  for (dim_t m = 1; m < num_mels; ++m) {
+    if (features.at<float>({0, m, t}) > features.at<float>({0, best_mel, t}))
+      best_mel = m;
+  }
+  EXPECT_EQ(best_mel, 26);
+
+  // The values are clamped to 8 below the maximum, which is 2 after scaling.
+  const auto values = features.to_vector<float>();
+  const float max_value = *std::max_element(values.begin(), values.end());
+  const float min_value = *std::min_element(values.begin(), values.end());
+  EXPECT_NEAR(max_value - min_value, 2.f, 1e-5);
+}
+
 class OpDeviceTest : public ::testing::TestWithParam<Device> {
 };
 
@@ -592,6 +795,83 @@ TEST_P(OpDeviceTest, TopKChangeK) {
   expect_storage_eq(indices_k3, expected_indices_k3);
 }
 
+TEST_P(OpDeviceTest, TopKLargeDepth) {
+  const Device device = GetParam();
+  const dim_t batch_size = 2;
+  const dim_t depth = 5000;
+  const dim_t k = 5;
+
+  std::vector<float> x(batch_size * depth);
+  for (dim_t i = 0; i < batch_size; ++i) {
+    for (dim_t j = 0; j < depth; ++j)
+      x[i * depth + j] = float((j * 7919 + i * 13) % depth) / depth - 0.5f;
+  }
+
+  std::vector<float> expected_values;
+  std::vector<int32_t> expected_indices;
+  for (dim_t i = 0; i < batch_size; ++i) {
+    std::vector<int32_t> ids(depth);
+    std::iota(ids.begin(), ids.end(), 0);
+    const float* row = x.data() + i * depth;
+    std::sort(ids.begin(), ids.end(), [row](int32_t a, int32_t b) { return row[a] > row[b]; });
+    for (dim_t j = 0; j < k; ++j) {
+      expected_indices.push_back(ids[j]);
+      expected_values.push_back(row[ids[j]]);
+    }
+  }
+
+  StorageView values(DataType::FLOAT32, device);
+  StorageView indices(DataType::INT32, device);
+  const ops::TopK op(k);
+  op(StorageView({batch_size, depth}, x, device), values, indices);
+  expect_storage_eq(values, StorageView({batch_size, k}, expected_values, device));
+  expect_storage_eq(indices, StorageView({batch_size, k}, expected_indices, device));
+}
+
+TEST_P(OpDeviceTest, TopKMaskedScores) {
+  // Fewer finite scores than k: the -inf entries should complete the top K. The depth is
+  // large enough to use the block selection on CPU and the finite scores are in different
+  // blocks. The second batch has no finite scores at all.
+  const Device device = GetParam();
+  constexpr float inf = std::numeric_limits<float>::infinity();
+  const dim_t depth = 4096;
+  const dim_t k = 8;
+
+  std::vector<float> x(2 * depth, -inf);
+  x[3000] = 0.5f;
+  x[3] = 2.f;
+  x[1500] = 1.f;
+
+  StorageView values(DataType::FLOAT32, device);
+  StorageView indices(DataType::INT32, device);
+  const ops::TopK op(k);
+  op(StorageView({2, depth}, x, device), values, indices);
+
+  const auto values_vec = values.to_vector<float>();
+  const auto indices_vec = indices.to_vector<int32_t>();
+  ASSERT_EQ(values_vec.size(), 2 * k);
+  EXPECT_EQ(values_vec[0], 2.f);
+  EXPECT_EQ(values_vec[1], 1.f);
+  EXPECT_EQ(values_vec[2], 0.5f);
+  EXPECT_EQ(indices_vec[0], 3);
+  EXPECT_EQ(indices_vec[1], 1500);
+  EXPECT_EQ(indices_vec[2], 3000);
+  for (dim_t b = 0; b < 2; ++b) {
+    const dim_t num_finite = (b == 0 ? 3 : 0);
+    std::set<int32_t> unique_indices;
+    for (dim_t j = 0; j < k; ++j) {
+      const int32_t index = indices_vec[b * k + j];
+      EXPECT_GE(index, 0);
+      EXPECT_LT(index, depth);
+      unique_indices.emplace(index);
+      if (j >= num_finite) {
+        EXPECT_EQ(values_vec[b * k + j], -inf);
+      }
+    }
+    EXPECT_EQ(unique_indices.size(), k);
+  }
+}
+
 TEST_P(OpDeviceFPTest, TopPMask) {
   const Device device = GetParam().device;
   const DataType dtype = GetParam().dtype;
@@ -759,6 +1039,60 @@ TEST_P(OpDeviceFPTest, RMSNorm) {
   expect_storage_eq(y.to_float32(), expected, error * 10);
 }
 
+TEST_P(OpDeviceFPTest, ResidualLayerNorm) {
+  const Device device = GetParam().device;
+  const DataType dtype = GetParam().dtype;
+  const float error = GetParam().error;
+  StorageView gamma({5}, std::vector<float>{0.2, 2.1, 1.1, -0.6, 0.7}, device);
+  StorageView beta({5}, std::vector<float>{-6.6, -5.7, 0.01, 2.0, 0}, device);
+  StorageView x({2, 5}, std::vector<float>{
+      -1.2, 2.0, 0.2, -2.1, -1.0,
+      3.6, 2.3, -0.8, -2.6, 0.0}, device);
+  StorageView residual({2, 5}, 1.f, device);
+  StorageView expected_sum({2, 5}, std::vector<float>{
+      -0.2, 3.0, 1.2, -1.1, 0.0,
+      4.6, 3.3, 0.2, -1.6, 1.0}, device);
+  StorageView expected({2, 5}, std::vector<float>{
+      -6.710264, -2.107929, 0.492053, 2.712477, -0.286970,
+      -6.319339, -3.988876, -0.637330, 2.841982, -0.158437}, device);
+  StorageView y(dtype, device);
+  StorageView sum(dtype, device);
+  const StorageView residual_t = residual.to(dtype);
+  const StorageView beta_t = beta.to(dtype);
+  ops::ResidualNorm()(&beta_t, gamma.to(dtype), x.to(dtype), &residual_t, y, &sum);
+  expect_storage_eq(sum.to_float32(), expected_sum, error);
+  expect_storage_eq(y.to_float32(), expected, error);
+}
+
+TEST_P(OpDeviceFPTest, ResidualRMSNormQuantize) {
+  const Device device = GetParam().device;
+  const DataType dtype = GetParam().dtype;
+  if (dtype != DataType::FLOAT32)
+    GTEST_SKIP() << "INT8 quantization expects a float32 input";
+  StorageView gamma({5}, std::vector<float>{0.2, 2.1, 1.1, -0.6, 0.7}, device);
+  StorageView x({2, 5}, std::vector<float>{
+      -0.2, 3.0, 1.2, -1.1, 0.0,
+      4.6, 3.3, 0.2, -1.6, 1.0}, device);
+  StorageView residual({2, 5}, std::vector<float>{
+      0.5, -1.0, 0.3, 0.0, 2.2,
+      -0.4, 0.1, 0.9, 1.6, -3.0}, device);
+
+  StorageView sum(dtype, device);
+  StorageView normalized(dtype, device);
+  StorageView expected_qy(DataType::INT8, device);
+  StorageView expected_scale(dtype, device);
+  const ops::Quantize quantize_op(ops::Quantize::ScaleType::GLOBAL, false, true);
+  ops::Add()(x, residual, sum);
+  ops::RMSNorm()(gamma, sum, normalized);
+  quantize_op(normalized, expected_qy, expected_scale);
+
+  StorageView qy(DataType::INT8, device);
+  StorageView scale(dtype, device);
+  ops::ResidualNorm(1e-6)(nullptr, gamma, x, &residual, quantize_op, qy, scale);
+  expect_storage_eq(qy, expected_qy);
+  expect_storage_eq(scale, expected_scale, 1e-4);
+}
+
 TEST_P(OpDeviceTest, QuantizeINT8) {
   Device device = GetParam();
   StorageView a({2, 4}, std::vector<float>{-10, -3, 5, 2, 5, 21, -3, 0}, device);
@@ -905,6 +1239,18 @@ TEST_P(OpDeviceFPTest, Swish) {
   expect_storage_eq(output.to_float32(), expected, error);
 }
 
+TEST_P(OpDeviceFPTest, GatedSwish) {
+  const Device device = GetParam().device;
+  const DataType dtype = GetParam().dtype;
+  const float error = GetParam().error;
+  StorageView input({2, 4}, std::vector<float>{0.2, -1.3, 2, 3, -1.3, 0.2, -1, 0.5}, device);
+  StorageView expected({2, 2}, std::vector<float>{0.21993358, -0.83524356,
+                                                  0.27841452, 0.05498340}, device);
+  StorageView output(dtype, device);
+  ops::GatedActivation(ops::ActivationType::Swish)(input.to(dtype), output);
+  expect_storage_eq(output.to_float32(), expected, error);
+}
+
 TEST_P(OpDeviceFPTest, Tanh) {
   const Device device = GetParam().device;
   const DataType dtype = GetParam().dtype;
@@ -1193,6 +1539,116 @@ TEST_P(OpDeviceFPTest, Conv1DGroup) {
     expect_storage_eq(output.to_float32(), expected, error);
 }
 
+// Reference convolution computed with nested loops.
+static StorageView naive_conv1d(const StorageView& input,
+                                const StorageView& weight,
+                                const StorageView& bias,
+                                dim_t stride,
+                                dim_t padding,
+                                dim_t groups) {
+  const dim_t batch_size = input.dim(0);
+  const dim_t input_length = input.dim(2);
+  const dim_t out_channels = weight.dim(0);
+  const dim_t group_in_channels = weight.dim(1);
+  const dim_t kernel_size = weight.dim(2);
+  const dim_t group_out_channels = out_channels / groups;
+  const dim_t output_length = (input_length + 2 * padding - kernel_size) / stride + 1;
+
+  std::vector<float> output(batch_size * out_channels * output_length);
+  for (dim_t b = 0; b < batch_size; ++b) {
+    for (dim_t oc = 0; oc < out_channels; ++oc) {
+      const dim_t g = oc / group_out_channels;
+      for (dim_t t = 0; t < output_length; ++t) {
+        float sum = bias.at<float>(oc);
+        for (dim_t i = 0; i < group_in_channels; ++i) {
+          const dim_t ic = g * group_in_channels + i;
+          for (dim_t k = 0; k < kernel_size; ++k) {
+            const dim_t x = t * stride + k - padding;
+            if (x >= 0 && x < input_length)
+              sum += (weight.at<float>({oc, i, k})
+                      * input.at<float>({b, ic, x}));
+          }
+        }
+        output[(b * out_channels + oc) * output_length + t] = sum;
+      }
+    }
+  }
+
+  return StorageView({batch_size, out_channels, output_length}, output);
+}
+
+TEST(OpTest, Conv1DQuantizedWithActivation) {
+#ifdef CT2_WITH_DNNL
+  GTEST_SKIP() << "Quantized convolution is not implemented for DNNL.";
+#endif
+  // The int8 weights run the direct convolution kernel (with the bias and activation fused)
+  // or the quantized GEMM depending on the ISA and the GEMM backend.
+  const dim_t batch_size = 2;
+  const dim_t in_channels = 6;
+  const dim_t out_channels = 22;
+  const dim_t input_length = 71;
+
+  std::vector<float> input_values(batch_size * in_channels * input_length);
+  for (size_t i = 0; i < input_values.size(); ++i)
+    input_values[i] = std::sin(0.1f * i);
+
+  const StorageView input({batch_size, in_channels, input_length}, input_values);
+  const ops::ActivationType activation_type = ops::ActivationType::GELU;
+
+  // The larger kernels and paddings cover the tap offsets and the edges of the stride phases.
+  const std::vector<std::pair<dim_t, dim_t>> kernel_size_and_padding = {
+    {3, 1}, {5, 2}, {7, 0}, {7, 3}};
+
+  for (const auto& [kernel_size, padding] : kernel_size_and_padding) {
+    for (const dim_t groups : {1, 2}) {
+      for (const dim_t stride : {1, 2}) {
+        const dim_t group_in_channels = in_channels / groups;
+
+        std::vector<int8_t> qweight_values(out_channels * group_in_channels * kernel_size);
+        std::vector<float> weight_values(qweight_values.size());
+        std::vector<float> qscale_values(out_channels);
+        std::vector<float> bias_values(out_channels);
+        for (dim_t oc = 0; oc < out_channels; ++oc) {
+          qscale_values[oc] = 100.f + oc;
+          bias_values[oc] = 0.1f * oc - 0.5f;
+          for (dim_t i = 0; i < group_in_channels * kernel_size; ++i) {
+            const dim_t index = oc * group_in_channels * kernel_size + i;
+            qweight_values[index] = static_cast<int8_t>((index * 37) % 255 - 127);
+            weight_values[index] = qweight_values[index] / qscale_values[oc];
+          }
+        }
+
+        const Shape weight_shape{out_channels, group_in_channels, kernel_size};
+        const StorageView qweight(weight_shape, qweight_values);
+        const StorageView weight(weight_shape, weight_values);
+        const StorageView qscale({out_channels}, qscale_values);
+        const StorageView bias({out_channels}, bias_values);
+
+        StorageView expected = naive_conv1d(input, weight, bias, stride, padding, groups);
+        ops::GELU()(expected, expected);
+
+        // The weights are only packed for the direct kernel. The GEMM path quantizes the
+        // input, so its error is larger.
+        const ops::Conv1D conv_op(stride, padding, 1, groups, &activation_type);
+        const StorageView packed_weight = conv_op.pack_weight(qweight, &qscale);
+        StorageView output;
+        conv_op(input, qweight, bias, output, &qscale);
+        expect_storage_eq(output, expected, packed_weight ? 1e-5 : 1e-1);
+
+        StorageView packed_output;
+        conv_op(input, qweight, bias, packed_output, &qscale,
+                packed_weight ? &packed_weight : nullptr);
+        expect_storage_eq(packed_output, output, 1e-6);
+
+        // The float weights run the direct kernel with AVX512 and the GEMM otherwise.
+        StorageView float_output;
+        conv_op(input, weight, bias, float_output, nullptr, nullptr);
+        expect_storage_eq(float_output, expected, 1e-5);
+      }
+    }
+  }
+}
+
 INSTANTIATE_TEST_SUITE_P(CPU, OpDeviceTest, ::testing::Values(Device::CPU));
 INSTANTIATE_TEST_SUITE_P(CPU, OpDeviceFPTest,
                          ::testing::Values(FloatType{Device::CPU, DataType::FLOAT32, 1e-5}),
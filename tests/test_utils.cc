@@ -1,5 +1,9 @@
 #include "test_utils.h"
 
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
 extern std::string g_data_dir;
 
 const std::string& get_data_dir() {
@@ -9,3 +13,115 @@ const std::string& get_data_dir() {
 std::string default_model_dir() {
   return g_data_dir + "/models/v2/aren-transliteration";
 }
+
+static std::string read_file(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file)
+    throw std::runtime_error("Failed to open " + path);
+  std::ostringstream content;
+  content << file.rdbuf();
+  return content.str();
+}
+
+template <typename T>
+static T read_value(const std::string& data, size_t& offset) {
+  T value;
+  std::memcpy(&value, data.data() + offset, sizeof (T));
+  offset += sizeof (T);
+  return value;
+}
+
+template <typename T>
+static void write_value(std::string& data, const T& value) {
+  data.append(reinterpret_cast<const char*>(&value), sizeof (T));
+}
+
+static std::string read_string(const std::string& data, size_t& offset) {
+  const auto length = read_value<uint16_t>(data, offset);
+  std::string value(data.data() + offset);
+  offset += length;
+  return value;
+}
+
+static void write_string(std::string& data, const std::string& value) {
+  write_value<uint16_t>(data, value.size() + 1);
+  data.append(value.c_str(), value.size() + 1);
+}
+
+static void write_variable(std::string& data,
+                           const std::string& name,
+                           const StorageView& variable,
+                           const uint32_t binary_version) {
+  StorageView value = variable.to(Device::CPU);
+  // Before version 4, the type is deduced from the item size and 4 bytes mean float32.
+  if (binary_version < 4 && value.dtype() == DataType::INT32) {
+    const std::vector<int32_t> values = value.to_vector<int32_t>();
+    value = StorageView(value.shape(), std::vector<float>(values.begin(), values.end()));
+  }
+
+  const dim_t num_bytes = value.size() * value.item_size();
+  write_string(data, name);
+  write_value<uint8_t>(data, value.rank());
+  for (const dim_t dim : value.shape())
+    write_value<uint32_t>(data, dim);
+  if (binary_version >= 4) {
+    write_value<uint8_t>(data, static_cast<uint8_t>(value.dtype()));
+    write_value<uint32_t>(data, num_bytes);
+  } else {
+    write_value<uint8_t>(data, value.item_size());
+    write_value<uint32_t>(data, value.size());
+  }
+  data.append(static_cast<const char*>(value.buffer()), num_bytes);
+}
+
+// See the model serialization in python/ctranslate2/specs/model_spec.py.
+std::shared_ptr<const models::Model>
+load_default_model_with_variables(const std::unordered_map<std::string, StorageView>& variables) {
+  const std::string model_dir = default_model_dir();
+  const std::string model = read_file(model_dir + "/model.bin");
+
+  size_t offset = 0;
+  const auto binary_version = read_value<uint32_t>(model, offset);
+  read_string(model, offset);  // Spec name.
+  read_value<uint32_t>(model, offset);  // Spec revision.
+  const size_t header_size = offset;
+  const auto num_variables = read_value<uint32_t>(model, offset);
+
+  std::string saved_variables;
+  uint32_t num_saved_variables = 0;
+
+  for (uint32_t i = 0; i < num_variables; ++i) {
+    const size_t begin = offset;
+    const std::string name = read_string(model, offset);
+    const auto rank = read_value<uint8_t>(model, offset);
+    offset += rank * sizeof (uint32_t);
+    if (binary_version >= 4) {
+      read_value<uint8_t>(model, offset);  // Data type.
+      offset += read_value<uint32_t>(model, offset);
+    } else {
+      const auto item_size = read_value<uint8_t>(model, offset);
+      offset += read_value<uint32_t>(model, offset) * item_size;
+    }
+
+    if (variables.find(name) == variables.end()) {
+      saved_variables.append(model, begin, offset - begin);
+      num_saved_variables += 1;
+    }
+  }
+
+  for (const auto& pair : variables) {
+    write_variable(saved_variables, pair.first, pair.second, binary_version);
+    num_saved_variables += 1;
+  }
+
+  std::string new_model = model.substr(0, header_size);
+  write_value<uint32_t>(new_model, num_saved_variables);
+  new_model += saved_variables;
+  new_model += model.substr(offset);  // Aliases.
+
+  models::ModelMemoryReader reader(model_dir);
+  reader.register_file("model.bin", std::move(new_model));
+  for (const std::string filename : {"source_vocabulary.txt", "target_vocabulary.txt"})
+    reader.register_file(filename, read_file(model_dir + "/" + filename));
+  return models::Model::load(reader);
+}
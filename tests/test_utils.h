@@ -2,6 +2,7 @@
 
 #include <gtest/gtest.h>
 
+#include "ctranslate2/models/model.h"
 #include "ctranslate2/storage_view.h"
 
 #include "type_dispatch.h"
@@ -11,6 +12,10 @@ using namespace ctranslate2;
 const std::string& get_data_dir();
 std::string default_model_dir();
 
+// Loads the default model with variables added to the model or replacing existing ones.
+std::shared_ptr<const models::Model>
+load_default_model_with_variables(const std::unordered_map<std::string, StorageView>& variables);
+
 #define ASSERT_RAISES(STMT, EXCEPT)                     \
   do {                                                  \
     try {                                               \
@@ -1,8 +1,10 @@
 #include <ctranslate2/buffered_translation_wrapper.h>
 #include <ctranslate2/translator.h>
 #include <ctranslate2/decoding.h>
+#include <ctranslate2/random.h>
 
 #include <algorithm>
+#include <set>
 #include <unordered_set>
 
 #include "test_utils.h"
@@ -891,6 +893,30 @@ TEST(TranslatorTest, Patience) {
   EXPECT_EQ(result.num_hypotheses(), options.num_hypotheses);
 }
 
+TEST(TranslatorTest, DiverseBeamSearch) {
+  Translator translator = default_translator();
+  TranslationOptions options;
+  options.beam_size = 4;
+  options.num_beam_groups = 2;
+  options.diversity_penalty = 10;
+  options.num_hypotheses = 4;
+  options.return_scores = true;
+  const std::vector<std::string> input = {"آ" ,"ت" ,"ز" ,"م" ,"و" ,"ن"};
+  const auto result = translator.translate_batch({input, input}, options);
+  ASSERT_EQ(result.size(), 2);
+  ASSERT_EQ(result[0].num_hypotheses(), options.num_hypotheses);
+  EXPECT_EQ(result[0].hypotheses, result[1].hypotheses);
+  EXPECT_EQ(std::set<std::vector<std::string>>(result[0].hypotheses.begin(),
+                                               result[0].hypotheses.end()).size(),
+            options.num_hypotheses);
+  ASSERT_EQ(result[0].scores.size(), options.num_hypotheses);
+  for (size_t i = 1; i < result[0].scores.size(); ++i)
+    EXPECT_GE(result[0].scores[i - 1], result[0].scores[i]);
+
+  options.beam_size = 3;
+  EXPECT_THROW(translator.translate_batch({input}, options), std::invalid_argument);
+}
+
 TEST(TranslatorTest, IgnoreScore) {
   Translator translator = default_translator();
   TranslationOptions options;
@@ -983,3 +1009,205 @@ TEST(TranslatorTest, ScoringMaxInputLength) {
   EXPECT_EQ(result.tokens, (std::vector<std::string>{"a", "t", "z", "</s>"}));
   EXPECT_EQ(result.tokens_score.size(), options.max_input_length);
 }
+
+TEST(TranslatorTest, SpeculativeDecoding) {
+  const auto model = models::Model::load(default_model_dir(), Device::CPU);
+  Translator translator(model);
+  TranslationOptions options;
+  options.beam_size = 1;
+  options.return_scores = true;
+  const std::vector<std::vector<std::string>> inputs = {
+    {"آ", "ز", "ا"},
+    {"آ" ,"ت" ,"ز" ,"م" ,"و" ,"ن"}};
+  const std::vector<std::vector<std::string>> prefix = {{}, {"a", "t", "s"}};
+  const auto expected = translator.translate_batch(inputs, prefix, options);
+
+  // The model drafts for itself so all the draft tokens should be accepted.
+  options.draft_model = model;
+  options.num_speculative_tokens = 3;
+  const auto results = translator.translate_batch(inputs, prefix, options);
+  ASSERT_EQ(results.size(), expected.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].output(), expected[i].output());
+    EXPECT_NEAR(results[i].score(), expected[i].score(), 1e-4);
+    EXPECT_GT(results[i].num_draft_tokens, 0);
+    EXPECT_EQ(results[i].num_accepted_draft_tokens, results[i].num_draft_tokens);
+  }
+
+  options.sampling_topk = 0;
+  options.sampling_temperature = 0.8;
+  const auto sampled = translator.translate_batch(inputs, options);
+  for (const auto& result : sampled) {
+    EXPECT_FALSE(result.output().empty());
+    EXPECT_EQ(result.num_accepted_draft_tokens, result.num_draft_tokens);
+  }
+}
+
+TEST(TranslatorTest, PromptLookupDecoding) {
+  Translator translator(default_model_dir());
+  TranslationOptions options;
+  options.beam_size = 1;
+  options.return_scores = true;
+  const std::vector<std::vector<std::string>> inputs = {
+    {"آ", "ز", "ا"},
+    {"آ" ,"ت" ,"ز" ,"م" ,"و" ,"ن"}};
+  const auto expected = translator.translate_batch(inputs, options);
+
+  options.prompt_lookup_ngram_size = 2;
+  const auto results = translator.translate_batch(inputs, options);
+  ASSERT_EQ(results.size(), expected.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].output(), expected[i].output());
+    EXPECT_NEAR(results[i].score(), expected[i].score(), 1e-4);
+    EXPECT_LE(results[i].num_accepted_draft_tokens, results[i].num_draft_tokens);
+  }
+
+  options.draft_model = models::Model::load(default_model_dir(), Device::CPU);
+  EXPECT_THROW(translator.translate_batch(inputs, options), std::invalid_argument);
+}
+
+TEST(TranslatorTest, SpeculativeDecodingPerBatchAcceptance) {
+  const auto model = models::Model::load(default_model_dir(), Device::CPU);
+  Translator translator(model);
+  TranslationOptions options;
+  options.beam_size = 1;
+  options.return_scores = true;
+  options.min_decoding_length = 10;
+  const std::vector<std::vector<std::string>> inputs = {
+    {"آ", "ت", "ز", "م", "و", "ن", "آ", "ت", "ز", "م", "و", "ن", "آ", "ت", "ز", "م", "و", "ن"},
+    {"آ", "ز", "ا"},
+    {"آ" ,"ت" ,"ش" ,"ي" ,"س" ,"و" ,"ن", "آ" ,"ت" ,"ش" ,"ي" ,"س" ,"و" ,"ن"}};
+  const auto expected = translator.translate_batch(inputs, options);
+
+  // The draft model ignores the minimum length, so its tokens are rejected for the short
+  // example. The other examples should still accept all their draft tokens.
+  options.draft_model = model;
+  const auto results = translator.translate_batch(inputs, options);
+  ASSERT_EQ(results.size(), expected.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].output(), expected[i].output());
+    EXPECT_NEAR(results[i].score(), expected[i].score(), 1e-4);
+  }
+  EXPECT_LT(results[1].num_accepted_draft_tokens, results[1].num_draft_tokens);
+  EXPECT_EQ(results[0].num_accepted_draft_tokens, results[0].num_draft_tokens);
+  EXPECT_EQ(results[2].num_accepted_draft_tokens, results[2].num_draft_tokens);
+
+  options.draft_model.reset();
+  options.prompt_lookup_ngram_size = 2;
+  const auto lookup_results = translator.translate_batch(inputs, options);
+  for (size_t i = 0; i < lookup_results.size(); ++i) {
+    EXPECT_EQ(lookup_results[i].output(), expected[i].output());
+    EXPECT_NEAR(lookup_results[i].score(), expected[i].score(), 1e-4);
+  }
+}
+
+TEST(TranslatorTest, CacheEncoderOutput) {
+  const auto model = models::Model::load(default_model_dir(), Device::CPU);
+  const auto& encoder_cache = dynamic_cast<const models::SequenceToSequenceModel&>(*model)
+    .get_encoder_cache();
+  Translator translator(model);
+  TranslationOptions options;
+  options.return_scores = true;
+  const std::vector<std::vector<std::string>> inputs = {
+    {"آ", "ز", "ا"},
+    {"آ" ,"ت" ,"ز" ,"م" ,"و" ,"ن"},
+    {"آ" ,"ت" ,"ش" ,"ي" ,"س" ,"و" ,"ن"}};
+  const auto expected = translator.translate_batch(inputs, options);
+
+  options.cache_encoder_output = true;
+  translator.translate_batch({inputs[1]}, options);
+  EXPECT_EQ(encoder_cache.get_stats().num_entries, 1);
+
+  // The batch mixes cached and new encoder outputs.
+  const auto results = translator.translate_batch(inputs, options);
+  ASSERT_EQ(results.size(), expected.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].output(), expected[i].output());
+    EXPECT_NEAR(results[i].score(), expected[i].score(), 1e-4);
+  }
+
+  const auto stats = encoder_cache.get_stats();
+  EXPECT_EQ(stats.num_entries, 3);
+  EXPECT_EQ(stats.num_hits, 1);
+}
+
+TEST(TranslatorTest, ResultCache) {
+  Translator translator(default_model_dir());
+  auto& cache = translator.get_result_cache();
+  cache.set_max_size(1 << 20);
+
+  TranslationOptions options;
+  options.return_scores = true;
+  const std::vector<std::vector<std::string>> inputs = {
+    {"آ", "ز", "ا"},
+    {"آ" ,"ت" ,"ز" ,"م" ,"و" ,"ن"},
+    {"آ" ,"ت" ,"ش" ,"ي" ,"س" ,"و" ,"ن"}};
+  const auto expected = translator.translate_batch(inputs, options);
+  EXPECT_EQ(cache.get_stats().num_entries, 3);
+  EXPECT_EQ(cache.get_stats().num_evictions, 0);
+
+  // The results are evicted when the cache exceeds its size in bytes.
+  cache.set_max_size(cache.get_stats().size_in_bytes - 1);
+  EXPECT_EQ(cache.get_stats().num_entries, 2);
+  EXPECT_EQ(cache.get_stats().num_evictions, 1);
+  EXPECT_LT(cache.get_stats().size_in_bytes, cache.max_size());
+
+  const auto results = translator.translate_batch(inputs, options);
+  ASSERT_EQ(results.size(), expected.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].output(), expected[i].output());
+    EXPECT_NEAR(results[i].score(), expected[i].score(), 1e-4);
+  }
+  EXPECT_GE(cache.get_stats().num_hits, 1);
+
+  // The options are part of the key.
+  options.beam_size = 1;
+  const auto num_hits = cache.get_stats().num_hits;
+  translator.translate_batch({inputs[0]}, options);
+  EXPECT_EQ(cache.get_stats().num_hits, num_hits);
+  translator.translate_batch({inputs[0]}, options);
+  EXPECT_EQ(cache.get_stats().num_hits, num_hits + 1);
+
+  // The speculative decoding options change the draft statistics.
+  options.prompt_lookup_ngram_size = 2;
+  translator.translate_batch({inputs[0]}, options);
+  EXPECT_EQ(cache.get_stats().num_hits, num_hits + 1);
+  options.num_speculative_tokens = 2;
+  translator.translate_batch({inputs[0]}, options);
+  EXPECT_EQ(cache.get_stats().num_hits, num_hits + 1);
+  const auto speculative_result = translator.translate_batch({inputs[0]}, options)[0];
+  EXPECT_EQ(cache.get_stats().num_hits, num_hits + 2);
+  EXPECT_EQ(speculative_result.output(), expected[0].output());
+
+  // Random sampling is not cached.
+  options.sampling_topk = 0;
+  const auto num_lookups = cache.get_stats().num_lookups;
+  translator.translate_batch({inputs[0]}, options);
+  EXPECT_EQ(cache.get_stats().num_lookups, num_lookups);
+}
+
+TEST(TranslatorTest, RandomSamplingMultipleHypotheses) {
+  // The encoder output is shared by the hypotheses of each example until they finish.
+  set_random_seed(42);
+  Translator translator(default_model_dir());
+  TranslationOptions options;
+  options.beam_size = 1;
+  options.sampling_topk = 0;
+  options.num_hypotheses = 4;
+  options.length_penalty = 0;
+  options.return_scores = true;
+  const std::vector<std::vector<std::string>> inputs = {
+    {"آ", "ز", "ا"},
+    {"آ" ,"ت" ,"ز" ,"م" ,"و" ,"ن"}};
+  const auto results = translator.translate_batch(inputs, options);
+  ASSERT_EQ(results.size(), inputs.size());
+
+  // The scores should match the scores of the sampled hypotheses.
+  for (size_t i = 0; i < results.size(); ++i) {
+    ASSERT_EQ(results[i].num_hypotheses(), options.num_hypotheses);
+    const std::vector<std::vector<std::string>> source(options.num_hypotheses, inputs[i]);
+    const auto scores = translator.score_batch(source, results[i].hypotheses);
+    for (size_t h = 0; h < options.num_hypotheses; ++h)
+      EXPECT_NEAR(scores[h].cumulated_score(), results[i].scores[h], 1e-3);
+  }
+}